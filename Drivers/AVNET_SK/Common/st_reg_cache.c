@@ -0,0 +1,216 @@
+#include "st_reg_cache.h"
+#include <string.h>
+
+// Registers the device changes itself, or that clear themselves, are never cached
+static const st_reg_range_t lsm6dsoVolatile[] = {
+	{ 0, LSM6DSO_WHO_AM_I, LSM6DSO_WHO_AM_I },						// so a failed probe is retried on the bus
+	{ 0, LSM6DSO_CTRL3_C, LSM6DSO_CTRL3_C },						// sw_reset and boot clear themselves
+	{ 0, LSM6DSO_ALL_INT_SRC, LSM6DSO_OUTZ_H_A },					// sources, status and output data
+	{ 0, LSM6DSO_EMB_FUNC_STATUS_MAINPAGE, LSM6DSO_FIFO_STATUS2 },
+	{ 0, LSM6DSO_TIMESTAMP0, LSM6DSO_TIMESTAMP3 },
+	{ 0, 0x49, 0x55 },												// UI_STATUS_REG_OIS to UI_OUTZ_H_A_OIS
+	{ 0, LSM6DSO_FIFO_DATA_OUT_TAG, LSM6DSO_FIFO_DATA_OUT_Z_H },
+	{ 1, LSM6DSO_SENSOR_HUB_1, LSM6DSO_SENSOR_HUB_1 + 17 },			// SENSOR_HUB_1 to SENSOR_HUB_18
+	{ 1, LSM6DSO_STATUS_MASTER, LSM6DSO_STATUS_MASTER },
+	{ 2, LSM6DSO_PAGE_ADDRESS, LSM6DSO_PAGE_VALUE },				// advanced page access
+	{ 2, LSM6DSO_EMB_FUNC_STATUS, LSM6DSO_PAGE_RW },
+	{ 2, LSM6DSO_FSM_LONG_COUNTER_L, LSM6DSO_FSM_OUTS16 },
+	{ 2, LSM6DSO_STEP_COUNTER_L, LSM6DSO_EMB_FUNC_INIT_B },
+};
+
+const st_reg_cache_device_t st_reg_cache_lsm6dso = {
+	.bankCount = 3,		// LSM6DSO_USER_BANK, LSM6DSO_SENSOR_HUB_BANK and LSM6DSO_EMBEDDED_FUNC_BANK
+	.bankReg = LSM6DSO_FUNC_CFG_ACCESS,
+	.bankShift = 6,
+	.resetReg = LSM6DSO_CTRL3_C,
+	.resetMask = 0x81,	// boot and sw_reset
+	.volatileRegs = lsm6dsoVolatile,
+	.volatileCount = sizeof(lsm6dsoVolatile) / sizeof(lsm6dsoVolatile[0]) };
+
+static const st_reg_range_t lps22hhVolatile[] = {
+	{ 0, LPS22HH_WHO_AM_I, LPS22HH_WHO_AM_I },
+	{ 0, LPS22HH_CTRL_REG2, LPS22HH_CTRL_REG2 },					// boot, swreset and one_shot clear themselves
+	{ 0, LPS22HH_REF_P_L, LPS22HH_REF_P_H },						// set by autozero
+	{ 0, LPS22HH_INT_SOURCE, LPS22HH_TEMP_OUT_H },					// sources, status and output data
+	{ 0, LPS22HH_FIFO_DATA_OUT_PRESS_XL, LPS22HH_FIFO_DATA_OUT_TEMP_H },
+};
+
+const st_reg_cache_device_t st_reg_cache_lps22hh = {
+	.bankCount = 1,
+	.resetReg = LPS22HH_CTRL_REG2,
+	.resetMask = 0x84,	// boot and swreset
+	.volatileRegs = lps22hhVolatile,
+	.volatileCount = sizeof(lps22hhVolatile) / sizeof(lps22hhVolatile[0]) };
+
+
+static bool is_bank_reg(st_reg_cache_t* cache, unsigned reg)
+{
+	return cache->device->bankCount > 1 && reg == cache->device->bankReg;
+}
+
+static bool is_cacheable(st_reg_cache_t* cache, unsigned reg)
+{
+	if (cache->bank < 0 || reg >= ST_REG_CACHE_REGS || is_bank_reg(cache, reg))
+	{
+		return false;
+	}
+
+	for (uint8_t i = 0; i < cache->device->volatileCount; i++)
+	{
+		const st_reg_range_t* range = &cache->device->volatileRegs[i];
+		if (range->bank == cache->bank && reg >= range->first && reg <= range->last)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool is_valid(st_reg_cache_t* cache, unsigned reg)
+{
+	return (cache->valid[cache->bank][reg / 8] & (1U << (reg % 8))) != 0;
+}
+
+static void store(st_reg_cache_t* cache, unsigned reg, uint8_t value)
+{
+	cache->value[cache->bank][reg] = value;
+	cache->valid[cache->bank][reg / 8] |= (uint8_t)(1U << (reg % 8));
+}
+
+static void forget(st_reg_cache_t* cache, unsigned reg)
+{
+	cache->valid[cache->bank][reg / 8] &= (uint8_t)~(1U << (reg % 8));
+}
+
+static void set_bank(st_reg_cache_t* cache, uint8_t value)
+{
+	int bank = value >> cache->device->bankShift;
+
+	cache->bankValue = value;
+	cache->bank = bank < cache->device->bankCount ? bank : -1;
+}
+
+
+static int32_t cached_read(void* handle, uint8_t reg, uint8_t* data, uint16_t len)
+{
+	st_reg_cache_t* cache = (st_reg_cache_t*)handle;
+	bool cached = len > 0;
+	int32_t ret;
+
+	if (len == 1 && is_bank_reg(cache, reg) && cache->bank >= 0)
+	{
+		data[0] = cache->bankValue;
+		cache->hits++;
+		return 0;
+	}
+
+	for (unsigned i = 0; i < len && cached; i++)
+	{
+		cached = is_cacheable(cache, reg + i) && is_valid(cache, reg + i);
+	}
+
+	if (cached)
+	{
+		memcpy(data, &cache->value[cache->bank][reg], len);
+		cache->hits++;
+		return 0;
+	}
+
+	ret = cache->read_reg(cache->handle, reg, data, len);
+	cache->busReads++;
+
+	if (ret == 0)
+	{
+		if (is_bank_reg(cache, reg))
+		{
+			set_bank(cache, data[0]);
+		}
+		for (unsigned i = 0; i < len; i++)
+		{
+			if (is_cacheable(cache, reg + i))
+			{
+				store(cache, reg + i, data[i]);
+			}
+		}
+	}
+
+	return ret;
+}
+
+
+static int32_t cached_write(void* handle, uint8_t reg, uint8_t* data, uint16_t len)
+{
+	st_reg_cache_t* cache = (st_reg_cache_t*)handle;
+	const st_reg_cache_device_t* device = cache->device;
+	int32_t ret;
+
+	ret = cache->write_reg(cache->handle, reg, data, len);
+	cache->busWrites++;
+
+	// A reset puts every register back to its default, and leaves the bank unknown until read
+	if (cache->bank <= 0 && reg <= device->resetReg && device->resetReg < reg + len &&
+		(data[device->resetReg - reg] & device->resetMask) != 0)
+	{
+		st_reg_cache_invalidate(cache);
+		return ret;
+	}
+
+	if (is_bank_reg(cache, reg))
+	{
+		if (ret == 0)
+		{
+			set_bank(cache, data[0]);
+		}
+		else
+		{
+			cache->bank = -1;
+		}
+		return ret;
+	}
+
+	for (unsigned i = 0; i < len; i++)
+	{
+		if (is_cacheable(cache, reg + i))
+		{
+			if (ret == 0)
+			{
+				store(cache, reg + i, data[i]);
+			}
+			else
+			{
+				forget(cache, reg + i);
+			}
+		}
+	}
+
+	return ret;
+}
+
+
+/// <summary>
+///     Route ctx through cache. From here on reads and writes made with ctx go through the
+///     cache to the read and write functions ctx had, with its handle
+/// </summary>
+void st_reg_cache_attach(st_reg_cache_t* cache, const st_reg_cache_device_t* device, stmdev_ctx_t* ctx)
+{
+	memset(cache, 0, sizeof(st_reg_cache_t));
+	cache->device = device;
+	cache->write_reg = ctx->write_reg;
+	cache->read_reg = ctx->read_reg;
+	cache->handle = ctx->handle;
+	st_reg_cache_invalidate(cache);
+
+	ctx->write_reg = cached_write;
+	ctx->read_reg = cached_read;
+	ctx->handle = cache;
+}
+
+
+/// <summary>
+///     Forget every cached register, for when the device may have changed behind the cache's back
+/// </summary>
+void st_reg_cache_invalidate(st_reg_cache_t* cache)
+{
+	memset(cache->valid, 0, sizeof(cache->valid));
+	cache->bank = cache->device->bankCount > 1 ? -1 : 0;
+}
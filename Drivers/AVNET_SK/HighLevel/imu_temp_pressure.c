@@ -1,4 +1,5 @@
 #include "imu_temp_pressure.h"
+#include "st_reg_cache.h"
 
 /*
  ******************************************************************************
@@ -94,9 +95,16 @@ static uint8_t whoamI, rst;
 
 //static uint8_t tx_buffer[1000];
 
-static int i2cHandle = -1;
+// The LSM6DSO runs at up to 1 MHz, the bus manager slows the bus for any slower device sharing it
+static LP_I2C_DEVICE imuDevice = {
+	.address = LSM6DSO_ADDRESS,
+	.maxSpeed = I2C_BUS_SPEED_FAST_PLUS,
+	.priority = LP_I2C_PRIORITY_NORMAL,
+	.name = "lsm6dso" };
 static stmdev_ctx_t dev_ctx;
 static stmdev_ctx_t pressure_ctx;
+static st_reg_cache_t imuCache;
+static st_reg_cache_t pressureCache;
 static bool lps22hhDetected;
 static bool initialized = false;
 
@@ -134,10 +142,10 @@ static int32_t platform_write(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
 	cmdBuffer[0] = reg;
 	memcpy(&cmdBuffer[1], bufp, (size_t)len);
 
-	int32_t retVal = I2CMaster_Write(*(int*)handle, LSM6DSO_ADDRESS, cmdBuffer, (size_t)(len + 1));
-	if (retVal != len + 1)
+	// The bus manager retries and logs failures
+	if (lp_i2cWrite((LP_I2C_DEVICE*)handle, cmdBuffer, (size_t)(len + 1)) < 0)
 	{
-		Log_Debug("ERROR: Expected return value to match count\n");
+		return -1;
 	}
 
 	return 0;
@@ -156,13 +164,23 @@ static int32_t platform_write(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
  */
 static int32_t platform_read(void* handle, uint8_t reg, uint8_t* bufp, uint16_t len)
 {
-	int32_t retVal = I2CMaster_WriteThenRead(*(int*)handle, LSM6DSO_ADDRESS, &reg, 1, bufp, (size_t)len);
-	if (retVal < 0)
+	ssize_t result;
+
+	// Reading these pops FIFO words or clears latched flags, so a retry would skip what the failed
+	// attempt already consumed. They are read once and the failure is passed up instead. The same
+	// addresses in the other register banks are harmless to read once as well
+	if ((reg >= LSM6DSO_ALL_INT_SRC && reg <= LSM6DSO_D6D_SRC) ||
+		(reg >= LSM6DSO_EMB_FUNC_STATUS_MAINPAGE && reg <= LSM6DSO_FIFO_STATUS2) ||
+		(reg >= LSM6DSO_FIFO_DATA_OUT_TAG && reg <= LSM6DSO_FIFO_DATA_OUT_Z_H))
 	{
-		Log_Debug("ERROR: Expected return value to match count\n");
+		result = lp_i2cWriteThenReadOnce((LP_I2C_DEVICE*)handle, &reg, 1, bufp, (size_t)len);
+	}
+	else
+	{
+		result = lp_i2cWriteThenRead((LP_I2C_DEVICE*)handle, &reg, 1, bufp, (size_t)len);
 	}
 
-	return 0;
+	return result < 0 ? -1 : 0;
 }
 
 
@@ -188,26 +206,10 @@ static void platform_delay(uint32_t ms)
  */
 static void platform_init(void)
 {
-	// IMPLEMENT
-	i2cHandle = I2CMaster_Open(I2cMaster2);
-	if (i2cHandle < 0)
+	// Opens the ISU if no other driver has, and negotiates its speed
+	if (!lp_i2cAttach(&imuDevice, I2cMaster2))
 	{
-		Log_Debug("ERROR: I2CMaster_Open: errno=%d (%s)\n", errno, strerror(errno));
-		return;
-	}
-
-	int result = I2CMaster_SetBusSpeed(i2cHandle, I2C_BUS_SPEED_STANDARD);
-	if (result != 0)
-	{
-		Log_Debug("ERROR: I2CMaster_SetBusSpeed: errno=%d (%s)\n", errno, strerror(errno));
-		return;
-	}
-
-	result = I2CMaster_SetTimeout(i2cHandle, 100);
-	if (result != 0)
-	{
-		Log_Debug("ERROR: I2CMaster_SetTimeout: errno=%d (%s)\n", errno, strerror(errno));
-		return;
+		Log_Debug("ERROR: lp_i2cAttach: errno=%d (%s)\n", errno, strerror(errno));
 	}
 }
 
@@ -323,31 +325,9 @@ AngularRateDegreesPerSecond lp_get_angular_rate(void)
 
 float lp_get_temperature_lps22h(void)	// get_temperature() from lsm6dso is faster
 {
-	lps22hh_reg_t lps22hhReg;
-	int16_t i16bit;
-	static float lps22hhTemperature_degC = NAN;
+	float temperature_degC, pressure_hPa;
 
-	if (!initialized)
-	{
-		return NAN;
-	}
-
-	if (lps22hhDetected)
-	{
-		i16bit = 0;
-
-		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t*)&lps22hhReg, 1);
-
-		//Read output only if new value is available
-
-		if ((lps22hhReg.status.p_da == 1) && (lps22hhReg.status.t_da == 1))
-		{
-			lps22hh_temperature_raw_get(&pressure_ctx, &i16bit);
-			lps22hhTemperature_degC = lps22hh_from_lsb_to_celsius(i16bit);
-		}
-		return lps22hhTemperature_degC;
-	}
-	return NAN;
+	return lp_read_environment(&temperature_degC, &pressure_hPa) ? temperature_degC : NAN;
 }
 
 
@@ -377,94 +357,372 @@ float lp_get_temperature(void)
 
 float lp_get_pressure(void)
 {
-	lps22hh_reg_t lps22hhReg;
+	float temperature_degC, pressure_hPa;
+
+	return lp_read_environment(&temperature_degC, &pressure_hPa) ? pressure_hPa : NAN;
+}
+
+
+/*
+ * Environment reads through the sensor hub.
+ *
+ * The LPS22HH is not on our bus, it hangs off the LSM6DSO's sensor hub. Reading it in pass
+ * through mode reconfigures the hub, starts the accelerometer to trigger it and polls for the
+ * result, some sixty bus transactions and two 20 ms waits for each register block. So
+ * once the LPS22HH is found, slave 0 of the hub is left reading LPS22HH_STATUS through
+ * LPS22HH_TEMP_OUT_H on every accelerometer sample, and the hub mirrors those six bytes into
+ * its SENSOR_HUB_1 registers. lp_read_environment takes the status and both readings from the
+ * mirror in one burst read.
+ */
+
+#define ENVIRONMENT_MIRROR_SIZE (LPS22HH_TEMP_OUT_H - LPS22HH_STATUS + 1)
+
+static bool environmentReady = false;
+
+
+static bool start_environment_mirror(void)
+{
+	lsm6dso_sh_cfg_read_t sh_cfg_read;
+
+	// The hub is triggered by the accelerometer, stop it while slave 0 is reconfigured
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_OFF);
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_DISABLE);
+
+	sh_cfg_read.slv_add = (LPS22HH_I2C_ADD_L & 0xFEU) >> 1; /* 7bit I2C address */
+	sh_cfg_read.slv_subadd = LPS22HH_STATUS;
+	sh_cfg_read.slv_len = ENVIRONMENT_MIRROR_SIZE;
+
+	if (lsm6dso_sh_slv0_cfg_read(&dev_ctx, &sh_cfg_read) != 0)
+	{
+		return false;
+	}
+
+	lsm6dso_sh_slave_connected_set(&dev_ctx, LSM6DSO_SLV_0);
+
+	// A little faster than the LPS22HH's 10 Hz so no conversion is missed, whatever rate the
+	// accelerometer runs at above 12.5 Hz
+	lsm6dso_sh_data_rate_set(&dev_ctx, LSM6DSO_SH_ODR_13Hz);
+
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_ENABLE);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_12Hz5);
+
+	environmentReady = false;
+
+	return true;
+}
+
+
+bool lp_read_environment(float* temperature_degC, float* pressure_hPa)
+{
+	uint8_t mirror[ENVIRONMENT_MIRROR_SIZE];
+	lps22hh_status_t status;
 	uint32_t ui32bit;
-	static float pressure_hPa = NAN;
+	int16_t i16bit;
 
-	if (!initialized)
+	if (!initialized || !lps22hhDetected)
 	{
-		return NAN;
+		return false;
 	}
 
-	if (lps22hhDetected)
+	if (lsm6dso_sh_read_data_raw_get(&dev_ctx, mirror, ENVIRONMENT_MIRROR_SIZE) != 0)
 	{
-		ui32bit = 0;
+		return false;
+	}
 
-		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t*)&lps22hhReg, 1);
+	// The data registers keep the latest conversion whether or not the hub read that fetched
+	// them saw it arrive, so the status only says whether there has been one yet
+	memcpy(&status, &mirror[0], 1);
+	if ((status.p_da == 1) && (status.t_da == 1))
+	{
+		environmentReady = true;
+	}
 
-		//Read output only if new value is available
+	if (!environmentReady)
+	{
+		return false;
+	}
 
-		if ((lps22hhReg.status.p_da == 1) && (lps22hhReg.status.t_da == 1))
-		{
-			lps22hh_pressure_raw_get(&pressure_ctx, &ui32bit);
-			pressure_hPa = lps22hh_from_lsb_to_hpa(ui32bit);
-		}
-		return pressure_hPa;
+	ui32bit = mirror[LPS22HH_PRESS_OUT_H - LPS22HH_STATUS];
+	ui32bit = (ui32bit * 256) + mirror[LPS22HH_PRESS_OUT_L - LPS22HH_STATUS];
+	ui32bit = (ui32bit * 256) + mirror[LPS22HH_PRESS_OUT_XL - LPS22HH_STATUS];
+	ui32bit *= 256;
+	*pressure_hPa = lps22hh_from_lsb_to_hpa(ui32bit);
+
+	i16bit = (int16_t)((mirror[LPS22HH_TEMP_OUT_H - LPS22HH_STATUS] << 8) | mirror[LPS22HH_TEMP_OUT_L - LPS22HH_STATUS]);
+	*temperature_degC = lps22hh_from_lsb_to_celsius(i16bit);
+
+	return true;
+}
+
+
+/*
+ * FIFO acquisition.
+ *
+ * Rather than polling the data ready flags and reading each sample, the LSM6DSO batches the
+ * accelerometer and gyroscope at 104 Hz into its FIFO, each pair tagged with a timestamp.
+ * Once the watermark is reached lp_imu_fifo_read drains it in one burst read, the FIFO output
+ * registers roll back from FIFO_DATA_OUT_Z_H to FIFO_DATA_OUT_TAG so consecutive words come
+ * out of a single transaction. That is two bus transactions per block, the status and the
+ * burst, instead of four per sample.
+ */
+
+#define FIFO_WORD_SIZE 7			// tag and six data bytes
+#define FIFO_WORDS_PER_SAMPLE 3		// accelerometer, gyroscope and timestamp
+#define TIMESTAMP_US_PER_LSB 25
+
+static uint8_t fifoBuffer[LP_IMU_FIFO_MAX_SAMPLES * FIFO_WORDS_PER_SAMPLE * FIFO_WORD_SIZE];
+static ImuSample fifoSample;	// kept across reads, a burst can end halfway through a sample
+static bool fifoHasAcceleration, fifoHasAngularRate;
+static bool fifoRunning = false;
+
+
+bool lp_imu_fifo_start(uint16_t watermarkSamples)
+{
+	if (!initialized || watermarkSamples == 0 || watermarkSamples > LP_IMU_FIFO_MAX_SAMPLES)
+	{
+		return false;
 	}
-	return NAN;
+
+	// Bypass mode empties the FIFO
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+
+	lsm6dso_fifo_watermark_set(&dev_ctx, (uint16_t)(watermarkSamples * FIFO_WORDS_PER_SAMPLE));
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, LSM6DSO_XL_BATCHED_AT_104Hz);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, LSM6DSO_GY_BATCHED_AT_104Hz);
+	lsm6dso_fifo_timestamp_decimation_set(&dev_ctx, LSM6DSO_DEC_1);
+	lsm6dso_timestamp_set(&dev_ctx, PROPERTY_ENABLE);
+
+	// The accelerometer also triggers the sensor hub reading the LPS22HH, which keeps its own 13 Hz
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_104Hz);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_104Hz);
+
+	fifoHasAcceleration = fifoHasAngularRate = false;
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_STREAM_MODE);
+	fifoRunning = true;
+
+	return true;
 }
 
 
-void lp_calibrate_angular_rate(void)
+void lp_imu_fifo_stop(void)
 {
-	if (!initialized)
+	if (!fifoRunning)
 	{
 		return;
 	}
 
-	// Read the raw angular rate data from the device to use as offsets.  We're making the assumption that the device
-	// is stationary.
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, LSM6DSO_XL_NOT_BATCHED);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, LSM6DSO_GY_NOT_BATCHED);
+	lsm6dso_fifo_timestamp_decimation_set(&dev_ctx, LSM6DSO_NO_DECIMATION);
 
-	uint8_t reg;
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_12Hz5);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_12Hz5);
 
-	Log_Debug("LSM6DSO: Calibrating angular rate . . .\n");
-	Log_Debug("LSM6DSO: Please make sure the device is stationary.\n");
+	fifoRunning = false;
+}
 
-	do
+
+size_t lp_imu_fifo_read(ImuSampleBlock* block)
+{
+	uint8_t status[2];
+	lsm6dso_fifo_status2_t status2;
+	uint16_t words;
+	axis3bit16_t raw;
+
+	block->count = 0;
+	block->overrun = false;
+
+	if (!fifoRunning)
 	{
+		return 0;
+	}
 
-		// Delay and read the device until we have data!
-		do
+	// FIFO_STATUS1 and FIFO_STATUS2 in one read
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_FIFO_STATUS1, status, 2) != 0)
+	{
+		return 0;
+	}
+	memcpy(&status2, &status[1], 1);
+	if (!status2.fifo_wtm_ia)
+	{
+		return 0;
+	}
+
+	block->overrun = status2.fifo_ovr_ia;
+	words = (uint16_t)(status[0] | (status2.diff_fifo << 8));
+	if (words > sizeof(fifoBuffer) / FIFO_WORD_SIZE)
+	{
+		words = sizeof(fifoBuffer) / FIFO_WORD_SIZE;
+	}
+
+	// What a failed burst took out of the FIFO is lost, and with it the sample it was halfway through
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_FIFO_DATA_OUT_TAG, fifoBuffer, (uint16_t)(words * FIFO_WORD_SIZE)) != 0)
+	{
+		fifoHasAcceleration = fifoHasAngularRate = false;
+		return 0;
+	}
+
+	for (uint16_t i = 0; i < words; i++)
+	{
+		uint8_t* word = &fifoBuffer[i * FIFO_WORD_SIZE];
+		uint32_t timestamp;
+
+		memcpy(raw.u8bit, &word[1], sizeof(raw.u8bit));
+
+		switch (word[0] >> 3)
+		{
+		case LSM6DSO_TIMESTAMP_TAG:
+			memcpy(&timestamp, &word[1], sizeof(timestamp));
+			fifoSample.timestamp_us = timestamp * TIMESTAMP_US_PER_LSB;
+			break;
+		case LSM6DSO_XL_NC_TAG:
+			fifoSample.acceleration.x = lsm6dso_from_fs2_to_mg(raw.i16bit[0]);
+			fifoSample.acceleration.y = lsm6dso_from_fs2_to_mg(raw.i16bit[1]);
+			fifoSample.acceleration.z = lsm6dso_from_fs2_to_mg(raw.i16bit[2]);
+			fifoHasAcceleration = true;
+			break;
+		case LSM6DSO_GYRO_NC_TAG:
+			fifoSample.angularRate.x = lsm6dso_from_fs2000_to_mdps(raw.i16bit[0] - raw_angular_rate_calibration.i16bit[0]) / 1000.0f;
+			fifoSample.angularRate.y = lsm6dso_from_fs2000_to_mdps(raw.i16bit[1] - raw_angular_rate_calibration.i16bit[1]) / 1000.0f;
+			fifoSample.angularRate.z = lsm6dso_from_fs2000_to_mdps(raw.i16bit[2] - raw_angular_rate_calibration.i16bit[2]) / 1000.0f;
+			fifoHasAngularRate = true;
+			break;
+		default:
+			break;
+		}
+
+		if (fifoHasAcceleration && fifoHasAngularRate && block->count < LP_IMU_FIFO_MAX_SAMPLES)
 		{
-			// Read the calibration values
-			platform_delay(500);
-			lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-		} while (!reg);
+			block->samples[block->count++] = fifoSample;
+			fifoHasAcceleration = fifoHasAngularRate = false;
+		}
+	}
 
+	return block->count;
+}
+
+
+// Waits for gyro data, polling the data ready flag every 500 ms up to polls times, 0 for no limit
+static bool wait_angular_rate_ready(unsigned int polls)
+{
+	uint8_t reg = 0;
+
+	for (unsigned int poll = 0; polls == 0 || poll < polls; poll++)
+	{
+		platform_delay(500);
+		lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
 		if (reg)
 		{
-			// Read angular rate field data to use for calibration offsets
-			memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-			lsm6dso_angular_rate_raw_get(&dev_ctx, raw_angular_rate_calibration.u8bit);
+			return true;
 		}
+	}
+	return false;
+}
 
-		// Delay and read the device until we have data!
-		do
+// Reads the angular rate of the stationary device into calibration, until a second read with the
+// offsets applied gives 0 angular rate in all directions. Gives up after attempts, 0 for no limit
+static bool calibrate_angular_rate(axis3bit16_t* calibration, unsigned int attempts, unsigned int polls)
+{
+	axis3bit16_t raw;
+	AngularRateDegreesPerSecond rate;
+
+	for (unsigned int attempt = 0; attempts == 0 || attempt < attempts; attempt++)
+	{
+		// Read angular rate field data to use for calibration offsets
+		if (!wait_angular_rate_ready(polls))
 		{
-			// Read the calibration values
-			platform_delay(500);
-			lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-		} while (!reg);
+			return false;
+		}
+		lsm6dso_angular_rate_raw_get(&dev_ctx, calibration->u8bit);
 
-		// Read the angular data rate again and verify that after applying the calibration, we have 0 angular rate in all directions
-		if (reg)
+		// Read the angular data rate again and verify the calibration
+		if (!wait_angular_rate_ready(polls))
 		{
-			// Read angular rate field data
-			memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-			lsm6dso_angular_rate_raw_get(&dev_ctx, data_raw_angular_rate.u8bit);
-
-			// Before we store the mdps values subtract the calibration data we captured at startup.
-			angularRateDps.x = lsm6dso_from_fs2000_to_mdps((int16_t)(data_raw_angular_rate.i16bit[0] - (int)raw_angular_rate_calibration.i16bit[0]));
-			angularRateDps.y = lsm6dso_from_fs2000_to_mdps((int16_t)(data_raw_angular_rate.i16bit[1] - raw_angular_rate_calibration.i16bit[1]));
-			angularRateDps.z = lsm6dso_from_fs2000_to_mdps((int16_t)(data_raw_angular_rate.i16bit[2] - raw_angular_rate_calibration.i16bit[2]));
+			return false;
 		}
+		memset(raw.u8bit, 0x00, 3 * sizeof(int16_t));
+		lsm6dso_angular_rate_raw_get(&dev_ctx, raw.u8bit);
+
+		rate.x = lsm6dso_from_fs2000_to_mdps((int16_t)(raw.i16bit[0] - (int)calibration->i16bit[0]));
+		rate.y = lsm6dso_from_fs2000_to_mdps((int16_t)(raw.i16bit[1] - calibration->i16bit[1]));
+		rate.z = lsm6dso_from_fs2000_to_mdps((int16_t)(raw.i16bit[2] - calibration->i16bit[2]));
 
 		// If the angular values after applying the offset are not all 0.0s, then do it again!
-	} while ((angularRateDps.x != 0.0) || (angularRateDps.y != 0.0) || (angularRateDps.z != 0.0));
+		if (rate.x == 0.0 && rate.y == 0.0 && rate.z == 0.0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void lp_calibrate_angular_rate(void)
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+	// Read the raw angular rate data from the device to use as offsets.  We're making the assumption that the device
+	// is stationary.
+
+	Log_Debug("LSM6DSO: Calibrating angular rate . . .\n");
+	Log_Debug("LSM6DSO: Please make sure the device is stationary.\n");
+
+	calibrate_angular_rate(&raw_angular_rate_calibration, 0, 0);
+	angularRateDps.x = angularRateDps.y = angularRateDps.z = 0.0f;
 
 	Log_Debug("LSM6DSO: Calibrating angular rate complete!\n");
 }
 
+// Written by the worker, copied to raw_angular_rate_calibration only if calibration succeeds
+static axis3bit16_t asyncCalibration;
+static void (*calibrateComplete)(bool ok) = NULL;
+
+static bool CalibrateAngularRateWork(void* context)
+{
+	return calibrate_angular_rate(&asyncCalibration, LP_CALIBRATE_ATTEMPTS, LP_CALIBRATE_POLLS);
+}
+
+static void CalibrateAngularRateComplete(void* context, LP_WORK_RESULT result)
+{
+	if (result == LP_WORK_OK)
+	{
+		raw_angular_rate_calibration = asyncCalibration;
+	}
+	Log_Debug("LSM6DSO: Calibrating angular rate %s\n", result == LP_WORK_OK ? "complete!" : "failed");
+	if (calibrateComplete != NULL)
+	{
+		calibrateComplete(result == LP_WORK_OK);
+	}
+}
+
+static LP_WORK calibrateWork = {
+	.run = CalibrateAngularRateWork,
+	.complete = CalibrateAngularRateComplete,
+	.timeout = { 30, 0 },
+	.name = "calibrateAngularRate" };
+
+/// <summary>
+///     Calibrates the gyro on a worker thread, so the 500 ms data ready polls do not block the
+///     event loop. complete runs on the event loop thread. The driver is not thread safe, so
+///     while the pool is in use, read the IMU only through it, with lp_readTelemetryAsync.
+///     Returns false if the IMU is not initialized or a calibration is still busy
+/// </summary>
+bool lp_calibrate_angular_rate_async(void (*complete)(bool ok))
+{
+	if (!initialized || !lp_workerPoolStart(1) || lp_workerBusy(&calibrateWork))
+	{
+		return false;
+	}
+
+	Log_Debug("LSM6DSO: Calibrating angular rate, please make sure the device is stationary.\n");
+	calibrateComplete = complete;
+
+	return lp_workerSubmit(&calibrateWork);
+}
+
 
 static void detect_lps22hh(void)
 {
@@ -515,6 +773,12 @@ static void detect_lps22hh(void)
 			break;
 		}
 	}
+
+	// From here on the LPS22HH is only read through the sensor hub mirror
+	if (lps22hhDetected && !start_environment_mirror())
+	{
+		lps22hhDetected = false;
+	}
 }
 
 
@@ -525,12 +789,16 @@ void lp_imu_initialize(void)
 	/* Initialize mems driver interface */
 	dev_ctx.write_reg = platform_write;
 	dev_ctx.read_reg = platform_read;
-	dev_ctx.handle = &i2cHandle;
+	dev_ctx.handle = &imuDevice;
 
 	// Initialize lps22hh mems driver interface
 	pressure_ctx.read_reg = lsm6dso_read_lps22hh_cx;
 	pressure_ctx.write_reg = lsm6dso_write_lps22hh_cx;
-	pressure_ctx.handle = &i2cHandle;
+	pressure_ctx.handle = &imuDevice;
+
+	// Setters read the registers they change from a shadow copy, so only their writes reach the bus
+	st_reg_cache_attach(&imuCache, &st_reg_cache_lsm6dso, &dev_ctx);
+	st_reg_cache_attach(&pressureCache, &st_reg_cache_lps22hh, &pressure_ctx);
 
 	/* Init test platform */
 	platform_init();
@@ -587,33 +855,19 @@ void lp_imu_initialize(void)
 
 
 /// <summary>
-///     Closes a file descriptor and prints an error on failure.
+///     Detaches from the I2C bus, which is closed once no other driver is using it.
 /// </summary>
-/// <param name="fd">File descriptor to close</param>
-/// <param name="fdName">File descriptor name to use in error message</param>
-static void CloseFdPrintError(int fd, const char* fdName)
+void lp_imu_close(void)
 {
-	if (initialized && fd >= 0)
+	if (initialized)
 	{
-		int result = close(fd);
-		if (result != 0)
-		{
-			Log_Debug("ERROR: Could not close fd %s: %s (%d).\n", fdName, strerror(errno), errno);
-		}
+		lp_i2cLogStats(&imuDevice);
 	}
+	lp_i2cDetach(&imuDevice);
 	initialized = false;
 }
 
 
-/// <summary>
-///     Closes the I2C interface File Descriptors.
-/// </summary>
-void lp_imu_close(void)
-{
-	CloseFdPrintError(i2cHandle, "i2c");
-}
-
-
 /*
  * @brief  Write lsm2mdl device register (used by configuration functions)
  *
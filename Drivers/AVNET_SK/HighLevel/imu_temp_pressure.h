@@ -1,6 +1,8 @@
 #pragma once
 
 #include "hw/azure_sphere_learning_path.h"
+#include "i2c_bus.h"
+#include "worker_pool.h"
 #include "lsm6dso_reg.h"
 #include "lps22hh_reg.h"
 #include <applibs/i2c.h>
@@ -14,6 +16,10 @@
 
 #define LSM6DSO_ADDRESS	   0x6A	  // I2C Address
 
+// lp_calibrate_angular_rate_async gives up after this many tries, each waiting up to LP_CALIBRATE_POLLS * 500 ms for data
+#define LP_CALIBRATE_ATTEMPTS 20
+#define LP_CALIBRATE_POLLS 4
+
 typedef struct
 {
 	float x;
@@ -28,11 +34,33 @@ typedef struct
 	float z;
 } AccelerationMilligForce;
 
+// FIFO acquisition, see lp_imu_fifo_start
+#define LP_IMU_FIFO_MAX_SAMPLES 32
+
+typedef struct
+{
+	uint32_t timestamp_us;	// LSM6DSO timestamp counter, wraps after 71 minutes
+	AccelerationMilligForce acceleration;
+	AngularRateDegreesPerSecond angularRate;
+} ImuSample;
+
+typedef struct
+{
+	size_t count;
+	bool overrun;			// the FIFO filled up and older samples were lost
+	ImuSample samples[LP_IMU_FIFO_MAX_SAMPLES];
+} ImuSampleBlock;
+
 void lp_imu_initialize(void);
 void lp_imu_close(void);
 float lp_get_temperature(void);
 float lp_get_pressure(void);
 float lp_get_temperature_lps22h(void);	// get_temperature() from lsm6dso is faster
+bool lp_read_environment(float* temperature_degC, float* pressure_hPa);	// one read for both, false until the first conversion
 void lp_calibrate_angular_rate(void);
+bool lp_calibrate_angular_rate_async(void (*complete)(bool ok));	// on the worker pool, see worker_pool.h
 AngularRateDegreesPerSecond lp_get_angular_rate(void);
 AccelerationMilligForce lp_get_acceleration(void);
+bool lp_imu_fifo_start(uint16_t watermarkSamples);	// watermarkSamples up to LP_IMU_FIFO_MAX_SAMPLES
+void lp_imu_fifo_stop(void);
+size_t lp_imu_fifo_read(ImuSampleBlock* block);	// 0 until the watermark is reached
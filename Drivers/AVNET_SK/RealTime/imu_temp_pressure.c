@@ -1,4 +1,5 @@
 #include "imu_temp_pressure.h"
+#include "st_reg_cache.h"
 
 /*
  ******************************************************************************
@@ -64,7 +65,7 @@ Acknowledgment: Built from ST Micro samples
 // 1 tick = 10ms. It is configurable.
 #define MS_TO_TICK(ms)  ((ms) * (TX_TIMER_TICKS_PER_SECOND) / 1000)
 
-#define I2C_MAX_LEN 64
+#define I2C_MAX_LEN 672	// the largest FIFO burst, LP_IMU_FIFO_MAX_SAMPLES of three words
 static uint8_t i2c_tx_buf[I2C_MAX_LEN];
 static uint8_t i2c_rx_buf[I2C_MAX_LEN];
 
@@ -106,6 +107,8 @@ static uint8_t whoamI, rst;
 // static int i2cHandle = -1;
 static stmdev_ctx_t dev_ctx;
 static stmdev_ctx_t pressure_ctx;
+static st_reg_cache_t imuCache;
+static st_reg_cache_t pressureCache;
 static bool lps22hhDetected;
 static bool initialized = false;
 
@@ -151,7 +154,8 @@ static int32_t platform_write(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
 		memcpy(&i2c_tx_buf[1], bufp, len);
 	}
 
-	mtk_os_hal_i2c_write(*(int*)handle, LSM6DSO_ADDRESS, i2c_tx_buf, len + 1);
+	if (mtk_os_hal_i2c_write(*(int*)handle, LSM6DSO_ADDRESS, i2c_tx_buf, len + 1) < 0)
+		return -1;
 
 	return 0;
 }
@@ -175,8 +179,9 @@ static int32_t platform_read(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
 	if (len > (I2C_MAX_LEN))
 		return -1;
 
-	mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
-		&reg, i2c_rx_buf, 1, len);
+	if (mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
+		&reg, i2c_rx_buf, 1, len) < 0)
+		return -1;
 
 	memcpy(bufp, i2c_rx_buf, len);
 
@@ -328,31 +333,9 @@ AngularRateDegreesPerSecond lp_get_angular_rate(void)
 
 float lp_get_temperature_lps22h(void)	// get_temperature() from lsm6dso is faster
 {
-	lps22hh_reg_t lps22hhReg;
-	int16_t i16bit;
-	static float lps22hhTemperature_degC = NAN;
+	float temperature_degC, pressure_hPa;
 
-	if (!initialized)
-	{
-		return NAN;
-	}
-
-	if (lps22hhDetected)
-	{
-		i16bit = 0;
-
-		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t*)&lps22hhReg, 1);
-
-		//Read output only if new value is available
-
-		if ((lps22hhReg.status.p_da == 1) && (lps22hhReg.status.t_da == 1))
-		{
-			lps22hh_temperature_raw_get(&pressure_ctx, &i16bit);
-			lps22hhTemperature_degC = lps22hh_from_lsb_to_celsius(i16bit);
-		}
-		return lps22hhTemperature_degC;
-	}
-	return NAN;
+	return lp_read_environment(&temperature_degC, &pressure_hPa) ? temperature_degC : NAN;
 }
 
 
@@ -382,31 +365,249 @@ float lp_get_temperature(void)
 
 float lp_get_pressure(void)
 {
-	lps22hh_reg_t lps22hhReg;
+	float temperature_degC, pressure_hPa;
+
+	return lp_read_environment(&temperature_degC, &pressure_hPa) ? pressure_hPa : NAN;
+}
+
+
+/*
+ * Environment reads through the sensor hub.
+ *
+ * The LPS22HH is not on our bus, it hangs off the LSM6DSO's sensor hub. Reading it in pass
+ * through mode reconfigures the hub, starts the accelerometer to trigger it and polls for the
+ * result, some sixty bus transactions and two 20 ms waits for each register block. So
+ * once the LPS22HH is found, slave 0 of the hub is left reading LPS22HH_STATUS through
+ * LPS22HH_TEMP_OUT_H on every accelerometer sample, and the hub mirrors those six bytes into
+ * its SENSOR_HUB_1 registers. lp_read_environment takes the status and both readings from the
+ * mirror in one burst read.
+ */
+
+#define ENVIRONMENT_MIRROR_SIZE (LPS22HH_TEMP_OUT_H - LPS22HH_STATUS + 1)
+
+static bool environmentReady = false;
+
+
+static bool start_environment_mirror(void)
+{
+	lsm6dso_sh_cfg_read_t sh_cfg_read;
+
+	// The hub is triggered by the accelerometer, stop it while slave 0 is reconfigured
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_OFF);
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_DISABLE);
+
+	sh_cfg_read.slv_add = (LPS22HH_I2C_ADD_L & 0xFEU) >> 1; /* 7bit I2C address */
+	sh_cfg_read.slv_subadd = LPS22HH_STATUS;
+	sh_cfg_read.slv_len = ENVIRONMENT_MIRROR_SIZE;
+
+	if (lsm6dso_sh_slv0_cfg_read(&dev_ctx, &sh_cfg_read) != 0)
+	{
+		return false;
+	}
+
+	lsm6dso_sh_slave_connected_set(&dev_ctx, LSM6DSO_SLV_0);
+
+	// A little faster than the LPS22HH's 10 Hz so no conversion is missed, whatever rate the
+	// accelerometer runs at above 12.5 Hz
+	lsm6dso_sh_data_rate_set(&dev_ctx, LSM6DSO_SH_ODR_13Hz);
+
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_ENABLE);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_12Hz5);
+
+	environmentReady = false;
+
+	return true;
+}
+
+
+bool lp_read_environment(float* temperature_degC, float* pressure_hPa)
+{
+	uint8_t mirror[ENVIRONMENT_MIRROR_SIZE];
+	lps22hh_status_t status;
 	uint32_t ui32bit;
-	static float pressure_hPa = NAN;
+	int16_t i16bit;
 
-	if (!initialized)
+	if (!initialized || !lps22hhDetected)
 	{
-		return NAN;
+		return false;
+	}
+
+	if (lsm6dso_sh_read_data_raw_get(&dev_ctx, mirror, ENVIRONMENT_MIRROR_SIZE) != 0)
+	{
+		return false;
+	}
+
+	// The data registers keep the latest conversion whether or not the hub read that fetched
+	// them saw it arrive, so the status only says whether there has been one yet
+	memcpy(&status, &mirror[0], 1);
+	if ((status.p_da == 1) && (status.t_da == 1))
+	{
+		environmentReady = true;
+	}
+
+	if (!environmentReady)
+	{
+		return false;
+	}
+
+	ui32bit = mirror[LPS22HH_PRESS_OUT_H - LPS22HH_STATUS];
+	ui32bit = (ui32bit * 256) + mirror[LPS22HH_PRESS_OUT_L - LPS22HH_STATUS];
+	ui32bit = (ui32bit * 256) + mirror[LPS22HH_PRESS_OUT_XL - LPS22HH_STATUS];
+	ui32bit *= 256;
+	*pressure_hPa = lps22hh_from_lsb_to_hpa(ui32bit);
+
+	i16bit = (int16_t)((mirror[LPS22HH_TEMP_OUT_H - LPS22HH_STATUS] << 8) | mirror[LPS22HH_TEMP_OUT_L - LPS22HH_STATUS]);
+	*temperature_degC = lps22hh_from_lsb_to_celsius(i16bit);
+
+	return true;
+}
+
+
+/*
+ * FIFO acquisition.
+ *
+ * Rather than polling the data ready flags and reading each sample, the LSM6DSO batches the
+ * accelerometer and gyroscope at 104 Hz into its FIFO, each pair tagged with a timestamp.
+ * Once the watermark is reached lp_imu_fifo_read drains it in one burst read, the FIFO output
+ * registers roll back from FIFO_DATA_OUT_Z_H to FIFO_DATA_OUT_TAG so consecutive words come
+ * out of a single transaction. That is two bus transactions per block, the status and the
+ * burst, instead of four per sample.
+ */
+
+#define FIFO_WORD_SIZE 7			// tag and six data bytes
+#define FIFO_WORDS_PER_SAMPLE 3		// accelerometer, gyroscope and timestamp
+#define TIMESTAMP_US_PER_LSB 25
+
+static uint8_t fifoBuffer[LP_IMU_FIFO_MAX_SAMPLES * FIFO_WORDS_PER_SAMPLE * FIFO_WORD_SIZE];
+static ImuSample fifoSample;	// kept across reads, a burst can end halfway through a sample
+static bool fifoHasAcceleration, fifoHasAngularRate;
+static bool fifoRunning = false;
+
+
+bool lp_imu_fifo_start(uint16_t watermarkSamples)
+{
+	if (!initialized || watermarkSamples == 0 || watermarkSamples > LP_IMU_FIFO_MAX_SAMPLES)
+	{
+		return false;
 	}
 
-	if (lps22hhDetected)
+	// Bypass mode empties the FIFO
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+
+	lsm6dso_fifo_watermark_set(&dev_ctx, (uint16_t)(watermarkSamples * FIFO_WORDS_PER_SAMPLE));
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, LSM6DSO_XL_BATCHED_AT_104Hz);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, LSM6DSO_GY_BATCHED_AT_104Hz);
+	lsm6dso_fifo_timestamp_decimation_set(&dev_ctx, LSM6DSO_DEC_1);
+	lsm6dso_timestamp_set(&dev_ctx, PROPERTY_ENABLE);
+
+	// The accelerometer also triggers the sensor hub reading the LPS22HH, which keeps its own 13 Hz
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_104Hz);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_104Hz);
+
+	fifoHasAcceleration = fifoHasAngularRate = false;
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_STREAM_MODE);
+	fifoRunning = true;
+
+	return true;
+}
+
+
+void lp_imu_fifo_stop(void)
+{
+	if (!fifoRunning)
 	{
-		ui32bit = 0;
+		return;
+	}
+
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, LSM6DSO_XL_NOT_BATCHED);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, LSM6DSO_GY_NOT_BATCHED);
+	lsm6dso_fifo_timestamp_decimation_set(&dev_ctx, LSM6DSO_NO_DECIMATION);
 
-		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t*)&lps22hhReg, 1);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_12Hz5);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_12Hz5);
+
+	fifoRunning = false;
+}
 
-		//Read output only if new value is available
 
-		if ((lps22hhReg.status.p_da == 1) && (lps22hhReg.status.t_da == 1))
+size_t lp_imu_fifo_read(ImuSampleBlock* block)
+{
+	uint8_t status[2];
+	lsm6dso_fifo_status2_t status2;
+	uint16_t words;
+	axis3bit16_t raw;
+
+	block->count = 0;
+	block->overrun = false;
+
+	if (!fifoRunning)
+	{
+		return 0;
+	}
+
+	// FIFO_STATUS1 and FIFO_STATUS2 in one read
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_FIFO_STATUS1, status, 2) != 0)
+	{
+		return 0;
+	}
+	memcpy(&status2, &status[1], 1);
+	if (!status2.fifo_wtm_ia)
+	{
+		return 0;
+	}
+
+	block->overrun = status2.fifo_ovr_ia;
+	words = (uint16_t)(status[0] | (status2.diff_fifo << 8));
+	if (words > sizeof(fifoBuffer) / FIFO_WORD_SIZE)
+	{
+		words = sizeof(fifoBuffer) / FIFO_WORD_SIZE;
+	}
+
+	// What a failed burst took out of the FIFO is lost, and with it the sample it was halfway through
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_FIFO_DATA_OUT_TAG, fifoBuffer, (uint16_t)(words * FIFO_WORD_SIZE)) != 0)
+	{
+		fifoHasAcceleration = fifoHasAngularRate = false;
+		return 0;
+	}
+
+	for (uint16_t i = 0; i < words; i++)
+	{
+		uint8_t* word = &fifoBuffer[i * FIFO_WORD_SIZE];
+		uint32_t timestamp;
+
+		memcpy(raw.u8bit, &word[1], sizeof(raw.u8bit));
+
+		switch (word[0] >> 3)
+		{
+		case LSM6DSO_TIMESTAMP_TAG:
+			memcpy(&timestamp, &word[1], sizeof(timestamp));
+			fifoSample.timestamp_us = timestamp * TIMESTAMP_US_PER_LSB;
+			break;
+		case LSM6DSO_XL_NC_TAG:
+			fifoSample.acceleration.x = lsm6dso_from_fs2_to_mg(raw.i16bit[0]);
+			fifoSample.acceleration.y = lsm6dso_from_fs2_to_mg(raw.i16bit[1]);
+			fifoSample.acceleration.z = lsm6dso_from_fs2_to_mg(raw.i16bit[2]);
+			fifoHasAcceleration = true;
+			break;
+		case LSM6DSO_GYRO_NC_TAG:
+			fifoSample.angularRate.x = lsm6dso_from_fs2000_to_mdps(raw.i16bit[0] - raw_angular_rate_calibration.i16bit[0]) / 1000.0f;
+			fifoSample.angularRate.y = lsm6dso_from_fs2000_to_mdps(raw.i16bit[1] - raw_angular_rate_calibration.i16bit[1]) / 1000.0f;
+			fifoSample.angularRate.z = lsm6dso_from_fs2000_to_mdps(raw.i16bit[2] - raw_angular_rate_calibration.i16bit[2]) / 1000.0f;
+			fifoHasAngularRate = true;
+			break;
+		default:
+			break;
+		}
+
+		if (fifoHasAcceleration && fifoHasAngularRate && block->count < LP_IMU_FIFO_MAX_SAMPLES)
 		{
-			lps22hh_pressure_raw_get(&pressure_ctx, &ui32bit);
-			pressure_hPa = lps22hh_from_lsb_to_hpa(ui32bit);
+			block->samples[block->count++] = fifoSample;
+			fifoHasAcceleration = fifoHasAngularRate = false;
 		}
-		return pressure_hPa;
 	}
-	return NAN;
+
+	return block->count;
 }
 
 
@@ -520,6 +721,12 @@ static void detect_lps22hh(void)
 			break;
 		}
 	}
+
+	// From here on the LPS22HH is only read through the sensor hub mirror
+	if (lps22hhDetected && !start_environment_mirror())
+	{
+		lps22hhDetected = false;
+	}
 }
 
 
@@ -537,6 +744,10 @@ bool lp_imu_initialize(void)
 	pressure_ctx.write_reg = lsm6dso_write_lps22hh_cx;
 	pressure_ctx.handle = &i2cHandle;
 
+	// Setters read the registers they change from a shadow copy, so only their writes reach the bus
+	st_reg_cache_attach(&imuCache, &st_reg_cache_lsm6dso, &dev_ctx);
+	st_reg_cache_attach(&pressureCache, &st_reg_cache_lps22hh, &pressure_ctx);
+
 	/* Init test platform */
 	platform_init();
 
@@ -29,11 +29,32 @@ typedef struct
 	float z;
 } AccelerationMilligForce;
 
+// FIFO acquisition, see lp_imu_fifo_start
+#define LP_IMU_FIFO_MAX_SAMPLES 32
+
+typedef struct
+{
+	uint32_t timestamp_us;	// LSM6DSO timestamp counter, wraps after 71 minutes
+	AccelerationMilligForce acceleration;
+	AngularRateDegreesPerSecond angularRate;
+} ImuSample;
+
+typedef struct
+{
+	size_t count;
+	bool overrun;			// the FIFO filled up and older samples were lost
+	ImuSample samples[LP_IMU_FIFO_MAX_SAMPLES];
+} ImuSampleBlock;
+
 bool lp_imu_initialize(void);
 void lp_imu_close(void);
 float lp_get_temperature(void);
 float lp_get_pressure(void);
 float lp_get_temperature_lps22h(void);	// get_temperature() from lsm6dso is faster
+bool lp_read_environment(float* temperature_degC, float* pressure_hPa);	// one read for both, false until the first conversion
 void lp_calibrate_angular_rate(void);
 AngularRateDegreesPerSecond lp_get_angular_rate(void);
 AccelerationMilligForce lp_get_acceleration(void);
+bool lp_imu_fifo_start(uint16_t watermarkSamples);	// watermarkSamples up to LP_IMU_FIFO_MAX_SAMPLES
+void lp_imu_fifo_stop(void);
+size_t lp_imu_fifo_read(ImuSampleBlock* block);	// 0 until the watermark is reached
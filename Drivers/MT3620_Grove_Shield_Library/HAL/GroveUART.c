@@ -1,5 +1,6 @@
 #include "GroveUART.h"
 #include <unistd.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -21,11 +22,14 @@ void GroveUART_Write(int fd, const uint8_t* data, int dataSize)
 
 bool GroveUART_Read(int fd, uint8_t* data, int dataSize)
 {
+	struct pollfd uartPoll = { .fd = fd, .events = POLLIN };
 	int totalReadSize = 0;
 	do
 	{
+		// Give up if the shield stops answering, rather than waiting for ever
+		if (poll(&uartPoll, 1, GROVE_UART_READ_TIMEOUT_MS) <= 0) return false;
 		int readSize = read(fd, &data[totalReadSize], (size_t)(dataSize - totalReadSize));
-		if (readSize < 0) return false;
+		if (readSize <= 0) return false;
 		totalReadSize += readSize;
 	} while (totalReadSize < dataSize);
 
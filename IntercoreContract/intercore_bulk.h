@@ -0,0 +1,160 @@
+#pragma once
+
+#include "intercore_ring.h"
+
+/*
+ * Bulk sample frames.
+ *
+ * For streams such as raw IMU data, one message per sample would cost a doorbell and a
+ * socket read each. A bulk frame instead packs as many fixed size samples as fit in the
+ * largest message the high-level app can receive. It starts with an LP_IC_BULK_HEADER, whose
+ * magic tells it apart from versioned messages and legacy blocks, followed by count samples.
+ *
+ * The real-time app stages samples with lp_icBulkAppend, which copies the frame into the ring
+ * once it is full. The high-level app hands the frame to its consumer in place, see
+ * lp_interCoreBulkEnable. Frames carry a sequence number so the consumer can see drops.
+ */
+
+#define LP_IC_BULK_MAGIC 0xB0C5	// never a legacy cmd value or LP_IC_MAGIC
+#define LP_IC_BULK_VERSION 1
+#define LP_IC_BULK_MAX_FRAME 1024	// largest message the high-level app can receive
+
+typedef enum
+{
+	LP_IC_BULK_UNKNOWN,
+	LP_IC_BULK_IMU	// LP_IC_IMU_SAMPLE
+} LP_IC_BULK_TYPE;
+
+typedef struct __attribute__((packed))
+{
+	uint16_t magic;
+	uint8_t version;
+	uint8_t type;			// LP_IC_BULK_TYPE
+	uint16_t sequence;		// frame number, a gap means frames were dropped
+	uint16_t count;			// samples following the header
+	uint16_t sampleSize;	// samples may grow at the end, readers use the fields they know
+	uint16_t reserved;
+} LP_IC_BULK_HEADER;
+
+typedef struct __attribute__((packed))
+{
+	uint32_t timestamp_us;	// real-time core clock, wraps after 71 minutes
+	int16_t acceleration[3];	// raw LSM6DSO output, scaled by the configured full scale
+	int16_t angularRate[3];
+} LP_IC_IMU_SAMPLE;
+
+_Static_assert(sizeof(LP_IC_BULK_HEADER) == 12, "LP_IC_BULK_HEADER must be 12 bytes on both cores");
+_Static_assert(sizeof(LP_IC_IMU_SAMPLE) == 16, "LP_IC_IMU_SAMPLE must be 16 bytes on both cores");
+
+#define LP_IC_BULK_CAPACITY(sampleSize) ((LP_IC_BULK_MAX_FRAME - sizeof(LP_IC_BULK_HEADER)) / (sampleSize))
+
+/// <summary>
+///     Check a received message is a complete bulk frame of this version, and return its header
+/// </summary>
+static inline bool lp_icBulkParse(const uint8_t *buffer, size_t length, LP_IC_BULK_HEADER *header)
+{
+	if (length < sizeof(LP_IC_BULK_HEADER))
+	{
+		return false;
+	}
+
+	memcpy(header, buffer, sizeof(LP_IC_BULK_HEADER));
+	return header->magic == LP_IC_BULK_MAGIC && header->version == LP_IC_BULK_VERSION && header->sampleSize != 0 &&
+		   sizeof(LP_IC_BULK_HEADER) + (size_t)header->count * header->sampleSize <= length;
+}
+
+static inline bool lp_icIsBulkFrame(const uint8_t *buffer, size_t length)
+{
+	uint16_t magic;
+
+	if (length < sizeof(LP_IC_BULK_HEADER))
+	{
+		return false;
+	}
+	memcpy(&magic, buffer, sizeof(magic));
+	return magic == LP_IC_BULK_MAGIC;
+}
+
+typedef struct
+{
+	LP_IC_RING *ring;
+	const uint8_t *componentHeader;	// echoed at the start of every block for the high-level app
+	uint32_t componentHeaderSize;
+	uint16_t sampleSize;
+	uint16_t capacity;
+	LP_IC_BULK_HEADER header;
+	uint8_t samples[LP_IC_BULK_MAX_FRAME - sizeof(LP_IC_BULK_HEADER)];
+	// Counters
+	uint32_t framesSent;
+	uint32_t framesDropped;	// the ring was full
+	uint32_t samplesSent;
+} LP_IC_BULK_WRITER;
+
+static inline void lp_icBulkInit(LP_IC_BULK_WRITER *writer, LP_IC_RING *ring, const uint8_t *componentHeader,
+								 uint32_t componentHeaderSize, LP_IC_BULK_TYPE type, uint16_t sampleSize)
+{
+	memset(writer, 0, sizeof(LP_IC_BULK_WRITER));
+	writer->ring = ring;
+	writer->componentHeader = componentHeader;
+	writer->componentHeaderSize = componentHeaderSize;
+	writer->sampleSize = sampleSize;
+	writer->capacity = (uint16_t)LP_IC_BULK_CAPACITY(sampleSize);
+	writer->header.magic = LP_IC_BULK_MAGIC;
+	writer->header.version = LP_IC_BULK_VERSION;
+	writer->header.type = (uint8_t)type;
+	writer->header.sampleSize = sampleSize;
+}
+
+/// <summary>
+///     Copy the staged samples into the ring as one frame and ring the doorbell. The frame is
+///     dropped and counted if the ring is full, the sequence still moves on so the high-level
+///     app sees the gap. Returns false if there was nothing to send or the frame was dropped
+/// </summary>
+static inline bool lp_icBulkFlush(LP_IC_BULK_WRITER *writer)
+{
+	uint32_t headerSize = writer->componentHeaderSize;
+	uint32_t samplesSize = (uint32_t)writer->header.count * writer->sampleSize;
+	uint32_t length = headerSize + sizeof(LP_IC_BULK_HEADER) + samplesSize;
+	uint8_t *block;
+
+	if (writer->header.count == 0)
+	{
+		return false;
+	}
+
+	block = lp_icRingReserve(writer->ring, length);
+	if (block != NULL)
+	{
+		memcpy(block, writer->componentHeader, headerSize);
+		memcpy(&block[headerSize], &writer->header, sizeof(LP_IC_BULK_HEADER));
+		memcpy(&block[headerSize + sizeof(LP_IC_BULK_HEADER)], writer->samples, samplesSize);
+		lp_icRingCommit(writer->ring, length);
+		lp_icRingFlushWrites(writer->ring);
+
+		writer->framesSent++;
+		writer->samplesSent += writer->header.count;
+	}
+	else
+	{
+		writer->framesDropped++;
+	}
+
+	writer->header.sequence++;
+	writer->header.count = 0;
+
+	return block != NULL;
+}
+
+/// <summary>
+///     Stage one sample of sampleSize bytes. Returns true when the frame is full and should be
+///     sent with lp_icBulkFlush, which the caller does so it can take the ring lock first
+/// </summary>
+static inline bool lp_icBulkAppend(LP_IC_BULK_WRITER *writer, const void *sample)
+{
+	if (writer->header.count < writer->capacity)
+	{
+		memcpy(&writer->samples[(uint32_t)writer->header.count * writer->sampleSize], sample, writer->sampleSize);
+		writer->header.count++;
+	}
+	return writer->header.count == writer->capacity;
+}
@@ -1,12 +1,30 @@
 #pragma once
 
-typedef enum 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef enum
 {
 	LP_IC_UNKNOWN,
 	LP_IC_HEARTBEAT,
 	LP_IC_ENVIRONMENT_SENSOR,
+	LP_IC_EVENT_BUTTON_A,
+	LP_IC_EVENT_BUTTON_B,
+	LP_IC_SET_DESIRED_TEMPERATURE,
+	LP_IC_BLINK_RATE,
+	LP_IC_INTERCORE_STATS,
+	LP_IC_SENSOR_SUMMARY
 } LP_INTER_CORE_CMD;
 
+typedef enum
+{
+	LP_IC_SENSOR_TEMPERATURE,
+	LP_IC_SENSOR_PRESSURE,
+	LP_IC_SENSOR_HUMIDITY
+} LP_IC_SENSOR;
+
 typedef struct
 {
 	LP_INTER_CORE_CMD cmd;
@@ -14,3 +32,268 @@ typedef struct
 	float pressure;
 	float humidity;
 } LP_INTER_CORE_BLOCK;
+
+_Static_assert(sizeof(LP_INTER_CORE_BLOCK) == 16, "the legacy LP_INTER_CORE_BLOCK layout is fixed, add payloads to LP_IC_MESSAGE");
+
+/*
+ * A decoded command. Only the payload of cmd is valid, the others share its storage. The
+ * environment payload comes first and matches LP_INTER_CORE_BLOCK, the commands added since
+ * have fields the legacy block has no room for.
+ */
+typedef struct
+{
+	LP_INTER_CORE_CMD cmd;
+	union
+	{
+		// LP_IC_ENVIRONMENT_SENSOR and LP_IC_SET_DESIRED_TEMPERATURE
+		struct
+		{
+			float temperature;
+			float pressure;
+			float humidity;
+		};
+		// LP_IC_BLINK_RATE
+		int32_t blinkRate;
+		// LP_IC_INTERCORE_STATS, sent periodically by the real-time app
+		struct
+		{
+			uint32_t enqueued;
+			uint32_t dropped;
+			uint32_t coalesced;
+			uint32_t highWater;
+			uint32_t latencyMax_us;
+			uint32_t latencyAvg_us;
+			uint32_t rttMin_us;		// heartbeat round trips seen by the real-time app
+			uint32_t rttMax_us;
+			uint32_t rttAvg_us;
+		};
+		// LP_IC_HEARTBEAT, see intercore_link.h
+		struct
+		{
+			uint32_t heartbeatTime_us;	// sender's clock, echoed back unchanged
+			uint32_t linkEpoch;			// changes every time the sender starts
+			uint32_t heartbeatEcho;		// 0 for a heartbeat, 1 for the echo of one
+		};
+		// LP_IC_SENSOR_SUMMARY, one per sensor per window, see sensor_stats.h
+		struct
+		{
+			uint32_t sensor;			// LP_IC_SENSOR
+			uint32_t sampleCount;
+			uint32_t window_ms;
+			float mean;
+			float variance;
+			float minimum;
+			float maximum;
+			float percentile;			// estimated
+			uint32_t percentileRank;	// which percentile, 95 for the 95th
+		};
+	};
+} LP_IC_MESSAGE;
+
+/// <summary>
+///     Widen a legacy block into message
+/// </summary>
+static inline void lp_icFromBlock(const LP_INTER_CORE_BLOCK *block, LP_IC_MESSAGE *message)
+{
+	memset(message, 0, sizeof(LP_IC_MESSAGE));
+	message->cmd = block->cmd;
+	message->temperature = block->temperature;
+	message->pressure = block->pressure;
+	message->humidity = block->humidity;
+}
+
+/// <summary>
+///     Narrow message to a legacy block, which carries cmd and the environment payload only
+/// </summary>
+static inline void lp_icToBlock(const LP_IC_MESSAGE *message, LP_INTER_CORE_BLOCK *block)
+{
+	block->cmd = message->cmd;
+	block->temperature = message->temperature;
+	block->pressure = message->pressure;
+	block->humidity = message->humidity;
+}
+
+/// <summary>
+///     Whether cmd can be sent as a legacy block. The commands with payloads the block cannot
+///     carry are always sent as messages, which every receiver accepts
+/// </summary>
+static inline bool lp_icFitsBlock(LP_INTER_CORE_CMD cmd)
+{
+	switch (cmd)
+	{
+	case LP_IC_BLINK_RATE:
+	case LP_IC_INTERCORE_STATS:
+	case LP_IC_SENSOR_SUMMARY:
+		return false;
+	default:
+		return true;
+	}
+}
+
+/*
+ * Versioned message format.
+ *
+ * The legacy format ships the whole LP_INTER_CORE_BLOCK. A message instead starts with an
+ * LP_IC_HEADER and carries only the payload fields its command needs, as listed in the
+ * schema below, and is decoded into an LP_IC_MESSAGE. The encoders and decoders are generated from the schema, so the high-level
+ * inter_core.c and the real-time mt3620-intercore.c apps share one definition.
+ *
+ * Each command lists its payload as F(type, name), where name is the LP_IC_MESSAGE member it
+ * is read from and written to. To evolve a command, only append fields: a decoder
+ * zero fills fields an older sender did not send and ignores fields it does not know yet.
+ * Bump LP_IC_PROTOCOL_VERSION only for incompatible changes, decoders reject other versions.
+ */
+
+#define LP_IC_MAGIC 0xC1A5	// never a legacy cmd value, which tells the two formats apart
+#define LP_IC_PROTOCOL_VERSION 1
+#define LP_IC_MAX_PAYLOAD 48
+
+typedef struct __attribute__((packed))
+{
+	uint16_t magic;
+	uint8_t version;
+	uint8_t type;		// LP_INTER_CORE_CMD
+	uint16_t sequence;
+	uint16_t length;	// payload bytes following the header
+} LP_IC_HEADER;
+
+#define LP_IC_HEARTBEAT_FIELDS(F) F(uint32_t, heartbeatTime_us) F(uint32_t, linkEpoch) F(uint32_t, heartbeatEcho)
+#define LP_IC_ENVIRONMENT_SENSOR_FIELDS(F) F(float, temperature) F(float, pressure) F(float, humidity)
+#define LP_IC_EVENT_BUTTON_A_FIELDS(F)
+#define LP_IC_EVENT_BUTTON_B_FIELDS(F)
+#define LP_IC_SET_DESIRED_TEMPERATURE_FIELDS(F) F(float, temperature)
+#define LP_IC_BLINK_RATE_FIELDS(F) F(int32_t, blinkRate)
+#define LP_IC_INTERCORE_STATS_FIELDS(F) F(uint32_t, enqueued) F(uint32_t, dropped) F(uint32_t, coalesced) F(uint32_t, highWater) \
+	F(uint32_t, latencyMax_us) F(uint32_t, latencyAvg_us) F(uint32_t, rttMin_us) F(uint32_t, rttMax_us) F(uint32_t, rttAvg_us)
+#define LP_IC_SENSOR_SUMMARY_FIELDS(F) F(uint32_t, sensor) F(uint32_t, sampleCount) F(uint32_t, window_ms) F(float, mean) \
+	F(float, variance) F(float, minimum) F(float, maximum) F(float, percentile) F(uint32_t, percentileRank)
+
+#define LP_IC_SCHEMA(X)                  \
+	X(LP_IC_HEARTBEAT)                   \
+	X(LP_IC_ENVIRONMENT_SENSOR)          \
+	X(LP_IC_EVENT_BUTTON_A)              \
+	X(LP_IC_EVENT_BUTTON_B)              \
+	X(LP_IC_SET_DESIRED_TEMPERATURE)     \
+	X(LP_IC_BLINK_RATE)                  \
+	X(LP_IC_INTERCORE_STATS)             \
+	X(LP_IC_SENSOR_SUMMARY)
+
+#define LP_IC_MAX_MESSAGE (sizeof(LP_IC_HEADER) + LP_IC_MAX_PAYLOAD)
+
+// Generated payload sizes, LP_IC_<command>_SIZE
+#define LP_IC_FIELD_SIZE(type, name) + sizeof(type)
+#define LP_IC_PAYLOAD_SIZE(cmd) cmd##_SIZE = 0 cmd##_FIELDS(LP_IC_FIELD_SIZE),
+enum { LP_IC_SCHEMA(LP_IC_PAYLOAD_SIZE) };
+
+// Generated compile time checks that the wire format fits and matches LP_IC_MESSAGE
+#define LP_IC_FIELD_CHECK(type, name) \
+	_Static_assert(sizeof(((LP_IC_MESSAGE *)0)->name) == sizeof(type), "payload field " #name " does not match LP_IC_MESSAGE");
+#define LP_IC_PAYLOAD_CHECK(cmd) \
+	_Static_assert(cmd##_SIZE <= LP_IC_MAX_PAYLOAD, #cmd " payload is larger than LP_IC_MAX_PAYLOAD"); \
+	cmd##_FIELDS(LP_IC_FIELD_CHECK)
+_Static_assert(sizeof(LP_IC_HEADER) == 8, "LP_IC_HEADER must be 8 bytes on both cores");
+_Static_assert(sizeof(LP_INTER_CORE_BLOCK) <= LP_IC_MAX_MESSAGE, "a buffer sized for a message must also hold a legacy block");
+LP_IC_SCHEMA(LP_IC_PAYLOAD_CHECK)
+
+#define LP_IC_ENCODE_FIELD(type, name)                          \
+	{                                                           \
+		type value = (type)block->name;                         \
+		memcpy(&buffer[offset], &value, sizeof(value));         \
+		offset += sizeof(value);                                \
+	}
+#define LP_IC_ENCODE_CASE(cmd)                                  \
+	case cmd:                                                   \
+		if (size < offset + cmd##_SIZE) { return 0; }           \
+		cmd##_FIELDS(LP_IC_ENCODE_FIELD)                        \
+		break;
+
+#define LP_IC_DECODE_FIELD(type, name)                          \
+	if (offset + sizeof(type) <= length)                        \
+	{                                                           \
+		type value;                                             \
+		memcpy(&value, &buffer[offset], sizeof(value));         \
+		block->name = value;                                    \
+		offset += sizeof(value);                                \
+	}
+#define LP_IC_DECODE_CASE(cmd)                                  \
+	case cmd:                                                   \
+		cmd##_FIELDS(LP_IC_DECODE_FIELD)                        \
+		break;
+
+static inline bool lp_icIsMessage(const uint8_t *buffer, size_t length)
+{
+	uint16_t magic;
+
+	if (length < sizeof(LP_IC_HEADER))
+	{
+		return false;
+	}
+	memcpy(&magic, buffer, sizeof(magic));
+	return magic == LP_IC_MAGIC;
+}
+
+/// <summary>
+///     Encode the fields block->cmd needs into buffer. Returns the message length, or 0 if the
+///     command is unknown or buffer is too small
+/// </summary>
+static inline size_t lp_icEncode(const LP_IC_MESSAGE *block, uint16_t sequence, uint8_t *buffer, size_t size)
+{
+	size_t offset = sizeof(LP_IC_HEADER);
+	LP_IC_HEADER header = {.magic = LP_IC_MAGIC, .version = LP_IC_PROTOCOL_VERSION, .type = (uint8_t)block->cmd, .sequence = sequence};
+
+	if (size < offset)
+	{
+		return 0;
+	}
+
+	switch (block->cmd)
+	{
+		LP_IC_SCHEMA(LP_IC_ENCODE_CASE)
+	default:
+		return 0;
+	}
+
+	header.length = (uint16_t)(offset - sizeof(LP_IC_HEADER));
+	memcpy(buffer, &header, sizeof(header));
+
+	return offset;
+}
+
+/// <summary>
+///     Decode a message into block, fields the command does not carry are zeroed. Returns false
+///     for legacy blocks, other protocol versions, unknown commands and short messages
+/// </summary>
+static inline bool lp_icDecode(const uint8_t *buffer, size_t length, LP_IC_MESSAGE *block, uint16_t *sequence)
+{
+	LP_IC_HEADER header;
+	size_t offset = sizeof(LP_IC_HEADER);
+
+	if (!lp_icIsMessage(buffer, length))
+	{
+		return false;
+	}
+
+	memcpy(&header, buffer, sizeof(header));
+	if (header.version != LP_IC_PROTOCOL_VERSION || sizeof(LP_IC_HEADER) + header.length > length)
+	{
+		return false;
+	}
+	length = sizeof(LP_IC_HEADER) + header.length;
+
+	memset(block, 0, sizeof(LP_IC_MESSAGE));
+	block->cmd = (LP_INTER_CORE_CMD)header.type;
+
+	switch (block->cmd)
+	{
+		LP_IC_SCHEMA(LP_IC_DECODE_CASE)
+	default:
+		return false;
+	}
+
+	if (sequence != NULL)
+	{
+		*sequence = header.sequence;
+	}
+
+	return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "intercore_contract.h"
+
+/*
+ * Link monitor, shared by the high-level and real-time apps.
+ *
+ * Each side sends an LP_IC_HEARTBEAT at its own cadence, stamped with its own clock, and the
+ * other side echoes it back unchanged, so the round trip is measured on one clock. A side that
+ * gets no echo for missLimit heartbeats in a row takes the link down, any heartbeat or echo
+ * brings it back up. Heartbeats also carry the sender's epoch, which changes every time it
+ * starts, so a restarted peer is noticed even when no heartbeat was missed.
+ */
+
+typedef struct
+{
+	uint32_t epoch;			// ours
+	uint32_t peerEpoch;		// 0 until the peer's first heartbeat
+	bool peerRestarted;		// the peer's epoch changed, the caller clears it once it has resynced
+	bool up;
+	bool outstanding;		// a heartbeat is waiting for its echo
+	uint16_t sequence;		// of the outstanding heartbeat
+	uint32_t missed;		// heartbeats in a row without an echo
+	uint32_t linkDowns;
+	// Round trip times
+	uint32_t lastRtt_us;
+	uint32_t rttMin_us;
+	uint32_t rttMax_us;
+	uint64_t rttTotal_us;
+	uint32_t rttCount;
+} LP_IC_LINK;
+
+/// <summary>
+///     epoch should differ from one start to the next, and not be 0
+/// </summary>
+static inline void lp_icLinkInit(LP_IC_LINK *link, uint32_t epoch)
+{
+	memset(link, 0, sizeof(LP_IC_LINK));
+	link->epoch = epoch != 0 ? epoch : 1;
+	link->rttMin_us = UINT32_MAX;
+}
+
+/// <summary>
+///     Build the next heartbeat into block, to be sent as a versioned message with sequence.
+///     Counts a miss if the previous one was not echoed and takes the link down after missLimit
+///     misses in a row. Returns whether the link is up
+/// </summary>
+static inline bool lp_icLinkHeartbeat(LP_IC_LINK *link, LP_IC_MESSAGE *block, uint16_t sequence, uint32_t now_us, uint32_t missLimit)
+{
+	if (link->outstanding)
+	{
+		link->missed++;
+		if (link->up && link->missed >= missLimit)
+		{
+			link->up = false;
+			link->linkDowns++;
+		}
+	}
+
+	memset(block, 0, sizeof(LP_IC_MESSAGE));
+	block->cmd = LP_IC_HEARTBEAT;
+	block->heartbeatTime_us = now_us;
+	block->linkEpoch = link->epoch;
+	block->heartbeatEcho = 0;
+
+	link->outstanding = true;
+	link->sequence = sequence;
+
+	return link->up;
+}
+
+/// <summary>
+///     Turn a heartbeat from the peer into its echo in block, for the caller to send back with the
+///     same sequence, without tracking the link. Returns false for an echo, which is not answered
+/// </summary>
+static inline bool lp_icLinkEcho(const LP_IC_LINK *link, LP_IC_MESSAGE *block)
+{
+	if (block->heartbeatEcho != 0)
+	{
+		return false;
+	}
+
+	block->heartbeatEcho = 1;
+	block->linkEpoch = link->epoch;
+	return true;
+}
+
+/// <summary>
+///     Handle a received LP_IC_HEARTBEAT. An echo of our outstanding heartbeat records the round
+///     trip. A heartbeat from the peer is turned into its echo in block, and true is returned so
+///     the caller sends it back with the same sequence
+/// </summary>
+static inline bool lp_icLinkReceive(LP_IC_LINK *link, LP_IC_MESSAGE *block, uint16_t sequence, uint32_t now_us)
+{
+	// Heartbeats and echoes both carry the epoch of the side that sent them
+	if (block->linkEpoch != 0)
+	{
+		if (link->peerEpoch != 0 && link->peerEpoch != block->linkEpoch)
+		{
+			link->peerRestarted = true;
+		}
+		link->peerEpoch = block->linkEpoch;
+	}
+
+	link->up = true;
+
+	if (block->heartbeatEcho != 0)
+	{
+		if (link->outstanding && sequence == link->sequence)
+		{
+			uint32_t rtt_us = now_us - block->heartbeatTime_us;
+
+			link->outstanding = false;
+			link->missed = 0;
+			link->lastRtt_us = rtt_us;
+			link->rttTotal_us += rtt_us;
+			link->rttCount++;
+			if (rtt_us < link->rttMin_us)
+			{
+				link->rttMin_us = rtt_us;
+			}
+			if (rtt_us > link->rttMax_us)
+			{
+				link->rttMax_us = rtt_us;
+			}
+		}
+		return false;
+	}
+
+	return lp_icLinkEcho(link, block);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "intercore_contract.h"
+#include "intercore_ring.h"
+
+/*
+ * Real-time side backpressure for an intercore channel.
+ *
+ * Messages go straight into the ring while it has room. When it is full they wait in a small
+ * outbox, and the overflow policy decides what happens when the outbox fills up too. Blocks
+ * already in the ring are the high-level core's, so the policies only ever touch the outbox.
+ * Nothing here prints, the counters are reported with an LP_IC_INTERCORE_STATS message.
+ */
+
+#define LP_IC_OUTBOX_DEPTH 8
+
+typedef enum
+{
+	LP_IC_OVERFLOW_DROP_NEWEST,			// keep what is waiting, drop the new message
+	LP_IC_OVERFLOW_DROP_OLDEST_BY_TYPE,	// drop the oldest waiting message with the same command
+	LP_IC_OVERFLOW_COALESCE				// keep only the latest waiting message per command
+} LP_IC_OVERFLOW_POLICY;
+
+typedef struct
+{
+	uint32_t enqueued;	// written to the ring
+	uint32_t dropped;
+	uint32_t coalesced;	// replaced by a newer message with the same command
+	uint32_t highWater;	// most messages waiting in the outbox
+} LP_IC_CHANNEL_STATS;
+
+typedef struct
+{
+	LP_IC_MESSAGE block;
+	uint16_t sequence;
+	bool asMessage;
+} LP_IC_OUTBOX_ITEM;
+
+typedef struct
+{
+	LP_IC_RING *ring;
+	LP_IC_OVERFLOW_POLICY policy;
+	const uint8_t *componentHeader;	// echoed at the start of every block for the high-level app
+	uint32_t componentHeaderSize;
+	LP_IC_OUTBOX_ITEM items[LP_IC_OUTBOX_DEPTH];	// oldest first
+	uint32_t count;
+	LP_IC_CHANNEL_STATS stats;
+} LP_IC_OUTBOX;
+
+static inline void lp_icOutboxInit(LP_IC_OUTBOX *outbox, LP_IC_RING *ring, LP_IC_OVERFLOW_POLICY policy,
+								   const uint8_t *componentHeader, uint32_t componentHeaderSize)
+{
+	memset(outbox, 0, sizeof(LP_IC_OUTBOX));
+	outbox->ring = ring;
+	outbox->policy = policy;
+	outbox->componentHeader = componentHeader;
+	outbox->componentHeaderSize = componentHeaderSize;
+}
+
+// Encode straight into the ring, false if it is full
+static inline bool lp_icOutboxWrite(LP_IC_OUTBOX *outbox, const LP_IC_MESSAGE *block, uint16_t sequence, bool asMessage)
+{
+	uint32_t headerSize = outbox->componentHeaderSize;
+	uint32_t length;
+	uint8_t *buffer = lp_icRingReserve(outbox->ring, headerSize + LP_IC_MAX_MESSAGE);
+
+	if (buffer == NULL)
+	{
+		return false;
+	}
+
+	memcpy(buffer, outbox->componentHeader, headerSize);
+	if (asMessage || !lp_icFitsBlock(block->cmd))
+	{
+		length = (uint32_t)lp_icEncode(block, sequence, &buffer[headerSize], LP_IC_MAX_MESSAGE);
+	}
+	else
+	{
+		LP_INTER_CORE_BLOCK legacy;
+
+		lp_icToBlock(block, &legacy);
+		memcpy(&buffer[headerSize], &legacy, sizeof(legacy));
+		length = sizeof(legacy);
+	}
+
+	lp_icRingCommit(outbox->ring, headerSize + length);
+	outbox->stats.enqueued++;
+
+	return true;
+}
+
+static inline void lp_icOutboxRemove(LP_IC_OUTBOX *outbox, uint32_t index)
+{
+	memmove(&outbox->items[index], &outbox->items[index + 1], (outbox->count - index - 1) * sizeof(LP_IC_OUTBOX_ITEM));
+	outbox->count--;
+}
+
+/// <summary>
+///     Move waiting messages into the ring, oldest first, as far as there is room
+/// </summary>
+static inline void lp_icOutboxDrain(LP_IC_OUTBOX *outbox)
+{
+	while (outbox->count != 0 && lp_icOutboxWrite(outbox, &outbox->items[0].block, outbox->items[0].sequence, outbox->items[0].asMessage))
+	{
+		lp_icOutboxRemove(outbox, 0);
+	}
+}
+
+/// <summary>
+///     Queue block for the high-level app, encoded as a versioned message when asMessage is set
+///     or the command does not fit a legacy block.
+///     The ring is not flushed, call lp_icOutboxFlush once the batch is complete. Returns false
+///     if the overflow policy dropped the block
+/// </summary>
+static inline bool lp_icOutboxSend(LP_IC_OUTBOX *outbox, const LP_IC_MESSAGE *block, uint16_t sequence, bool asMessage)
+{
+	uint32_t index;
+
+	lp_icOutboxDrain(outbox);
+	if (outbox->count == 0 && lp_icOutboxWrite(outbox, block, sequence, asMessage))
+	{
+		return true;
+	}
+
+	if (outbox->policy == LP_IC_OVERFLOW_COALESCE)
+	{
+		for (index = 0; index < outbox->count; index++)
+		{
+			if (outbox->items[index].block.cmd == block->cmd)
+			{
+				lp_icOutboxRemove(outbox, index);
+				outbox->stats.coalesced++;
+				break;
+			}
+		}
+	}
+
+	if (outbox->count == LP_IC_OUTBOX_DEPTH)
+	{
+		if (outbox->policy != LP_IC_OVERFLOW_DROP_OLDEST_BY_TYPE)
+		{
+			outbox->stats.dropped++;
+			return false;
+		}
+
+		// The oldest message with the same command, or the oldest of all if there is none
+		index = 0;
+		while (index < outbox->count && outbox->items[index].block.cmd != block->cmd)
+		{
+			index++;
+		}
+		lp_icOutboxRemove(outbox, index < outbox->count ? index : 0);
+		outbox->stats.dropped++;
+	}
+
+	outbox->items[outbox->count].block = *block;
+	outbox->items[outbox->count].sequence = sequence;
+	outbox->items[outbox->count].asMessage = asMessage;
+	outbox->count++;
+
+	if (outbox->count > outbox->stats.highWater)
+	{
+		outbox->stats.highWater = outbox->count;
+	}
+
+	return true;
+}
+
+/// <summary>
+///     Drain what fits and publish it with a single doorbell
+/// </summary>
+static inline uint32_t lp_icOutboxFlush(LP_IC_OUTBOX *outbox)
+{
+	lp_icOutboxDrain(outbox);
+	return lp_icRingFlushWrites(outbox->ring);
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Single producer, single consumer ring over the intercore shared buffers.
+ *
+ * The layout is the one the Azure Sphere OS sets up and the high-level core reads: each
+ * buffer starts with an LP_IC_RING_HEADER followed by the data area, and every block is a
+ * 32 bit length followed by the payload, padded to LP_IC_RING_ALIGNMENT. The payload may wrap
+ * around the end of the data area, the length may not.
+ *
+ * Positions are published with release stores and read with acquire loads, so the other
+ * core never sees a position before the data it covers, and a block is not overwritten
+ * before the other core has finished reading it. A full barrier (DMB on the Cortex cores)
+ * separates the store from the doorbell, so the interrupt cannot overtake the position.
+ *
+ * Writers reserve space, build the message in place and commit it. Commits are private until
+ * lp_icRingFlushWrites publishes them and rings the doorbell, once for the whole batch. Reads
+ * work the same way with lp_icRingFlushReads. One context may write and one may read.
+ */
+
+#define LP_IC_RING_ALIGNMENT 16
+#define LP_IC_RING_BOUNCE_SIZE 1056	// largest block that can be reserved where the ring wraps, a full bulk frame with its component ID
+#define LP_IC_RING_SWINT_WRITE 0	// doorbell raised after publishing writes
+#define LP_IC_RING_SWINT_READ 1		// doorbell raised after publishing reads
+
+typedef struct
+{
+	uint32_t writePosition;
+	uint32_t readPosition;
+	uint32_t reserved[14];
+} LP_IC_RING_HEADER;
+
+typedef struct
+{
+	LP_IC_RING_HEADER *outbound;
+	LP_IC_RING_HEADER *inbound;
+	uint32_t size;
+	void (*doorbell)(uint32_t swint);
+	// Writer
+	uint32_t writePosition;
+	uint32_t reservedLength;
+	uint32_t pendingWrites;
+	bool bounced;
+	uint8_t bounce[LP_IC_RING_BOUNCE_SIZE];
+	// Reader
+	uint32_t readPosition;
+	uint32_t pendingReads;
+} LP_IC_RING;
+
+static inline uint8_t *lp_icRingData(LP_IC_RING_HEADER *header, uint32_t offset)
+{
+	return (uint8_t *)(header + 1) + offset;
+}
+
+static inline uint32_t lp_icRingAdvance(const LP_IC_RING *ring, uint32_t position, uint32_t blockSize)
+{
+	position = (position + sizeof(uint32_t) + blockSize + (LP_IC_RING_ALIGNMENT - 1)) & ~(uint32_t)(LP_IC_RING_ALIGNMENT - 1);
+	return position >= ring->size ? position - ring->size : position;
+}
+
+/// <summary>
+///     Attach to the buffers returned by GetIntercoreBuffers. doorbell is called with
+///     LP_IC_RING_SWINT_WRITE or LP_IC_RING_SWINT_READ to raise the mailbox software interrupt
+/// </summary>
+static inline void lp_icRingInit(LP_IC_RING *ring, void *outbound, void *inbound, uint32_t size, void (*doorbell)(uint32_t swint))
+{
+	memset(ring, 0, sizeof(LP_IC_RING));
+	ring->outbound = (LP_IC_RING_HEADER *)outbound;
+	ring->inbound = (LP_IC_RING_HEADER *)inbound;
+	ring->size = size;
+	ring->doorbell = doorbell;
+	ring->writePosition = ring->outbound->writePosition;
+	ring->readPosition = ring->outbound->readPosition;
+}
+
+/// <summary>
+///     Reserve length bytes for the next block. Returns where to build it, in the ring itself
+///     unless the block wraps, or NULL if there is not enough space yet
+/// </summary>
+static inline uint8_t *lp_icRingReserve(LP_IC_RING *ring, uint32_t length)
+{
+	uint32_t remoteReadPosition = __atomic_load_n(&ring->inbound->readPosition, __ATOMIC_ACQUIRE);
+	uint32_t localWritePosition = ring->writePosition;
+	uint32_t availSpace;
+
+	if (remoteReadPosition >= ring->size)
+	{
+		return NULL;
+	}
+
+	// If the read position is behind the write position, the free space wraps around
+	if (remoteReadPosition <= localWritePosition)
+	{
+		availSpace = remoteReadPosition - localWritePosition + ring->size;
+	}
+	else
+	{
+		availSpace = remoteReadPosition - localWritePosition;
+	}
+
+	if (availSpace < sizeof(uint32_t) + length + LP_IC_RING_ALIGNMENT || ring->size - localWritePosition < sizeof(uint32_t))
+	{
+		return NULL;
+	}
+
+	ring->reservedLength = length;
+	ring->bounced = localWritePosition + sizeof(uint32_t) + length > ring->size;
+
+	if (ring->bounced)
+	{
+		return length <= LP_IC_RING_BOUNCE_SIZE ? ring->bounce : NULL;
+	}
+	return lp_icRingData(ring->outbound, localWritePosition + sizeof(uint32_t));
+}
+
+/// <summary>
+///     Complete the reserved block with its final length, at most the length reserved. The
+///     block is not visible to the other core until lp_icRingFlushWrites
+/// </summary>
+static inline void lp_icRingCommit(LP_IC_RING *ring, uint32_t length)
+{
+	uint32_t localWritePosition = ring->writePosition;
+
+	if (length > ring->reservedLength)
+	{
+		length = ring->reservedLength;
+	}
+
+	*(uint32_t *)lp_icRingData(ring->outbound, localWritePosition) = length;
+
+	if (ring->bounced)
+	{
+		uint32_t toEnd = ring->size - localWritePosition - sizeof(uint32_t);
+		if (toEnd > length)
+		{
+			toEnd = length;
+		}
+		memcpy(lp_icRingData(ring->outbound, localWritePosition + sizeof(uint32_t)), ring->bounce, toEnd);
+		memcpy(lp_icRingData(ring->outbound, 0), ring->bounce + toEnd, length - toEnd);
+	}
+
+	ring->writePosition = lp_icRingAdvance(ring, localWritePosition, length);
+	ring->reservedLength = 0;
+	ring->pendingWrites++;
+}
+
+/// <summary>
+///     Publish the committed blocks and ring the doorbell once. Returns the number published
+/// </summary>
+static inline uint32_t lp_icRingFlushWrites(LP_IC_RING *ring)
+{
+	uint32_t published = ring->pendingWrites;
+
+	if (published != 0)
+	{
+		__atomic_store_n(&ring->outbound->writePosition, ring->writePosition, __ATOMIC_RELEASE);
+		ring->pendingWrites = 0;
+		if (ring->doorbell != NULL)
+		{
+			// The doorbell is a device register write, which the release store does not order
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			ring->doorbell(LP_IC_RING_SWINT_WRITE);
+		}
+	}
+	return published;
+}
+
+/// <summary>
+///     Copy one block into the ring and publish it straight away, like EnqueueData.
+///     Returns 0 on success, -1 if there is not enough space
+/// </summary>
+static inline int lp_icRingEnqueue(LP_IC_RING *ring, const void *src, uint32_t dataSize)
+{
+	uint8_t *block = lp_icRingReserve(ring, dataSize);
+
+	if (block == NULL)
+	{
+		return -1;
+	}
+	memcpy(block, src, dataSize);
+	lp_icRingCommit(ring, dataSize);
+	lp_icRingFlushWrites(ring);
+
+	return 0;
+}
+
+/// <summary>
+///     Copy the next block into dest. On entry dataSize is the size of dest, on exit the block
+///     size. The space is handed back to the other core by lp_icRingFlushReads. Returns 0 on
+///     success, -1 if there is no complete block or dest is too small
+/// </summary>
+static inline int lp_icRingDequeue(LP_IC_RING *ring, void *dest, uint32_t *dataSize)
+{
+	uint32_t remoteWritePosition = __atomic_load_n(&ring->inbound->writePosition, __ATOMIC_ACQUIRE);
+	uint32_t localReadPosition = ring->readPosition;
+	uint32_t availData;
+
+	if (remoteWritePosition >= ring->size)
+	{
+		return -1;
+	}
+
+	// If the data wraps around the end of the buffer, it resumes at the start
+	if (remoteWritePosition >= localReadPosition)
+	{
+		availData = remoteWritePosition - localReadPosition;
+	}
+	else
+	{
+		availData = remoteWritePosition - localReadPosition + ring->size;
+	}
+
+	uint32_t dataToEnd = ring->size - localReadPosition;
+	if (availData < sizeof(uint32_t) || dataToEnd < sizeof(uint32_t))
+	{
+		return -1;
+	}
+
+	uint32_t blockSize = *(const uint32_t *)lp_icRingData(ring->inbound, localReadPosition);
+	if (blockSize + sizeof(uint32_t) > availData)
+	{
+		return -1;
+	}
+
+	if (blockSize > *dataSize)
+	{
+		*dataSize = blockSize;
+		return -1;
+	}
+	*dataSize = blockSize;
+
+	uint32_t readFromEnd = dataToEnd - sizeof(uint32_t);
+	if (blockSize < readFromEnd)
+	{
+		readFromEnd = blockSize;
+	}
+	memcpy(dest, lp_icRingData(ring->inbound, localReadPosition + sizeof(uint32_t)), readFromEnd);
+	memcpy((uint8_t *)dest + readFromEnd, lp_icRingData(ring->inbound, 0), blockSize - readFromEnd);
+
+	ring->readPosition = lp_icRingAdvance(ring, localReadPosition, blockSize);
+	ring->pendingReads++;
+
+	return 0;
+}
+
+/// <summary>
+///     Hand the space of the blocks read back to the other core and ring the doorbell once.
+///     Returns the number of blocks released
+/// </summary>
+static inline uint32_t lp_icRingFlushReads(LP_IC_RING *ring)
+{
+	uint32_t released = ring->pendingReads;
+
+	if (released != 0)
+	{
+		__atomic_store_n(&ring->outbound->readPosition, ring->readPosition, __ATOMIC_RELEASE);
+		ring->pendingReads = 0;
+		if (ring->doorbell != NULL)
+		{
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			ring->doorbell(LP_IC_RING_SWINT_READ);
+		}
+	}
+	return released;
+}
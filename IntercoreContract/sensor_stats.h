@@ -0,0 +1,212 @@
+#pragma once
+
+#include "intercore_contract.h"
+
+/*
+ * Streaming sensor statistics for the real-time apps.
+ *
+ * A sensor is sampled far faster than the high-level app wants to hear about it, so each
+ * sample only updates a running summary of the current window: the mean and variance by
+ * Welford's method, the minimum and maximum, and one percentile estimated by the P² algorithm
+ * (Jain and Chlamtac, 1985), which keeps five markers instead of the samples. When the window
+ * ends the summary is sent as an LP_IC_SENSOR_SUMMARY message and the next window starts
+ * empty. Updates take constant time and space, and use single precision so the Cortex-M4 FPU
+ * does the work.
+ */
+
+#define LP_P2_MARKERS 5
+
+typedef struct
+{
+	float p;						// the quantile estimated, 0 to 1
+	uint32_t count;
+	float height[LP_P2_MARKERS];	// marker heights, the first five samples until there are five
+	int32_t position[LP_P2_MARKERS];
+	float desired[LP_P2_MARKERS];	// desired marker positions
+	float increment[LP_P2_MARKERS];
+} LP_P2_QUANTILE;
+
+typedef struct
+{
+	LP_IC_SENSOR sensor;
+	uint32_t percentileRank;	// the percentile estimated, 1 to 99
+	uint32_t count;
+	float mean;
+	float m2;					// sum of squared differences from the mean
+	float minimum;
+	float maximum;
+	LP_P2_QUANTILE percentile;
+} LP_SENSOR_STATS;
+
+static inline void lp_p2Init(LP_P2_QUANTILE *q, float p)
+{
+	memset(q, 0, sizeof(LP_P2_QUANTILE));
+	q->p = p;
+	q->increment[1] = p / 2;
+	q->increment[2] = p;
+	q->increment[3] = (1 + p) / 2;
+	q->increment[4] = 1;
+}
+
+static inline void lp_p2Update(LP_P2_QUANTILE *q, float x)
+{
+	int k;
+
+	if (q->count < LP_P2_MARKERS)
+	{
+		// Insertion sort the first samples, they become the initial marker heights
+		int i = (int)q->count++;
+		while (i > 0 && q->height[i - 1] > x)
+		{
+			q->height[i] = q->height[i - 1];
+			i--;
+		}
+		q->height[i] = x;
+
+		if (q->count == LP_P2_MARKERS)
+		{
+			for (i = 0; i < LP_P2_MARKERS; i++)
+			{
+				q->position[i] = i;
+				q->desired[i] = 4 * q->increment[i];
+			}
+		}
+		return;
+	}
+
+	q->count++;
+
+	// The cell x falls in, stretching the extremes if it lies outside them
+	if (x < q->height[0])
+	{
+		q->height[0] = x;
+		k = 0;
+	}
+	else if (x >= q->height[4])
+	{
+		q->height[4] = x;
+		k = 3;
+	}
+	else
+	{
+		k = 0;
+		while (x >= q->height[k + 1])
+		{
+			k++;
+		}
+	}
+
+	for (int i = k + 1; i < LP_P2_MARKERS; i++)
+	{
+		q->position[i]++;
+	}
+	for (int i = 0; i < LP_P2_MARKERS; i++)
+	{
+		q->desired[i] += q->increment[i];
+	}
+
+	// Move the middle markers toward their desired positions, parabolic where it stays monotonic
+	for (int i = 1; i < LP_P2_MARKERS - 1; i++)
+	{
+		float d = q->desired[i] - (float)q->position[i];
+		int32_t below = q->position[i] - q->position[i - 1];
+		int32_t above = q->position[i + 1] - q->position[i];
+
+		if ((d >= 1 && above > 1) || (d <= -1 && below > 1))
+		{
+			int s = d >= 0 ? 1 : -1;
+			float h = q->height[i] + (float)s / (float)(above + below) *
+										 ((float)(below + s) * (q->height[i + 1] - q->height[i]) / (float)above +
+										  (float)(above - s) * (q->height[i] - q->height[i - 1]) / (float)below);
+
+			if (q->height[i - 1] < h && h < q->height[i + 1])
+			{
+				q->height[i] = h;
+			}
+			else
+			{
+				q->height[i] += (float)s * (q->height[i + s] - q->height[i]) / (float)(q->position[i + s] - q->position[i]);
+			}
+			q->position[i] += s;
+		}
+	}
+}
+
+static inline float lp_p2Estimate(const LP_P2_QUANTILE *q)
+{
+	if (q->count == 0)
+	{
+		return 0;
+	}
+	if (q->count < LP_P2_MARKERS)
+	{
+		// Still exact, the samples are sorted
+		return q->height[(uint32_t)(q->p * (float)(q->count - 1) + 0.5f)];
+	}
+	return q->height[2];
+}
+
+/// <summary>
+///     Start an empty window for sensor, estimating percentileRank, 1 to 99
+/// </summary>
+static inline void lp_sensorStatsInit(LP_SENSOR_STATS *stats, LP_IC_SENSOR sensor, uint32_t percentileRank)
+{
+	memset(stats, 0, sizeof(LP_SENSOR_STATS));
+	stats->sensor = sensor;
+	stats->percentileRank = percentileRank;
+	lp_p2Init(&stats->percentile, (float)percentileRank / 100);
+}
+
+static inline void lp_sensorStatsUpdate(LP_SENSOR_STATS *stats, float x)
+{
+	float delta;
+
+	if (x != x)	// NaN, a failed read
+	{
+		return;
+	}
+
+	delta = x - stats->mean;
+	stats->count++;
+	stats->mean += delta / (float)stats->count;
+	stats->m2 += delta * (x - stats->mean);
+
+	if (stats->count == 1 || x < stats->minimum)
+	{
+		stats->minimum = x;
+	}
+	if (stats->count == 1 || x > stats->maximum)
+	{
+		stats->maximum = x;
+	}
+
+	lp_p2Update(&stats->percentile, x);
+}
+
+/// <summary>
+///     Fill block with the LP_IC_SENSOR_SUMMARY for the window just ended, window_ms long, and
+///     start the next one. Returns false, leaving block alone, if the window had no samples
+/// </summary>
+static inline bool lp_sensorStatsSummary(LP_SENSOR_STATS *stats, LP_IC_MESSAGE *block, uint32_t window_ms)
+{
+	if (stats->count == 0)
+	{
+		return false;
+	}
+
+	memset(block, 0, sizeof(LP_IC_MESSAGE));
+	block->cmd = LP_IC_SENSOR_SUMMARY;
+	block->sensor = stats->sensor;
+	block->sampleCount = stats->count;
+	block->window_ms = window_ms;
+	block->mean = stats->mean;
+	block->variance = stats->count > 1 ? stats->m2 / (float)(stats->count - 1) : 0;
+	block->minimum = stats->minimum;
+	block->maximum = stats->maximum;
+	block->percentile = lp_p2Estimate(&stats->percentile);
+	block->percentileRank = stats->percentileRank;
+
+	lp_sensorStatsInit(stats, stats->sensor, stats->percentileRank);
+
+	return true;
+}
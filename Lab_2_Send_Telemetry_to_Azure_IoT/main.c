@@ -70,6 +70,7 @@
 
 // Forward signatures
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer);
+static void TelemetryReady(LP_ENVIRONMENT* environment, bool ok);
 static void AzureIoTConnectionStatusHandler(EventLoopTimer* eventLoopTimer);
 
 LP_USER_CONFIG lp_config;
@@ -133,11 +134,10 @@ static void AzureIoTConnectionStatusHandler(EventLoopTimer* eventLoopTimer)
 }
 
 /// <summary>
-/// Read sensor and send to Azure IoT
+/// Read sensor on a worker thread, TelemetryReady sends the reading to Azure IoT
 /// </summary>
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 {
-	static int msgId = 0;
 	static LP_ENVIRONMENT environment;
 
 	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0)
@@ -145,13 +145,24 @@ static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
 	}
 	else {
-		if (lp_readTelemetry(&environment) &&
-			snprintf(msgBuffer, JSON_MESSAGE_BYTES, msgTemplate,
-				environment.temperature, environment.humidity, environment.pressure, msgId++) > 0)
-		{
-			Log_Debug("%s\n", msgBuffer);
-			lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
-		}
+		// Skips this period if the previous read has not finished
+		lp_readTelemetryAsync(&environment, TelemetryReady);
+	}
+}
+
+/// <summary>
+/// Send the sensor reading to Azure IoT, runs on the event loop thread
+/// </summary>
+static void TelemetryReady(LP_ENVIRONMENT* environment, bool ok)
+{
+	static int msgId = 0;
+
+	if (ok &&
+		snprintf(msgBuffer, JSON_MESSAGE_BYTES, msgTemplate,
+			environment->temperature, environment->humidity, environment->pressure, msgId++) > 0)
+	{
+		Log_Debug("%s\n", msgBuffer);
+		lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
 	}
 }
 
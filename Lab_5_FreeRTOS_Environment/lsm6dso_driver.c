@@ -182,6 +182,37 @@ int lsm6dso_init(void *i2c_write, void *i2c_read)
 	return 0;
 }
 
+/* Raise both output data rates to 417 Hz for streaming raw samples */
+void lsm6dso_stream_start(void)
+{
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_417Hz);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_417Hz);
+}
+
+/*
+ * Read a new raw accelerometer and gyroscope sample, if both are ready. One status read, then
+ * OUTX_L_G to OUTZ_H_A in a single burst as the output registers are contiguous.
+ */
+bool lsm6dso_raw_sample_get(int16_t *acceleration, int16_t *angular_rate)
+{
+	lsm6dso_status_reg_t status;
+	uint8_t raw[12];
+	int i;
+
+	if (lsm6dso_status_reg_get(&dev_ctx, &status) != 0 || !status.xlda || !status.gda)
+		return false;
+
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_OUTX_L_G, raw, sizeof(raw)) != 0)
+		return false;
+
+	for (i = 0; i < 3; i++) {
+		angular_rate[i] = (int16_t)(raw[2 * i] | (raw[2 * i + 1] << 8));
+		acceleration[i] = (int16_t)(raw[6 + 2 * i] | (raw[6 + 2 * i + 1] << 8));
+	}
+
+	return true;
+}
+
 void calibrate_lsm6dso(void) {
 	//printf("LSM6DSO: Calibrating angular rate...\n");
 	//printf("LSM6DSO: Please make sure the device is stationary.\n");
@@ -36,6 +36,9 @@
 #ifndef __LSM6DSO_DRIVER_H__
 #define __LSM6DSO_DRIVER_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,6 +46,8 @@ extern "C" {
 void lsm6dso_show_result(void);
 int lsm6dso_init(void *i2c_write, void *i2c_read);
 float get_temperature(void);
+void lsm6dso_stream_start(void);
+bool lsm6dso_raw_sample_get(int16_t *acceleration, int16_t *angular_rate);
 
 
 #ifdef __cplusplus
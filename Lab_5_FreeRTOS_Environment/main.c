@@ -66,34 +66,24 @@
 
 
 #include "hw/azure_sphere_learning_path.h"
+#include "intercore_contract.h"
+#include "intercore_outbox.h"
+#include "intercore_bulk.h"
+#include "intercore_link.h"
+#include "sensor_stats.h"
 
 
  /******************************************************************************/
  /* Configurations */
  /******************************************************************************/
 
-enum LP_INTER_CORE_CMD
-{
-	LP_IC_UNKNOWN,
-	LP_IC_HEARTBEAT,
-	LP_IC_TEMPERATURE_PRESSURE_HUMIDITY,
-	LP_IC_EVENT_BUTTON_A,
-	LP_IC_EVENT_BUTTON_B,
-	LP_IC_SET_DESIRED_TEMPERATURE,
-	LP_IC_BLINK_RATE
-};
-
-typedef struct LP_INTER_CORE_BLOCK
-{
-	enum LP_INTER_CORE_CMD cmd;
-	float	temperature;
-	float	pressure;
-	float	humidity;
-	int		blinkRate;
-
-} LP_INTER_CORE_BLOCK;
+static LP_IC_MESSAGE ic_control_block;
 
-static LP_INTER_CORE_BLOCK ic_control_block;
+// Reply with versioned messages when the high-level app sends them, legacy blocks otherwise.
+// Replies echo the request sequence so the high-level app can match them to lp_interCoreCall
+static bool useMessages = false;
+static uint16_t txSequence = 0;
+static uint16_t rxSequence = 0;
 
 #define UART_PORT_NUM OS_HAL_UART_ISU0
 #define APP_STACK_SIZE_BYTES (1024 / 4)
@@ -106,12 +96,60 @@ static SemaphoreHandle_t LEDSemphr;
 
 
 // Inter-core Communications
-#include "mt3620-intercore.h" // Support for inter Core Communications
+#include "os_hal_mbox.h"
+#include "os_hal_mbox_shared_mem.h" // Support for inter Core Communications
+#include "os_hal_gpt.h"
 static const size_t payloadStart = 20;
 static uint8_t buf[256];
 static uint32_t dataSize;
+static uint8_t hlComponentHeader[20];	// the high-level component ID, copied from its first message
+static bool hlComponentKnown = false;
 static BufferHeader* outbound, * inbound;
 static uint32_t sharedBufSize = 0;
+static LP_IC_RING ring;
+static LP_IC_OUTBOX outbox;
+static SemaphoreHandle_t ringWriteLock;	// the ring takes one writer, replies and button events share it
+
+// What happens to messages when the high-level app falls behind, see intercore_outbox.h
+#define INTER_CORE_OVERFLOW_POLICY LP_IC_OVERFLOW_COALESCE
+#define INTER_CORE_STATS_INTERVAL_MS 10000
+
+// The high-level app is taken as gone after HEARTBEAT_MISS_LIMIT heartbeats without an echo,
+// nothing more is queued for it until it is heard from again
+#define HEARTBEAT_INTERVAL_MS 5000
+#define HEARTBEAT_MISS_LIMIT 3
+static LP_IC_LINK hlLink;
+
+// Mailbox software interrupts 0 and 1, the high-level app raises 1 when it enqueues a message
+// and 0 when it has read, which frees space for messages waiting in the outbox
+static const uint32_t mboxIrqStatus = 0x3;
+#define MBOX_SW_INT_MSG_RECEIVED (1 << 1)
+SemaphoreHandle_t blockFifoSema;	// given by the mailbox FIFO interrupt, GetIntercoreBuffers waits on it
+static SemaphoreHandle_t blockDeqSema;
+
+// GPT3 counts microseconds from the latest mailbox interrupt, replies record the latency
+#define LATENCY_GPT OS_HAL_GPT3
+static uint32_t latencyCount = 0;
+static uint32_t latencyMax_us = 0;
+static uint64_t latencyTotal_us = 0;
+
+// GPT2 runs free at 32 kHz, it timestamps heartbeats and IMU samples
+#define TIMESTAMP_GPT OS_HAL_GPT2
+
+// GPT0 paces the environment sampling, only the summary of each window goes to the high-level app
+#define SAMPLE_GPT OS_HAL_GPT0
+#define SENSOR_SAMPLE_PERIOD_MS 20	// GPT0 counts at 1 kHz
+#define SENSOR_WINDOW_MS 10000
+#define SENSOR_PERCENTILE 95
+static SemaphoreHandle_t sampleSema;
+static LP_SENSOR_STATS sensorStats[3];
+
+#ifdef OEM_AVNET
+// Raw IMU samples stream to the high-level app in bulk frames
+#define IMU_POLL_PERIOD_MS 1	// faster than the 417 Hz output data rate so no sample is missed
+static LP_IC_BULK_WRITER imuWriter;
+static SemaphoreHandle_t sensorLock;	// the IMU stream and environment requests share the I2C bus
+#endif // OEM_AVNET
 
 bool HLAppReady = false;
 int desired_temperature = 0.0;
@@ -230,15 +268,164 @@ void free(void* ptr)
 	}
 }
 
-void send_inter_core_msg(void)
+// Queue the message for the high-level app, flush publishes it and rings the mailbox doorbell.
+// When the ring is full the outbox holds it and INTER_CORE_OVERFLOW_POLICY decides what to drop.
+// A reply is sent with the sequence replyTo points at, anything else takes the next txSequence
+// under ringWriteLock, as several tasks send. Returns the sequence used
+static uint16_t send_inter_core_sequenced(const LP_IC_MESSAGE* block, const uint16_t* replyTo, bool flush)
 {
+	uint16_t sequence;
+
+	xSemaphoreTake(ringWriteLock, portMAX_DELAY);
+
+	sequence = replyTo != NULL ? *replyTo : txSequence++;
 	if (HLAppReady)
 	{
-		memcpy((void*)&buf[payloadStart], (void*)&ic_control_block, sizeof(ic_control_block));
-		dataSize = payloadStart + sizeof(ic_control_block);
+		lp_icOutboxSend(&outbox, block, sequence, useMessages);
+		if (flush)
+		{
+			lp_icOutboxFlush(&outbox);
+		}
+	}
+
+	xSemaphoreGive(ringWriteLock);
+
+	return sequence;
+}
+
+// Unsolicited messages such as button events
+void send_inter_core_msg(void)
+{
+	send_inter_core_sequenced(&ic_control_block, NULL, true);
+}
+
+// Time from the mailbox interrupt to the reply, reported in the intercore stats message.
+// Nothing is printed here, the UART would add milliseconds to the reply path
+static void record_latency(void)
+{
+	uint32_t latency_us = mtk_os_hal_gpt_get_cur_count(LATENCY_GPT);
+
+	latencyCount++;
+	latencyTotal_us += latency_us;
+	if (latency_us > latencyMax_us)
+	{
+		latencyMax_us = latency_us;
+	}
+}
+
+// Channel counters and reply latency since the last report, so the high-level app sees the trend
+static void send_inter_core_stats(void)
+{
+	LP_IC_MESSAGE stats = { .cmd = LP_IC_INTERCORE_STATS };
+
+	xSemaphoreTake(ringWriteLock, portMAX_DELAY);
+	stats.enqueued = outbox.stats.enqueued;
+	stats.dropped = outbox.stats.dropped;
+	stats.coalesced = outbox.stats.coalesced;
+	stats.highWater = outbox.stats.highWater;
+	xSemaphoreGive(ringWriteLock);
+
+	stats.latencyMax_us = latencyMax_us;
+	stats.latencyAvg_us = latencyCount == 0 ? 0 : (uint32_t)(latencyTotal_us / latencyCount);
+	latencyCount = 0;
+	latencyMax_us = 0;
+	latencyTotal_us = 0;
+
+	stats.rttMin_us = hlLink.rttCount == 0 ? 0 : hlLink.rttMin_us;
+	stats.rttMax_us = hlLink.rttMax_us;
+	stats.rttAvg_us = hlLink.rttCount == 0 ? 0 : (uint32_t)(hlLink.rttTotal_us / hlLink.rttCount);
+	hlLink.rttCount = 0;
+	hlLink.rttMin_us = UINT32_MAX;
+	hlLink.rttMax_us = 0;
+	hlLink.rttTotal_us = 0;
+
+	send_inter_core_sequenced(&stats, NULL, true);
+}
 
-		EnqueueData(inbound, outbound, sharedBufSize, buf, dataSize);
+static uint32_t now_us(void)
+{
+	return (uint32_t)((uint64_t)mtk_os_hal_gpt_get_cur_count(TIMESTAMP_GPT) * 1000000 / 32768);
+}
+
+// Heartbeat to the high-level app, which echoes it back, see intercore_link.h
+static void send_heartbeat(void)
+{
+	LP_IC_MESSAGE heartbeat;
+	bool wasUp = hlLink.up;
+
+	if (!lp_icLinkHeartbeat(&hlLink, &heartbeat, 0, now_us(), HEARTBEAT_MISS_LIMIT) && wasUp)
+	{
+		printf("High-level app is not answering\n");
+		HLAppReady = false;
 	}
+	// The sequence is only allocated as the heartbeat is queued. Its echo is handled on this task,
+	// so the link learns the sequence before the echo can be matched against it
+	hlLink.sequence = send_inter_core_sequenced(&heartbeat, NULL, true);
+}
+
+// Reply to the request just received, RTCoreMsgTask flushes the replies once it has drained the ring
+void send_inter_core_reply(void)
+{
+	send_inter_core_sequenced(&ic_control_block, &rxSequence, false);
+	record_latency();
+}
+
+static void ring_doorbell(uint32_t swint)
+{
+	mtk_os_hal_mbox_ioctl(OS_HAL_MBOX_CH0, MBOX_IOSET_SWINT_TRIG, &swint);
+}
+
+// Mailbox FIFO interrupt, the high-level core writes the shared buffer addresses to the FIFO at startup
+static void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data* data)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+	if (data->event.channel == OS_HAL_MBOX_CH0 && data->event.wr_int)
+	{
+		xSemaphoreGiveFromISR(blockFifoSema, &higherPriorityTaskWoken);
+		portYIELD_FROM_ISR(higherPriorityTaskWoken);
+	}
+}
+
+// Mailbox software interrupt, wakes RTCoreMsgTask when the high-level app has enqueued messages
+// or made room for the outbox
+static void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data* data)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+	if (data->swint.swint_sts & MBOX_SW_INT_MSG_RECEIVED)
+	{
+		mtk_os_hal_gpt_restart(LATENCY_GPT);
+	}
+	xSemaphoreGiveFromISR(blockDeqSema, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static void latency_gpt_cb(void* data)
+{
+	// GPT3 is one-shot, it only expires after 71 minutes without a message
+}
+
+static void inter_core_init(void)
+{
+	struct mbox_fifo_event mask = { .channel = OS_HAL_MBOX_CH0, .wr_int = 1 };
+	struct os_gpt_int latencyGptInt = { .gpt_cb_hdl = latency_gpt_cb, .gpt_cb_data = NULL };
+
+	blockFifoSema = xSemaphoreCreateBinary();
+	blockDeqSema = xSemaphoreCreateBinary();
+	ringWriteLock = xSemaphoreCreateMutex();
+
+	mtk_os_hal_mbox_open_channel(OS_HAL_MBOX_CH0);
+	mtk_os_hal_mbox_fifo_register_cb(OS_HAL_MBOX_CH0, mbox_fifo_cb, &mask);
+	mtk_os_hal_mbox_sw_int_register_cb(OS_HAL_MBOX_CH0, mbox_swint_cb, mboxIrqStatus);
+
+	mtk_os_hal_gpt_init();
+	mtk_os_hal_gpt_config(LATENCY_GPT, false, &latencyGptInt);
+	mtk_os_hal_gpt_reset_timer(LATENCY_GPT, UINT32_MAX, false);
+	mtk_os_hal_gpt_start(LATENCY_GPT);
+
+	mtk_os_hal_gpt_config(TIMESTAMP_GPT, 1, NULL);
+	mtk_os_hal_gpt_start(TIMESTAMP_GPT);
 }
 
 static void ButtonTask(void* pParameters)
@@ -332,85 +519,244 @@ void SetTemperatureStatus(int temperature)
 	}
 }
 
-static void RTCoreMsgTask(void* pParameters)
-{
-	int rand_number;
-
 #ifdef OEM_AVNET
-	mtk_os_hal_i2c_ctrl_init(i2c_port_num);		// Initialize MT3620 I2C bus
-	i2c_enum();									// Enumerate I2C Bus
-	i2c_init();
-	lsm6dso_init(i2c_write, i2c_read);
-#endif // OEM_AVNET	
+// Stage raw IMU samples and send a bulk frame each time one fills, about every 150 ms
+static void ImuStreamTask(void* pParameters)
+{
+	LP_IC_IMU_SAMPLE sample;
+	int16_t acceleration[3], angularRate[3];
+	TickType_t lastWake = xTaskGetTickCount();
 
-	srand((unsigned int)time(NULL)); // seed the random number generator for fake telemetry
+	xSemaphoreTake(sensorLock, portMAX_DELAY);
+	lsm6dso_stream_start();
+	xSemaphoreGive(sensorLock);
 
 	while (1)
 	{
-		dataSize = sizeof(buf);
-		int r = DequeueData(outbound, inbound, sharedBufSize, buf, &dataSize);
-		
-		if (r == 0 && dataSize > payloadStart)
+		vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(IMU_POLL_PERIOD_MS));
+
+		xSemaphoreTake(sensorLock, portMAX_DELAY);
+		bool ready = lsm6dso_raw_sample_get(acceleration, angularRate);
+		xSemaphoreGive(sensorLock);
+
+		if (!ready || !HLAppReady)
 		{
-			HLAppReady = true;
+			continue;
+		}
 
-			memcpy((void*)&ic_control_block, (void*)&buf[payloadStart], sizeof(ic_control_block));
+		sample.timestamp_us = now_us();
+		memcpy(sample.acceleration, acceleration, sizeof(acceleration));
+		memcpy(sample.angularRate, angularRate, sizeof(angularRate));
 
-			switch (ic_control_block.cmd)
-			{
-			case LP_IC_HEARTBEAT:
-				break;
-			case LP_IC_SET_DESIRED_TEMPERATURE:
-				desired_temperature = round(ic_control_block.temperature);
-				SetTemperatureStatus(last_temperature);
-				break;
-			case LP_IC_BLINK_RATE:
-				blinkIntervalIndex = ic_control_block.blinkRate % numBlinkIntervals;
-				break;
-			case LP_IC_TEMPERATURE_PRESSURE_HUMIDITY:
+		if (lp_icBulkAppend(&imuWriter, &sample))
+		{
+			xSemaphoreTake(ringWriteLock, portMAX_DELAY);
+			lp_icBulkFlush(&imuWriter);
+			xSemaphoreGive(ringWriteLock);
+		}
+	}
+}
+#endif // OEM_AVNET
+
+static void read_environment(LP_IC_MESSAGE* block)
+{
+	int rand_number;
+
+	block->cmd = LP_IC_ENVIRONMENT_SENSOR;
 
 #ifdef OEM_AVNET
 
-				ic_control_block.cmd = LP_IC_TEMPERATURE_PRESSURE_HUMIDITY;
-				ic_control_block.temperature = get_temperature();
+	xSemaphoreTake(sensorLock, portMAX_DELAY);
+	block->temperature = get_temperature();
+	xSemaphoreGive(sensorLock);
 
-				rand_number = (rand() % 20) - 10;
-				ic_control_block.humidity = (float)(50.0 + rand_number);
+	rand_number = (rand() % 20) - 10;
+	block->humidity = (float)(50.0 + rand_number);
 
-				rand_number = (rand() % 50) - 25;
-				ic_control_block.pressure = (float)(1000.0 + rand_number);
+	rand_number = (rand() % 50) - 25;
+	block->pressure = (float)(1000.0 + rand_number);
 
 #endif // OEM_AVNET
 
 // The Seeed Studio Developer boards do not include any sensors so create some fake telemetry
 #if defined(OEM_SEEED_STUDIO) || defined (OEM_SEEED_STUDIO_MINI)
 
-				ic_control_block.cmd = LP_IC_TEMPERATURE_PRESSURE_HUMIDITY;
-
-				rand_number = (rand() % 10) - 5;
-				ic_control_block.temperature = (float)(25.0 + rand_number);
+	rand_number = (rand() % 10) - 5;
+	block->temperature = (float)(25.0 + rand_number);
 
-				rand_number = (rand() % 20) - 10;
-				ic_control_block.humidity = (float)(50.0 + rand_number);
+	rand_number = (rand() % 20) - 10;
+	block->humidity = (float)(50.0 + rand_number);
 
-				rand_number = (rand() % 50) - 25;
-				ic_control_block.pressure = (float)(1000.0 + rand_number);				
+	rand_number = (rand() % 50) - 25;
+	block->pressure = (float)(1000.0 + rand_number);
 
 #endif // OEM_SEEED_STUDIO
+}
+
+static void sample_gpt_cb(void* data)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
 
-				send_inter_core_msg();
+	xSemaphoreGiveFromISR(sampleSema, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
 
-				last_temperature = round(ic_control_block.temperature);
-				SetTemperatureStatus(last_temperature);
+// Sample the environment on every GPT0 tick and send each sensor's summary once a window ends
+static void SensorStatsTask(void* pParameters)
+{
+	struct os_gpt_int sampleGptInt = { .gpt_cb_hdl = sample_gpt_cb, .gpt_cb_data = NULL };
+	LP_IC_MESSAGE environment, summary;
+	uint32_t samples = 0;
 
-				break;
-			default:
+	lp_sensorStatsInit(&sensorStats[0], LP_IC_SENSOR_TEMPERATURE, SENSOR_PERCENTILE);
+	lp_sensorStatsInit(&sensorStats[1], LP_IC_SENSOR_PRESSURE, SENSOR_PERCENTILE);
+	lp_sensorStatsInit(&sensorStats[2], LP_IC_SENSOR_HUMIDITY, SENSOR_PERCENTILE);
+
+	mtk_os_hal_gpt_config(SAMPLE_GPT, false, &sampleGptInt);
+	mtk_os_hal_gpt_reset_timer(SAMPLE_GPT, SENSOR_SAMPLE_PERIOD_MS, true);
+	mtk_os_hal_gpt_start(SAMPLE_GPT);
+
+	while (1)
+	{
+		xSemaphoreTake(sampleSema, portMAX_DELAY);
+
+		read_environment(&environment);
+		lp_sensorStatsUpdate(&sensorStats[0], environment.temperature);
+		lp_sensorStatsUpdate(&sensorStats[1], environment.pressure);
+		lp_sensorStatsUpdate(&sensorStats[2], environment.humidity);
+
+		if (++samples < SENSOR_WINDOW_MS / SENSOR_SAMPLE_PERIOD_MS)
+		{
+			continue;
+		}
+		samples = 0;
+
+		// Summaries of a window the high-level app was not there for are dropped with it
+		for (size_t i = 0; i < sizeof(sensorStats) / sizeof(sensorStats[0]); i++)
+		{
+			if (lp_sensorStatsSummary(&sensorStats[i], &summary, SENSOR_WINDOW_MS))
+			{
+				send_inter_core_sequenced(&summary, NULL, false);
+			}
+		}
+
+		xSemaphoreTake(ringWriteLock, portMAX_DELAY);
+		lp_icOutboxFlush(&outbox);
+		xSemaphoreGive(ringWriteLock);
+	}
+}
+
+static void RTCoreMsgTask(void* pParameters)
+{
+	if (GetIntercoreBuffers(&outbound, &inbound, &sharedBufSize) == -1)
+	{
+		printf("Unable to get the intercore buffers\n");
+		vTaskDelete(NULL);
+	}
+	lp_icRingInit(&ring, outbound, inbound, sharedBufSize, ring_doorbell);
+	lp_icOutboxInit(&outbox, &ring, INTER_CORE_OVERFLOW_POLICY, hlComponentHeader, payloadStart);
+
+	// How long the high-level app took to start varies from boot to boot, which makes a good epoch
+	lp_icLinkInit(&hlLink, now_us() ^ mtk_os_hal_gpt_get_cur_count(LATENCY_GPT));
+
+#ifdef OEM_AVNET
+	mtk_os_hal_i2c_ctrl_init(i2c_port_num);		// Initialize MT3620 I2C bus
+	i2c_enum();									// Enumerate I2C Bus
+	i2c_init();
+	lsm6dso_init(i2c_write, i2c_read);
+
+	sensorLock = xSemaphoreCreateMutex();
+	lp_icBulkInit(&imuWriter, &ring, hlComponentHeader, payloadStart, LP_IC_BULK_IMU, sizeof(LP_IC_IMU_SAMPLE));
+	xTaskCreate(ImuStreamTask, "IMU Stream Task", APP_STACK_SIZE_BYTES, NULL, 3, NULL);
+#endif // OEM_AVNET	
+
+	srand((unsigned int)time(NULL)); // seed the random number generator for fake telemetry
+
+	sampleSema = xSemaphoreCreateBinary();
+	xTaskCreate(SensorStatsTask, "Sensor Stats Task", APP_STACK_SIZE_BYTES, NULL, 3, NULL);
+
+	TickType_t lastStats = xTaskGetTickCount();
+	TickType_t lastHeartbeat = xTaskGetTickCount();
+
+	while (1)
+	{
+		// Sleep until the mailbox interrupt says the high-level app has enqueued or read messages
+		xSemaphoreTake(blockDeqSema, pdMS_TO_TICKS(HEARTBEAT_INTERVAL_MS));
+
+		if (xTaskGetTickCount() - lastHeartbeat >= pdMS_TO_TICKS(HEARTBEAT_INTERVAL_MS))
+		{
+			lastHeartbeat = xTaskGetTickCount();
+			send_heartbeat();
+		}
+
+		if (xTaskGetTickCount() - lastStats >= pdMS_TO_TICKS(INTER_CORE_STATS_INTERVAL_MS))
+		{
+			lastStats = xTaskGetTickCount();
+			send_inter_core_stats();
+		}
+
+		// Drain the ring, one interrupt can cover several messages
+		for (;;)
+		{
+			dataSize = sizeof(buf);
+			int r = lp_icRingDequeue(&ring, buf, &dataSize);
+			if (r != 0)
+			{
 				break;
 			}
+
+			if (dataSize > payloadStart)
+			{
+				// Copied once, the outbox keeps sending it while buf takes the next messages
+				if (!hlComponentKnown)
+				{
+					memcpy(hlComponentHeader, buf, sizeof(hlComponentHeader));
+					hlComponentKnown = true;
+				}
+				HLAppReady = true;
+
+				useMessages = lp_icDecode(&buf[payloadStart], dataSize - payloadStart, &ic_control_block, &rxSequence);
+				if (!useMessages)
+				{
+					LP_INTER_CORE_BLOCK legacy;
+					memcpy((void*)&legacy, (void*)&buf[payloadStart], sizeof(legacy));
+					lp_icFromBlock(&legacy, &ic_control_block);
+				}
+
+				switch (ic_control_block.cmd)
+				{
+				case LP_IC_HEARTBEAT:
+					if (lp_icLinkReceive(&hlLink, &ic_control_block, rxSequence, now_us()))
+					{
+						send_inter_core_reply();
+					}
+					break;
+				case LP_IC_SET_DESIRED_TEMPERATURE:
+					desired_temperature = round(ic_control_block.temperature);
+					SetTemperatureStatus(last_temperature);
+					break;
+				case LP_IC_BLINK_RATE:
+					blinkIntervalIndex = ic_control_block.blinkRate % numBlinkIntervals;
+					break;
+				case LP_IC_ENVIRONMENT_SENSOR:
+					read_environment(&ic_control_block);
+					send_inter_core_reply();
+
+					last_temperature = round(ic_control_block.temperature);
+					SetTemperatureStatus(last_temperature);
+
+					break;
+				default:
+					break;
+				}
+			}
 		}
 
-		// Delay for 100ms
-		vTaskDelay(pdMS_TO_TICKS(100));
+		// One doorbell each way for the whole batch, the outbox moves into the space freed
+		lp_icRingFlushReads(&ring);
+		xSemaphoreTake(ringWriteLock, portMAX_DELAY);
+		lp_icOutboxFlush(&outbox);
+		xSemaphoreGive(ringWriteLock);
 	}
 }
 
@@ -456,14 +802,8 @@ _Noreturn void RTCoreMain(void)
 	printf("\nFreeRTOS GPIO Demo\n");
 
 
-	// Initialize Inter-Core Communications
-	if (GetIntercoreBuffers(&outbound, &inbound, &sharedBufSize) == -1)
-	{
-		for (;;)
-		{
-			// empty.
-		}
-	}
+	// Initialize Inter-Core Communications, RTCoreMsgTask waits for the shared buffers
+	inter_core_init();
 
 	LEDSemphr = xSemaphoreCreateBinary();
 
@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * Register shadow cache for the ST sensor drivers.
+ *
+ * Every bit field setter in lsm6dso_reg.c and lps22hh_reg.c reads the register, changes the
+ * field and writes it back, two bus transactions where one would do. st_reg_cache_attach slides
+ * a write through cache in under a driver context: configuration registers are kept once they
+ * have been read or written, so a setter's read is served from memory and only its write goes
+ * to the bus. Status, data and self clearing registers are listed as volatile for each device
+ * and always go to the bus, and a software reset or reboot empties the cache.
+ *
+ * Devices with register banks, the LSM6DSO's sensor hub and embedded function banks, are cached
+ * per bank. The current bank is tracked from the bank register, and nothing is cached until it
+ * has been read or written, so a cache attached to a device left in another bank by a previous
+ * run starts out passing everything through.
+ */
+
+#include "lsm6dso_reg.h"
+#include "lps22hh_reg.h"
+#include <stdbool.h>
+
+#define ST_REG_CACHE_REGS 0x80	// registers at or above this are never cached
+#define ST_REG_CACHE_BANKS 3
+
+typedef struct
+{
+	uint8_t bank;
+	uint8_t first;
+	uint8_t last;
+} st_reg_range_t;
+
+typedef struct
+{
+	uint8_t bankCount;			// 1 for a device without banks
+	uint8_t bankReg;			// selects the bank, present in every bank
+	uint8_t bankShift;			// bank = bankReg value >> bankShift
+	uint8_t resetReg;			// in bank 0, writing a resetMask bit resets the device
+	uint8_t resetMask;
+	const st_reg_range_t* volatileRegs;
+	uint8_t volatileCount;
+} st_reg_cache_device_t;
+
+typedef struct
+{
+	const st_reg_cache_device_t* device;
+	// The bus underneath
+	stmdev_write_ptr write_reg;
+	stmdev_read_ptr read_reg;
+	void* handle;
+	int bank;					// -1 until the bank register has been read or written
+	uint8_t bankValue;
+	uint8_t value[ST_REG_CACHE_BANKS][ST_REG_CACHE_REGS];
+	uint8_t valid[ST_REG_CACHE_BANKS][ST_REG_CACHE_REGS / 8];
+	// Statistics
+	uint32_t hits;				// reads served from the cache
+	uint32_t busReads;
+	uint32_t busWrites;
+} st_reg_cache_t;
+
+extern const st_reg_cache_device_t st_reg_cache_lsm6dso;
+extern const st_reg_cache_device_t st_reg_cache_lps22hh;
+
+void st_reg_cache_attach(st_reg_cache_t* cache, const st_reg_cache_device_t* device, stmdev_ctx_t* ctx);
+void st_reg_cache_invalidate(st_reg_cache_t* cache);
@@ -22,8 +22,13 @@
 #include "../IMU_lib/imu_temp_pressure.h"
 #include "hw/azure_sphere_learning_path.h"
 #include "intercore_contract.h"
-#include "mt3620-intercore.h"
+#include "intercore_link.h"
+#include "intercore_outbox.h"
+#include "sensor_stats.h"
 #include "os_hal_gpio.h"
+#include "os_hal_gpt.h"
+#include "os_hal_mbox.h"
+#include "os_hal_mbox_shared_mem.h"
 #include "os_hal_uart.h"
 #include "printf.h"
 #include "tx_api.h"
@@ -42,12 +47,62 @@
 // resources for inter core messaging
 static uint8_t buf[256];
 static uint32_t dataSize;
+static uint8_t hlComponentHeader[20];    // the high-level component ID, copied from its first message
+static bool hlComponentKnown = false;
 static BufferHeader* outbound, * inbound;
 static uint32_t sharedBufSize = 0;
+static LP_IC_RING ring;
+static LP_IC_OUTBOX outbox;
 static const size_t payloadStart = 20;
 
-LP_INTER_CORE_BLOCK ic_control_block;
-LP_INTER_CORE_BLOCK enviroment_control_block;
+// What happens to messages when the high-level app falls behind, see intercore_outbox.h
+#define INTERCORE_OVERFLOW_POLICY LP_IC_OVERFLOW_COALESCE
+#define INTERCORE_STATS_INTERVAL_MS 10000
+
+// The high-level app is taken as gone after HEARTBEAT_MISS_LIMIT heartbeats without an echo,
+// nothing more is queued for it until it is heard from again
+#define HEARTBEAT_INTERVAL_MS 5000
+#define HEARTBEAT_MISS_LIMIT 3
+static LP_IC_LINK hlLink;
+
+// Intercore_event_flags_0 bits
+#define INTERCORE_EVENT_MAILBOX 0x1
+#define INTERCORE_EVENT_STATS 0x2
+#define INTERCORE_EVENT_HEARTBEAT 0x4
+#define INTERCORE_EVENT_SUMMARY 0x8
+
+// The sensors are sampled every SENSOR_SAMPLE_PERIOD_MS, the LPS22HH output data rate, and only
+// the summary of each window goes to the high-level app
+#define SENSOR_SAMPLE_PERIOD_MS 100
+#define SENSOR_WINDOW_MS 10000
+#define SENSOR_PERCENTILE 95
+static LP_SENSOR_STATS sensorStats[3];
+static LP_IC_MESSAGE sensorSummaries[3];  // written by read_sensor_thread, sent by intercore_thread
+static size_t sensorSummaryCount = 0;
+
+// Mailbox software interrupts 0 and 1, the high-level app raises 1 when it enqueues a message
+// and 0 when it has read, which frees space for messages waiting in the outbox
+static const uint32_t mboxIrqStatus = 0x3;
+#define MBOX_SW_INT_MSG_RECEIVED (1 << 1)
+extern volatile u8 blockFifoSema;    // counted by the mailbox FIFO interrupt, GetIntercoreBuffers waits on it
+
+// GPT3 counts microseconds from the latest mailbox interrupt, replies record the latency
+#define LATENCY_GPT OS_HAL_GPT3
+static uint32_t latencyCount = 0;
+static uint32_t latencyMax_us = 0;
+static uint64_t latencyTotal_us = 0;
+
+// GPT2 runs free at 32 kHz, it timestamps heartbeats
+#define TIMESTAMP_GPT OS_HAL_GPT2
+
+LP_IC_MESSAGE ic_control_block;
+LP_IC_MESSAGE enviroment_control_block;
+
+// Reply with versioned messages when the high-level app sends them, legacy blocks otherwise.
+// Replies echo the request sequence so the high-level app can match them to lp_interCoreCall
+static bool useMessages = false;
+static uint16_t txSequence = 0;
+static uint16_t rxSequence = 0;
 
 bool highLevelReady = false;
 
@@ -96,7 +151,7 @@ void tx_application_define(void* first_unused_memory)
         printf("failed to create hardware_event_flags\r\n");
     }
 
-    status = tx_event_flags_create(&Intercore_event_flags_0, "Intercore Event");                     // Intercore events fire every 10 ms
+    status = tx_event_flags_create(&Intercore_event_flags_0, "Intercore Event");                     // Intercore events are set by the mailbox interrupt
     if (status != TX_SUCCESS)
     {
         printf("failed to create Intercore_event_flags\r\n");
@@ -160,10 +215,7 @@ bool initialize_hardware(void)
         // Prime the temperature and humidity sensors
         // Observed the first few readings on startup may return NaN
         for (size_t i = 0; i < 6; i++) {
-            enviroment_control_block.temperature = lp_get_temperature_lps22h();
-            enviroment_control_block.pressure = lp_get_pressure();
-
-            if (!isnan(enviroment_control_block.temperature) && !isnan(enviroment_control_block.pressure)) {
+            if (lp_read_environment(&enviroment_control_block.temperature, &enviroment_control_block.pressure)) {
                 break;
             }
             tx_thread_sleep(MS_TO_TICK(100));
@@ -181,14 +233,29 @@ bool initialize_hardware(void) {
 // Using default threadX 10ms tick period
 void timer_scheduler(ULONG input)
 {
-    static size_t intercoreTickCounter = 0;
     static size_t readSensorTickCounter = SIZE_MAX;
+    static size_t statsTickCounter = 0;
+    static size_t heartbeatTickCounter = 0;
     ULONG status = TX_SUCCESS;
 
+    heartbeatTickCounter++;
+    if (heartbeatTickCounter >= MS_TO_TICK(HEARTBEAT_INTERVAL_MS))
+    {
+        heartbeatTickCounter = 0;
+        tx_event_flags_set(&Intercore_event_flags_0, INTERCORE_EVENT_HEARTBEAT, TX_OR);
+    }
+
+    statsTickCounter++;
+    if (statsTickCounter >= MS_TO_TICK(INTERCORE_STATS_INTERVAL_MS))
+    {
+        statsTickCounter = 0;
+        tx_event_flags_set(&Intercore_event_flags_0, INTERCORE_EVENT_STATS, TX_OR);
+    }
+
     if (hardwareInitOK == true)
     {
         readSensorTickCounter++;
-        if (readSensorTickCounter >= 200)  // 2000ms = 2 seconds
+        if (readSensorTickCounter >= MS_TO_TICK(SENSOR_SAMPLE_PERIOD_MS))
         {
             readSensorTickCounter = 0;
             status = tx_event_flags_set(&hardware_event_flags_0, 0x1, TX_OR);
@@ -197,26 +264,155 @@ void timer_scheduler(ULONG input)
                 printf("failed to set hardware event flags\r\n");
             }
         }
+    }
+}
 
-        intercoreTickCounter++;
-        if (intercoreTickCounter >= 50)  // 500ms = 0.5 seconds.
-        {
-            intercoreTickCounter = 0;
-            status = tx_event_flags_set(&Intercore_event_flags_0, 0x1, TX_OR);
-            if (status != TX_SUCCESS)
-            {
-                printf("failed to set Intercore event flags\r\n");
-            }
-        }
+// Time from the mailbox interrupt to the reply, reported in the intercore stats message.
+// Nothing is printed here, the UART would add milliseconds to the reply path
+static void record_latency(void)
+{
+    uint32_t latency_us = mtk_os_hal_gpt_get_cur_count(LATENCY_GPT);
+
+    latencyCount++;
+    latencyTotal_us += latency_us;
+    if (latency_us > latencyMax_us)
+    {
+        latencyMax_us = latency_us;
     }
 }
 
+// Queue the message for the high-level app, intercore_thread flushes once it has drained the ring.
+// When the ring is full the outbox holds it and INTERCORE_OVERFLOW_POLICY decides what to drop.
+// A reply is sent with the sequence replyTo points at, anything else takes the next txSequence.
+// Only intercore_thread sends, which keeps txSequence and the outbox to one writer. Returns the sequence used
+static uint16_t send_intercore_sequenced(const LP_IC_MESSAGE* block, const uint16_t* replyTo)
+{
+    uint16_t sequence = replyTo != NULL ? *replyTo : txSequence++;
+
+    lp_icOutboxSend(&outbox, block, sequence, useMessages);
+    return sequence;
+}
+
+// Reply to the request just received
 void send_intercore_msg(void)
 {
-    memcpy((void*)&buf[payloadStart], (void*)&enviroment_control_block, sizeof(enviroment_control_block));
-    dataSize = payloadStart + sizeof(enviroment_control_block);
+    send_intercore_sequenced(&enviroment_control_block, &rxSequence);
+    record_latency();
+}
 
-    EnqueueData(inbound, outbound, sharedBufSize, buf, dataSize);
+// Channel counters and reply latency since the last report, so the high-level app sees the trend
+static void send_intercore_stats(void)
+{
+    LP_IC_MESSAGE stats = {
+        .cmd = LP_IC_INTERCORE_STATS,
+        .enqueued = outbox.stats.enqueued,
+        .dropped = outbox.stats.dropped,
+        .coalesced = outbox.stats.coalesced,
+        .highWater = outbox.stats.highWater,
+        .latencyMax_us = latencyMax_us,
+        .latencyAvg_us = latencyCount == 0 ? 0 : (uint32_t)(latencyTotal_us / latencyCount),
+        .rttMin_us = hlLink.rttCount == 0 ? 0 : hlLink.rttMin_us,
+        .rttMax_us = hlLink.rttMax_us,
+        .rttAvg_us = hlLink.rttCount == 0 ? 0 : (uint32_t)(hlLink.rttTotal_us / hlLink.rttCount) };
+
+    latencyCount = 0;
+    latencyMax_us = 0;
+    latencyTotal_us = 0;
+
+    hlLink.rttCount = 0;
+    hlLink.rttMin_us = UINT32_MAX;
+    hlLink.rttMax_us = 0;
+    hlLink.rttTotal_us = 0;
+
+    send_intercore_sequenced(&stats, NULL);
+}
+
+static uint32_t now_us(void)
+{
+    return (uint32_t)((uint64_t)mtk_os_hal_gpt_get_cur_count(TIMESTAMP_GPT) * 1000000 / 32768);
+}
+
+// Heartbeat to the high-level app, which echoes it back, see intercore_link.h
+static void send_heartbeat(void)
+{
+    LP_IC_MESSAGE heartbeat;
+    bool wasUp = hlLink.up;
+
+    if (!lp_icLinkHeartbeat(&hlLink, &heartbeat, 0, now_us(), HEARTBEAT_MISS_LIMIT) && wasUp)
+    {
+        printf("High-level app is not answering\r\n");
+        highLevelReady = false;
+    }
+    // The sequence is only allocated as the heartbeat is queued, before this thread can see its echo
+    hlLink.sequence = send_intercore_sequenced(&heartbeat, NULL);
+}
+
+static void ring_doorbell(uint32_t swint)
+{
+    mtk_os_hal_mbox_ioctl(OS_HAL_MBOX_CH0, MBOX_IOSET_SWINT_TRIG, &swint);
+}
+
+// Mailbox FIFO interrupt, the high-level core writes the shared buffer addresses to the FIFO at startup
+static void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data* data)
+{
+    if (data->event.channel == OS_HAL_MBOX_CH0 && data->event.wr_int)
+    {
+        blockFifoSema++;
+    }
+}
+
+// Mailbox software interrupt, wakes intercore_thread when the high-level app has enqueued messages
+// or made room for the outbox
+static void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data* data)
+{
+    if (data->swint.swint_sts & MBOX_SW_INT_MSG_RECEIVED)
+    {
+        mtk_os_hal_gpt_restart(LATENCY_GPT);
+    }
+    tx_event_flags_set(&Intercore_event_flags_0, INTERCORE_EVENT_MAILBOX, TX_OR);
+}
+
+static void latency_gpt_cb(void* data)
+{
+    // GPT3 is one-shot, it only expires after 71 minutes without a message
+}
+
+static void intercore_init(void)
+{
+    struct mbox_fifo_event mask = { .channel = OS_HAL_MBOX_CH0, .wr_int = 1 };
+    struct os_gpt_int latencyGptInt = { .gpt_cb_hdl = latency_gpt_cb, .gpt_cb_data = NULL };
+
+    mtk_os_hal_mbox_open_channel(OS_HAL_MBOX_CH0);
+    mtk_os_hal_mbox_fifo_register_cb(OS_HAL_MBOX_CH0, mbox_fifo_cb, &mask);
+    mtk_os_hal_mbox_sw_int_register_cb(OS_HAL_MBOX_CH0, mbox_swint_cb, mboxIrqStatus);
+
+    mtk_os_hal_gpt_init();
+    mtk_os_hal_gpt_config(LATENCY_GPT, false, &latencyGptInt);
+    mtk_os_hal_gpt_reset_timer(LATENCY_GPT, UINT32_MAX, false);
+    mtk_os_hal_gpt_start(LATENCY_GPT);
+
+    mtk_os_hal_gpt_config(TIMESTAMP_GPT, 1, NULL);
+    mtk_os_hal_gpt_start(TIMESTAMP_GPT);
+}
+
+// Summaries of a window the high-level app was not there for are dropped with it
+static void send_sensor_summaries(void)
+{
+    LP_IC_MESSAGE summaries[3];
+    size_t count;
+    TX_INTERRUPT_SAVE_AREA
+
+    // read_sensor_thread runs at a higher priority, take a consistent copy before it writes the next window
+    TX_DISABLE
+    count = sensorSummaryCount;
+    memcpy(summaries, sensorSummaries, count * sizeof(LP_IC_MESSAGE));
+    sensorSummaryCount = 0;
+    TX_RESTORE
+
+    for (size_t i = 0; i < count && highLevelReady; i++)
+    {
+        send_intercore_sequenced(&summaries[i], NULL);
+    }
 }
 
 /*************************************************************************************************************************************
@@ -230,37 +426,131 @@ void intercore_thread(ULONG thread_input)
     UINT status = TX_SUCCESS;
     ULONG actual_flags;
 
+    intercore_init();
+
     if (GetIntercoreBuffers(&outbound, &inbound, &sharedBufSize) == -1)
     {
         return; // kill the thread
     }
+    lp_icRingInit(&ring, outbound, inbound, sharedBufSize, ring_doorbell);
+    lp_icOutboxInit(&outbox, &ring, INTERCORE_OVERFLOW_POLICY, hlComponentHeader, payloadStart);
+
+    // How long the high-level app took to start varies from boot to boot, which makes a good epoch
+    lp_icLinkInit(&hlLink, now_us() ^ mtk_os_hal_gpt_get_cur_count(LATENCY_GPT));
 
     while (true)
     {
-        status = tx_event_flags_get(&Intercore_event_flags_0, 0x1, TX_OR_CLEAR, &actual_flags, TX_WAIT_FOREVER);
+        // Sleeps until the mailbox interrupt says the high-level app has enqueued or read messages, or stats or a heartbeat are due
+        status = tx_event_flags_get(&Intercore_event_flags_0,
+                                    INTERCORE_EVENT_MAILBOX | INTERCORE_EVENT_STATS | INTERCORE_EVENT_HEARTBEAT | INTERCORE_EVENT_SUMMARY,
+                                    TX_OR_CLEAR, &actual_flags, TX_WAIT_FOREVER);
 
-        if ((status != TX_SUCCESS) || (actual_flags != 0x1)) { break; }
+        if (status != TX_SUCCESS) { break; }
 
-        dataSize = sizeof(buf);
-        int r = DequeueData(outbound, inbound, sharedBufSize, buf, &dataSize);
+        if ((actual_flags & INTERCORE_EVENT_HEARTBEAT) && highLevelReady)
+        {
+            send_heartbeat();
+        }
 
-        if (r == 0 && dataSize > payloadStart)
+        if ((actual_flags & INTERCORE_EVENT_STATS) && highLevelReady)
         {
-            memcpy((void*)&ic_control_block, (void*)&buf[payloadStart], sizeof(ic_control_block));
+            send_intercore_stats();
+        }
 
-            switch (ic_control_block.cmd)
+        if (actual_flags & INTERCORE_EVENT_SUMMARY)
+        {
+            send_sensor_summaries();
+        }
+
+        // Drain the ring, one interrupt can cover several messages
+        for (;;)
+        {
+            dataSize = sizeof(buf);
+            int r = lp_icRingDequeue(&ring, buf, &dataSize);
+            if (r != 0)
             {
-            case LP_IC_HEARTBEAT:
-                break;
-            case LP_IC_ENVIRONMENT_SENSOR:
-                send_intercore_msg();
-            default:
                 break;
             }
+
+            if (dataSize > payloadStart)
+            {
+                // Copied once, the outbox keeps sending it while buf takes the next messages
+                if (!hlComponentKnown)
+                {
+                    memcpy(hlComponentHeader, buf, sizeof(hlComponentHeader));
+                    hlComponentKnown = true;
+                }
+                highLevelReady = true;
+
+                useMessages = lp_icDecode(&buf[payloadStart], dataSize - payloadStart, &ic_control_block, &rxSequence);
+                if (!useMessages)
+                {
+                    LP_INTER_CORE_BLOCK legacy;
+                    memcpy((void*)&legacy, (void*)&buf[payloadStart], sizeof(legacy));
+                    lp_icFromBlock(&legacy, &ic_control_block);
+                }
+
+                switch (ic_control_block.cmd)
+                {
+                case LP_IC_HEARTBEAT:
+                    if (lp_icLinkReceive(&hlLink, &ic_control_block, rxSequence, now_us()))
+                    {
+                        send_intercore_sequenced(&ic_control_block, &rxSequence);
+                    }
+                    break;
+                case LP_IC_ENVIRONMENT_SENSOR:
+                    send_intercore_msg();
+                default:
+                    break;
+                }
+            }
         }
+
+        // One doorbell each way for the whole batch, the outbox moves into the space freed
+        lp_icRingFlushReads(&ring);
+        lp_icOutboxFlush(&outbox);
     }
 }
 
+// Add the latest reading to the window, and hand the summaries to intercore_thread once it ends
+static void update_sensor_stats(void)
+{
+    static bool started = false;
+    static size_t samples = 0;
+    size_t count = 0;
+
+    if (!started)
+    {
+        started = true;
+        lp_sensorStatsInit(&sensorStats[0], LP_IC_SENSOR_TEMPERATURE, SENSOR_PERCENTILE);
+        lp_sensorStatsInit(&sensorStats[1], LP_IC_SENSOR_PRESSURE, SENSOR_PERCENTILE);
+        lp_sensorStatsInit(&sensorStats[2], LP_IC_SENSOR_HUMIDITY, SENSOR_PERCENTILE);
+    }
+
+    lp_sensorStatsUpdate(&sensorStats[0], enviroment_control_block.temperature);
+    lp_sensorStatsUpdate(&sensorStats[1], enviroment_control_block.pressure);
+    lp_sensorStatsUpdate(&sensorStats[2], enviroment_control_block.humidity);
+
+    if (++samples < SENSOR_WINDOW_MS / SENSOR_SAMPLE_PERIOD_MS)
+    {
+        return;
+    }
+    samples = 0;
+
+    // intercore_thread runs at a lower priority and copies the summaries with interrupts disabled,
+    // so it never sees them half written
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (lp_sensorStatsSummary(&sensorStats[i], &sensorSummaries[count], SENSOR_WINDOW_MS))
+        {
+            count++;
+        }
+    }
+    sensorSummaryCount = count;
+
+    tx_event_flags_set(&Intercore_event_flags_0, INTERCORE_EVENT_SUMMARY, TX_OR);
+}
+
 // sensor read
 #if defined(OEM_AVNET)
 void read_sensor_thread(ULONG thread_input)
@@ -279,11 +569,15 @@ void read_sensor_thread(ULONG thread_input)
 
         enviroment_control_block.cmd = LP_IC_ENVIRONMENT_SENSOR;
 
-        enviroment_control_block.temperature = lp_get_temperature_lps22h();
-        enviroment_control_block.pressure = lp_get_pressure();
+        if (!lp_read_environment(&enviroment_control_block.temperature, &enviroment_control_block.pressure)) {
+            enviroment_control_block.temperature = NAN;
+            enviroment_control_block.pressure = NAN;
+        }
 
         rand_number = (rand() % 20);
         enviroment_control_block.humidity = (float)(40.0 + rand_number);
+
+        update_sensor_stats();
     }
 }
 #else
@@ -312,6 +606,8 @@ void read_sensor_thread(ULONG thread_input)
 
         rand_number = (rand() % 20);
         enviroment_control_block.humidity = (float)(40.0 + rand_number);
+
+        update_sensor_stats();
     }
 }
 #endif
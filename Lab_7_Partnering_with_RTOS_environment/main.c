@@ -73,6 +73,7 @@
 #include <applibs/gpio.h>
 #include <applibs/log.h>
 #include <applibs/powermanagement.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <time.h>
@@ -95,11 +96,12 @@
 // Forward signatures
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer);
 static void AzureIoTConnectionStatusHandler(EventLoopTimer* eventLoopTimer);
-static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block);
+static void InterCoreHandler(LP_IC_MESSAGE* ic_message_block);
+static void ImuFrameHandler(const LP_IC_BULK_VIEW* view);
 static void DeviceTwinSetTemperatureHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
 
 LP_USER_CONFIG lp_config;
-LP_INTER_CORE_BLOCK ic_control_block;
+LP_IC_MESSAGE ic_control_block;
 
 static int previous_temperature = 0;
 
@@ -156,6 +158,11 @@ LP_DEVICE_TWIN_BINDING* deviceTwinBindingSet[] = { &dt_desiredTemperature, &dt_r
 // Telemetry message template and properties
 static const char* msgTemplate = "{ \"Temperature\":%3.2f, \"Humidity\":%3.1f, \"Pressure\":%3.1f, \"MsgId\":%d }";
 
+// Window summaries from the real-time app, one message per sensor, indexed by LP_IC_SENSOR
+static const char* sensorNames[] = { "Temperature", "Pressure", "Humidity" };
+static const char* summaryTemplate = "{ \"%sMean\":%3.2f, \"%sStdDev\":%3.3f, \"%sMin\":%3.2f, \"%sMax\":%3.2f, "
+	"\"%sP%u\":%3.2f, \"Samples\":%u, \"WindowMs\":%u }";
+
 static LP_MESSAGE_PROPERTY* telemetryMessageProperties[] = {
 	&(LP_MESSAGE_PROPERTY) { .key = "appid", .value = "hvac" },
 	&(LP_MESSAGE_PROPERTY) {.key = "format", .value = "json" },
@@ -242,10 +249,32 @@ static void DeviceTwinSetTemperatureHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBi
 	}
 }
 
+/// <summary>
+/// Forward the summary of a sensor window from the real-time app to Azure IoT
+/// </summary>
+static void SendSensorSummary(LP_IC_MESSAGE* summary)
+{
+	const char* name;
+
+	if (summary->sensor >= NELEMS(sensorNames))
+	{
+		return;
+	}
+	name = sensorNames[summary->sensor];
+
+	if (snprintf(msgBuffer, JSON_MESSAGE_BYTES, summaryTemplate, name, summary->mean, name, sqrtf(summary->variance),
+		name, summary->minimum, name, summary->maximum, name, summary->percentileRank, summary->percentile,
+		summary->sampleCount, summary->window_ms) > 0) {
+
+		Log_Debug("%s\n", msgBuffer);
+		lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
+	}
+}
+
 /// <summary>
 /// Callback handler for Inter-Core Messaging - Does Device Twin Update, and Event Message
 /// </summary>
-static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
+static void InterCoreHandler(LP_IC_MESSAGE* ic_message_block)
 {
 	static int msgId = 0;
 
@@ -267,11 +296,58 @@ static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
 			previous_temperature = (int)ic_message_block->temperature;
 		}
 		break;
+	case LP_IC_INTERCORE_STATS:
+		Log_Debug("Real-time intercore: %u sent, %u dropped, %u coalesced, %u waiting at most, latency max %u us avg %u us, "
+			"heartbeat round trip min %u us max %u us avg %u us\n",
+			ic_message_block->enqueued, ic_message_block->dropped, ic_message_block->coalesced, ic_message_block->highWater,
+			ic_message_block->latencyMax_us, ic_message_block->latencyAvg_us,
+			ic_message_block->rttMin_us, ic_message_block->rttMax_us, ic_message_block->rttAvg_us);
+		break;
+	case LP_IC_SENSOR_SUMMARY:
+		SendSensorSummary(ic_message_block);
+		break;
 	default:
 		break;
 	}
 }
 
+/// <summary>
+/// Bulk frames of raw IMU samples streamed by the real-time app, read in place from the receive buffer.
+/// Reports the sustained sample rate every 2000 samples
+/// </summary>
+static void ImuFrameHandler(const LP_IC_BULK_VIEW* view)
+{
+	static unsigned long samples = 0;
+	static struct timespec start;
+	LP_IC_IMU_SAMPLE sample;
+	LP_INTER_CORE_STATS stats;
+	struct timespec now;
+
+	if (view->type != LP_IC_BULK_IMU || view->count == 0 || view->sampleSize < sizeof(LP_IC_IMU_SAMPLE))
+	{
+		return;
+	}
+
+	if (samples == 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+	}
+	samples += view->count;
+
+	if (samples >= 2000)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double seconds = (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+
+		memcpy(&sample, &view->samples[(view->count - 1) * view->sampleSize], sizeof(sample));
+		lp_interCoreGetStats(&stats);
+		Log_Debug("IMU stream: %.0f samples/s, %lu frames lost, last accel %d %d %d gyro %d %d %d\n", samples / seconds, stats.bulkFramesLost,
+			sample.acceleration[0], sample.acceleration[1], sample.acceleration[2], sample.angularRate[0], sample.angularRate[1], sample.angularRate[2]);
+
+		samples = 0;
+	}
+}
+
 /// <summary>
 ///  Initialize PeripheralGpios, device twins, direct methods, timers.
 /// </summary>
@@ -288,6 +364,7 @@ static void InitPeripheralAndHandlers(void)
 	lp_azureToDeviceStart();
 
 	lp_interCoreCommunicationsEnable(lp_config.rtComponentId, InterCoreHandler);  // Initialize Inter Core Communications
+	lp_interCoreBulkEnable(ImuFrameHandler);
 }
 
 /// <summary>
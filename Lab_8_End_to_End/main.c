@@ -50,6 +50,7 @@
 #include <applibs/gpio.h>
 #include <applibs/log.h>
 #include <applibs/powermanagement.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <time.h>
@@ -72,7 +73,10 @@
 // Forward signatures
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer);
 static void AzureIoTConnectionStatusHandler(EventLoopTimer* eventLoopTimer);
-static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block);
+static void InterCoreHandler(LP_IC_MESSAGE* ic_message_block);
+static void InterCoreLinkHandler(LP_INTER_CORE_CHANNEL* channel, bool up);
+static void InterCoreMetricsHandler(EventLoopTimer* eventLoopTimer);
+static void EnvironmentReplyHandler(LP_IC_MESSAGE* reply, LP_IC_CALL_STATUS status, void* context);
 static void ResetDeviceHandler(EventLoopTimer* eventLoopTimer);
 static void DeviceTwinSetTemperatureHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
 static LP_DIRECT_METHOD_RESPONSE_CODE ResetDirectMethodHandler(JSON_Value* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, char** responseMsg);
@@ -80,13 +84,16 @@ static LP_DIRECT_METHOD_RESPONSE_CODE ResetDirectMethodHandler(JSON_Value* json,
 LP_USER_CONFIG lp_config;
 
 static char msgBuffer[JSON_MESSAGE_BYTES] = { 0 };
-LP_INTER_CORE_BLOCK ic_control_block;
+LP_IC_MESSAGE ic_control_block;
 
 enum LEDS { RED, GREEN, BLUE };
 static enum LEDS current_led = RED;
 static const char* hvacState[] = { "heating", "off", "cooling" };
 
 static float last_temperature = 0;
+static const struct timespec environmentReplyTimeout = { 2, 0 };
+static const struct timespec interCoreHeartbeatPeriod = { 5, 0 };
+#define INTER_CORE_HEARTBEAT_MISS_LIMIT 3
 
 // Declare GPIO
 
@@ -114,6 +121,11 @@ static LP_TIMER measureSensorTimer = {
 	.name = "measureSensorTimer",
 	.handler = MeasureSensorHandler };
 
+static LP_TIMER interCoreMetricsTimer = {
+	.period = { 60, 0 },
+	.name = "interCoreMetricsTimer",
+	.handler = InterCoreMetricsHandler };
+
 static LP_TIMER resetDeviceOneShotTimer = {
 	.period = { 0, 0 },
 	.name = "resetDeviceOneShotTimer",
@@ -138,7 +150,7 @@ static LP_DEVICE_TWIN_BINDING deviceResetUtc = {
 	.twinType = LP_TYPE_STRING };
 
 // Initialize Sets
-LP_TIMER* timerSet[] = { &azureIotConnectionStatusTimer, &measureSensorTimer, &resetDeviceOneShotTimer };
+LP_TIMER* timerSet[] = { &azureIotConnectionStatusTimer, &measureSensorTimer, &interCoreMetricsTimer, &resetDeviceOneShotTimer };
 LP_GPIO* gpioSet[] = { &azureIotConnectedLed };
 LP_DEVICE_TWIN_BINDING* deviceTwinBindingSet[] = { &desiredTemperature, &actualTemperature, &actualHvacState, &deviceResetUtc };
 
@@ -150,6 +162,11 @@ LP_DIRECT_METHOD_BINDING* directMethodBindingSet[] = {
 // Telemetry message template and properties
 static const char* msgTemplate = "{ \"Temperature\":%3.2f, \"Humidity\":%3.1f, \"Pressure\":%3.1f, \"MsgId\":%d }";
 
+// Window summaries from the real-time app, one message per sensor, indexed by LP_IC_SENSOR
+static const char* sensorNames[] = { "Temperature", "Pressure", "Humidity" };
+static const char* summaryTemplate = "{ \"%sMean\":%3.2f, \"%sStdDev\":%3.3f, \"%sMin\":%3.2f, \"%sMax\":%3.2f, "
+	"\"%sP%u\":%3.2f, \"Samples\":%u, \"WindowMs\":%u }";
+
 static LP_MESSAGE_PROPERTY* telemetryMessageProperties[] = {
 	&(LP_MESSAGE_PROPERTY) { .key = "appid", .value = "hvac" },
 	&(LP_MESSAGE_PROPERTY) {.key = "format", .value = "json" },
@@ -157,6 +174,17 @@ static LP_MESSAGE_PROPERTY* telemetryMessageProperties[] = {
 	&(LP_MESSAGE_PROPERTY) {.key = "version", .value = "1" }
 };
 
+// Intercore link health, from the heartbeats exchanged with the real-time app
+static const char* metricsTemplate = "{ \"IntercoreRttAvg\":%u, \"IntercoreRttP99\":%u, \"IntercoreRttMax\":%u, "
+	"\"IntercoreLinkDowns\":%u, \"IntercoreResyncs\":%u }";
+
+static LP_MESSAGE_PROPERTY* metricsMessageProperties[] = {
+	&(LP_MESSAGE_PROPERTY) { .key = "appid", .value = "hvac" },
+	&(LP_MESSAGE_PROPERTY) {.key = "format", .value = "json" },
+	&(LP_MESSAGE_PROPERTY) {.key = "type", .value = "metrics" },
+	&(LP_MESSAGE_PROPERTY) {.key = "version", .value = "1" }
+};
+
 /// <summary>
 /// Check status of connection to Azure IoT
 /// </summary>
@@ -223,38 +251,130 @@ static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
 	}
 	else {
-		// send request to Real-Time core app to read temperature, pressure, and humidity
+		// request the Real-Time core app to read temperature, pressure, and humidity, the reply is matched by sequence number
 		ic_control_block.cmd = LP_IC_ENVIRONMENT_SENSOR;
-		lp_interCoreSendMessage(&ic_control_block, sizeof(ic_control_block));
+		if (!lp_interCoreCall(&ic_control_block, LP_IC_ENVIRONMENT_SENSOR, &environmentReplyTimeout, EnvironmentReplyHandler, NULL))
+		{
+			Log_Debug("Unable to request environment reading from the real-time core\n");
+		}
 	}
 }
 
 /// <summary>
-/// Callback handler for Inter-Core Messaging - Does Device Twin Update, and Event Message
+/// Send environment telemetry to Azure IoT and update the temperature status
 /// </summary>
-static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
+static void SendEnvironmentTelemetry(LP_IC_MESSAGE* environment)
 {
 	static int msgId = 0;
 
-	switch (ic_message_block->cmd)
+	if (snprintf(msgBuffer, JSON_MESSAGE_BYTES, msgTemplate, environment->temperature,
+		environment->humidity, environment->pressure, msgId++) > 0) {
+
+		Log_Debug("%s", msgBuffer);
+		lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
+	}
+
+	SetTemperatureStatusColour(environment->temperature);
+	last_temperature = environment->temperature;
+}
+
+/// <summary>
+/// Completion handler for the environment request sent by MeasureSensorHandler
+/// </summary>
+static void EnvironmentReplyHandler(LP_IC_MESSAGE* reply, LP_IC_CALL_STATUS status, void* context)
+{
+	switch (status)
 	{
-	case LP_IC_ENVIRONMENT_SENSOR:
-		if (snprintf(msgBuffer, JSON_MESSAGE_BYTES, msgTemplate, ic_message_block->temperature, 
-			ic_message_block->humidity, ic_message_block->pressure, msgId++) > 0) {
+	case LP_IC_CALL_OK:
+		SendEnvironmentTelemetry(reply);
+		break;
+	case LP_IC_CALL_TIMEOUT:
+		Log_Debug("Real-time core did not reply to the environment request\n");
+		break;
+	default:
+		break;
+	}
+}
 
-			Log_Debug("%s", msgBuffer);
-			lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
-		}
+/// <summary>
+/// Forward the summary of a sensor window from the real-time app to Azure IoT
+/// </summary>
+static void SendSensorSummary(LP_IC_MESSAGE* summary)
+{
+	const char* name;
+
+	if (summary->sensor >= NELEMS(sensorNames))
+	{
+		return;
+	}
+	name = sensorNames[summary->sensor];
+
+	if (snprintf(msgBuffer, JSON_MESSAGE_BYTES, summaryTemplate, name, summary->mean, name, sqrtf(summary->variance),
+		name, summary->minimum, name, summary->maximum, name, summary->percentileRank, summary->percentile,
+		summary->sampleCount, summary->window_ms) > 0) {
 
-		SetTemperatureStatusColour(ic_message_block->temperature);
-		last_temperature = ic_message_block->temperature;
+		Log_Debug("%s\n", msgBuffer);
+		lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
+	}
+}
 
+/// <summary>
+/// Callback handler for Inter-Core Messaging - Does Device Twin Update, and Event Message
+/// </summary>
+static void InterCoreHandler(LP_IC_MESSAGE* ic_message_block)
+{
+	switch (ic_message_block->cmd)
+	{
+	case LP_IC_ENVIRONMENT_SENSOR:	// from a real-time app that replies with legacy blocks
+		SendEnvironmentTelemetry(ic_message_block);
+		break;
+	case LP_IC_INTERCORE_STATS:
+		Log_Debug("Real-time intercore: %u sent, %u dropped, %u coalesced, %u waiting at most, latency max %u us avg %u us, "
+			"heartbeat round trip min %u us max %u us avg %u us\n",
+			ic_message_block->enqueued, ic_message_block->dropped, ic_message_block->coalesced, ic_message_block->highWater,
+			ic_message_block->latencyMax_us, ic_message_block->latencyAvg_us,
+			ic_message_block->rttMin_us, ic_message_block->rttMax_us, ic_message_block->rttAvg_us);
+		break;
+	case LP_IC_SENSOR_SUMMARY:
+		SendSensorSummary(ic_message_block);
 		break;
 	default:
 		break;
 	}
 }
 
+/// <summary>
+/// The real-time app stopped echoing heartbeats, or is answering again
+/// </summary>
+static void InterCoreLinkHandler(LP_INTER_CORE_CHANNEL* channel, bool up)
+{
+	Log_Debug("Real-time app %s\n", up ? "is answering" : "stopped answering");
+}
+
+/// <summary>
+/// Report the intercore link health to Azure IoT
+/// </summary>
+static void InterCoreMetricsHandler(EventLoopTimer* eventLoopTimer)
+{
+	LP_INTER_CORE_STATS stats;
+
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0)
+	{
+		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+		return;
+	}
+
+	lp_interCoreGetStats(&stats);
+
+	if (snprintf(msgBuffer, JSON_MESSAGE_BYTES, metricsTemplate,
+		stats.rttCount == 0 ? 0 : (unsigned int)(stats.rttTotal_us / stats.rttCount), lp_interCoreRttPercentile(&stats, 99),
+		(unsigned int)stats.rttMax_us, (unsigned int)stats.linkDowns, (unsigned int)stats.resyncs) > 0) {
+
+		Log_Debug("%s\n", msgBuffer);
+		lp_azureMsgSendWithProperties(msgBuffer, metricsMessageProperties, NELEMS(metricsMessageProperties));
+	}
+}
+
 /// <summary>
 /// Reset the Device
 /// </summary>
@@ -327,6 +447,8 @@ static void InitPeripheralAndHandlers(void)
 
 	ic_control_block.cmd = LP_IC_HEARTBEAT;		// Prime RT Core with Component ID Signature
 	lp_interCoreSendMessage(&ic_control_block, sizeof(ic_control_block));
+
+	lp_interCoreHeartbeatEnable(&interCoreHeartbeatPeriod, INTER_CORE_HEARTBEAT_MISS_LIMIT, InterCoreLinkHandler);
 }
 
 /// <summary>
@@ -336,6 +458,7 @@ static void ClosePeripheralAndHandlers(void)
 {
 	Log_Debug("Closing file descriptors\n");
 
+	lp_interCoreCallCancelAll();
 	lp_timerSetStop(timerSet, NELEMS(timerSet));
 	lp_azureToDeviceStop();
 
@@ -32,7 +32,7 @@ bool lp_initializeDevKit(void)
 
 	lp_imu_initialize();
 
-	//lp_calibrate_angular_rate(); // call if using gyro
+	//lp_calibrate_angular_rate_async(NULL); // call if using gyro, calibrates on the worker pool
 
 	//lp_OpenADC();
 
@@ -42,5 +42,7 @@ bool lp_initializeDevKit(void)
 bool lp_closeDevKit(void)
 {
 	//closeI2c();
+	lp_workerPoolStop();
+
 	return true;
 }
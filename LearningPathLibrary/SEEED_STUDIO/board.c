@@ -25,5 +25,7 @@ bool lp_initializeDevKit(void) {
 
 bool lp_closeDevKit(void) {
 
+	lp_workerPoolStop();
+
 	return true;
 }
\ No newline at end of file
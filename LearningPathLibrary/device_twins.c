@@ -1,18 +1,30 @@
 #include "device_twins.h"
 
-static void setDesiredState(JSON_Object* desiredProperties, LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
+static void setDesiredState(JSON_Object* desiredProperties, JSON_Value* jsonValue, LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
 static bool deviceTwinUpdateReportedState(char* reportedPropertiesString);
 static bool deviceTwinReportState(LP_DEVICE_TWIN_BINDING* deviceTwinBinding, void* state, bool deviceTwinAcknowledgment, LP_DEVICE_TWIN_RESPONSE_CODE statusCode);
 
 
 static LP_DEVICE_TWIN_BINDING** _deviceTwins = NULL;
 static size_t _deviceTwinCount = 0;
+static JSON_Path* _desiredPath = NULL;
+static JSON_Path* _versionPath = NULL;
 
 
 void lp_deviceTwinSetOpen(LP_DEVICE_TWIN_BINDING* deviceTwins[], size_t deviceTwinCount) {
 	_deviceTwins = deviceTwins;
 	_deviceTwinCount = deviceTwinCount;
 
+	if (_desiredPath == NULL) {
+		_desiredPath = json_path_compile("desired");
+	}
+	if (_versionPath == NULL) {
+		_versionPath = json_path_compile("$version");
+	}
+	if (_desiredPath == NULL || _versionPath == NULL) {
+		Log_Debug("ERROR: Device Twin paths not compiled, falling back to dotget lookups\n");
+	}
+
 	for (int i = 0; i < _deviceTwinCount; i++) {
 		lp_deviceTwinOpen(_deviceTwins[i]);
 	}
@@ -20,6 +32,11 @@ void lp_deviceTwinSetOpen(LP_DEVICE_TWIN_BINDING* deviceTwins[], size_t deviceTw
 
 void lp_deviceTwinSetClose(void) {
 	for (int i = 0; i < _deviceTwinCount; i++) { lp_deviceTwinClose(_deviceTwins[i]); }
+
+	json_path_free(_desiredPath);
+	_desiredPath = NULL;
+	json_path_free(_versionPath);
+	_versionPath = NULL;
 }
 
 void lp_deviceTwinOpen(LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
@@ -28,6 +45,11 @@ void lp_deviceTwinOpen(LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
 		lp_terminate(ExitCode_OpenDeviceTwin);
 	}
 
+	// Twin property names cannot contain '.', so the path is the one key
+	if (deviceTwinBinding->twinPath == NULL) {
+		deviceTwinBinding->twinPath = json_path_compile(deviceTwinBinding->twinProperty);
+	}
+
 	// types JSON and String allocated dynamically when called in azure_iot.c
 	switch (deviceTwinBinding->twinType) {
 	case LP_TYPE_INT:
@@ -51,6 +73,9 @@ void lp_deviceTwinOpen(LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
 }
 
 void lp_deviceTwinClose(LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
+	json_path_free(deviceTwinBinding->twinPath);
+	deviceTwinBinding->twinPath = NULL;
+
 	if (deviceTwinBinding->twinState != NULL) {
 		free(deviceTwinBinding->twinState);
 		deviceTwinBinding->twinState = NULL;
@@ -75,7 +100,7 @@ void lp_twinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned char*
 	memcpy(payLoadString, payload, payloadSize);
 	payLoadString[payloadSize] = 0; //null terminate string
 
-	root_value = json_parse_string(payLoadString);
+	root_value = json_parse_string_in_situ(payLoadString);
 	if (root_value == NULL) {
 		goto cleanup;
 	}
@@ -85,15 +110,20 @@ void lp_twinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned char*
 		goto cleanup;
 	}
 
-	JSON_Object* desiredProperties = json_object_dotget_object(root_object, "desired");
+	// A full twin document holds the desired properties under "desired", a patch is the desired properties
+	JSON_Object* desiredProperties = _desiredPath != NULL
+		? json_object_pathget_object(root_object, _desiredPath)
+		: json_object_dotget_object(root_object, "desired");
 	if (desiredProperties == NULL) {
 		desiredProperties = root_object;
 	}
 
 	for (int i = 0; i < _deviceTwinCount; i++) {
-		JSON_Value* jsonValue = json_object_get_value(desiredProperties, _deviceTwins[i]->twinProperty);
+		JSON_Value* jsonValue = _deviceTwins[i]->twinPath != NULL
+			? json_object_pathget_value(desiredProperties, _deviceTwins[i]->twinPath)
+			: json_object_get_value(desiredProperties, _deviceTwins[i]->twinProperty);
 		if (jsonValue != NULL) {
-			setDesiredState(desiredProperties, _deviceTwins[i]);
+			setDesiredState(desiredProperties, jsonValue, _deviceTwins[i]);
 		}
 	}
 
@@ -110,18 +140,21 @@ void lp_twinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned char*
 }
 
 /// <summary>
-///     Checks to see if the device twin twinProperty(name) is found in the json object. If yes, then act upon the request
+///     Acts on the desired state jsonValue found for the device twin twinProperty(name) in the json object
 /// </summary>
-static void setDesiredState(JSON_Object* jsonObject, LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
+static void setDesiredState(JSON_Object* jsonObject, JSON_Value* jsonValue, LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
+	JSON_Value* version = _versionPath != NULL
+		? json_object_pathget_value(jsonObject, _versionPath)
+		: json_object_get_value(jsonObject, "$version");
 
-	if (json_object_has_value_of_type(jsonObject, "$version", JSONNumber)) {
-		deviceTwinBinding->twinVersion = (int)json_object_get_number(jsonObject, "$version");
+	if (json_value_get_type(version) == JSONNumber) {
+		deviceTwinBinding->twinVersion = (int)json_value_get_number(version);
 	}
 
 	switch (deviceTwinBinding->twinType) {
 	case LP_TYPE_INT:
-		if (json_object_has_value_of_type(jsonObject, deviceTwinBinding->twinProperty, JSONNumber)) {
-			*(int*)deviceTwinBinding->twinState = (int)json_object_get_number(jsonObject, deviceTwinBinding->twinProperty);
+		if (json_value_get_type(jsonValue) == JSONNumber) {
+			*(int*)deviceTwinBinding->twinState = (int)json_value_get_number(jsonValue);
 
 			deviceTwinBinding->twinStateUpdated = true;
 
@@ -131,8 +164,8 @@ static void setDesiredState(JSON_Object* jsonObject, LP_DEVICE_TWIN_BINDING* dev
 		}
 		break;
 	case LP_TYPE_FLOAT:
-		if (json_object_has_value_of_type(jsonObject, deviceTwinBinding->twinProperty, JSONNumber)) {
-			*(float*)deviceTwinBinding->twinState = (float)json_object_get_number(jsonObject, deviceTwinBinding->twinProperty);
+		if (json_value_get_type(jsonValue) == JSONNumber) {
+			*(float*)deviceTwinBinding->twinState = (float)json_value_get_number(jsonValue);
 
 			deviceTwinBinding->twinStateUpdated = true;
 
@@ -142,8 +175,8 @@ static void setDesiredState(JSON_Object* jsonObject, LP_DEVICE_TWIN_BINDING* dev
 		}
 		break;
 	case LP_TYPE_BOOL:
-		if (json_object_has_value_of_type(jsonObject, deviceTwinBinding->twinProperty, JSONBoolean)) {
-			*(bool*)deviceTwinBinding->twinState = (bool)json_object_get_boolean(jsonObject, deviceTwinBinding->twinProperty);
+		if (json_value_get_type(jsonValue) == JSONBoolean) {
+			*(bool*)deviceTwinBinding->twinState = (bool)json_value_get_boolean(jsonValue);
 
 			deviceTwinBinding->twinStateUpdated = true;
 
@@ -153,8 +186,8 @@ static void setDesiredState(JSON_Object* jsonObject, LP_DEVICE_TWIN_BINDING* dev
 		}
 		break;
 	case LP_TYPE_STRING:
-		if (json_object_has_value_of_type(jsonObject, deviceTwinBinding->twinProperty, JSONString)) {
-			deviceTwinBinding->twinState = (char*)json_object_get_string(jsonObject, deviceTwinBinding->twinProperty);
+		if (json_value_get_type(jsonValue) == JSONString) {
+			deviceTwinBinding->twinState = (char*)json_value_get_string(jsonValue);
 
 			if (deviceTwinBinding->handler != NULL) {
 				deviceTwinBinding->handler(deviceTwinBinding);
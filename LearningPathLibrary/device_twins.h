@@ -20,6 +20,7 @@ struct _deviceTwinBinding {
 	bool twinStateUpdated;
 	LP_DEVICE_TWIN_TYPE twinType;
 	void (*handler)(struct _deviceTwinBinding* deviceTwinBinding);
+	JSON_Path* twinPath;	// compiled from twinProperty by lp_deviceTwinOpen
 };
 
 typedef enum
@@ -55,7 +55,7 @@ int lp_directMethodHandler(const char* method_name, const unsigned char* payload
 	memcpy(payLoadString, payload, payloadSize);
 	payLoadString[payloadSize] = 0; //null terminate string
 
-	root_value = json_parse_string(payLoadString);
+	root_value = json_parse_string_in_situ(payLoadString);
 	if (root_value == NULL)
 	{
 		responseMessage = invalidJsonMsg;
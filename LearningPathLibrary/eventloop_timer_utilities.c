@@ -17,14 +17,31 @@
 static int SetTimerPeriod(int timerFd, const struct timespec *initial,
                           const struct timespec *repeat);
 
+static struct timespec timerGrid = {.tv_sec = 0, .tv_nsec = 0};
+
 static int SetTimerPeriod(int timerFd, const struct timespec *initial,
                           const struct timespec *repeat)
 {
     static const struct timespec nullTimeSpec = {.tv_sec = 0, .tv_nsec = 0};
     struct itimerspec newValue = {.it_value = initial ? *initial : nullTimeSpec,
                                   .it_interval = repeat ? *repeat : nullTimeSpec};
+    int flags = 0;
+
+    // Align the first expiry to the grid, so timers with periods that are multiples of the
+    // grid expire together.
+    uint64_t grid = (uint64_t)timerGrid.tv_sec * 1000000000 + (uint64_t)timerGrid.tv_nsec;
+    if (grid != 0 && (newValue.it_value.tv_sec != 0 || newValue.it_value.tv_nsec != 0)) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t expires = (uint64_t)(now.tv_sec + newValue.it_value.tv_sec) * 1000000000 +
+                           (uint64_t)(now.tv_nsec + newValue.it_value.tv_nsec);
+        expires = (expires + grid - 1) / grid * grid;
+        newValue.it_value.tv_sec = (time_t)(expires / 1000000000);
+        newValue.it_value.tv_nsec = (long)(expires % 1000000000);
+        flags = TFD_TIMER_ABSTIME;
+    }
 
-    if (timerfd_settime(timerFd, /* flags */ 0, &newValue, /* old_value */ NULL) < 0) {
+    if (timerfd_settime(timerFd, flags, &newValue, /* old_value */ NULL) < 0) {
         Log_Debug("ERROR: Could not set timer period: %s (%d).\n", strerror(errno), errno);
         return -1;
     }
@@ -37,14 +54,48 @@ struct EventLoopTimer {
     EventLoopTimerHandler handler;
     int fd;
     EventRegistration *registration;
+    LP_PROFILE *profile;
+    uint64_t deadline; // Next expiry in ns on CLOCK_MONOTONIC, 0 when disarmed.
+    uint64_t period;   // In ns, 0 for a one shot or disarmed timer.
 };
 
+static EventLoopTimerStats timerStats;
+
+// Remember when the timerfd will next expire, so the handler lag can be measured.
+static void TrackDeadline(EventLoopTimer *timer)
+{
+#ifdef LP_PROFILE_ENABLED
+    struct itimerspec value;
+
+    if (timer->profile == NULL || timerfd_gettime(timer->fd, &value) == -1) {
+        return;
+    }
+
+    timer->period = (uint64_t)value.it_interval.tv_sec * 1000000000 + (uint64_t)value.it_interval.tv_nsec;
+    timer->deadline = 0;
+    if (value.it_value.tv_sec != 0 || value.it_value.tv_nsec != 0) {
+        timer->deadline = lp_profileNow() + (uint64_t)value.it_value.tv_sec * 1000000000 +
+                          (uint64_t)value.it_value.tv_nsec;
+    }
+#endif
+}
+
 // This satisfies the EventLoopIoCallback signature.
 static void TimerCallback(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
 {
     EventLoopTimer *timer = (EventLoopTimer *)context;
 
+    timerStats.wakeups++;
+#ifdef LP_PROFILE_ENABLED
+    // The handler may dispose of the timer, so nothing in it is touched afterwards.
+    LP_PROFILE *profile = timer->profile;
+    uint64_t deadline = timer->deadline;
+    uint64_t start = lp_profileNow();
     timer->handler(timer);
+    lp_profileRecord(profile, deadline, start, 0);
+#else
+    timer->handler(timer);
+#endif
 }
 
 EventLoopTimer *CreateEventLoopPeriodicTimer(EventLoop *eventLoop, EventLoopTimerHandler handler,
@@ -62,10 +113,14 @@ EventLoopTimer *CreateEventLoopPeriodicTimer(EventLoop *eventLoop, EventLoopTime
 
     timer->eventLoop = eventLoop;
     timer->handler = handler;
+    timerStats.timerCount++;
 
     // Initialize to unused values in case have to clean up partially initialized object.
     timer->fd = -1;
     timer->registration = NULL;
+    timer->profile = NULL;
+    timer->deadline = 0;
+    timer->period = 0;
 
     timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
     if (timer->fd == -1) {
@@ -83,6 +138,7 @@ EventLoopTimer *CreateEventLoopPeriodicTimer(EventLoop *eventLoop, EventLoopTime
         Log_Debug("ERROR: Unable to register timer event: %s (%d).\n", strerror(errno), errno);
         goto failed;
     }
+    timerStats.fdCount++;
 
     return timer;
 
@@ -103,11 +159,15 @@ void DisposeEventLoopTimer(EventLoopTimer *timer)
     }
 
     EventLoop_UnregisterIo(timer->eventLoop, timer->registration);
+    if (timer->registration != NULL) {
+        timerStats.fdCount--;
+    }
 
     if (timer->fd != -1) {
         close(timer->fd);
     }
 
+    timerStats.timerCount--;
     free(timer);
 }
 
@@ -120,20 +180,56 @@ int ConsumeEventLoopTimerEvent(EventLoopTimer *timer)
         return -1;
     }
 
+#ifdef LP_PROFILE_ENABLED
+    // More than one expiration means the handler ran late and periods were missed.
+    if (timer->profile != NULL && timerData > 1) {
+        timer->profile->missed += timerData - 1;
+    }
+    timer->deadline = timer->period == 0 ? 0 : timer->deadline + timerData * timer->period;
+#endif
+
     return 0;
 }
 
 int SetEventLoopTimerPeriod(EventLoopTimer *timer, const struct timespec *period)
 {
-    return SetTimerPeriod(timer->fd, /* initial */ period, /* period */ period);
+    int result = SetTimerPeriod(timer->fd, /* initial */ period, /* period */ period);
+    TrackDeadline(timer);
+    return result;
 }
 
 int SetEventLoopTimerOneShot(EventLoopTimer *timer, const struct timespec *delay)
 {
-    return SetTimerPeriod(timer->fd, /* initial */ delay, /* repeat */ NULL);
+    int result = SetTimerPeriod(timer->fd, /* initial */ delay, /* repeat */ NULL);
+    TrackDeadline(timer);
+    return result;
 }
 
 int DisarmEventLoopTimer(EventLoopTimer *timer)
 {
-    return SetTimerPeriod(timer->fd, /* initial */ NULL, /* repeat */ NULL);
+    int result = SetTimerPeriod(timer->fd, /* initial */ NULL, /* repeat */ NULL);
+    TrackDeadline(timer);
+    return result;
+}
+
+void GetEventLoopTimerStats(EventLoopTimerStats *stats)
+{
+    *stats = timerStats;
+}
+
+int SetEventLoopTimerSlack(EventLoopTimer *timer, const struct timespec *slack)
+{
+    // Each timer has its own timerfd here, so there is nothing to coalesce with.
+    return 0;
+}
+
+void SetEventLoopTimerProfile(EventLoopTimer *timer, LP_PROFILE *profile)
+{
+    timer->profile = profile;
+    TrackDeadline(timer);
+}
+
+void SetEventLoopTimerGrid(const struct timespec *grid)
+{
+    timerGrid = grid ? *grid : (struct timespec){.tv_sec = 0, .tv_nsec = 0};
 }
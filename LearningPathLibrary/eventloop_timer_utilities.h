@@ -8,6 +8,8 @@
 
 #include <applibs/eventloop.h>
 
+#include "loop_profile.h"
+
 /// <summary>
 /// Opaque handle. Obtain via <see cref="CreateEventLoopPeriodicTimer" />
 /// or <see cref="CreateEventLoopDisarmedTimer" /> and dispose of via
@@ -100,3 +102,48 @@ int SetEventLoopTimerOneShot(EventLoopTimer *timer, const struct timespec *delay
 /// <seealso cref="SetEventLoopTimerOneShot" />
 /// <seealso cref="SetEventLoopTimerPeriod" />
 int DisarmEventLoopTimer(EventLoopTimer *timer);
+
+/// <summary>
+/// Allow the timer to expire up to <paramref name="slack" /> after its deadline, so it can
+/// share a wakeup with other timers. Only the LP_TIMER_WHEEL backend coalesces timers; with
+/// the default backend this has no effect.
+/// </summary>
+/// <param name="timer">LP_TIMER previously allocated with <see cref="CreateEventLoopPeriodicTimer" />
+/// or <see cref="CreateEventLoopDisarmedTimer" />.</param>
+/// <param name="slack">How late the timer may expire, or NULL for no slack.</param>
+/// <returns>0 on success, -1 on failure, in which case errno contains more information.</returns>
+int SetEventLoopTimerSlack(EventLoopTimer *timer, const struct timespec *slack);
+
+/// <summary>
+/// Align the first expiry of timers armed from now on to a multiple of <paramref name="grid" />
+/// on CLOCK_MONOTONIC. Periodic timers whose periods are multiples of the grid then expire
+/// together whenever their deadlines meet.
+/// </summary>
+/// <param name="grid">Alignment grid, or NULL to stop aligning.</param>
+void SetEventLoopTimerGrid(const struct timespec *grid);
+
+/// <summary>
+/// Record handler invocations, run time, missed expirations and lag for this timer into
+/// <paramref name="profile" />. Only has an effect when built with LP_PROFILE_ENABLED.
+/// </summary>
+/// <param name="timer">LP_TIMER previously allocated with <see cref="CreateEventLoopPeriodicTimer" />
+/// or <see cref="CreateEventLoopDisarmedTimer" />.</param>
+/// <param name="profile">Profile to record into, or NULL to stop recording.</param>
+void SetEventLoopTimerProfile(EventLoopTimer *timer, LP_PROFILE *profile);
+
+/// <summary>
+/// Counters describing how timers are multiplexed onto the event loop.
+/// </summary>
+typedef struct {
+    unsigned int timerCount; // Timers currently allocated.
+    unsigned int fdCount;    // File descriptors registered with the event loop for timers.
+    unsigned long wakeups;   // Timer events dispatched by the event loop since start.
+} EventLoopTimerStats;
+
+/// <summary>
+/// Get the timer counters. Sampling <c>wakeups</c> twice gives the wakeup rate, which can be
+/// compared between the default backend (one timerfd per timer) and the LP_TIMER_WHEEL
+/// backend (one timerfd for all timers).
+/// </summary>
+/// <param name="stats">Receives the current counters.</param>
+void GetEventLoopTimerStats(EventLoopTimerStats *stats);
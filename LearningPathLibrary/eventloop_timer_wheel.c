@@ -0,0 +1,502 @@
+/* Timer wheel implementation of eventloop_timer_utilities.h.
+
+   Every EventLoopTimer lives in one hierarchical timer wheel which is driven by a single
+   timerfd registered with the event loop, instead of one timerfd and one event registration
+   per timer. Select it with the LP_TIMER_WHEEL CMake option.
+
+   The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots. Level 0 slots are one tick (1 ms)
+   wide; each higher level slot spans a whole lower level. A timer is linked into the lowest
+   level that can hold its deadline and moves down (cascades) as the deadline approaches, so
+   starting and stopping a timer is O(1). The timerfd is armed for the earliest deadline only,
+   so cascading never costs an extra wakeup.
+
+   A timer with slack may fire up to slack later than its deadline. The timerfd is armed for
+   the earliest deadline plus slack, and every timer whose deadline has passed by then fires
+   in the same wakeup. Finding that expiry only visits the slots due before it. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <applibs/log.h>
+#include <applibs/eventloop.h>
+
+#include "eventloop_timer_utilities.h"
+
+#define WHEEL_LEVELS 4
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVEL_SHIFT(level) ((level) * WHEEL_SLOT_BITS)
+// Ticks covered by the whole wheel, 2^24 ms is about 4.6 hours. Later deadlines are parked
+// in the last slot reachable and relinked when they cascade.
+#define WHEEL_RANGE ((uint64_t)1 << WHEEL_LEVEL_SHIFT(WHEEL_LEVELS))
+#define NS_PER_TICK 1000000L
+#define TICK_NEVER UINT64_MAX
+
+struct EventLoopTimer {
+    EventLoopTimerHandler handler;
+    uint64_t expires;     // Absolute deadline in ticks.
+    uint64_t period;      // In ticks, 0 for a one shot or disarmed timer.
+    uint64_t expirations; // Expirations not yet consumed, as a timerfd would report.
+    uint64_t slack;       // In ticks, how late the timer may fire to share a wakeup.
+    LP_PROFILE *profile;
+    bool linked;
+    int level;
+    int slot;
+    EventLoopTimer *prev;
+    EventLoopTimer *next;
+};
+
+typedef struct {
+    EventLoop *eventLoop;
+    int fd;
+    EventRegistration *registration;
+    uint64_t now;      // Tick the wheel has been advanced to.
+    uint64_t armedFor; // Tick the timerfd is armed for, TICK_NEVER when disarmed.
+    unsigned int timerCount;
+    unsigned int slackCount; // Timers with non zero slack.
+    unsigned long wakeups;
+    uint64_t grid; // In ticks, first deadlines are aligned to multiples of it when non zero.
+    uint64_t occupied[WHEEL_LEVELS]; // One bit per non empty slot.
+    EventLoopTimer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+} TimerWheel;
+
+static TimerWheel wheel = {.fd = -1, .armedFor = TICK_NEVER};
+
+static uint64_t GetTicks(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)(now.tv_nsec / NS_PER_TICK);
+}
+
+// Rounds up, so a timer never fires early.
+static uint64_t TimespecToTicks(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000 + (uint64_t)((ts->tv_nsec + NS_PER_TICK - 1) / NS_PER_TICK);
+}
+
+static bool IsZeroTimespec(const struct timespec *ts)
+{
+    return ts == NULL || (ts->tv_sec == 0 && ts->tv_nsec == 0);
+}
+
+// Rotates a slot bitmap so bit 0 is the slot at index start.
+static uint64_t RotateSlots(uint64_t occupied, int start)
+{
+    return start == 0 ? occupied : (occupied >> start) | (occupied << (WHEEL_SLOTS - start));
+}
+
+static void WheelLink(EventLoopTimer *timer)
+{
+    // A deadline of the current tick only reaches here by cascading, before that tick's level 0
+    // slot fires, so it can stay in that slot. Anything already past moves to the next tick.
+    uint64_t at = timer->expires < wheel.now ? wheel.now + 1 : timer->expires;
+    uint64_t delta = at - wheel.now;
+    int level = 0;
+
+    if (delta >= WHEEL_RANGE) {
+        at = wheel.now + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+
+    while (delta >= ((uint64_t)1 << WHEEL_LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+
+    timer->level = level;
+    timer->slot = (int)((at >> WHEEL_LEVEL_SHIFT(level)) & WHEEL_SLOT_MASK);
+    timer->prev = NULL;
+    timer->next = wheel.slots[level][timer->slot];
+    if (timer->next != NULL) {
+        timer->next->prev = timer;
+    }
+    wheel.slots[level][timer->slot] = timer;
+    wheel.occupied[level] |= (uint64_t)1 << timer->slot;
+    timer->linked = true;
+}
+
+static void WheelUnlink(EventLoopTimer *timer)
+{
+    if (!timer->linked) {
+        return;
+    }
+
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel.slots[timer->level][timer->slot] = timer->next;
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+    if (wheel.slots[timer->level][timer->slot] == NULL) {
+        wheel.occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+    }
+    timer->linked = false;
+}
+
+// Tick of the next level 0 slot to fire or higher level slot to cascade.
+static uint64_t WheelNextEventTick(void)
+{
+    uint64_t next = TICK_NEVER;
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (wheel.occupied[level] == 0) {
+            continue;
+        }
+        int shift = WHEEL_LEVEL_SHIFT(level);
+        // Level 0 holds the current tick onwards, higher levels start with the next slot.
+        uint64_t first = (wheel.now >> shift) + (level == 0 ? 0 : 1);
+        uint64_t bits = RotateSlots(wheel.occupied[level], (int)(first & WHEEL_SLOT_MASK));
+        uint64_t tick = (first + (uint64_t)__builtin_ctzll(bits)) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+// Earliest deadline plus slack of any timer. Each level is searched slot by slot in deadline
+// order, and a level is left at the first slot starting at or after the best expiry found, as
+// nothing in it can fire sooner. Only timers due before the earliest deadline plus its slack
+// are visited, not every timer.
+static uint64_t WheelNextSlackExpiry(void)
+{
+    uint64_t next = TICK_NEVER;
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_LEVEL_SHIFT(level);
+        uint64_t first = (wheel.now >> shift) + (level == 0 ? 0 : 1);
+        uint64_t bits = RotateSlots(wheel.occupied[level], (int)(first & WHEEL_SLOT_MASK));
+        for (; bits != 0; bits &= bits - 1) {
+            uint64_t index = first + (uint64_t)__builtin_ctzll(bits);
+            if ((index << shift) >= next) {
+                break;
+            }
+            int slot = (int)(index & WHEEL_SLOT_MASK);
+            for (EventLoopTimer *timer = wheel.slots[level][slot]; timer != NULL; timer = timer->next) {
+                uint64_t expires = timer->expires <= wheel.now ? wheel.now + 1 : timer->expires;
+                if (expires + timer->slack < next) {
+                    next = expires + timer->slack;
+                }
+            }
+        }
+    }
+
+    return next;
+}
+
+// Earliest deadline in the wheel, used to arm the timerfd.
+static uint64_t WheelNextExpiry(void)
+{
+    uint64_t next = TICK_NEVER;
+
+    if (wheel.slackCount != 0) {
+        return WheelNextSlackExpiry();
+    }
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (wheel.occupied[level] == 0) {
+            continue;
+        }
+        int shift = WHEEL_LEVEL_SHIFT(level);
+        uint64_t first = (wheel.now >> shift) + (level == 0 ? 0 : 1);
+        uint64_t bits = RotateSlots(wheel.occupied[level], (int)(first & WHEEL_SLOT_MASK));
+        int slot = (int)((first + (uint64_t)__builtin_ctzll(bits)) & WHEEL_SLOT_MASK);
+        for (EventLoopTimer *timer = wheel.slots[level][slot]; timer != NULL; timer = timer->next) {
+            uint64_t expires = timer->expires <= wheel.now ? wheel.now + 1 : timer->expires;
+            if (expires < next) {
+                next = expires;
+            }
+        }
+    }
+
+    return next;
+}
+
+static int WheelArm(uint64_t tick)
+{
+    struct itimerspec newValue = {.it_value = {0, 0}, .it_interval = {0, 0}};
+
+    if (tick != TICK_NEVER) {
+        newValue.it_value.tv_sec = (time_t)(tick / 1000);
+        newValue.it_value.tv_nsec = (long)(tick % 1000) * NS_PER_TICK;
+    }
+
+    if (timerfd_settime(wheel.fd, TFD_TIMER_ABSTIME, &newValue, /* old_value */ NULL) < 0) {
+        Log_Debug("ERROR: Could not set timer period: %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+
+    wheel.armedFor = tick;
+    return 0;
+}
+
+// Rearms the timerfd if the earliest deadline has moved. A deadline that moved later only
+// costs a spurious wakeup, so that case is left alone unless forced.
+static int WheelRearm(bool force)
+{
+    uint64_t next = WheelNextExpiry();
+
+    if (next < wheel.armedFor || (force && next != wheel.armedFor)) {
+        return WheelArm(next);
+    }
+
+    return 0;
+}
+
+static void WheelFire(EventLoopTimer *timer, uint64_t now)
+{
+    uint64_t elapsed = 1;
+#ifdef LP_PROFILE_ENABLED
+    // The handler may dispose of the timer, so nothing in it is touched afterwards.
+    LP_PROFILE *profile = timer->profile;
+    uint64_t deadline = timer->expires * NS_PER_TICK;
+#endif
+
+    WheelUnlink(timer);
+
+    if (timer->period != 0) {
+        // Skip periods missed by a late wakeup and count them, as timerfd does.
+        elapsed += now > timer->expires ? (now - timer->expires) / timer->period : 0;
+        timer->expirations += elapsed;
+        timer->expires += elapsed * timer->period;
+        WheelLink(timer);
+    } else {
+        timer->expirations++;
+    }
+
+#ifdef LP_PROFILE_ENABLED
+    uint64_t start = lp_profileNow();
+    timer->handler(timer);
+    lp_profileRecord(profile, deadline, start, elapsed - 1);
+#else
+    timer->handler(timer);
+#endif
+}
+
+static void WheelAdvance(uint64_t target)
+{
+    uint64_t tick;
+
+    while ((tick = WheelNextEventTick()) <= target) {
+        wheel.now = tick;
+
+        // Cascade higher levels first, so timers can drop more than one level at once.
+        for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+            int shift = WHEEL_LEVEL_SHIFT(level);
+            if ((tick & (((uint64_t)1 << shift) - 1)) != 0) {
+                continue;
+            }
+            int slot = (int)((tick >> shift) & WHEEL_SLOT_MASK);
+            EventLoopTimer *timer;
+            while ((timer = wheel.slots[level][slot]) != NULL) {
+                WheelUnlink(timer);
+                WheelLink(timer);
+            }
+        }
+
+        // Handlers may start, stop or dispose any timer, so always take the current head.
+        EventLoopTimer *timer;
+        while ((timer = wheel.slots[0][tick & WHEEL_SLOT_MASK]) != NULL) {
+            WheelFire(timer, target);
+        }
+    }
+
+    if (target > wheel.now) { // A handler may have reopened the wheel at a later tick.
+        wheel.now = target;
+    }
+}
+
+// This satisfies the EventLoopIoCallback signature.
+static void WheelCallback(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    uint64_t timerData = 0;
+
+    if (read(wheel.fd, &timerData, sizeof(timerData)) == -1 && errno != EAGAIN) {
+        Log_Debug("ERROR: Could not read timerfd %s (%d).\n", strerror(errno), errno);
+    }
+
+    wheel.wakeups++;
+    wheel.armedFor = TICK_NEVER;
+
+    WheelAdvance(GetTicks());
+    WheelRearm(true);
+}
+
+static int WheelOpen(EventLoop *eventLoop)
+{
+    if (wheel.fd != -1) {
+        if (wheel.eventLoop != eventLoop) {
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    wheel.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (wheel.fd == -1) {
+        Log_Debug("ERROR: Unable to create timer: %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+
+    wheel.registration =
+        EventLoop_RegisterIo(eventLoop, wheel.fd, EventLoop_Input, WheelCallback, NULL);
+    if (wheel.registration == NULL) {
+        Log_Debug("ERROR: Unable to register timer event: %s (%d).\n", strerror(errno), errno);
+        close(wheel.fd);
+        wheel.fd = -1;
+        return -1;
+    }
+
+    wheel.eventLoop = eventLoop;
+    wheel.now = GetTicks();
+    wheel.armedFor = TICK_NEVER;
+
+    return 0;
+}
+
+static void WheelClose(void)
+{
+    EventLoop_UnregisterIo(wheel.eventLoop, wheel.registration);
+    close(wheel.fd);
+
+    wheel = (TimerWheel){
+        .fd = -1, .armedFor = TICK_NEVER, .wakeups = wheel.wakeups, .grid = wheel.grid};
+}
+
+static int SetTimerPeriod(EventLoopTimer *timer, const struct timespec *initial,
+                          const struct timespec *repeat)
+{
+    WheelUnlink(timer);
+
+    timer->period = IsZeroTimespec(repeat) ? 0 : TimespecToTicks(repeat);
+    if (IsZeroTimespec(initial)) { // A zero initial value disarms, as with timerfd_settime.
+        timer->period = 0;
+        return WheelRearm(false);
+    }
+
+    // GetTicks truncates, count the current partial tick too so the timer never fires early.
+    timer->expires = GetTicks() + 1 + TimespecToTicks(initial);
+    if (wheel.grid != 0) {
+        timer->expires = (timer->expires + wheel.grid - 1) / wheel.grid * wheel.grid;
+    }
+    WheelLink(timer);
+
+    return WheelRearm(false);
+}
+
+EventLoopTimer *CreateEventLoopPeriodicTimer(EventLoop *eventLoop, EventLoopTimerHandler handler,
+                                             const struct timespec *period)
+{
+    if (handler == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (WheelOpen(eventLoop) == -1) {
+        return NULL;
+    }
+
+    EventLoopTimer *timer = calloc(1, sizeof(EventLoopTimer));
+    if (timer == NULL) {
+        if (wheel.timerCount == 0) {
+            WheelClose();
+        }
+        return NULL;
+    }
+
+    timer->handler = handler;
+    wheel.timerCount++;
+
+    if (SetTimerPeriod(timer, /* initial */ period, /* repeat */ period) == -1) {
+        DisposeEventLoopTimer(timer);
+        return NULL;
+    }
+
+    return timer;
+}
+
+EventLoopTimer *CreateEventLoopDisarmedTimer(EventLoop *eventLoop, EventLoopTimerHandler handler)
+{
+    return CreateEventLoopPeriodicTimer(eventLoop, handler, NULL);
+}
+
+void DisposeEventLoopTimer(EventLoopTimer *timer)
+{
+    if (timer == NULL) {
+        return;
+    }
+
+    WheelUnlink(timer);
+    if (timer->slack != 0) {
+        wheel.slackCount--;
+    }
+    free(timer);
+
+    if (--wheel.timerCount == 0) {
+        WheelClose();
+    }
+}
+
+int ConsumeEventLoopTimerEvent(EventLoopTimer *timer)
+{
+    // The shared timerfd is consumed by the wheel, so only the per timer count is reset. No
+    // pending expirations is benign: the handler was called directly, or consumed the event twice.
+    timer->expirations = 0;
+    return 0;
+}
+
+int SetEventLoopTimerPeriod(EventLoopTimer *timer, const struct timespec *period)
+{
+    return SetTimerPeriod(timer, /* initial */ period, /* period */ period);
+}
+
+int SetEventLoopTimerOneShot(EventLoopTimer *timer, const struct timespec *delay)
+{
+    return SetTimerPeriod(timer, /* initial */ delay, /* repeat */ NULL);
+}
+
+int DisarmEventLoopTimer(EventLoopTimer *timer)
+{
+    return SetTimerPeriod(timer, /* initial */ NULL, /* repeat */ NULL);
+}
+
+int SetEventLoopTimerSlack(EventLoopTimer *timer, const struct timespec *slack)
+{
+    uint64_t ticks = IsZeroTimespec(slack) ? 0 : TimespecToTicks(slack);
+
+    if (timer->slack == 0 && ticks != 0) {
+        wheel.slackCount++;
+    } else if (timer->slack != 0 && ticks == 0) {
+        wheel.slackCount--;
+    }
+    timer->slack = ticks;
+
+    return WheelRearm(false);
+}
+
+void SetEventLoopTimerProfile(EventLoopTimer *timer, LP_PROFILE *profile)
+{
+    timer->profile = profile;
+}
+
+void SetEventLoopTimerGrid(const struct timespec *grid)
+{
+    wheel.grid = IsZeroTimespec(grid) ? 0 : TimespecToTicks(grid);
+}
+
+void GetEventLoopTimerStats(EventLoopTimerStats *stats)
+{
+    stats->timerCount = wheel.timerCount;
+    stats->fdCount = wheel.fd == -1 ? 0 : 1;
+    stats->wakeups = wheel.wakeups;
+}
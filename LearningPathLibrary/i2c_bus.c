@@ -0,0 +1,368 @@
+#include "i2c_bus.h"
+#include <applibs/log.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * I2C bus manager.
+ *
+ * Drivers used to open and configure an ISU themselves, so two drivers on one bus each set
+ * its speed and could interleave transfers from different threads. Here each ISU is opened
+ * once, by the first device attached to it, and runs at the fastest speed every attached
+ * device supports. Transactions wait for the bus in priority order, first come first served
+ * within a priority, and the transfer itself runs without the lock held so others can queue
+ * meanwhile. A failed transfer gives the bus up and queues again, up to LP_I2C_MAX_RETRIES
+ * times, before failing with errno set. It only sleeps between retries for devices that set
+ * retryBackoff, as most are driven from the event loop, which must not sleep. Reads that change
+ * the device, popping a FIFO or clearing latched flags, go through lp_i2cWriteThenReadOnce and
+ * are never retried, since a short transfer may already have consumed what it did not return.
+ */
+
+typedef struct LP_I2C_WAITER {
+	LP_I2C_PRIORITY priority;
+	struct LP_I2C_WAITER* next;
+} LP_I2C_WAITER;
+
+typedef struct LP_I2C_BUS {
+	bool open;
+	I2C_InterfaceId isu;
+	int fd;
+	uint32_t speed;
+	LP_I2C_DEVICE* devices[LP_I2C_MAX_DEVICES];
+	size_t deviceCount;
+	bool busy;				// a transfer or a reconfiguration owns the bus
+	LP_I2C_WAITER* waiters;	// highest priority first
+} LP_I2C_BUS;
+
+static const uint32_t busSpeeds[] = { I2C_BUS_SPEED_FAST_PLUS, I2C_BUS_SPEED_FAST, I2C_BUS_SPEED_STANDARD };
+
+static LP_I2C_BUS buses[LP_I2C_MAX_BUSES];
+static pthread_mutex_t busLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t busReleased = PTHREAD_COND_INITIALIZER;
+
+static uint32_t BusNow_us(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)((uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000);
+}
+
+/// <summary>
+///     Wait for the bus behind the waiters of the same or higher priority. Called with busLock held
+/// </summary>
+static void AcquireBus(LP_I2C_BUS* bus, LP_I2C_PRIORITY priority) {
+	LP_I2C_WAITER self = { .priority = priority };
+	LP_I2C_WAITER** link = &bus->waiters;
+
+	while (*link != NULL && (*link)->priority >= priority) {
+		link = &(*link)->next;
+	}
+	self.next = *link;
+	*link = &self;
+
+	while (bus->busy || bus->waiters != &self) {
+		pthread_cond_wait(&busReleased, &busLock);
+	}
+
+	bus->waiters = self.next;
+	bus->busy = true;
+}
+
+static void ReleaseBus(LP_I2C_BUS* bus) {
+	bus->busy = false;
+	pthread_cond_broadcast(&busReleased);
+}
+
+static LP_I2C_BUS* FindBus(I2C_InterfaceId isu) {
+	for (size_t i = 0; i < LP_I2C_MAX_BUSES; i++) {
+		if (buses[i].open && buses[i].isu == isu) {
+			return &buses[i];
+		}
+	}
+	return NULL;
+}
+
+static LP_I2C_BUS* OpenBus(I2C_InterfaceId isu) {
+	for (size_t i = 0; i < LP_I2C_MAX_BUSES; i++) {
+		LP_I2C_BUS* bus = &buses[i];
+
+		if (!bus->open) {
+			if ((bus->fd = I2CMaster_Open(isu)) < 0) {
+				Log_Debug("ERROR: I2CMaster_Open: errno=%d (%s)\n", errno, strerror(errno));
+				return NULL;
+			}
+			if (I2CMaster_SetTimeout(bus->fd, 100) != 0) {
+				Log_Debug("ERROR: I2CMaster_SetTimeout: errno=%d (%s)\n", errno, strerror(errno));
+				close(bus->fd);
+				return NULL;
+			}
+			bus->open = true;
+			bus->isu = isu;
+			bus->speed = 0;
+			bus->deviceCount = 0;
+			return bus;
+		}
+	}
+
+	errno = ENOSPC;
+	return NULL;
+}
+
+static void CloseBus(LP_I2C_BUS* bus) {
+	if (close(bus->fd) != 0) {
+		Log_Debug("ERROR: Could not close fd i2c: %s (%d).\n", strerror(errno), errno);
+	}
+	bus->open = false;
+}
+
+/// <summary>
+///     Run the bus at the fastest speed every attached device supports, falling back to slower
+///     speeds if the ISU refuses one. Called with the bus acquired
+/// </summary>
+static bool NegotiateSpeed(LP_I2C_BUS* bus) {
+	uint32_t limit = I2C_BUS_SPEED_FAST_PLUS;
+
+	for (size_t i = 0; i < bus->deviceCount; i++) {
+		uint32_t maxSpeed = bus->devices[i]->maxSpeed != 0 ? bus->devices[i]->maxSpeed : I2C_BUS_SPEED_STANDARD;
+		if (maxSpeed < limit) {
+			limit = maxSpeed;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(busSpeeds) / sizeof(busSpeeds[0]); i++) {
+		if (busSpeeds[i] > limit) {
+			continue;
+		}
+		if (busSpeeds[i] == bus->speed) {
+			return true;
+		}
+		if (I2CMaster_SetBusSpeed(bus->fd, busSpeeds[i]) == 0) {
+			bus->speed = busSpeeds[i];
+			return true;
+		}
+		Log_Debug("ERROR: I2CMaster_SetBusSpeed %u: errno=%d (%s)\n", busSpeeds[i], errno, strerror(errno));
+	}
+
+	return false;
+}
+
+static void RemoveDevice(LP_I2C_BUS* bus, LP_I2C_DEVICE* device) {
+	for (size_t i = 0; i < bus->deviceCount; i++) {
+		if (bus->devices[i] == device) {
+			bus->devices[i] = bus->devices[--bus->deviceCount];
+			break;
+		}
+	}
+	device->bus = NULL;
+}
+
+/// <summary>
+///     Attach device to the ISU, opening it if this is the first device on it. The bus speed is
+///     renegotiated to suit every device now attached
+/// </summary>
+bool lp_i2cAttach(LP_I2C_DEVICE* device, I2C_InterfaceId isu) {
+	LP_I2C_BUS* bus;
+	bool ok;
+
+	pthread_mutex_lock(&busLock);
+
+	if (device->bus != NULL) {
+		pthread_mutex_unlock(&busLock);
+		return true;
+	}
+
+	if ((bus = FindBus(isu)) == NULL && (bus = OpenBus(isu)) == NULL) {
+		pthread_mutex_unlock(&busLock);
+		return false;
+	}
+
+	if (bus->deviceCount == LP_I2C_MAX_DEVICES) {
+		pthread_mutex_unlock(&busLock);
+		errno = ENOSPC;
+		return false;
+	}
+
+	AcquireBus(bus, LP_I2C_PRIORITY_HIGH);
+
+	memset(&device->stats, 0, sizeof(device->stats));
+	device->stats.latencyMin_us = UINT32_MAX;
+	device->bus = bus;
+	bus->devices[bus->deviceCount++] = device;
+
+	if (!(ok = NegotiateSpeed(bus))) {
+		RemoveDevice(bus, device);
+		if (bus->deviceCount == 0) {
+			CloseBus(bus);
+		}
+	}
+
+	ReleaseBus(bus);
+	pthread_mutex_unlock(&busLock);
+
+	return ok;
+}
+
+/// <summary>
+///     Detach device, closing the ISU once no device is left on it. The remaining devices may get
+///     a faster bus
+/// </summary>
+void lp_i2cDetach(LP_I2C_DEVICE* device) {
+	LP_I2C_BUS* bus;
+
+	pthread_mutex_lock(&busLock);
+
+	if ((bus = device->bus) != NULL) {
+		AcquireBus(bus, LP_I2C_PRIORITY_HIGH);
+		RemoveDevice(bus, device);
+
+		if (bus->deviceCount == 0) {
+			CloseBus(bus);
+		} else {
+			NegotiateSpeed(bus);
+		}
+		ReleaseBus(bus);
+	}
+
+	pthread_mutex_unlock(&busLock);
+}
+
+/// <summary>
+///     Returns the speed the ISU runs at, 0 if it is not open
+/// </summary>
+uint32_t lp_i2cBusSpeed(I2C_InterfaceId isu) {
+	LP_I2C_BUS* bus;
+	uint32_t speed;
+
+	pthread_mutex_lock(&busLock);
+	speed = (bus = FindBus(isu)) != NULL ? bus->speed : 0;
+	pthread_mutex_unlock(&busLock);
+
+	return speed;
+}
+
+static void RecordLatency(LP_I2C_STATS* stats, uint32_t wait_us, uint32_t latency_us) {
+	if (wait_us > stats->waitMax_us) {
+		stats->waitMax_us = wait_us;
+	}
+	if (latency_us < stats->latencyMin_us) {
+		stats->latencyMin_us = latency_us;
+	}
+	if (latency_us > stats->latencyMax_us) {
+		stats->latencyMax_us = latency_us;
+	}
+	stats->latencyTotal_us += latency_us;
+}
+
+/// <summary>
+///     Run one transfer for device, retrying failures. The device may be detached, and its bus
+///     closed, by another thread while this waits for the bus, so the bus is looked up under
+///     busLock and checked again once acquired. Failures are retried only if retry is set
+/// </summary>
+static ssize_t Transfer(LP_I2C_DEVICE* device, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength, bool retry) {
+	ssize_t expected = (ssize_t)(writeLength + readLength);
+
+	for (unsigned int attempt = 0;; attempt++) {
+		LP_I2C_BUS* bus;
+		ssize_t result;
+		int error, fd;
+		uint32_t queued, started;
+
+		pthread_mutex_lock(&busLock);
+		if ((bus = device->bus) == NULL) {
+			pthread_mutex_unlock(&busLock);
+			errno = ENODEV;
+			return -1;
+		}
+		queued = BusNow_us();
+		AcquireBus(bus, device->priority);
+		if (device->bus != bus || !bus->open) {
+			ReleaseBus(bus);
+			pthread_mutex_unlock(&busLock);
+			errno = ENODEV;
+			return -1;
+		}
+		fd = bus->fd;
+		pthread_mutex_unlock(&busLock);
+
+		started = BusNow_us();
+
+		if (writeLength != 0 && readLength != 0) {
+			result = I2CMaster_WriteThenRead(fd, device->address, writeData, writeLength, readData, readLength);
+		} else if (readLength != 0) {
+			result = I2CMaster_Read(fd, device->address, readData, readLength);
+		} else {
+			result = I2CMaster_Write(fd, device->address, writeData, writeLength);
+		}
+		error = result < 0 ? errno : (result != expected ? EIO : 0);
+
+		pthread_mutex_lock(&busLock);
+		RecordLatency(&device->stats, started - queued, BusNow_us() - started);
+		ReleaseBus(bus);
+
+		if (error == 0) {
+			device->stats.transactions++;
+			device->stats.bytes += (uint64_t)expected;
+			pthread_mutex_unlock(&busLock);
+			return result;
+		}
+
+		if (!retry || attempt == LP_I2C_MAX_RETRIES) {
+			device->stats.transactions++;
+			device->stats.errors++;
+			device->stats.lastError = error;
+			pthread_mutex_unlock(&busLock);
+
+			Log_Debug("ERROR: I2C %s 0x%02x failed after %u retries: errno=%d (%s)\n",
+				device->name != NULL ? device->name : "device", device->address, attempt, error, strerror(error));
+			errno = error;
+			return -1;
+		}
+
+		device->stats.retries++;
+		pthread_mutex_unlock(&busLock);
+
+		// Queue again straight away, behind any other waiters, unless the device opted in to
+		// sleeping. The backoff is with the bus released, so a busy device does not hold up others
+		if (!device->retryBackoff) {
+			continue;
+		}
+		uint32_t backoff_ms = LP_I2C_RETRY_BACKOFF_MS << attempt;
+		if (backoff_ms > LP_I2C_RETRY_BACKOFF_MAX_MS) {
+			backoff_ms = LP_I2C_RETRY_BACKOFF_MAX_MS;
+		}
+		struct timespec backoff = { .tv_sec = 0, .tv_nsec = (long)backoff_ms * 1000000 };
+		nanosleep(&backoff, NULL);
+	}
+}
+
+ssize_t lp_i2cWrite(LP_I2C_DEVICE* device, const uint8_t* data, size_t length) {
+	return Transfer(device, data, length, NULL, 0, true);
+}
+
+ssize_t lp_i2cRead(LP_I2C_DEVICE* device, uint8_t* data, size_t length) {
+	return Transfer(device, NULL, 0, data, length, true);
+}
+
+ssize_t lp_i2cWriteThenRead(LP_I2C_DEVICE* device, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength) {
+	return Transfer(device, writeData, writeLength, readData, readLength, true);
+}
+
+ssize_t lp_i2cWriteThenReadOnce(LP_I2C_DEVICE* device, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength) {
+	return Transfer(device, writeData, writeLength, readData, readLength, false);
+}
+
+void lp_i2cLogStats(LP_I2C_DEVICE* device) {
+	LP_I2C_STATS stats;
+
+	pthread_mutex_lock(&busLock);
+	stats = device->stats;
+	pthread_mutex_unlock(&busLock);
+
+	Log_Debug("I2C %s 0x%02x: %u transactions, %u errors, %u retries, latency %u/%u/%u us min/avg/max, wait max %u us\n",
+		device->name != NULL ? device->name : "device", device->address, stats.transactions, stats.errors, stats.retries,
+		stats.latencyMin_us == UINT32_MAX ? 0 : stats.latencyMin_us,
+		stats.transactions != 0 ? (uint32_t)(stats.latencyTotal_us / (stats.transactions + stats.retries)) : 0,
+		stats.latencyMax_us, stats.waitMax_us);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <applibs/i2c.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LP_I2C_MAX_BUSES 5		// ISU0 to ISU4
+#define LP_I2C_MAX_DEVICES 8	// per bus
+#define LP_I2C_MAX_RETRIES 3
+#define LP_I2C_RETRY_BACKOFF_MS 2	// doubled for each retry, for devices that set retryBackoff
+#define LP_I2C_RETRY_BACKOFF_MAX_MS 10
+
+typedef enum {
+	LP_I2C_PRIORITY_LOW,
+	LP_I2C_PRIORITY_NORMAL,
+	LP_I2C_PRIORITY_HIGH
+} LP_I2C_PRIORITY;
+
+typedef struct {
+	uint32_t transactions;
+	uint32_t errors;			// transactions that still failed after their retries
+	uint32_t retries;
+	int lastError;				// errno of the last failure, 0 if none
+	uint64_t bytes;
+	// Time on the bus, from being granted it to the transfer completing
+	uint32_t latencyMin_us;
+	uint32_t latencyMax_us;
+	uint64_t latencyTotal_us;
+	uint32_t waitMax_us;		// longest wait for the bus behind other transactions
+} LP_I2C_STATS;
+
+typedef struct LP_I2C_DEVICE {
+	I2C_DeviceAddress address;
+	uint32_t maxSpeed;			// fastest bus speed the device supports, I2C_BUS_SPEED_*
+	LP_I2C_PRIORITY priority;
+	const char* name;
+	bool retryBackoff;			// sleep between retries, only for devices never used on the event loop thread
+	// Owned by the bus manager
+	struct LP_I2C_BUS* bus;
+	LP_I2C_STATS stats;
+} LP_I2C_DEVICE;
+
+bool lp_i2cAttach(LP_I2C_DEVICE* device, I2C_InterfaceId isu);
+void lp_i2cDetach(LP_I2C_DEVICE* device);
+uint32_t lp_i2cBusSpeed(I2C_InterfaceId isu);
+ssize_t lp_i2cWrite(LP_I2C_DEVICE* device, const uint8_t* data, size_t length);
+ssize_t lp_i2cRead(LP_I2C_DEVICE* device, uint8_t* data, size_t length);
+ssize_t lp_i2cWriteThenRead(LP_I2C_DEVICE* device, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength);
+// Never retried, for reads that pop a FIFO or clear flags, where a second attempt would lose data
+ssize_t lp_i2cWriteThenReadOnce(LP_I2C_DEVICE* device, const uint8_t* writeData, size_t writeLength, uint8_t* readData, size_t readLength);
+void lp_i2cLogStats(LP_I2C_DEVICE* device);
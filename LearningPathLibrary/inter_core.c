@@ -1,109 +1,813 @@
 #include "inter_core.h"
 
+typedef struct
+{
+	bool inUse;
+	LP_INTER_CORE_CHANNEL *channel;
+	LP_IC_MESSAGE request;	// replayed if the link resyncs before the reply
+	uint16_t sequence;
+	LP_INTER_CORE_CMD replyCmd;
+	uint64_t deadline;
+	void (*complete)(LP_IC_MESSAGE *reply, LP_IC_CALL_STATUS status, void *context);
+	void *context;
+} PENDING_CALL;
+
 static void SocketEventHandler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context);
-static bool ProcessMsg(void);
-static void (*_interCoreCallback)(LP_INTER_CORE_BLOCK *);
-static const char *_rtAppComponentId = NULL;
-static int sockFd = -1;
-static EventRegistration *socketEventReg = NULL;
+static size_t ReceiveBatch(LP_INTER_CORE_CHANNEL *channel, size_t *reads);
+static void ReceiveBulkFrame(LP_INTER_CORE_CHANNEL *channel, const uint8_t *frame, size_t length);
+static void CallTimeoutHandler(EventLoopTimer *eventLoopTimer);
+static void HeartbeatHandler(EventLoopTimer *eventLoopTimer);
+static PENDING_CALL pendingCalls[LP_IC_CALL_MAX_PENDING];
+static LP_INTER_CORE_CHANNEL *heartbeatChannels[LP_INTER_CORE_MAX_CHANNELS];
+
+// Used by the single real-time app functions, lp_interCoreCommunicationsEnable and friends
+static LP_INTER_CORE_CHANNEL defaultChannel = {
+	.name = "interCoreSocket",
+	.sockFd = -1};
+
+static LP_TIMER callTimeoutTimer = {
+	.period = {0, 0},
+	.name = "interCoreCallTimeoutTimer",
+	.handler = CallTimeoutHandler};
+
+static LP_TIMER heartbeatTimer = {
+	.period = {0, 0},
+	.name = "interCoreHeartbeatTimer",
+	.handler = HeartbeatHandler};
 
-static bool initialise_inter_core_communications(void)
+static bool initialise_inter_core_communications(LP_INTER_CORE_CHANNEL *channel)
 {
-	if (sockFd != -1) // Already initialised
+	if (channel->sockFd != -1) // Already initialised
 	{
 		return true;
 	}
 
-	if (_rtAppComponentId == NULL)
+	if (channel->rtAppComponentId == NULL)
 	{
 		lp_terminate(ExitCode_MissingRealTimeComponentId);
 		return false;
 	}
 
 	// Open connection to real-time capable application.
-	sockFd = Application_Connect(_rtAppComponentId);
-	if (sockFd == -1)
+	channel->sockFd = Application_Connect(channel->rtAppComponentId);
+	if (channel->sockFd == -1)
 	{
-		Log_Debug("ERROR: Unable to create socket: %d (%s)\n", errno, strerror(errno));
+		Log_Debug("ERROR: Unable to create socket for %s: %d (%s)\n", channel->name, errno, strerror(errno));
 		return false;
 	}
 
-	// Set timeout, to handle case where real-time capable application does not respond.
-	static const struct timeval recvTimeout = {.tv_sec = 5, .tv_usec = 0};
-	int result = setsockopt(sockFd, SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
-	if (result == -1)
+	// Register handler for incoming messages from real-time capable application.
+	channel->eventReg = lp_eventLoopRegisterIo(lp_timerGetEventLoop(), channel->sockFd, EventLoop_Input, SocketEventHandler,
+											   channel, channel->name);
+	if (channel->eventReg == NULL)
 	{
-		Log_Debug("ERROR: Unable to set socket timeout: %d (%s)\n", errno, strerror(errno));
+		Log_Debug("ERROR: Unable to register socket event for %s: %d (%s)\n", channel->name, errno, strerror(errno));
+		close(channel->sockFd);
+		channel->sockFd = -1;
 		return false;
 	}
 
-	// Register handler for incoming messages from real-time capable application.
-	socketEventReg = EventLoop_RegisterIo(lp_timerGetEventLoop(), sockFd, EventLoop_Input, SocketEventHandler,
-										  /* context */ NULL);
-	if (socketEventReg == NULL)
+	return true;
+}
+
+static void CloseSocket(LP_INTER_CORE_CHANNEL *channel)
+{
+	if (channel->eventReg != NULL)
+	{
+		lp_eventLoopUnregisterIo(lp_timerGetEventLoop(), channel->eventReg);
+		channel->eventReg = NULL;
+	}
+	if (channel->sockFd != -1)
+	{
+		close(channel->sockFd);
+		channel->sockFd = -1;
+	}
+	channel->rxBulkLength = 0;
+	channel->rxErrorRun = 0;
+}
+
+static bool SendBlock(LP_INTER_CORE_CHANNEL *channel, LP_IC_MESSAGE *control_block, size_t len, bool asMessage, uint16_t sequence)
+{
+	initialise_inter_core_communications(channel);
+
+	if (channel->sockFd == -1)
 	{
-		Log_Debug("ERROR: Unable to register socket event: %d (%s)\n", errno, strerror(errno));
+		Log_Debug("Socket not initialized");
+		return false;
+	}
+
+	int bytesSent;
+	if (asMessage || !lp_icFitsBlock(control_block->cmd))
+	{
+		uint8_t message[LP_IC_MAX_MESSAGE];
+		size_t length = lp_icEncode(control_block, sequence, message, sizeof(message));
+		if (length == 0)
+		{
+			Log_Debug("ERROR: Unable to encode message for command %d\n", control_block->cmd);
+			return false;
+		}
+		bytesSent = send(channel->sockFd, message, length, 0);
+	}
+	else
+	{
+		LP_INTER_CORE_BLOCK legacy;
+
+		lp_icToBlock(control_block, &legacy);
+		bytesSent = send(channel->sockFd, (void *)&legacy, len < sizeof(legacy) ? len : sizeof(legacy), 0);
+	}
+
+	if (bytesSent == -1)
+	{
+		Log_Debug("ERROR: Unable to send message to %s: %d (%s)\n", channel->name, errno, strerror(errno));
 		return false;
 	}
 
 	return true;
 }
 
-bool lp_interCoreSendMessage(LP_INTER_CORE_BLOCK *control_block, size_t len)
+bool lp_interCoreChannelSend(LP_INTER_CORE_CHANNEL *channel, LP_IC_MESSAGE *control_block, size_t len)
 {
-	initialise_inter_core_communications();
+	if (!SendBlock(channel, control_block, len, channel->useMessages, channel->txSequence))
+	{
+		return false;
+	}
 
-	if (sockFd == -1)
+	channel->txSequence++;
+	return true;
+}
+
+bool lp_interCoreSendMessage(LP_IC_MESSAGE *control_block, size_t len)
+{
+	return lp_interCoreChannelSend(&defaultChannel, control_block, len);
+}
+
+static uint64_t CallNow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+// Arm the timeout timer for the earliest deadline of the pending calls
+static void ArmCallTimeout(void)
+{
+	uint64_t next = UINT64_MAX;
+	uint64_t now = CallNow();
+
+	for (size_t i = 0; i < LP_IC_CALL_MAX_PENDING; i++)
+	{
+		if (pendingCalls[i].inUse && pendingCalls[i].deadline < next)
+		{
+			next = pendingCalls[i].deadline;
+		}
+	}
+
+	if (next != UINT64_MAX)
+	{
+		uint64_t delay = next > now ? next - now : 1;
+		struct timespec period = {.tv_sec = (time_t)(delay / 1000000000), .tv_nsec = (long)(delay % 1000000000)};
+		lp_timerOneShotSet(&callTimeoutTimer, &period);
+	}
+}
+
+static void CallTimeoutHandler(EventLoopTimer *eventLoopTimer)
+{
+	uint64_t now = CallNow();
+
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < LP_IC_CALL_MAX_PENDING; i++)
+	{
+		PENDING_CALL *call = &pendingCalls[i];
+		if (call->inUse && call->deadline <= now)
+		{
+			call->inUse = false;
+			call->channel->stats.callTimeouts++;
+			call->complete(NULL, LP_IC_CALL_TIMEOUT, call->context);
+		}
+	}
+
+	ArmCallTimeout();
+}
+
+// Complete the pending call a reply belongs to, returns false if it was not a reply
+static bool CompleteCall(LP_INTER_CORE_CHANNEL *channel, LP_IC_MESSAGE *reply, uint16_t sequence)
+{
+	for (size_t i = 0; i < LP_IC_CALL_MAX_PENDING; i++)
+	{
+		PENDING_CALL *call = &pendingCalls[i];
+		if (call->inUse && call->channel == channel && call->sequence == sequence && call->replyCmd == reply->cmd)
+		{
+			call->inUse = false;
+			call->complete(reply, LP_IC_CALL_OK, call->context);
+			ArmCallTimeout();
+			return true;
+		}
+	}
+	return false;
+}
+
+// Complete the pending calls on channel, or on every channel if it is NULL, with LP_IC_CALL_CANCELLED
+static void CancelCalls(LP_INTER_CORE_CHANNEL *channel)
+{
+	for (size_t i = 0; i < LP_IC_CALL_MAX_PENDING; i++)
+	{
+		PENDING_CALL *call = &pendingCalls[i];
+		if (call->inUse && (channel == NULL || call->channel == channel))
+		{
+			call->inUse = false;
+			call->complete(NULL, LP_IC_CALL_CANCELLED, call->context);
+		}
+	}
+}
+
+/// <summary>
+///     Send request to the real-time app on channel as a versioned message and call complete with
+///     the reply, the first replyCmd message carrying the same sequence number, or with
+///     LP_IC_CALL_TIMEOUT. Up to LP_IC_CALL_MAX_PENDING calls can be outstanding across all
+///     channels. Returns false if the table is full, complete or timeout is NULL or the send
+///     fails, complete is not called then and no sequence number is used up
+/// </summary>
+bool lp_interCoreChannelCall(LP_INTER_CORE_CHANNEL *channel, LP_IC_MESSAGE *request, LP_INTER_CORE_CMD replyCmd,
+							 const struct timespec *timeout,
+							 void (*complete)(LP_IC_MESSAGE *reply, LP_IC_CALL_STATUS status, void *context), void *context)
+{
+	PENDING_CALL *call = NULL;
+
+	for (size_t i = 0; i < LP_IC_CALL_MAX_PENDING && call == NULL; i++)
+	{
+		if (!pendingCalls[i].inUse)
+		{
+			call = &pendingCalls[i];
+		}
+	}
+
+	if (call == NULL || complete == NULL || timeout == NULL || !lp_timerStart(&callTimeoutTimer))
 	{
-		Log_Debug("Socket not initialized");
 		return false;
 	}
 
-	int bytesSent = send(sockFd, (void *)control_block, len, 0);
-	if (bytesSent == -1)
+	uint16_t sequence = channel->txSequence;
+	if (!SendBlock(channel, request, sizeof(LP_IC_MESSAGE), true, sequence))
 	{
-		Log_Debug("ERROR: Unable to send message: %d (%s)\n", errno, strerror(errno));
 		return false;
 	}
+	channel->txSequence++;
+
+	call->inUse = true;
+	call->channel = channel;
+	call->request = *request;
+	call->sequence = sequence;
+	call->replyCmd = replyCmd;
+	call->deadline = CallNow() + (uint64_t)timeout->tv_sec * 1000000000 + (uint64_t)timeout->tv_nsec;
+	call->complete = complete;
+	call->context = context;
+
+	ArmCallTimeout();
 
 	return true;
 }
 
-int lp_interCoreCommunicationsEnable(const char *rtAppComponentId, void (*interCoreCallback)(LP_INTER_CORE_BLOCK *))
+bool lp_interCoreCall(LP_IC_MESSAGE *request, LP_INTER_CORE_CMD replyCmd, const struct timespec *timeout,
+					  void (*complete)(LP_IC_MESSAGE *reply, LP_IC_CALL_STATUS status, void *context), void *context)
 {
-	_interCoreCallback = interCoreCallback;
-	_rtAppComponentId = rtAppComponentId;
+	return lp_interCoreChannelCall(&defaultChannel, request, replyCmd, timeout, complete, context);
+}
 
-	return 0;
+/// <summary>
+///     Complete every pending call with LP_IC_CALL_CANCELLED, for example before shutting down
+/// </summary>
+void lp_interCoreCallCancelAll(void)
+{
+	lp_timerStop(&callTimeoutTimer);
+	CancelCalls(NULL);
+}
+
+// Send the pending calls on channel again with their original sequence numbers
+static void ReplayCalls(LP_INTER_CORE_CHANNEL *channel)
+{
+	channel->stats.resyncs++;
+
+	for (size_t i = 0; i < LP_IC_CALL_MAX_PENDING; i++)
+	{
+		PENDING_CALL *call = &pendingCalls[i];
+		if (call->inUse && call->channel == channel)
+		{
+			SendBlock(channel, &call->request, sizeof(LP_IC_MESSAGE), true, call->sequence);
+		}
+	}
+}
+
+static void RecordRtt(LP_INTER_CORE_CHANNEL *channel, uint32_t rtt_us)
+{
+	LP_INTER_CORE_STATS *stats = &channel->stats;
+	int bucket = rtt_us == 0 ? 0 : 32 - __builtin_clz(rtt_us);
+
+	if (stats->rttCount == 0 || rtt_us < stats->rttMin_us)
+	{
+		stats->rttMin_us = rtt_us;
+	}
+	if (rtt_us > stats->rttMax_us)
+	{
+		stats->rttMax_us = rtt_us;
+	}
+	stats->rttCount++;
+	stats->rttTotal_us += rtt_us;
+	stats->rttHistogram[bucket < LP_IC_RTT_BUCKETS ? bucket : LP_IC_RTT_BUCKETS - 1]++;
 }
 
 /// <summary>
-///     Handle socket event by reading incoming data from real-time capable application.
+///     Heartbeat round trip in microseconds below which percent of them completed. The histogram
+///     is logarithmic, so this is the upper edge of the bucket, capped at the maximum
 /// </summary>
-static void SocketEventHandler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+uint32_t lp_interCoreRttPercentile(const LP_INTER_CORE_STATS *stats, unsigned int percent)
 {
-	if (!ProcessMsg())
+	uint64_t threshold = ((uint64_t)stats->rttCount * percent + 99) / 100;
+	uint64_t seen = 0;
+
+	if (stats->rttCount == 0)
 	{
-		lp_terminate(ExitCode_InterCoreHandler);
+		return 0;
 	}
+
+	for (int bucket = 0; bucket < LP_IC_RTT_BUCKETS - 1; bucket++)
+	{
+		seen += stats->rttHistogram[bucket];
+		if (seen >= threshold)
+		{
+			uint32_t upper = bucket == 0 ? 0 : (1u << bucket) - 1;
+			return upper < stats->rttMax_us ? upper : (uint32_t)stats->rttMax_us;
+		}
+	}
+
+	return (uint32_t)stats->rttMax_us;
+}
+
+static bool HeartbeatEnabled(const LP_INTER_CORE_CHANNEL *channel)
+{
+	return channel->heartbeatPeriod.tv_sec != 0 || channel->heartbeatPeriod.tv_nsec != 0;
+}
+
+// Epochs differ from one start of the app, or opening of the channel, to the next
+static void InitLink(LP_INTER_CORE_CHANNEL *channel)
+{
+	lp_icLinkInit(&channel->link, (uint32_t)time(NULL) ^ (uint32_t)CallNow());
 }
 
 /// <summary>
-///     Handle socket event by reading incoming data from real-time capable application.
+///     Handle a heartbeat or an echo from the real-time app. The pending calls are replayed when
+///     the link comes back up or the real-time app has restarted, as their requests may be lost.
+///     Without heartbeats of our own the real-time app's heartbeats are only echoed, the link is
+///     not tracked
 /// </summary>
-static bool ProcessMsg()
+static void ReceiveHeartbeat(LP_INTER_CORE_CHANNEL *channel, LP_IC_MESSAGE *block, uint16_t sequence)
 {
-	LP_INTER_CORE_BLOCK ic_control_block;
+	LP_IC_LINK *link = &channel->link;
+	bool wasUp = link->up;
+	uint32_t rttCount = link->rttCount;
 
-	int bytesReceived = recv(sockFd, (void *)&ic_control_block, sizeof(ic_control_block), 0);
+	if (!HeartbeatEnabled(channel))
+	{
+		if (lp_icLinkEcho(link, block))
+		{
+			SendBlock(channel, block, sizeof(LP_IC_MESSAGE), true, sequence);
+		}
+		return;
+	}
 
-	if (bytesReceived == -1)
+	if (lp_icLinkReceive(link, block, sequence, (uint32_t)(CallNow() / 1000)))
+	{
+		SendBlock(channel, block, sizeof(LP_IC_MESSAGE), true, sequence);
+	}
+
+	if (link->rttCount != rttCount)
+	{
+		RecordRtt(channel, link->lastRtt_us);
+	}
+
+	// Not on the first echo, there was nothing to lose before it
+	if (link->peerRestarted || (!wasUp && link->linkDowns != 0))
+	{
+		link->peerRestarted = false;
+		ReplayCalls(channel);
+	}
+
+	if (!wasUp && channel->linkCallback != NULL)
+	{
+		channel->linkCallback(channel, true);
+	}
+}
+
+// Arm the heartbeat timer for the channel due next
+static void ArmHeartbeat(void)
+{
+	uint64_t next = UINT64_MAX;
+	uint64_t now = CallNow();
+
+	for (size_t i = 0; i < LP_INTER_CORE_MAX_CHANNELS; i++)
+	{
+		if (heartbeatChannels[i] != NULL && heartbeatChannels[i]->nextHeartbeat < next)
+		{
+			next = heartbeatChannels[i]->nextHeartbeat;
+		}
+	}
+
+	if (next != UINT64_MAX)
+	{
+		uint64_t delay = next > now ? next - now : 1;
+		struct timespec period = {.tv_sec = (time_t)(delay / 1000000000), .tv_nsec = (long)(delay % 1000000000)};
+		lp_timerOneShotSet(&heartbeatTimer, &period);
+	}
+}
+
+static void HeartbeatHandler(EventLoopTimer *eventLoopTimer)
+{
+	uint64_t now = CallNow();
+
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < LP_INTER_CORE_MAX_CHANNELS; i++)
+	{
+		LP_INTER_CORE_CHANNEL *channel = heartbeatChannels[i];
+		if (channel == NULL || channel->nextHeartbeat > now)
+		{
+			continue;
+		}
+
+		LP_IC_MESSAGE heartbeat;
+		uint16_t sequence = channel->txSequence;
+		bool wasUp = channel->link.up;
+		unsigned int missLimit = channel->heartbeatMissLimit != 0 ? channel->heartbeatMissLimit : 3;
+
+		lp_icLinkHeartbeat(&channel->link, &heartbeat, sequence, (uint32_t)(now / 1000), missLimit);
+		if (SendBlock(channel, &heartbeat, sizeof(heartbeat), true, sequence))
+		{
+			channel->txSequence++;
+			channel->stats.heartbeatsSent++;
+		}
+
+		channel->nextHeartbeat = now + (uint64_t)channel->heartbeatPeriod.tv_sec * 1000000000 + (uint64_t)channel->heartbeatPeriod.tv_nsec;
+
+		if (wasUp && !channel->link.up)
+		{
+			channel->stats.linkDowns++;
+			Log_Debug("Intercore link to %s is down\n", channel->name);
+			if (channel->linkCallback != NULL)
+			{
+				channel->linkCallback(channel, false);
+			}
+		}
+	}
+
+	ArmHeartbeat();
+}
+
+// Heartbeats start straight away, the link is down until the first echo
+static bool StartHeartbeat(LP_INTER_CORE_CHANNEL *channel)
+{
+	size_t slot = LP_INTER_CORE_MAX_CHANNELS;
+
+	for (size_t i = 0; i < LP_INTER_CORE_MAX_CHANNELS; i++)
+	{
+		if (heartbeatChannels[i] == channel)
+		{
+			return true;
+		}
+		if (heartbeatChannels[i] == NULL && slot == LP_INTER_CORE_MAX_CHANNELS)
+		{
+			slot = i;
+		}
+	}
+
+	if (slot == LP_INTER_CORE_MAX_CHANNELS || !lp_timerStart(&heartbeatTimer))
+	{
+		return false;
+	}
+
+	channel->nextHeartbeat = CallNow();
+	heartbeatChannels[slot] = channel;
+	ArmHeartbeat();
+
+	return true;
+}
+
+static void StopHeartbeat(LP_INTER_CORE_CHANNEL *channel)
+{
+	for (size_t i = 0; i < LP_INTER_CORE_MAX_CHANNELS; i++)
+	{
+		if (heartbeatChannels[i] == channel)
+		{
+			heartbeatChannels[i] = NULL;
+		}
+	}
+}
+
+int lp_interCoreCommunicationsEnable(const char *rtAppComponentId, void (*interCoreCallback)(LP_IC_MESSAGE *))
+{
+	defaultChannel.interCoreCallback = interCoreCallback;
+	defaultChannel.interCoreBatchCallback = NULL;
+	defaultChannel.rtAppComponentId = rtAppComponentId;
+	InitLink(&defaultChannel);
+
+	return 0;
+}
+
+/// <summary>
+///     Like lp_interCoreCommunicationsEnable, but all the messages queued when the socket becomes
+///     readable are delivered in one call, up to LP_INTER_CORE_BATCH_SIZE at a time
+/// </summary>
+int lp_interCoreCommunicationsEnableBatch(const char *rtAppComponentId, void (*interCoreBatchCallback)(LP_IC_MESSAGE *, size_t))
+{
+	defaultChannel.interCoreCallback = NULL;
+	defaultChannel.interCoreBatchCallback = interCoreBatchCallback;
+	defaultChannel.rtAppComponentId = rtAppComponentId;
+	InitLink(&defaultChannel);
+
+	return 0;
+}
+
+/// <summary>
+///     Send versioned messages carrying only the fields each command needs, instead of the whole
+///     LP_INTER_CORE_BLOCK. Commands the legacy block cannot carry are always sent as messages,
+///     and both formats are always accepted on receive
+/// </summary>
+void lp_interCoreUseMessages(bool enable)
+{
+	defaultChannel.useMessages = enable;
+}
+
+/// <summary>
+///     Deliver bulk sample frames to bulkCallback. The view points into the receive buffer, so
+///     samples are not copied but are only valid until the callback returns
+/// </summary>
+void lp_interCoreBulkEnable(void (*bulkCallback)(const LP_IC_BULK_VIEW *view))
+{
+	defaultChannel.bulkCallback = bulkCallback;
+}
+
+void lp_interCoreGetStats(LP_INTER_CORE_STATS *stats)
+{
+	*stats = defaultChannel.stats;
+}
+
+/// <summary>
+///     Monitor the link to the real-time app with a heartbeat every period, each way, see
+///     intercore_link.h. linkCallback, which is optional, is told when the link goes down after
+///     missLimit heartbeats without an echo and when it comes back up
+/// </summary>
+bool lp_interCoreHeartbeatEnable(const struct timespec *period, unsigned int missLimit, void (*linkCallback)(LP_INTER_CORE_CHANNEL *channel, bool up))
+{
+	defaultChannel.heartbeatPeriod = *period;
+	defaultChannel.heartbeatMissLimit = missLimit;
+	defaultChannel.linkCallback = linkCallback;
+
+	return initialise_inter_core_communications(&defaultChannel) && StartHeartbeat(&defaultChannel);
+}
+
+/// <summary>
+///     Connect to the real-time app named by channel->rtAppComponentId and start receiving. The
+///     caller fills in the name, component ID, callbacks and useMessages, and keeps channel alive
+///     until lp_interCoreChannelClose. Each channel has its own socket, receive buffer and stats
+/// </summary>
+bool lp_interCoreChannelOpen(LP_INTER_CORE_CHANNEL *channel)
+{
+	channel->sockFd = -1;
+	channel->eventReg = NULL;
+	channel->txSequence = 0;
+	channel->bulkSynced = false;
+	channel->rxBulkLength = 0;
+	channel->rxErrorRun = 0;
+	memset(&channel->stats, 0, sizeof(LP_INTER_CORE_STATS));
+	InitLink(channel);
+
+	if (channel->name == NULL)
+	{
+		channel->name = channel->rtAppComponentId;
+	}
+
+	if (!initialise_inter_core_communications(channel))
 	{
-		lp_terminate(ExitCode_InterCoreReceiveFailed);
 		return false;
 	}
 
-	_interCoreCallback(&ic_control_block);
+	if (HeartbeatEnabled(channel))
+	{
+		return StartHeartbeat(channel);
+	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+/// <summary>
+///     Stop receiving and close the socket. Pending calls on the channel complete with
+///     LP_IC_CALL_CANCELLED
+/// </summary>
+void lp_interCoreChannelClose(LP_INTER_CORE_CHANNEL *channel)
+{
+	StopHeartbeat(channel);
+	CancelCalls(channel);
+	CloseSocket(channel);
+}
+
+void lp_interCoreChannelGetStats(LP_INTER_CORE_CHANNEL *channel, LP_INTER_CORE_STATS *stats)
+{
+	*stats = channel->stats;
+}
+
+/// <summary>
+///     Handle socket event by draining the messages queued by the real-time capable application.
+///     Each channel has its own registration and gets at most LP_INTER_CORE_MAX_BATCHES batches per
+///     event loop turn, the socket stays readable so the rest is picked up on the next turn after
+///     the other channels have had theirs
+/// </summary>
+static void SocketEventHandler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+	LP_INTER_CORE_CHANNEL *channel = (LP_INTER_CORE_CHANNEL *)context;
+
+	for (int batch = 0; batch < LP_INTER_CORE_MAX_BATCHES; batch++)
+	{
+		size_t reads;
+		size_t received = ReceiveBatch(channel, &reads);
+		size_t count = 0;
+		size_t bulkLength = channel->rxBulkLength;
+
+		// Heartbeats go to the link monitor, replies to lp_interCoreCall to their completion, the rest to the callback
+		for (size_t i = 0; i < received; i++)
+		{
+			if (channel->rxSequenced[i] && channel->rxBlocks[i].cmd == LP_IC_HEARTBEAT)
+			{
+				ReceiveHeartbeat(channel, &channel->rxBlocks[i], channel->rxSequences[i]);
+			}
+			else if (!channel->rxSequenced[i] || !CompleteCall(channel, &channel->rxBlocks[i], channel->rxSequences[i]))
+			{
+				channel->rxBlocks[count++] = channel->rxBlocks[i];
+			}
+		}
+
+		channel->stats.batches++;
+		if (channel->interCoreBatchCallback != NULL && count != 0)
+		{
+			channel->interCoreBatchCallback(channel->rxBlocks, count);
+		}
+		else if (channel->interCoreCallback != NULL)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				channel->interCoreCallback(&channel->rxBlocks[i]);
+			}
+		}
+
+		// A bulk frame that arrived after blocks in the batch is delivered after them, in order
+		if (bulkLength != 0)
+		{
+			channel->rxBulkLength = 0;
+			ReceiveBulkFrame(channel, channel->rx.message, bulkLength);
+		}
+
+		if ((reads < LP_INTER_CORE_BATCH_SIZE && bulkLength == 0) || channel->sockFd == -1)
+		{
+			return;
+		}
+	}
+}
+
+/// <summary>
+///     Hand a bulk frame to the bulk callback in place and count frames lost in between
+/// </summary>
+static void ReceiveBulkFrame(LP_INTER_CORE_CHANNEL *channel, const uint8_t *frame, size_t length)
+{
+	LP_IC_BULK_HEADER header;
+
+	if (!lp_icBulkParse(frame, length, &header))
+	{
+		channel->stats.dropped++;
+		return;
+	}
+
+	if (channel->bulkSynced)
+	{
+		channel->stats.bulkFramesLost += (uint16_t)(header.sequence - channel->bulkSequence);
+	}
+	channel->bulkSynced = true;
+	channel->bulkSequence = (uint16_t)(header.sequence + 1);
+
+	channel->stats.bulkFrames++;
+	channel->stats.bulkSamples += header.count;
+
+	if (channel->bulkCallback != NULL)
+	{
+		LP_IC_BULK_VIEW view = {
+			.type = (LP_IC_BULK_TYPE)header.type,
+			.sequence = header.sequence,
+			.count = header.count,
+			.sampleSize = header.sampleSize,
+			.samples = &frame[sizeof(LP_IC_BULK_HEADER)]};
+
+		channel->bulkCallback(&view);
+	}
+}
+
+/// <summary>
+///     Read up to LP_INTER_CORE_BATCH_SIZE queued messages without blocking. Versioned messages
+///     are decoded into rxBlocks, those that fail to decode are dropped. Legacy blocks too short
+///     to carry a command are dropped, short ones are zero filled and long ones truncated. Bulk
+///     frames go straight to the bulk callback, unless blocks were received before them: the batch
+///     then ends and the frame is held in rx for SocketEventHandler to deliver after the blocks.
+///     Receive errors are counted rather than terminating the app, as the real-time core may
+///     simply be restarting, and only the first of a run is logged. The socket is closed when the
+///     real-time app closes its end or after LP_INTER_CORE_MAX_RX_ERRORS errors in a row, the
+///     next send reconnects
+/// </summary>
+static size_t ReceiveBatch(LP_INTER_CORE_CHANNEL *channel, size_t *reads)
+{
+	size_t count = 0;
+
+	for (*reads = 0; *reads < LP_INTER_CORE_BATCH_SIZE; (*reads)++)
+	{
+		LP_IC_MESSAGE *block = &channel->rxBlocks[count];
+		struct iovec iov = {.iov_base = &channel->rx, .iov_len = sizeof(channel->rx)};
+		struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+
+		ssize_t bytesReceived = recvmsg(channel->sockFd, &msg, MSG_DONTWAIT);
+		if (bytesReceived == -1)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				channel->stats.errors++;
+				if (channel->rxErrorRun++ == 0)
+				{
+					Log_Debug("ERROR: Unable to receive message from %s: %d (%s)\n", channel->name, errno, strerror(errno));
+				}
+				if (channel->rxErrorRun >= LP_INTER_CORE_MAX_RX_ERRORS)
+				{
+					Log_Debug("ERROR: Closing socket to %s after %u receive errors\n", channel->name, channel->rxErrorRun);
+					channel->stats.disconnects++;
+					CloseSocket(channel);
+				}
+			}
+			break;
+		}
+
+		if (bytesReceived == 0)
+		{
+			Log_Debug("Real-time app %s closed the socket\n", channel->name);
+			channel->stats.disconnects++;
+			CloseSocket(channel);
+			break;
+		}
+
+		channel->rxErrorRun = 0;
+
+		if (msg.msg_flags & MSG_TRUNC)
+		{
+			channel->stats.truncated++;
+		}
+
+		if (lp_icIsBulkFrame(channel->rx.message, (size_t)bytesReceived))
+		{
+			if (count != 0)
+			{
+				channel->rxBulkLength = (size_t)bytesReceived;
+				(*reads)++;
+				break;
+			}
+			ReceiveBulkFrame(channel, channel->rx.message, (size_t)bytesReceived);
+			continue;
+		}
+
+		if (lp_icIsMessage(channel->rx.message, (size_t)bytesReceived))
+		{
+			if (!lp_icDecode(channel->rx.message, (size_t)bytesReceived, block, &channel->rxSequences[count]))
+			{
+				channel->stats.dropped++;
+				continue;
+			}
+			channel->rxSequenced[count] = true;
+		}
+		else if ((size_t)bytesReceived < sizeof(block->cmd))
+		{
+			channel->stats.dropped++;
+			continue;
+		}
+		else
+		{
+			LP_INTER_CORE_BLOCK legacy;
+
+			channel->rxSequenced[count] = false;
+			memset(&legacy, 0, sizeof(legacy));
+			memcpy(&legacy, &channel->rx.block, (size_t)bytesReceived < sizeof(legacy) ? (size_t)bytesReceived : sizeof(legacy));
+			lp_icFromBlock(&legacy, block);
+		}
+
+		channel->stats.received++;
+		count++;
+	}
+
+	return count;
+}
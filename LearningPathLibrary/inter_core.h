@@ -15,6 +15,107 @@
 #include <unistd.h>
 #include "timer.h"
 #include "intercore_contract.h"
+#include "intercore_bulk.h"
+#include "intercore_link.h"
 
-bool lp_interCoreSendMessage(LP_INTER_CORE_BLOCK* control_block, size_t len);
-int lp_interCoreCommunicationsEnable(const char* rtAppComponentId, void (*interCoreCallback)(LP_INTER_CORE_BLOCK*));
+#define LP_INTER_CORE_BATCH_SIZE 16
+#define LP_INTER_CORE_MAX_BATCHES 4	// per channel per event loop turn, so a chatty real-time core cannot starve the others
+#define LP_IC_CALL_MAX_PENDING 8
+#define LP_INTER_CORE_MAX_CHANNELS 4	// with heartbeats running
+#define LP_INTER_CORE_MAX_RX_ERRORS 8	// receive errors in a row before the socket is closed, the next send reconnects
+
+// Heartbeat round trips are histogrammed in power of two microsecond buckets, bucket 0 holds
+// round trips under 1 us and the last bucket everything from about half a second up
+#define LP_IC_RTT_BUCKETS 20
+
+typedef enum
+{
+	LP_IC_CALL_OK,
+	LP_IC_CALL_TIMEOUT,
+	LP_IC_CALL_CANCELLED
+} LP_IC_CALL_STATUS;
+
+typedef struct
+{
+	unsigned long received;
+	unsigned long batches;
+	unsigned long dropped;		// too short to carry a command, or a message that failed to decode
+	unsigned long truncated;	// longer than the receive buffer
+	unsigned long errors;		// recv failures
+	unsigned long disconnects;	// the real-time app closed the socket, or receive failed LP_INTER_CORE_MAX_RX_ERRORS times in a row
+	unsigned long callTimeouts;	// lp_interCoreCall requests that got no reply in time
+	unsigned long bulkFrames;
+	unsigned long bulkSamples;
+	unsigned long bulkFramesLost;	// gaps in the frame sequence, dropped by the real-time app when the ring was full
+	unsigned long heartbeatsSent;
+	unsigned long linkDowns;		// missed heartbeats took the link down
+	unsigned long resyncs;			// pending calls replayed after the link came back or the real-time app restarted
+	unsigned long rttCount;
+	unsigned long rttMin_us;
+	unsigned long rttMax_us;
+	unsigned long long rttTotal_us;
+	unsigned long rttHistogram[LP_IC_RTT_BUCKETS];
+} LP_INTER_CORE_STATS;
+
+typedef struct
+{
+	LP_IC_BULK_TYPE type;
+	uint16_t sequence;
+	size_t count;
+	size_t sampleSize;
+	const uint8_t* samples;	// count samples of sampleSize bytes, in the receive buffer
+} LP_IC_BULK_VIEW;
+
+bool lp_interCoreSendMessage(LP_IC_MESSAGE* control_block, size_t len);
+int lp_interCoreCommunicationsEnable(const char* rtAppComponentId, void (*interCoreCallback)(LP_IC_MESSAGE*));
+int lp_interCoreCommunicationsEnableBatch(const char* rtAppComponentId, void (*interCoreBatchCallback)(LP_IC_MESSAGE*, size_t));
+void lp_interCoreGetStats(LP_INTER_CORE_STATS* stats);
+void lp_interCoreUseMessages(bool enable);
+bool lp_interCoreCall(LP_IC_MESSAGE* request, LP_INTER_CORE_CMD replyCmd, const struct timespec* timeout,
+	void (*complete)(LP_IC_MESSAGE* reply, LP_IC_CALL_STATUS status, void* context), void* context);
+void lp_interCoreCallCancelAll(void);
+void lp_interCoreBulkEnable(void (*bulkCallback)(const LP_IC_BULK_VIEW* view));
+uint32_t lp_interCoreRttPercentile(const LP_INTER_CORE_STATS* stats, unsigned int percent);
+
+/*
+ * Channels, one per real-time app. The functions above use a built-in default channel, a
+ * high-level app talking to more than one real-time app declares a channel for each.
+ */
+typedef struct LP_INTER_CORE_CHANNEL
+{
+	const char* name;
+	const char* rtAppComponentId;
+	void (*interCoreCallback)(LP_IC_MESSAGE*);
+	void (*interCoreBatchCallback)(LP_IC_MESSAGE*, size_t);	// optional, instead of interCoreCallback
+	void (*bulkCallback)(const LP_IC_BULK_VIEW* view);				// optional
+	bool useMessages;
+	struct timespec heartbeatPeriod;	// optional, heartbeats need a real-time app that echoes them
+	unsigned int heartbeatMissLimit;	// heartbeats without an echo before the link is down, 3 if 0
+	void (*linkCallback)(struct LP_INTER_CORE_CHANNEL* channel, bool up);	// optional
+	// Owned by inter_core.c
+	int sockFd;
+	EventRegistration* eventReg;
+	uint16_t txSequence;
+	bool bulkSynced;
+	uint16_t bulkSequence;	// next frame expected
+	size_t rxBulkLength;	// bulk frame held in rx until the blocks received before it are delivered
+	unsigned int rxErrorRun;	// receive errors in a row
+	LP_IC_LINK link;
+	uint64_t nextHeartbeat;
+	LP_INTER_CORE_STATS stats;
+	LP_IC_MESSAGE rxBlocks[LP_INTER_CORE_BATCH_SIZE];
+	uint16_t rxSequences[LP_INTER_CORE_BATCH_SIZE];
+	bool rxSequenced[LP_INTER_CORE_BATCH_SIZE];
+	union {
+		LP_INTER_CORE_BLOCK block;
+		uint8_t message[LP_IC_BULK_MAX_FRAME];
+	} rx;
+} LP_INTER_CORE_CHANNEL;
+
+bool lp_interCoreChannelOpen(LP_INTER_CORE_CHANNEL* channel);
+void lp_interCoreChannelClose(LP_INTER_CORE_CHANNEL* channel);
+bool lp_interCoreChannelSend(LP_INTER_CORE_CHANNEL* channel, LP_IC_MESSAGE* control_block, size_t len);
+bool lp_interCoreChannelCall(LP_INTER_CORE_CHANNEL* channel, LP_IC_MESSAGE* request, LP_INTER_CORE_CMD replyCmd, const struct timespec* timeout,
+	void (*complete)(LP_IC_MESSAGE* reply, LP_IC_CALL_STATUS status, void* context), void* context);
+void lp_interCoreChannelGetStats(LP_INTER_CORE_CHANNEL* channel, LP_INTER_CORE_STATS* stats);
+bool lp_interCoreHeartbeatEnable(const struct timespec* period, unsigned int missLimit, void (*linkCallback)(LP_INTER_CORE_CHANNEL* channel, bool up));
@@ -0,0 +1,215 @@
+#include "loop_post.h"
+#include "loop_profile.h"
+#include "timer.h"
+#include <applibs/log.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Bounded multi producer, single consumer queue. Each cell's sequence number says whether it
+// is free for the producer at that position or holds an item for the consumer, so producers
+// only contend on enqueuePos and never take a lock.
+typedef struct {
+	atomic_size_t sequence;
+	void (*handler)(void* context);
+	void* context;
+} POST_CELL;
+
+static void PostEventHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context);
+
+static POST_CELL cells[LP_POST_QUEUE_SIZE];
+static atomic_size_t enqueuePos;
+static size_t dequeuePos;
+static atomic_bool signalled;
+// Producers count themselves in posting before they load postFd, and lp_eventLoopPostStop clears
+// postFd before it waits for posting to drain, so no producer writes the eventfd once it is closed
+static atomic_int postFd = -1;
+static atomic_uint posting;
+static EventRegistration* postEventReg = NULL;
+static unsigned int budgetItems = 8;
+static uint64_t budgetNs = 0;
+
+static uint64_t PostNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+// Wake the event loop, once however many items are posted before it runs
+static void PostSignal(int fd) {
+	static const uint64_t one = 1;
+
+	if (!atomic_exchange(&signalled, true)) {
+		if (write(fd, &one, sizeof(one)) == -1) {
+			Log_Debug("ERROR: Unable to signal event loop: %d (%s)\n", errno, strerror(errno));
+		}
+	}
+}
+
+static bool PostDequeue(void (**handler)(void*), void** context) {
+	POST_CELL* cell = &cells[dequeuePos & (LP_POST_QUEUE_SIZE - 1)];
+	size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+
+	if (sequence != dequeuePos + 1) {
+		return false;
+	}
+
+	*handler = cell->handler;
+	*context = cell->context;
+	atomic_store_explicit(&cell->sequence, dequeuePos + LP_POST_QUEUE_SIZE, memory_order_release);
+	dequeuePos++;
+
+	return true;
+}
+
+static bool PostPending(void) {
+	POST_CELL* cell = &cells[dequeuePos & (LP_POST_QUEUE_SIZE - 1)];
+	return atomic_load_explicit(&cell->sequence, memory_order_acquire) == dequeuePos + 1;
+}
+
+/// <summary>
+///     Run posted work until the queue is empty or the budget for this loop iteration is spent.
+///     Leftover work signals the eventfd again, so timers and IO get a turn before it continues
+/// </summary>
+static void PostEventHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context) {
+	uint64_t count;
+	void (*handler)(void*);
+	void* handlerContext;
+	uint64_t start = PostNow();
+
+	if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+		Log_Debug("ERROR: Unable to read event loop post eventfd: %d (%s)\n", errno, strerror(errno));
+	}
+	// Cleared before draining, so a post racing with the drain signals again
+	atomic_store(&signalled, false);
+
+	for (unsigned int items = 0; items < budgetItems; items++) {
+		if (!PostDequeue(&handler, &handlerContext)) {
+			return;
+		}
+		handler(handlerContext);
+		if (budgetNs != 0 && PostNow() - start >= budgetNs) {
+			break;
+		}
+	}
+
+	if (atomic_load(&postFd) != -1 && PostPending()) {
+		PostSignal(fd);
+	}
+}
+
+/// <summary>
+///     Create the eventfd behind lp_eventLoopPost. Call from the event loop thread before any
+///     other thread posts
+/// </summary>
+bool lp_eventLoopPostStart(void) {
+	int fd;
+
+	if (atomic_load(&postFd) != -1) {
+		return true;
+	}
+
+	for (size_t i = 0; i < LP_POST_QUEUE_SIZE; i++) {
+		atomic_init(&cells[i].sequence, i);
+	}
+	atomic_init(&enqueuePos, 0);
+	atomic_init(&signalled, false);
+	dequeuePos = 0;
+
+	fd = eventfd(0, EFD_NONBLOCK);
+	if (fd == -1) {
+		Log_Debug("ERROR: Unable to create event loop post eventfd: %d (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	postEventReg = lp_eventLoopRegisterIo(lp_timerGetEventLoop(), fd, EventLoop_Input, PostEventHandler,
+		/* context */ NULL, "eventLoopPost");
+	if (postEventReg == NULL) {
+		Log_Debug("ERROR: Unable to register event loop post event: %d (%s)\n", errno, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	atomic_store(&postFd, fd);
+	return true;
+}
+
+/// <summary>
+///     Unregister the eventfd, work still queued is dropped. Posts from other threads fail from
+///     here on, and the eventfd is only closed once the posts already under way have signalled it
+/// </summary>
+void lp_eventLoopPostStop(void) {
+	int fd = atomic_exchange(&postFd, -1);
+
+	if (fd == -1) {
+		return;
+	}
+
+	lp_eventLoopUnregisterIo(lp_timerGetEventLoop(), postEventReg);
+	postEventReg = NULL;
+	while (atomic_load(&posting) != 0) {
+		sched_yield();
+	}
+	close(fd);
+}
+
+/// <summary>
+///     Queue handler(context) to run on the event loop. Safe to call from any thread and from
+///     handlers, which can split expensive work by posting the next chunk. Returns false when
+///     the queue is full or posting is not started
+/// </summary>
+bool lp_eventLoopPost(void (*handler)(void* context), void* context) {
+	if (handler == NULL) {
+		return false;
+	}
+
+	atomic_fetch_add(&posting, 1);
+	int fd = atomic_load(&postFd);
+	if (fd == -1) {
+		atomic_fetch_sub(&posting, 1);
+		return false;
+	}
+
+	size_t position = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+	POST_CELL* cell;
+
+	for (;;) {
+		cell = &cells[position & (LP_POST_QUEUE_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&enqueuePos, &position, position + 1,
+				memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			atomic_fetch_sub(&posting, 1);
+			return false;	// full
+		} else {
+			position = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+		}
+	}
+
+	cell->handler = handler;
+	cell->context = context;
+	atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+
+	PostSignal(fd);
+	atomic_fetch_sub(&posting, 1);
+
+	return true;
+}
+
+/// <summary>
+///     Limit the posted work run per loop iteration to maxItems items and, when maxTime is not
+///     NULL, to the items started within maxTime
+/// </summary>
+void lp_eventLoopPostSetBudget(unsigned int maxItems, const struct timespec* maxTime) {
+	budgetItems = maxItems == 0 ? 1 : maxItems;
+	budgetNs = maxTime == NULL ? 0 : (uint64_t)maxTime->tv_sec * 1000000000 + (uint64_t)maxTime->tv_nsec;
+}
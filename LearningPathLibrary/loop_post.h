@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+// Work items that can be queued at once, must be a power of two
+#define LP_POST_QUEUE_SIZE 64
+
+bool lp_eventLoopPostStart(void);
+void lp_eventLoopPostStop(void);
+bool lp_eventLoopPost(void (*handler)(void* context), void* context);
+void lp_eventLoopPostSetBudget(unsigned int maxItems, const struct timespec* maxTime);
@@ -0,0 +1,199 @@
+#include "loop_profile.h"
+
+#ifdef LP_PROFILE_ENABLED
+
+#include "timer.h"
+#include <applibs/log.h>
+#include <string.h>
+
+typedef struct {
+	LP_PROFILE* profile;
+	EventLoopIoCallback* callback;
+	void* context;
+	EventRegistration* registration;
+} PROFILED_IO;
+
+static void ProfileLogHandler(EventLoopTimer* eventLoopTimer);
+
+static LP_PROFILE profiles[LP_PROFILE_MAX];
+static size_t profileCount = 0;
+static PROFILED_IO profiledIo[LP_PROFILE_MAX];
+
+static LP_TIMER profileLogTimer = {
+	.period = { 0, 0 },
+	.name = "profileLogTimer",
+	.handler = ProfileLogHandler };
+
+/// <summary>
+///     Monotonic clock in nanoseconds, the time base for deadlines passed to lp_profileRecord
+/// </summary>
+uint64_t lp_profileNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/// <summary>
+///     Returns the profile for name, allocating it the first time the name is seen so a timer
+///     that is stopped and started again keeps accumulating into the same profile
+/// </summary>
+LP_PROFILE* lp_profileRegister(const char* name) {
+	LP_PROFILE* profile = name != NULL ? lp_profileFind(name) : NULL;
+
+	if (profile == NULL && profileCount < LP_PROFILE_MAX) {
+		profile = &profiles[profileCount++];
+		profile->name = name != NULL ? name : "(unnamed)";
+		profile->runMin_us = UINT32_MAX;
+	}
+
+	return profile;
+}
+
+LP_PROFILE* lp_profileFind(const char* name) {
+	for (size_t i = 0; i < profileCount; i++) {
+		if (strcmp(profiles[i].name, name) == 0) {
+			return &profiles[i];
+		}
+	}
+	return NULL;
+}
+
+/// <summary>
+///     Record one handler invocation that started at start_ns and finishes now. A deadline_ns
+///     of 0 means the handler had no deadline, as for IO events, so no lag is recorded
+/// </summary>
+void lp_profileRecord(LP_PROFILE* profile, uint64_t deadline_ns, uint64_t start_ns, uint64_t missed) {
+	if (profile == NULL) {
+		return;
+	}
+
+	uint64_t run_us = (lp_profileNow() - start_ns) / 1000;
+	uint32_t run = run_us > UINT32_MAX ? UINT32_MAX : (uint32_t)run_us;
+	int bucket = run == 0 ? 0 : 32 - __builtin_clz(run);
+
+	profile->count++;
+	profile->missed += missed;
+	profile->runTotal_us += run;
+	if (run < profile->runMin_us) { profile->runMin_us = run; }
+	if (run > profile->runMax_us) { profile->runMax_us = run; }
+	profile->histogram[bucket < LP_PROFILE_BUCKETS ? bucket : LP_PROFILE_BUCKETS - 1]++;
+
+	if (deadline_ns != 0 && start_ns > deadline_ns) {
+		uint64_t lag_us = (start_ns - deadline_ns) / 1000;
+		profile->lagTotal_us += lag_us;
+		if (lag_us > profile->lagMax_us) {
+			profile->lagMax_us = lag_us > UINT32_MAX ? UINT32_MAX : (uint32_t)lag_us;
+		}
+	}
+}
+
+/// <summary>
+///     Handler run time in microseconds below which percent of the invocations finished. The
+///     histogram is logarithmic, so this is the upper edge of the bucket, capped at the maximum
+/// </summary>
+uint32_t lp_profilePercentile(const LP_PROFILE* profile, unsigned int percent) {
+	uint64_t threshold = ((uint64_t)profile->count * percent + 99) / 100;
+	uint64_t seen = 0;
+
+	if (profile->count == 0) {
+		return 0;
+	}
+
+	for (int bucket = 0; bucket < LP_PROFILE_BUCKETS - 1; bucket++) {
+		seen += profile->histogram[bucket];
+		if (seen >= threshold) {
+			uint32_t upper = bucket == 0 ? 0 : (1u << bucket) - 1;
+			return upper < profile->runMax_us ? upper : profile->runMax_us;
+		}
+	}
+
+	return profile->runMax_us;
+}
+
+void lp_profileLog(void) {
+	for (size_t i = 0; i < profileCount; i++) {
+		LP_PROFILE* profile = &profiles[i];
+		if (profile->count == 0) {
+			continue;
+		}
+		Log_Debug("PROFILE: %s count=%lu run us min/avg/max/p99=%u/%u/%u/%u missed=%lu lag us avg/max=%u/%u\n",
+			profile->name, profile->count,
+			profile->runMin_us, (unsigned int)(profile->runTotal_us / profile->count), profile->runMax_us,
+			lp_profilePercentile(profile, 99), profile->missed,
+			(unsigned int)(profile->lagTotal_us / profile->count), profile->lagMax_us);
+	}
+}
+
+void lp_profileReset(void) {
+	for (size_t i = 0; i < profileCount; i++) {
+		const char* name = profiles[i].name;
+		memset(&profiles[i], 0, sizeof(LP_PROFILE));
+		profiles[i].name = name;
+		profiles[i].runMin_us = UINT32_MAX;
+	}
+}
+
+static void ProfileLogHandler(EventLoopTimer* eventLoopTimer) {
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+		return;
+	}
+	lp_profileLog();
+}
+
+/// <summary>
+///     Log every profile each period
+/// </summary>
+bool lp_profileLogStart(const struct timespec* period) {
+	if (profileLogTimer.eventLoopTimer != NULL) {
+		return lp_timerChange(&profileLogTimer, period);
+	}
+	profileLogTimer.period = *period;
+	return lp_timerStart(&profileLogTimer);
+}
+
+static void ProfiledIoHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context) {
+	PROFILED_IO* io = (PROFILED_IO*)context;
+	LP_PROFILE* profile = io->profile;	// the callback may unregister and release io
+	uint64_t start = lp_profileNow();
+
+	io->callback(el, fd, events, io->context);
+
+	lp_profileRecord(profile, 0, start, 0);
+}
+
+/// <summary>
+///     EventLoop_RegisterIo with the callback profiled under name
+/// </summary>
+EventRegistration* lp_eventLoopRegisterIo(EventLoop* eventLoop, int fd, EventLoop_IoEvents eventBitmask,
+	EventLoopIoCallback* callback, void* context, const char* name) {
+	for (size_t i = 0; i < LP_PROFILE_MAX; i++) {
+		PROFILED_IO* io = &profiledIo[i];
+		if (io->callback != NULL) {
+			continue;
+		}
+
+		io->registration = EventLoop_RegisterIo(eventLoop, fd, eventBitmask, ProfiledIoHandler, io);
+		if (io->registration == NULL) {
+			return NULL;
+		}
+		io->callback = callback;
+		io->context = context;
+		io->profile = lp_profileRegister(name);
+		return io->registration;
+	}
+
+	// Out of slots, register without profiling
+	return EventLoop_RegisterIo(eventLoop, fd, eventBitmask, callback, context);
+}
+
+void lp_eventLoopUnregisterIo(EventLoop* eventLoop, EventRegistration* registration) {
+	for (size_t i = 0; i < LP_PROFILE_MAX; i++) {
+		if (profiledIo[i].callback != NULL && profiledIo[i].registration == registration) {
+			profiledIo[i] = (PROFILED_IO){ 0 };
+			break;
+		}
+	}
+	EventLoop_UnregisterIo(eventLoop, registration);
+}
+
+#endif // LP_PROFILE_ENABLED
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <applibs/eventloop.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Handler run times are histogrammed in power of two microsecond buckets, bucket 0 holds
+// runs under 1 us and the last bucket everything from about 4 seconds up
+#define LP_PROFILE_BUCKETS 24
+#define LP_PROFILE_MAX 32
+
+typedef struct {
+	const char* name;
+	unsigned long count;		// handler invocations
+	unsigned long missed;		// timer expirations folded into a later invocation by a late wakeup
+	uint32_t runMin_us;
+	uint32_t runMax_us;
+	uint64_t runTotal_us;
+	uint32_t lagMax_us;			// how late a timer handler started versus its deadline
+	uint64_t lagTotal_us;
+	uint32_t histogram[LP_PROFILE_BUCKETS];
+} LP_PROFILE;
+
+#ifdef LP_PROFILE_ENABLED
+
+LP_PROFILE* lp_profileRegister(const char* name);
+LP_PROFILE* lp_profileFind(const char* name);
+uint32_t lp_profilePercentile(const LP_PROFILE* profile, unsigned int percent);
+void lp_profileLog(void);
+bool lp_profileLogStart(const struct timespec* period);
+void lp_profileReset(void);
+uint64_t lp_profileNow(void);
+void lp_profileRecord(LP_PROFILE* profile, uint64_t deadline_ns, uint64_t start_ns, uint64_t missed);
+EventRegistration* lp_eventLoopRegisterIo(EventLoop* eventLoop, int fd, EventLoop_IoEvents eventBitmask,
+	EventLoopIoCallback* callback, void* context, const char* name);
+void lp_eventLoopUnregisterIo(EventLoop* eventLoop, EventRegistration* registration);
+
+#else
+
+static inline LP_PROFILE* lp_profileRegister(const char* name) { (void)name; return NULL; }
+static inline LP_PROFILE* lp_profileFind(const char* name) { (void)name; return NULL; }
+static inline uint32_t lp_profilePercentile(const LP_PROFILE* profile, unsigned int percent) { (void)profile; (void)percent; return 0; }
+static inline void lp_profileLog(void) { }
+static inline bool lp_profileLogStart(const struct timespec* period) { (void)period; return true; }
+static inline void lp_profileReset(void) { }
+#define lp_eventLoopRegisterIo(eventLoop, fd, eventBitmask, callback, context, name) \
+	EventLoop_RegisterIo(eventLoop, fd, eventBitmask, callback, context)
+#define lp_eventLoopUnregisterIo(eventLoop, registration) EventLoop_UnregisterIo(eventLoop, registration)
+
+#endif // LP_PROFILE_ENABLED
@@ -41,6 +41,17 @@
 #include <ctype.h>
 #include <math.h>
 #include <errno.h>
+#include <stdint.h>
+
+/* Whitespace and string scanning use 16 byte SIMD kernels where the target has them.
+ * Define PARSON_DISABLE_SIMD to force the scalar code. */
+#if !defined(PARSON_DISABLE_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define PARSON_SIMD_SSE2
+#elif !defined(PARSON_DISABLE_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PARSON_SIMD_NEON
+#endif
 
 /* Apparently sscanf is not implemented in some "standard" libraries, so don't use it, if you
  * don't have to. */
@@ -55,10 +66,8 @@
 
 #define SIZEOF_TOKEN(a) (sizeof(a) - 1)
 #define SKIP_CHAR(str) ((*str)++)
-#define SKIP_WHITESPACES(str)                 \
-    while (isspace((unsigned char)(**str))) { \
-        SKIP_CHAR(str);                       \
-    }
+#define SKIP_WHITESPACES(str, end) (*(str) = skip_whitespaces(*(str), (end)))
+#define IS_STRING_SPECIAL(c) ((c) == '\"' || (c) == '\\' || (unsigned char)(c) < 0x20)
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
 #undef malloc
@@ -83,6 +92,7 @@ struct json_value_t {
     JSON_Value *parent;
     JSON_Value_Type type;
     JSON_Value_Value value;
+    int in_situ; /* string points into a buffer given to json_parse_string_in_situ */
 };
 
 struct json_object_t {
@@ -91,6 +101,17 @@ struct json_object_t {
     JSON_Value **values;
     size_t count;
     size_t capacity;
+    int names_in_situ; /* names point into a buffer given to json_parse_string_in_situ */
+};
+
+typedef struct json_path_segment_t {
+    const char *name;
+    size_t name_len;
+} JSON_Path_Segment;
+
+struct json_path_t {
+    size_t count;
+    JSON_Path_Segment *segments;
 };
 
 struct json_array_t {
@@ -110,12 +131,16 @@ static int num_bytes_in_utf8_sequence(unsigned char c);
 static int verify_utf8_sequence(const unsigned char *string, int *len);
 static int is_valid_utf8(const char *string, size_t string_len);
 static int is_decimal(const char *string, size_t length);
+static const char *skip_whitespaces(const char *string, const char *end);
+static const char *scan_string_special(const char *string, const char *end);
 
 /* JSON Object */
 static JSON_Object *json_object_init(JSON_Value *wrapping_value);
 static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_Value *value);
 static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_t name_len,
                                     JSON_Value *value);
+static JSON_Status json_object_add_in_situ(JSON_Object *object, char *name, JSON_Value *value);
+static JSON_Status json_object_own_names(JSON_Object *object);
 static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity);
 static JSON_Value *json_object_getn_value(const JSON_Object *object, const char *name,
                                           size_t name_len);
@@ -135,17 +160,21 @@ static void json_array_free(JSON_Array *array);
 static JSON_Value *json_value_init_string_no_copy(char *string);
 
 /* Parser */
-static JSON_Status skip_quotes(const char **string);
+static JSON_Status skip_quotes(const char **string, const char *end);
 static int parse_utf16(const char **unprocessed, char **processed);
+static char *process_string_to(const char *input, size_t len, char *output);
 static char *process_string(const char *input, size_t len);
-static char *get_quoted_string(const char **string);
-static JSON_Value *parse_object_value(const char **string, size_t nesting);
-static JSON_Value *parse_array_value(const char **string, size_t nesting);
-static JSON_Value *parse_string_value(const char **string);
+static char *get_quoted_string(const char **string, const char *end, int in_situ);
+static JSON_Value *parse_object_value(const char **string, const char *end, size_t nesting,
+                                      int in_situ);
+static JSON_Value *parse_array_value(const char **string, const char *end, size_t nesting,
+                                     int in_situ);
+static JSON_Value *parse_string_value(const char **string, const char *end, int in_situ);
 static JSON_Value *parse_boolean_value(const char **string);
 static JSON_Value *parse_number_value(const char **string);
 static JSON_Value *parse_null_value(const char **string);
-static JSON_Value *parse_value(const char **string, size_t nesting);
+static JSON_Value *parse_value(const char **string, const char *end, size_t nesting,
+                               int in_situ);
 
 /* Serialization */
 static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty,
@@ -322,6 +351,113 @@ static void remove_comments(char *string, const char *start_token, const char *e
     }
 }
 
+/* Scanning
+ * The scan functions take the end of the input, which is its terminating '\0' when parsing or
+ * the end of the quoted text when decoding a string. A 16 byte SIMD block is only loaded while
+ * the whole block lies before end, and what is left is scanned a byte at a time, so nothing past
+ * the input is ever read. Each block function returns 1 and the offset of the first matching
+ * byte in the block, or 0 if no byte matches. */
+#if defined(PARSON_SIMD_SSE2)
+static int block_find_non_whitespace(const char *block, unsigned int *offset)
+{
+    __m128i chars = _mm_loadu_si128((const __m128i *)block);
+    __m128i control = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+    __m128i spaces = _mm_or_si128(
+        _mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+        _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control)); /* '\t'..'\r' */
+    int mask = ~_mm_movemask_epi8(spaces) & 0xFFFF;
+    if (mask == 0) {
+        return 0;
+    }
+    *offset = (unsigned int)__builtin_ctz((unsigned int)mask);
+    return 1;
+}
+
+static int block_find_string_special(const char *block, unsigned int *offset)
+{
+    __m128i chars = _mm_loadu_si128((const __m128i *)block);
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\"')),
+                     _mm_cmpeq_epi8(chars, _mm_set1_epi8('\\'))),
+        _mm_cmpeq_epi8(_mm_min_epu8(chars, _mm_set1_epi8(0x1F)), chars)); /* 0x00..0x1F */
+    int mask = _mm_movemask_epi8(special);
+    if (mask == 0) {
+        return 0;
+    }
+    *offset = (unsigned int)__builtin_ctz((unsigned int)mask);
+    return 1;
+}
+#elif defined(PARSON_SIMD_NEON)
+/* Narrows a byte mask to 4 bits per byte, as NEON has no movemask */
+static int neon_find_first(uint8x16_t mask, unsigned int *offset)
+{
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(mask), 4);
+    uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+    if (bits == 0) {
+        return 0;
+    }
+    *offset = (unsigned int)(__builtin_ctzll(bits) >> 2);
+    return 1;
+}
+
+static int block_find_non_whitespace(const char *block, unsigned int *offset)
+{
+    uint8x16_t chars = vld1q_u8((const uint8_t *)block);
+    uint8x16_t spaces =
+        vorrq_u8(vceqq_u8(chars, vdupq_n_u8(' ')),
+                 vcleq_u8(vsubq_u8(chars, vdupq_n_u8('\t')), vdupq_n_u8(4))); /* '\t'..'\r' */
+    return neon_find_first(vmvnq_u8(spaces), offset);
+}
+
+static int block_find_string_special(const char *block, unsigned int *offset)
+{
+    uint8x16_t chars = vld1q_u8((const uint8_t *)block);
+    uint8x16_t special = vorrq_u8(
+        vorrq_u8(vceqq_u8(chars, vdupq_n_u8('\"')), vceqq_u8(chars, vdupq_n_u8('\\'))),
+        vcltq_u8(chars, vdupq_n_u8(0x20)));
+    return neon_find_first(special, offset);
+}
+#endif
+
+/* Returns pointer to the first character which isn't whitespace ('\0' included) */
+static const char *skip_whitespaces(const char *string, const char *end)
+{
+#if defined(PARSON_SIMD_SSE2) || defined(PARSON_SIMD_NEON)
+    unsigned int offset = 0;
+    if (!isspace((unsigned char)*string)) { /* compact JSON rarely has any */
+        return string;
+    }
+    while (end - string >= 16) {
+        if (block_find_non_whitespace(string, &offset)) {
+            return string + offset;
+        }
+        string += 16;
+    }
+#endif
+    while (string < end && isspace((unsigned char)*string)) {
+        string++;
+    }
+    return string;
+}
+
+/* Returns pointer to the first '"', '\\' or control character ('\0' included), or end */
+static const char *scan_string_special(const char *string, const char *end)
+{
+#if defined(PARSON_SIMD_SSE2) || defined(PARSON_SIMD_NEON)
+    unsigned int offset = 0;
+    while (end - string >= 16) {
+        if (block_find_string_special(string, &offset)) {
+            return string + offset;
+        }
+        string += 16;
+    }
+#endif
+    while (string < end && !IS_STRING_SPECIAL(*string)) {
+        string++;
+    }
+    return string;
+}
+
 /* JSON Object */
 static JSON_Object *json_object_init(JSON_Value *wrapping_value)
 {
@@ -334,6 +470,7 @@ static JSON_Object *json_object_init(JSON_Value *wrapping_value)
     new_obj->values = (JSON_Value **)NULL;
     new_obj->capacity = 0;
     new_obj->count = 0;
+    new_obj->names_in_situ = 0;
     return new_obj;
 }
 
@@ -355,6 +492,9 @@ static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_
     if (json_object_getn_value(object, name, name_len) != NULL) {
         return JSONFailure;
     }
+    if (json_object_own_names(object) == JSONFailure) {
+        return JSONFailure;
+    }
     if (object->count >= object->capacity) {
         size_t new_capacity = MAX(object->capacity * 2, STARTING_CAPACITY);
         if (json_object_resize(object, new_capacity) == JSONFailure) {
@@ -372,6 +512,59 @@ static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_
     return JSONSuccess;
 }
 
+/* Adds a name that points into an in-situ parsed buffer, so the object must not own its names */
+static JSON_Status json_object_add_in_situ(JSON_Object *object, char *name, JSON_Value *value)
+{
+    size_t index = 0;
+    size_t name_len = strlen(name);
+    if (json_object_getn_value(object, name, name_len) != NULL) {
+        return JSONFailure;
+    }
+    if (object->count >= object->capacity) {
+        size_t new_capacity = MAX(object->capacity * 2, STARTING_CAPACITY);
+        if (json_object_resize(object, new_capacity) == JSONFailure) {
+            return JSONFailure;
+        }
+    }
+    index = object->count;
+    object->names[index] = name;
+    object->names_in_situ = 1;
+    value->parent = json_object_get_wrapping_value(object);
+    object->values[index] = value;
+    object->count++;
+    return JSONSuccess;
+}
+
+/* Copies names that point into an in-situ parsed buffer to the heap, so owned names can be added */
+static JSON_Status json_object_own_names(JSON_Object *object)
+{
+    size_t i = 0;
+    char **temp_names = NULL;
+    if (!object->names_in_situ) {
+        return JSONSuccess;
+    }
+    if (object->count > 0) {
+        temp_names = (char **)parson_malloc(object->count * sizeof(char *));
+        if (temp_names == NULL) {
+            return JSONFailure;
+        }
+        for (i = 0; i < object->count; i++) {
+            temp_names[i] = parson_strdup(object->names[i]);
+            if (temp_names[i] == NULL) {
+                while (i--) {
+                    parson_free(temp_names[i]);
+                }
+                parson_free(temp_names);
+                return JSONFailure;
+            }
+        }
+        memcpy(object->names, temp_names, object->count * sizeof(char *));
+        parson_free(temp_names);
+    }
+    object->names_in_situ = 0;
+    return JSONSuccess;
+}
+
 static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
 {
     char **temp_names = NULL;
@@ -428,7 +621,9 @@ static JSON_Status json_object_remove_internal(JSON_Object *object, const char *
     last_item_index = json_object_get_count(object) - 1;
     for (i = 0; i < json_object_get_count(object); i++) {
         if (strcmp(object->names[i], name) == 0) {
-            parson_free(object->names[i]);
+            if (!object->names_in_situ) {
+                parson_free(object->names[i]);
+            }
             if (free_value) {
                 json_value_free(object->values[i]);
             }
@@ -464,7 +659,9 @@ static void json_object_free(JSON_Object *object)
 {
     size_t i;
     for (i = 0; i < object->count; i++) {
-        parson_free(object->names[i]);
+        if (!object->names_in_situ) {
+            parson_free(object->names[i]);
+        }
         json_value_free(object->values[i]);
     }
     parson_free(object->names);
@@ -538,17 +735,19 @@ static JSON_Value *json_value_init_string_no_copy(char *string)
     }
     new_value->parent = NULL;
     new_value->type = JSONString;
+    new_value->in_situ = 0;
     new_value->value.string = string;
     return new_value;
 }
 
 /* Parser */
-static JSON_Status skip_quotes(const char **string)
+static JSON_Status skip_quotes(const char **string, const char *end)
 {
     if (**string != '\"') {
         return JSONFailure;
     }
     SKIP_CHAR(string);
+    *string = scan_string_special(*string, end);
     while (**string != '\"') {
         if (**string == '\0') {
             return JSONFailure;
@@ -559,6 +758,7 @@ static JSON_Status skip_quotes(const char **string)
             }
         }
         SKIP_CHAR(string);
+        *string = scan_string_special(*string, end);
     }
     SKIP_CHAR(string);
     return JSONSuccess;
@@ -613,20 +813,24 @@ static int parse_utf16(const char **unprocessed, char **processed)
     return JSONSuccess;
 }
 
-/* Copies and processes passed string up to supplied length.
+/* Processes passed string up to supplied length into output, which must hold len + 1 chars and
+may be the input itself, as processed text is never longer than its source.
+Returns a pointer to the terminating '\0' in output or NULL on invalid input.
 Example: "\u006Corem ipsum" -> lorem ipsum */
-static char *process_string(const char *input, size_t len)
+static char *process_string_to(const char *input, size_t len, char *output)
 {
     const char *input_ptr = input;
-    size_t initial_size = (len + 1) * sizeof(char);
-    size_t final_size = 0;
-    char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
-    output = (char *)parson_malloc(initial_size);
-    if (output == NULL) {
-        goto error;
-    }
-    output_ptr = output;
-    while ((*input_ptr != '\0') && (size_t)(input_ptr - input) < len) {
+    const char *input_end = input + len;
+    const char *run_end = NULL;
+    char *output_ptr = output;
+    while ((*input_ptr != '\0') && input_ptr < input_end) {
+        run_end = scan_string_special(input_ptr, input_end);
+        if (run_end != input_ptr) { /* copy plain characters in one go, may overlap in situ */
+            memmove(output_ptr, input_ptr, (size_t)(run_end - input_ptr));
+            output_ptr += run_end - input_ptr;
+            input_ptr = run_end;
+            continue;
+        }
         if (*input_ptr == '\\') {
             input_ptr++;
             switch (*input_ptr) {
@@ -656,14 +860,14 @@ static char *process_string(const char *input, size_t len)
                 break;
             case 'u':
                 if (parse_utf16(&input_ptr, &output_ptr) == JSONFailure) {
-                    goto error;
+                    return NULL;
                 }
                 break;
             default:
-                goto error;
+                return NULL;
             }
         } else if ((unsigned char)*input_ptr < 0x20) {
-            goto error; /* 0x00-0x19 are invalid characters for json string
+            return NULL; /* 0x00-0x19 are invalid characters for json string
                            (http://www.ietf.org/rfc/rfc4627.txt) */
         } else {
             *output_ptr = *input_ptr;
@@ -672,6 +876,23 @@ static char *process_string(const char *input, size_t len)
         input_ptr++;
     }
     *output_ptr = '\0';
+    return output_ptr;
+}
+
+/* Copies and processes passed string up to supplied length. */
+static char *process_string(const char *input, size_t len)
+{
+    size_t initial_size = (len + 1) * sizeof(char);
+    size_t final_size = 0;
+    char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
+    output = (char *)parson_malloc(initial_size);
+    if (output == NULL) {
+        goto error;
+    }
+    output_ptr = process_string_to(input, len, output);
+    if (output_ptr == NULL) {
+        goto error;
+    }
     /* resize to new length */
     final_size = (size_t)(output_ptr - output) + 1;
     /* todo: don't resize if final_size == initial_size */
@@ -688,32 +909,40 @@ error:
 }
 
 /* Return processed contents of a string between quotes and
-   skips passed argument to a matching quote. */
-static char *get_quoted_string(const char **string)
+   skips passed argument to a matching quote. In situ the contents are decoded
+   in place over the quoted text, which is only valid for mutable input. */
+static char *get_quoted_string(const char **string, const char *end, int in_situ)
 {
     const char *string_start = *string;
     size_t string_len = 0;
-    JSON_Status status = skip_quotes(string);
+    JSON_Status status = skip_quotes(string, end);
     if (status != JSONSuccess) {
         return NULL;
     }
     string_len = (size_t)(*string - string_start - 2); /* length without quotes */
+    if (in_situ) {
+        if (process_string_to(string_start + 1, string_len, (char *)string_start + 1) == NULL) {
+            return NULL;
+        }
+        return (char *)string_start + 1;
+    }
     return process_string(string_start + 1, string_len);
 }
 
-static JSON_Value *parse_value(const char **string, size_t nesting)
+static JSON_Value *parse_value(const char **string, const char *end, size_t nesting,
+                               int in_situ)
 {
     if (nesting > MAX_NESTING) {
         return NULL;
     }
-    SKIP_WHITESPACES(string);
+    SKIP_WHITESPACES(string, end);
     switch (**string) {
     case '{':
-        return parse_object_value(string, nesting + 1);
+        return parse_object_value(string, end, nesting + 1, in_situ);
     case '[':
-        return parse_array_value(string, nesting + 1);
+        return parse_array_value(string, end, nesting + 1, in_situ);
     case '\"':
-        return parse_string_value(string);
+        return parse_string_value(string, end, in_situ);
     case 'f':
     case 't':
         return parse_boolean_value(string);
@@ -736,10 +965,12 @@ static JSON_Value *parse_value(const char **string, size_t nesting)
     }
 }
 
-static JSON_Value *parse_object_value(const char **string, size_t nesting)
+static JSON_Value *parse_object_value(const char **string, const char *end, size_t nesting,
+                                      int in_situ)
 {
     JSON_Value *output_value = NULL, *new_value = NULL;
     JSON_Object *output_object = NULL;
+    JSON_Status status = JSONFailure;
     char *new_key = NULL;
     output_value = json_value_init_object();
     if (output_value == NULL) {
@@ -751,45 +982,53 @@ static JSON_Value *parse_object_value(const char **string, size_t nesting)
     }
     output_object = json_value_get_object(output_value);
     SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
+    SKIP_WHITESPACES(string, end);
     if (**string == '}') { /* empty object */
         SKIP_CHAR(string);
         return output_value;
     }
     while (**string != '\0') {
-        new_key = get_quoted_string(string);
+        new_key = get_quoted_string(string, end, in_situ);
         if (new_key == NULL) {
             json_value_free(output_value);
             return NULL;
         }
-        SKIP_WHITESPACES(string);
+        SKIP_WHITESPACES(string, end);
         if (**string != ':') {
-            parson_free(new_key);
+            if (!in_situ) {
+                parson_free(new_key);
+            }
             json_value_free(output_value);
             return NULL;
         }
         SKIP_CHAR(string);
-        new_value = parse_value(string, nesting);
+        new_value = parse_value(string, end, nesting, in_situ);
         if (new_value == NULL) {
-            parson_free(new_key);
+            if (!in_situ) {
+                parson_free(new_key);
+            }
             json_value_free(output_value);
             return NULL;
         }
-        if (json_object_add(output_object, new_key, new_value) == JSONFailure) {
+        if (in_situ) {
+            status = json_object_add_in_situ(output_object, new_key, new_value);
+        } else {
+            status = json_object_add(output_object, new_key, new_value);
             parson_free(new_key);
+        }
+        if (status == JSONFailure) {
             json_value_free(new_value);
             json_value_free(output_value);
             return NULL;
         }
-        parson_free(new_key);
-        SKIP_WHITESPACES(string);
+        SKIP_WHITESPACES(string, end);
         if (**string != ',') {
             break;
         }
         SKIP_CHAR(string);
-        SKIP_WHITESPACES(string);
+        SKIP_WHITESPACES(string, end);
     }
-    SKIP_WHITESPACES(string);
+    SKIP_WHITESPACES(string, end);
     if (**string != '}' || /* Trim object after parsing is over */
         json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure) {
         json_value_free(output_value);
@@ -799,7 +1038,8 @@ static JSON_Value *parse_object_value(const char **string, size_t nesting)
     return output_value;
 }
 
-static JSON_Value *parse_array_value(const char **string, size_t nesting)
+static JSON_Value *parse_array_value(const char **string, const char *end, size_t nesting,
+                                     int in_situ)
 {
     JSON_Value *output_value = NULL, *new_array_value = NULL;
     JSON_Array *output_array = NULL;
@@ -813,13 +1053,13 @@ static JSON_Value *parse_array_value(const char **string, size_t nesting)
     }
     output_array = json_value_get_array(output_value);
     SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
+    SKIP_WHITESPACES(string, end);
     if (**string == ']') { /* empty array */
         SKIP_CHAR(string);
         return output_value;
     }
     while (**string != '\0') {
-        new_array_value = parse_value(string, nesting);
+        new_array_value = parse_value(string, end, nesting, in_situ);
         if (new_array_value == NULL) {
             json_value_free(output_value);
             return NULL;
@@ -829,14 +1069,14 @@ static JSON_Value *parse_array_value(const char **string, size_t nesting)
             json_value_free(output_value);
             return NULL;
         }
-        SKIP_WHITESPACES(string);
+        SKIP_WHITESPACES(string, end);
         if (**string != ',') {
             break;
         }
         SKIP_CHAR(string);
-        SKIP_WHITESPACES(string);
+        SKIP_WHITESPACES(string, end);
     }
-    SKIP_WHITESPACES(string);
+    SKIP_WHITESPACES(string, end);
     if (**string != ']' || /* Trim array after parsing is over */
         json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure) {
         json_value_free(output_value);
@@ -846,18 +1086,21 @@ static JSON_Value *parse_array_value(const char **string, size_t nesting)
     return output_value;
 }
 
-static JSON_Value *parse_string_value(const char **string)
+static JSON_Value *parse_string_value(const char **string, const char *end, int in_situ)
 {
     JSON_Value *value = NULL;
-    char *new_string = get_quoted_string(string);
+    char *new_string = get_quoted_string(string, end, in_situ);
     if (new_string == NULL) {
         return NULL;
     }
     value = json_value_init_string_no_copy(new_string);
     if (value == NULL) {
-        parson_free(new_string);
+        if (!in_situ) {
+            parson_free(new_string);
+        }
         return NULL;
     }
+    value->in_situ = in_situ;
     return value;
 }
 
@@ -1222,7 +1465,18 @@ JSON_Value *json_parse_string(const char *string)
     if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
         string = string + 3; /* Support for UTF-8 BOM */
     }
-    return parse_value((const char **)&string, 0);
+    return parse_value((const char **)&string, string + strlen(string), 0, 0);
+}
+
+JSON_Value *json_parse_string_in_situ(char *string)
+{
+    if (string == NULL) {
+        return NULL;
+    }
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    return parse_value((const char **)&string, string + strlen(string), 0, 1);
 }
 
 JSON_Value *json_parse_string_with_comments(const char *string)
@@ -1236,7 +1490,8 @@ JSON_Value *json_parse_string_with_comments(const char *string)
     remove_comments(string_mutable_copy, "/*", "*/");
     remove_comments(string_mutable_copy, "//", "\n");
     string_mutable_copy_ptr = string_mutable_copy;
-    result = parse_value((const char **)&string_mutable_copy_ptr, 0);
+    result = parse_value((const char **)&string_mutable_copy_ptr,
+                         string_mutable_copy + strlen(string_mutable_copy), 0, 0);
     parson_free(string_mutable_copy);
     return result;
 }
@@ -1312,6 +1567,95 @@ int json_object_dotget_boolean(const JSON_Object *object, const char *name)
     return json_value_get_boolean(json_object_dotget_value(object, name));
 }
 
+/* JSON Path API */
+
+JSON_Path *json_path_compile(const char *path)
+{
+    JSON_Path *compiled = NULL;
+    char *names = NULL;
+    const char *dot_position = NULL;
+    size_t i = 0, count = 1, path_len = 0;
+    if (path == NULL) {
+        return NULL;
+    }
+    path_len = strlen(path);
+    for (i = 0; i < path_len; i++) {
+        if (path[i] == '.') {
+            count++;
+        }
+    }
+    /* Header, segments and a private copy of the path live in one block */
+    compiled = (JSON_Path *)parson_malloc(sizeof(JSON_Path) + count * sizeof(JSON_Path_Segment) +
+                                          path_len + 1);
+    if (compiled == NULL) {
+        return NULL;
+    }
+    compiled->count = count;
+    compiled->segments = (JSON_Path_Segment *)(compiled + 1);
+    names = (char *)(compiled->segments + count);
+    memcpy(names, path, path_len + 1);
+    for (i = 0; i < count; i++) {
+        dot_position = strchr(names, '.');
+        compiled->segments[i].name = names;
+        compiled->segments[i].name_len =
+            dot_position ? (size_t)(dot_position - names) : strlen(names);
+        names += compiled->segments[i].name_len + 1;
+    }
+    return compiled;
+}
+
+void json_path_free(JSON_Path *path)
+{
+    parson_free(path);
+}
+
+JSON_Value *json_object_pathget_value(const JSON_Object *object, const JSON_Path *path)
+{
+    size_t i = 0;
+    JSON_Value *value = NULL;
+    const JSON_Path_Segment *segment = NULL;
+    if (object == NULL || path == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < path->count; i++) {
+        segment = &path->segments[i];
+        value = json_object_getn_value(object, segment->name, segment->name_len);
+        if (value == NULL) {
+            return NULL;
+        }
+        object = json_value_get_object(value);
+        if (object == NULL && i + 1 < path->count) {
+            return NULL;
+        }
+    }
+    return value;
+}
+
+const char *json_object_pathget_string(const JSON_Object *object, const JSON_Path *path)
+{
+    return json_value_get_string(json_object_pathget_value(object, path));
+}
+
+double json_object_pathget_number(const JSON_Object *object, const JSON_Path *path)
+{
+    return json_value_get_number(json_object_pathget_value(object, path));
+}
+
+JSON_Object *json_object_pathget_object(const JSON_Object *object, const JSON_Path *path)
+{
+    return json_value_get_object(json_object_pathget_value(object, path));
+}
+
+JSON_Array *json_object_pathget_array(const JSON_Object *object, const JSON_Path *path)
+{
+    return json_value_get_array(json_object_pathget_value(object, path));
+}
+
+int json_object_pathget_boolean(const JSON_Object *object, const JSON_Path *path)
+{
+    return json_value_get_boolean(json_object_pathget_value(object, path));
+}
+
 size_t json_object_get_count(const JSON_Object *object)
 {
     return object ? object->count : 0;
@@ -1448,7 +1792,9 @@ void json_value_free(JSON_Value *value)
         json_object_free(value->value.object);
         break;
     case JSONString:
-        parson_free(value->value.string);
+        if (!value->in_situ) {
+            parson_free(value->value.string);
+        }
         break;
     case JSONArray:
         json_array_free(value->value.array);
@@ -1467,6 +1813,7 @@ JSON_Value *json_value_init_object(void)
     }
     new_value->parent = NULL;
     new_value->type = JSONObject;
+    new_value->in_situ = 0;
     new_value->value.object = json_object_init(new_value);
     if (!new_value->value.object) {
         parson_free(new_value);
@@ -1483,6 +1830,7 @@ JSON_Value *json_value_init_array(void)
     }
     new_value->parent = NULL;
     new_value->type = JSONArray;
+    new_value->in_situ = 0;
     new_value->value.array = json_array_init(new_value);
     if (!new_value->value.array) {
         parson_free(new_value);
@@ -1526,6 +1874,7 @@ JSON_Value *json_value_init_number(double number)
     }
     new_value->parent = NULL;
     new_value->type = JSONNumber;
+    new_value->in_situ = 0;
     new_value->value.number = number;
     return new_value;
 }
@@ -1538,6 +1887,7 @@ JSON_Value *json_value_init_boolean(int boolean)
     }
     new_value->parent = NULL;
     new_value->type = JSONBoolean;
+    new_value->in_situ = 0;
     new_value->value.boolean = boolean ? 1 : 0;
     return new_value;
 }
@@ -1550,6 +1900,7 @@ JSON_Value *json_value_init_null(void)
     }
     new_value->parent = NULL;
     new_value->type = JSONNull;
+    new_value->in_situ = 0;
     return new_value;
 }
 
@@ -2028,10 +2379,13 @@ JSON_Status json_object_clear(JSON_Object *object)
         return JSONFailure;
     }
     for (i = 0; i < json_object_get_count(object); i++) {
-        parson_free(object->names[i]);
+        if (!object->names_in_situ) {
+            parson_free(object->names[i]);
+        }
         json_value_free(object->values[i]);
     }
     object->count = 0;
+    object->names_in_situ = 0;
     return JSONSuccess;
 }
 
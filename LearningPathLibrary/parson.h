@@ -41,6 +41,7 @@ extern "C" {
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t JSON_Array;
 typedef struct json_value_t JSON_Value;
+typedef struct json_path_t JSON_Path;
 
 enum json_value_type {
     JSONError = -1,
@@ -66,6 +67,12 @@ void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Fu
 /*  Parses first JSON value in a string, returns NULL in case of error */
 JSON_Value *json_parse_string(const char *string);
 
+/*  Parses first JSON value in a mutable string in situ, returns NULL in case of error.
+    The string is destroyed: escapes are decoded in place and every name and string value of the
+    result points into it instead of being copied, so it must outlive the returned value and
+    must not be modified while the value is in use. json_value_free never frees the string. */
+JSON_Value *json_parse_string_in_situ(char *string);
+
 /*  Parses first JSON value in a string and ignores comments (/ * * / and //),
     returns NULL in case of error */
 JSON_Value *json_parse_string_with_comments(const char *string);
@@ -122,6 +129,21 @@ double json_object_dotget_number(const JSON_Object *object,
 int json_object_dotget_boolean(const JSON_Object *object,
                                const char *name); /* returns -1 on fail */
 
+/* Compiled paths behave like dotget names, but the path is split once by json_path_compile,
+ so repeated lookups do no string splitting and no allocation.
+ A compiled path is independent of any document and must be freed with json_path_free. */
+JSON_Path *json_path_compile(const char *path); /* returns NULL on fail */
+void json_path_free(JSON_Path *path);
+
+JSON_Value *json_object_pathget_value(const JSON_Object *object, const JSON_Path *path);
+const char *json_object_pathget_string(const JSON_Object *object, const JSON_Path *path);
+JSON_Object *json_object_pathget_object(const JSON_Object *object, const JSON_Path *path);
+JSON_Array *json_object_pathget_array(const JSON_Object *object, const JSON_Path *path);
+double json_object_pathget_number(const JSON_Object *object,
+                                  const JSON_Path *path); /* returns 0 on fail */
+int json_object_pathget_boolean(const JSON_Object *object,
+                                const JSON_Path *path); /* returns -1 on fail */
+
 /* Functions to get available names */
 size_t json_object_get_count(const JSON_Object *object);
 const char *json_object_get_name(const JSON_Object *object, size_t index);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct
+{
+	float temperature;
+	float humidity;
+	float pressure;
+	int light;
+} LP_ENVIRONMENT;
+
+bool lp_readTelemetry(LP_ENVIRONMENT* environment);	// implemented by the board, AVNET/board.c or SEEED_STUDIO/board.c
+bool lp_readTelemetryAsync(LP_ENVIRONMENT* environment, void (*complete)(LP_ENVIRONMENT* environment, bool ok));
@@ -0,0 +1,46 @@
+#include "telemetry.h"
+#include "worker_pool.h"
+
+static LP_ENVIRONMENT workEnvironment;	// written by the worker only
+static LP_ENVIRONMENT* destination = NULL;
+static void (*asyncComplete)(LP_ENVIRONMENT* environment, bool ok) = NULL;
+
+static bool ReadTelemetryWork(void* context)
+{
+	return lp_readTelemetry(&workEnvironment);
+}
+
+/// <summary>
+///     Runs on the event loop thread. After a timeout the worker may still be writing
+///     workEnvironment, so the reading is only copied to the caller when it succeeded
+/// </summary>
+static void ReadTelemetryComplete(void* context, LP_WORK_RESULT result)
+{
+	if (result == LP_WORK_OK) {
+		*destination = workEnvironment;
+	}
+	asyncComplete(destination, result == LP_WORK_OK);
+}
+
+static LP_WORK readTelemetryWork = {
+	.run = ReadTelemetryWork,
+	.complete = ReadTelemetryComplete,
+	.timeout = { 2, 0 },
+	.name = "readTelemetry" };
+
+/// <summary>
+///     Reads telemetry on a worker thread so sensor I/O does not block the event loop.
+///     complete runs on the event loop thread, environment is only written when ok is true.
+///     Returns false if the previous read is still busy
+/// </summary>
+bool lp_readTelemetryAsync(LP_ENVIRONMENT* environment, void (*complete)(LP_ENVIRONMENT* environment, bool ok))
+{
+	if (!lp_workerPoolStart(1) || lp_workerBusy(&readTelemetryWork)) {
+		return false;
+	}
+
+	destination = environment;
+	asyncComplete = complete;
+
+	return lp_workerSubmit(&readTelemetryWork);
+}
@@ -0,0 +1,193 @@
+/* Compares compiled path lookups with dotget lookups on a device twin document, both for single
+ * paths and for the lookups lp_twinCallback makes for a set of twin bindings.
+ * Usage: bench_parson_path <twin_full.json> */
+
+#include "parson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ITERATIONS 1000000
+#define RUNS 5 /* best of */
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    char *contents = NULL;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents = malloc((size_t)size + 1);
+    if (contents != NULL && fread(contents, 1, (size_t)size, file) == (size_t)size) {
+        contents[size] = '\0';
+    } else {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    return contents;
+}
+
+static volatile const void *sink;
+static volatile double number_sink;
+
+static const char *twin_properties[] = { "DesiredTemperature", "DesiredTemperatureAlertLevel",
+                                         "DesiredCO2AlertLevel", "LedBlink", "Relay1",
+                                         "PublishInterval" };
+#define TWIN_PROPERTY_COUNT (sizeof(twin_properties) / sizeof(twin_properties[0]))
+
+static double best_ns(void (*run)(const JSON_Object *, const void *), const JSON_Object *root,
+                      const void *arg, int iterations)
+{
+    double best = 0, start, elapsed;
+    int run_index, i;
+
+    for (run_index = 0; run_index < RUNS; run_index++) {
+        start = now_ns();
+        for (i = 0; i < iterations; i++) {
+            run(root, arg);
+        }
+        elapsed = (now_ns() - start) / iterations;
+        if (run_index == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static void run_dotget(const JSON_Object *root, const void *path)
+{
+    sink = json_object_dotget_value(root, (const char *)path);
+}
+
+static void run_pathget(const JSON_Object *root, const void *path)
+{
+    sink = json_object_pathget_value(root, (const JSON_Path *)path);
+}
+
+static void run_compile(const JSON_Object *root, const void *path)
+{
+    JSON_Path *once = json_path_compile((const char *)path);
+    (void)root;
+    sink = once;
+    json_path_free(once);
+}
+
+static void bench(const JSON_Object *root, const char *path)
+{
+    JSON_Path *compiled = json_path_compile(path);
+    double dotget_ns = best_ns(run_dotget, root, path, ITERATIONS);
+    double pathget_ns = best_ns(run_pathget, root, compiled, ITERATIONS);
+    double compile_ns = best_ns(run_compile, root, path, ITERATIONS / 10);
+
+    printf("%-54s dotget %6.1f ns  pathget %6.1f ns  (%.2fx)  compile %6.1f ns\n", path,
+           dotget_ns, pathget_ns, dotget_ns / pathget_ns, compile_ns);
+    json_path_free(compiled);
+}
+
+/* lp_twinCallback before compiled paths: dotget "desired", then per binding a presence check, a
+ * type check and a typed get by name, and a type check and get for "$version" */
+static void run_callback_by_name(const JSON_Object *root, const void *unused)
+{
+    const JSON_Object *desired = json_object_dotget_object(root, "desired");
+    size_t i;
+
+    (void)unused;
+    for (i = 0; i < TWIN_PROPERTY_COUNT; i++) {
+        if (json_object_get_value(desired, twin_properties[i]) != NULL) {
+            if (json_object_has_value_of_type(desired, "$version", JSONNumber)) {
+                number_sink = json_object_get_number(desired, "$version");
+            }
+            if (json_object_has_value_of_type(desired, twin_properties[i], JSONNumber)) {
+                number_sink = json_object_get_number(desired, twin_properties[i]);
+            }
+        }
+    }
+}
+
+/* lp_twinCallback now: one compiled lookup per binding, and the value found is used directly */
+static void run_callback_compiled(const JSON_Object *root, const void *arg)
+{
+    JSON_Path *const *paths = (JSON_Path *const *)arg;
+    const JSON_Object *desired = json_object_pathget_object(root, paths[0]);
+    JSON_Value *value, *version;
+    size_t i;
+
+    for (i = 0; i < TWIN_PROPERTY_COUNT; i++) {
+        value = json_object_pathget_value(desired, paths[2 + i]);
+        if (value != NULL) {
+            version = json_object_pathget_value(desired, paths[1]);
+            if (json_value_get_type(version) == JSONNumber) {
+                number_sink = json_value_get_number(version);
+            }
+            if (json_value_get_type(value) == JSONNumber) {
+                number_sink = json_value_get_number(value);
+            }
+        }
+    }
+}
+
+static void bench_callback(const JSON_Object *root)
+{
+    JSON_Path *paths[2 + TWIN_PROPERTY_COUNT];
+    double by_name_ns, compiled_ns;
+    size_t i;
+
+    paths[0] = json_path_compile("desired");
+    paths[1] = json_path_compile("$version");
+    for (i = 0; i < TWIN_PROPERTY_COUNT; i++) {
+        paths[2 + i] = json_path_compile(twin_properties[i]);
+    }
+
+    by_name_ns = best_ns(run_callback_by_name, root, NULL, ITERATIONS / 10);
+    compiled_ns = best_ns(run_callback_compiled, root, paths, ITERATIONS / 10);
+    printf("%-54s by name %6.1f ns  compiled %6.1f ns  (%.2fx)\n",
+           "lp_twinCallback lookups, 6 bindings", by_name_ns, compiled_ns,
+           by_name_ns / compiled_ns);
+
+    for (i = 0; i < 2 + TWIN_PROPERTY_COUNT; i++) {
+        json_path_free(paths[i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char *twin = NULL;
+    JSON_Value *value = NULL;
+    JSON_Object *root = NULL;
+
+    if (argc < 2 || (twin = read_file(argv[1])) == NULL) {
+        fprintf(stderr, "usage: %s twin_full.json\n", argv[0]);
+        return 1;
+    }
+    value = json_parse_string(twin);
+    root = json_value_get_object(value);
+    if (root == NULL || json_object_pathget_value(root, NULL) != NULL) {
+        fprintf(stderr, "cannot parse %s\n", argv[1]);
+        return 1;
+    }
+
+    bench(root, "desired");
+    bench(root, "desired.DesiredTemperature");
+    bench(root, "desired.thermostat.setpoint");
+    bench(root, "desired.$metadata.PublishInterval.$lastUpdatedVersion");
+    bench(root, "reported.$version");
+    bench_callback(root);
+
+    json_value_free(value);
+    free(twin);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/* Times json_parse_string on each document given, which is dominated by the whitespace and
+ * string scanning. Built twice, with the SIMD scan kernels and with PARSON_DISABLE_SIMD, so the
+ * two can be compared on the same corpus.
+ * Usage: bench_parson_scan <file.json>... */
+
+#include "parson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BYTES_PER_RUN (16 * 1024 * 1024) /* parsed per timed run, whatever the document size */
+#define RUNS 5                           /* best of */
+
+#if defined(PARSON_DISABLE_SIMD)
+#define SCAN_KIND "scalar"
+#else
+#define SCAN_KIND "simd"
+#endif
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    char *contents = NULL;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents = malloc((size_t)size + 1);
+    if (contents != NULL && fread(contents, 1, (size_t)size, file) == (size_t)size) {
+        contents[size] = '\0';
+    } else {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    return contents;
+}
+
+static const char *base_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+static int bench(const char *path)
+{
+    char *document = read_file(path);
+    size_t length, iterations;
+    double best = 0, start, elapsed;
+    JSON_Value *value;
+    int run_index;
+    size_t i;
+
+    if (document == NULL || (value = json_parse_string(document)) == NULL) {
+        fprintf(stderr, "cannot parse %s\n", path);
+        free(document);
+        return 0;
+    }
+    json_value_free(value);
+
+    length = strlen(document);
+    iterations = BYTES_PER_RUN / length + 1;
+    for (run_index = 0; run_index < RUNS; run_index++) {
+        start = now_ns();
+        for (i = 0; i < iterations; i++) {
+            json_value_free(json_parse_string(document));
+        }
+        elapsed = (now_ns() - start) / iterations;
+        if (run_index == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    printf("%-6s %-48s %7zu bytes %9.1f us %7.1f MB/s\n", SCAN_KIND, base_name(path), length,
+           best / 1e3, length / best * 1e3);
+    free(document);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, ok = 1;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s file.json...\n", argv[0]);
+        return 1;
+    }
+    for (i = 1; i < argc; i++) {
+        ok &= bench(argv[i]);
+    }
+    return ok ? 0 : 1;
+}
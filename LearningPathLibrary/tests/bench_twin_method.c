@@ -0,0 +1,263 @@
+/* Times the library's cloud paths on the host, against the stubs in stubs/: lp_twinCallback on a
+ * full twin document and on a desired properties patch, lp_directMethodHandler dispatch, and the
+ * reported state serialization behind lp_deviceTwinReportState and lp_deviceTwinAckDesiredState.
+ * Where the linker can wrap malloc, the allocations each operation makes are counted too.
+ * Usage: bench_twin_method <twin_full.json> <twin_patch.json> */
+
+#include "azure_iot_stub.h"
+#include "device_twins.h"
+#include "direct_methods.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ITERATIONS 100000
+#define RUNS 5 /* best of */
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+/* Linked with -Wl,--wrap=malloc, so the library's and parson's allocations come here */
+static size_t allocations = 0;
+
+void *__real_malloc(size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+#endif
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    char *contents = NULL;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents = malloc((size_t)size + 1);
+    if (contents != NULL && fread(contents, 1, (size_t)size, file) == (size_t)size) {
+        contents[size] = '\0';
+    } else {
+        free(contents);
+        contents = NULL;
+    }
+    fclose(file);
+    return contents;
+}
+
+static volatile int handled = 0;
+
+static void twin_handler(LP_DEVICE_TWIN_BINDING *deviceTwinBinding)
+{
+    (void)deviceTwinBinding;
+    handled++;
+}
+
+/* The bindings a lab with the twin document in corpus/ would open */
+static LP_DEVICE_TWIN_BINDING dt_temperature = {
+    .twinProperty = "DesiredTemperature", .twinType = LP_TYPE_FLOAT, .handler = twin_handler};
+static LP_DEVICE_TWIN_BINDING dt_temperatureAlert = {
+    .twinProperty = "DesiredTemperatureAlertLevel", .twinType = LP_TYPE_FLOAT, .handler = twin_handler};
+static LP_DEVICE_TWIN_BINDING dt_co2Alert = {
+    .twinProperty = "DesiredCO2AlertLevel", .twinType = LP_TYPE_INT, .handler = twin_handler};
+static LP_DEVICE_TWIN_BINDING dt_ledBlink = {
+    .twinProperty = "LedBlink", .twinType = LP_TYPE_BOOL, .handler = twin_handler};
+static LP_DEVICE_TWIN_BINDING dt_relay = {
+    .twinProperty = "Relay1", .twinType = LP_TYPE_BOOL, .handler = twin_handler};
+static LP_DEVICE_TWIN_BINDING dt_publishInterval = {
+    .twinProperty = "PublishInterval", .twinType = LP_TYPE_INT, .handler = twin_handler};
+static LP_DEVICE_TWIN_BINDING dt_message = {
+    .twinProperty = "Message", .twinType = LP_TYPE_STRING, .handler = twin_handler};
+
+static LP_DEVICE_TWIN_BINDING *deviceTwinBindingSet[] = {
+    &dt_temperature, &dt_temperatureAlert, &dt_co2Alert, &dt_ledBlink,
+    &dt_relay,       &dt_publishInterval,  &dt_message};
+
+static LP_DIRECT_METHOD_RESPONSE_CODE fan_speed_handler(JSON_Value *json,
+                                                        LP_DIRECT_METHOD_BINDING *directMethodBinding,
+                                                        char **responseMsg)
+{
+    JSON_Object *object = json_value_get_object(json);
+    (void)directMethodBinding;
+
+    if (object == NULL || json_object_get_value(object, "speed") == NULL) {
+        return LP_METHOD_FAILED;
+    }
+    *responseMsg = malloc(32);
+    if (*responseMsg != NULL) {
+        snprintf(*responseMsg, 32, "Fan speed %d", (int)json_object_get_number(object, "speed"));
+    }
+    return LP_METHOD_SUCCEEDED;
+}
+
+static LP_DIRECT_METHOD_RESPONSE_CODE reset_handler(JSON_Value *json,
+                                                    LP_DIRECT_METHOD_BINDING *directMethodBinding,
+                                                    char **responseMsg)
+{
+    (void)json;
+    (void)directMethodBinding;
+    (void)responseMsg;
+    return LP_METHOD_SUCCEEDED;
+}
+
+static LP_DIRECT_METHOD_BINDING dm_lightControl = {.methodName = "LightControl", .handler = reset_handler};
+static LP_DIRECT_METHOD_BINDING dm_setFanSpeed = {.methodName = "SetFanSpeed", .handler = fan_speed_handler};
+static LP_DIRECT_METHOD_BINDING dm_resetMethod = {.methodName = "ResetMethod", .handler = reset_handler};
+
+static LP_DIRECT_METHOD_BINDING *directMethodBindingSet[] = {&dm_lightControl, &dm_setFanSpeed,
+                                                            &dm_resetMethod};
+
+typedef struct {
+    const char *name;
+    void (*run)(const void *arg);
+    const void *arg;
+} BENCH_CASE;
+
+static void run_twin_callback(const void *arg)
+{
+    const char *document = arg;
+    lp_twinCallback(DEVICE_TWIN_UPDATE_COMPLETE, (const unsigned char *)document, strlen(document), NULL);
+}
+
+static void run_method(const void *arg)
+{
+    const char *const *call = arg; /* method name, payload */
+    unsigned char *response = NULL;
+    size_t responseSize = 0;
+
+    lp_directMethodHandler(call[0], (const unsigned char *)call[1], strlen(call[1]), &response,
+                           &responseSize, NULL);
+    free(response);
+}
+
+static void run_report_float(const void *arg)
+{
+    float value = 22.5f;
+    (void)arg;
+    lp_deviceTwinReportState(&dt_temperature, &value);
+}
+
+static void run_report_int(const void *arg)
+{
+    int value = 1000;
+    (void)arg;
+    lp_deviceTwinReportState(&dt_co2Alert, &value);
+}
+
+static void run_report_bool(const void *arg)
+{
+    bool value = true;
+    (void)arg;
+    lp_deviceTwinReportState(&dt_ledBlink, &value);
+}
+
+static void run_report_string(const void *arg)
+{
+    (void)arg;
+    lp_deviceTwinReportState(&dt_message, "Hello from the host");
+}
+
+static void run_ack_float(const void *arg)
+{
+    float value = 22.5f;
+    (void)arg;
+    lp_deviceTwinAckDesiredState(&dt_temperature, &value, LP_DEVICE_TWIN_COMPLETED);
+}
+
+static void bench(const BENCH_CASE *benchCase)
+{
+    double best = 0, start, elapsed;
+    int run_index, i;
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+    allocations = 0;
+    benchCase->run(benchCase->arg);
+    size_t per_operation = allocations;
+#endif
+
+    for (run_index = 0; run_index < RUNS; run_index++) {
+        start = now_ns();
+        for (i = 0; i < ITERATIONS; i++) {
+            benchCase->run(benchCase->arg);
+        }
+        elapsed = (now_ns() - start) / ITERATIONS;
+        if (run_index == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+    printf("%-44s %9.1f ns %9.0f ops/s %4zu allocs\n", benchCase->name, best, 1e9 / best,
+           per_operation);
+#else
+    printf("%-44s %9.1f ns %9.0f ops/s\n", benchCase->name, best, 1e9 / best);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *fanSpeed[] = {"SetFanSpeed", "{\"speed\": 3}"};
+    static const char *reset[] = {"ResetMethod", "{}"};
+    static const char *notFound[] = {"NoSuchMethod", "{\"speed\": 3}"};
+    static const char *invalid[] = {"SetFanSpeed", "{\"speed\": "};
+    char *twin = NULL, *patch = NULL;
+    size_t i;
+
+    if (argc < 3 || (twin = read_file(argv[1])) == NULL || (patch = read_file(argv[2])) == NULL) {
+        fprintf(stderr, "usage: %s twin_full.json twin_patch.json\n", argv[0]);
+        return 1;
+    }
+
+    lp_deviceTwinSetOpen(deviceTwinBindingSet, NELEMS(deviceTwinBindingSet));
+    lp_directMethodSetOpen(directMethodBindingSet, NELEMS(directMethodBindingSet));
+
+    /* Check the cases do what they are named for before timing them */
+    run_twin_callback(twin);
+    if (handled != (int)NELEMS(deviceTwinBindingSet) || *(float *)dt_temperature.twinState != 22.0f) {
+        fprintf(stderr, "twin callback did not update the bindings\n");
+        return 1;
+    }
+    run_report_float(NULL);
+    if (strcmp(lp_hostReportedState(), "{\"DesiredTemperature\":22.500000}") != 0) {
+        fprintf(stderr, "unexpected reported state %s\n", lp_hostReportedState());
+        return 1;
+    }
+
+    const BENCH_CASE cases[] = {
+        {"lp_twinCallback full twin, 7 bindings", run_twin_callback, twin},
+        {"lp_twinCallback desired patch, 7 bindings", run_twin_callback, patch},
+        {"lp_directMethodHandler with response", run_method, fanSpeed},
+        {"lp_directMethodHandler default response", run_method, reset},
+        {"lp_directMethodHandler method not found", run_method, notFound},
+        {"lp_directMethodHandler invalid JSON", run_method, invalid},
+        {"lp_deviceTwinReportState float", run_report_float, NULL},
+        {"lp_deviceTwinReportState int", run_report_int, NULL},
+        {"lp_deviceTwinReportState bool", run_report_bool, NULL},
+        {"lp_deviceTwinReportState string", run_report_string, NULL},
+        {"lp_deviceTwinAckDesiredState float", run_ack_float, NULL},
+    };
+
+    for (i = 0; i < NELEMS(cases); i++) {
+        bench(&cases[i]);
+    }
+
+    lp_directMethodSetClose();
+    lp_deviceTwinSetClose();
+    free(patch);
+    free(twin);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/* libFuzzer harness for lp_directMethodHandler. The input is the method name, a newline, and the
+ * JSON payload, so seeds stay readable; without a newline it is all payload for an unnamed
+ * method. The response must always be a quoted JSON string with one of the response codes. */
+
+#include "direct_methods.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static LP_DIRECT_METHOD_RESPONSE_CODE speed_handler(JSON_Value *json,
+                                                    LP_DIRECT_METHOD_BINDING *directMethodBinding,
+                                                    char **responseMsg)
+{
+    JSON_Object *object = json_value_get_object(json);
+    const char *mode = json_object_dotget_string(object, "fan.mode");
+    (void)directMethodBinding;
+
+    if (json_object_get_value(object, "speed") == NULL) {
+        return LP_METHOD_FAILED;
+    }
+    if (mode != NULL) {
+        *responseMsg = strdup(mode);
+    }
+    return LP_METHOD_SUCCEEDED;
+}
+
+static LP_DIRECT_METHOD_RESPONSE_CODE empty_response_handler(JSON_Value *json,
+                                                             LP_DIRECT_METHOD_BINDING *directMethodBinding,
+                                                             char **responseMsg)
+{
+    (void)directMethodBinding;
+    *responseMsg = strdup("");
+    return json_value_get_type(json) == JSONObject ? LP_METHOD_SUCCEEDED : LP_METHOD_FAILED;
+}
+
+static LP_DIRECT_METHOD_BINDING dm_speed = {.methodName = "SetFanSpeed", .handler = speed_handler};
+static LP_DIRECT_METHOD_BINDING dm_empty = {.methodName = "ResetMethod", .handler = empty_response_handler};
+static LP_DIRECT_METHOD_BINDING dm_unhandled = {.methodName = "LightControl"};
+
+static LP_DIRECT_METHOD_BINDING *directMethodBindingSet[] = {&dm_speed, &dm_empty, &dm_unhandled};
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool opened = false;
+    const uint8_t *newline = memchr(data, '\n', size);
+    size_t nameLength = newline != NULL ? (size_t)(newline - data) : 0;
+    char *methodName = malloc(nameLength + 1);
+    const uint8_t *payload = newline != NULL ? newline + 1 : data;
+    size_t payloadSize = size - (size_t)(payload - data);
+    unsigned char *response = NULL;
+    size_t responseSize = 0;
+    int result;
+
+    if (methodName == NULL) {
+        return 0;
+    }
+    if (!opened) {
+        lp_directMethodSetOpen(directMethodBindingSet, NELEMS(directMethodBindingSet));
+        opened = true;
+    }
+    memcpy(methodName, data, nameLength);
+    methodName[nameLength] = '\0';
+
+    result = lp_directMethodHandler(methodName, payload, payloadSize, &response, &responseSize, NULL);
+
+    if (result != LP_METHOD_SUCCEEDED && result != LP_METHOD_FAILED && result != LP_METHOD_NOT_FOUND) {
+        __builtin_trap();
+    }
+    if (response == NULL || responseSize < 2 || response[0] != '"' || response[responseSize - 1] != '"') {
+        __builtin_trap();
+    }
+
+    free(response);
+    free(methodName);
+    return 0;
+}
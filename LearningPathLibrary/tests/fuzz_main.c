@@ -0,0 +1,42 @@
+/* Runs each file given through LLVMFuzzerTestOneInput, for compilers without libFuzzer, so the
+ * fuzz harnesses still build and replay their seeds under the sanitizers.
+ * Usage: fuzz_<target> <input>... */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        FILE *file = fopen(argv[i], "rb");
+        uint8_t *data = NULL;
+        long size;
+
+        if (file == NULL) {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+        fseek(file, 0, SEEK_END);
+        size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        /* An exact size allocation, so the sanitizers see any read past the input */
+        data = malloc(size > 0 ? (size_t)size : 1);
+        if (data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size) {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+            fclose(file);
+            free(data);
+            return 1;
+        }
+        fclose(file);
+        LLVMFuzzerTestOneInput(data, (size_t)size);
+        free(data);
+    }
+    printf("%d input(s) ran\n", argc - 1);
+    return 0;
+}
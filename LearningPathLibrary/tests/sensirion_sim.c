@@ -0,0 +1,301 @@
+/* The simulated SCD30 and SHT31, see sensirion_sim.h */
+
+#include "sensirion_sim.h"
+#include "virtual_clock.h"
+
+#include <applibs/gpio.h>
+#include <string.h>
+
+#include "sensirion_i2c.h"
+
+#define BUS_NS_PER_BYTE 22500ull /* 9 clocks at 400 kHz */
+#define SCD30_WRITE_DELAY_NS (20 * VCLOCK_NS_PER_MS)
+#define SHT31_CONVERSION_NS (15 * VCLOCK_NS_PER_MS)
+#define SHT31_COMMAND_NS (1 * VCLOCK_NS_PER_MS)
+#define NS_PER_SEC 1000000000ull
+
+#define SCD30_START_PERIODIC_MEASUREMENT 0x0010
+#define SCD30_STOP_PERIODIC_MEASUREMENT 0x0104
+#define SCD30_READ_MEASUREMENT 0x0300
+#define SCD30_SET_MEASUREMENT_INTERVAL 0x4600
+#define SCD30_GET_DATA_READY 0x0202
+#define SCD30_AUTO_SELF_CALIBRATION 0x5306
+#define SHT31_MEASURE_HPM 0x2400
+#define SHT31_MEASURE_LPM 0x2416
+#define SHT31_READ_STATUS 0xF32D
+
+typedef struct {
+    bool started;
+    uint16_t interval_sec;
+    uint64_t nextReady;
+    bool ready;
+    uint16_t asc;
+    uint64_t settingWritten; /* 0 when no setting is waiting out its delay */
+    uint16_t pending;        /* the command a read answers, 0 for none */
+} SCD30_STATE;
+
+typedef struct {
+    uint16_t pending;
+    uint64_t readyAt;
+} SHT31_STATE;
+
+/* Generated by the vendor Makefile, which the samples do not use */
+const char *SCD_DRV_VERSION_STR = "host";
+const char *SHT_DRV_VERSION_STR = "host";
+
+static SENSIRION_SIM sim;
+static SCD30_STATE scd30 = {.interval_sec = 2};
+static SHT31_STATE sht31;
+
+SENSIRION_SIM *sensirion_sim(bool reset)
+{
+    if (reset) {
+        memset(&sim, 0, sizeof(sim));
+        scd30 = (SCD30_STATE){.interval_sec = 2};
+        sht31 = (SHT31_STATE){0};
+    }
+    return &sim;
+}
+
+static uint8_t crc8(const uint8_t *data, int count)
+{
+    uint8_t crc = 0xFF;
+    int i, bit;
+
+    for (i = 0; i < count; i++) {
+        crc ^= data[i];
+        for (bit = 0; bit < 8; bit++) {
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* A word as the sensors send it, big endian with its CRC */
+static void put_word(uint8_t *data, uint16_t word)
+{
+    data[0] = (uint8_t)(word >> 8);
+    data[1] = (uint8_t)word;
+    data[2] = crc8(data, 2);
+}
+
+static void put_float(uint8_t *data, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    put_word(data, (uint16_t)(bits >> 16));
+    put_word(data + 3, (uint16_t)bits);
+}
+
+static void bus(uint16_t count)
+{
+    sim.transfers++;
+    sim.busNs += (count + 1) * BUS_NS_PER_BYTE;
+    vclock_advance((count + 1) * BUS_NS_PER_BYTE);
+}
+
+static void scd30_update(void)
+{
+    while (scd30.started && vclock_now() >= scd30.nextReady) {
+        scd30.ready = true;
+        scd30.nextReady += scd30.interval_sec * NS_PER_SEC;
+    }
+}
+
+static int8_t scd30_write(const uint8_t *data, uint16_t count)
+{
+    uint16_t command, argument = 0;
+    bool hasArgument = count == 5;
+
+    if (count != 2 && count != 5) {
+        sim.protocolErrors++;
+        return -1;
+    }
+    if (scd30.settingWritten != 0 && vclock_now() - scd30.settingWritten < SCD30_WRITE_DELAY_NS) {
+        sim.writeDelayViolations++;
+    }
+    scd30.settingWritten = 0;
+    command = (uint16_t)(data[0] << 8 | data[1]);
+    if (hasArgument) {
+        if (crc8(&data[2], 2) != data[4]) {
+            sim.protocolErrors++;
+            return -1;
+        }
+        argument = (uint16_t)(data[2] << 8 | data[3]);
+    }
+
+    scd30_update();
+    switch (command) {
+    case SCD30_START_PERIODIC_MEASUREMENT:
+        scd30.started = true;
+        scd30.ready = false;
+        scd30.nextReady = vclock_now() + scd30.interval_sec * NS_PER_SEC;
+        return 0;
+    case SCD30_STOP_PERIODIC_MEASUREMENT:
+        scd30.started = false;
+        return 0;
+    case SCD30_SET_MEASUREMENT_INTERVAL:
+        if (!hasArgument) {
+            break;
+        }
+        scd30.interval_sec = argument;
+        scd30.settingWritten = vclock_now();
+        return 0;
+    case SCD30_AUTO_SELF_CALIBRATION:
+        if (hasArgument) {
+            scd30.asc = argument;
+            scd30.settingWritten = vclock_now();
+        } else {
+            scd30.pending = command;
+        }
+        return 0;
+    case SCD30_GET_DATA_READY:
+    case SCD30_READ_MEASUREMENT:
+        scd30.pending = command;
+        return 0;
+    }
+    sim.protocolErrors++;
+    return -1;
+}
+
+static int8_t scd30_read(uint8_t *data, uint16_t count)
+{
+    uint16_t command = scd30.pending;
+
+    scd30.pending = 0;
+    scd30_update();
+    switch (command) {
+    case SCD30_GET_DATA_READY:
+    case SCD30_AUTO_SELF_CALIBRATION:
+        if (count != 3) {
+            break;
+        }
+        put_word(data, command == SCD30_GET_DATA_READY ? scd30.ready : scd30.asc);
+        return 0;
+    case SCD30_READ_MEASUREMENT:
+        if (count != 18) {
+            break;
+        }
+        put_float(data, SENSIRION_SIM_CO2_PPM);
+        put_float(data + 6, SENSIRION_SIM_SCD30_TEMPERATURE);
+        put_float(data + 12, SENSIRION_SIM_SCD30_HUMIDITY);
+        sim.scd30Measurements += scd30.ready;
+        scd30.ready = false;
+        return 0;
+    }
+    sim.protocolErrors++;
+    return -1;
+}
+
+static int8_t sht31_write(const uint8_t *data, uint16_t count)
+{
+    uint16_t command = count == 2 ? (uint16_t)(data[0] << 8 | data[1]) : 0;
+
+    switch (command) {
+    case SHT31_MEASURE_HPM:
+    case SHT31_MEASURE_LPM:
+        sht31.pending = command;
+        sht31.readyAt = vclock_now() + SHT31_CONVERSION_NS;
+        return 0;
+    case SHT31_READ_STATUS:
+        sht31.pending = command;
+        sht31.readyAt = vclock_now() + SHT31_COMMAND_NS;
+        return 0;
+    }
+    sim.protocolErrors++;
+    return -1;
+}
+
+static int8_t sht31_read(uint8_t *data, uint16_t count)
+{
+    if (sht31.pending == 0) {
+        sim.protocolErrors++;
+        return -1;
+    }
+    if (vclock_now() < sht31.readyAt) {
+        sim.earlyReads++;
+        return -1;
+    }
+    if (sht31.pending == SHT31_READ_STATUS && count == 3) {
+        put_word(data, 0x8010);
+    } else if (sht31.pending != SHT31_READ_STATUS && count == 6) {
+        put_word(data, SENSIRION_SIM_SHT31_RAW_TEMPERATURE);
+        put_word(data + 3, SENSIRION_SIM_SHT31_RAW_HUMIDITY);
+        sim.sht31Measurements++;
+    } else {
+        sim.protocolErrors++;
+        return -1;
+    }
+    sht31.pending = 0;
+    return 0;
+}
+
+/* A NACKed address costs a byte of bus time */
+static bool nacked(uint8_t address)
+{
+    unsigned *nacks = address == SENSIRION_SIM_SCD30_ADDRESS ? &sim.scd30Nacks :
+                      address == SENSIRION_SIM_SHT31_ADDRESS ? &sim.sht31Nacks : NULL;
+
+    if (nacks == NULL || *nacks != 0) {
+        if (nacks != NULL) {
+            (*nacks)--;
+        }
+        bus(0);
+        return true;
+    }
+    return false;
+}
+
+int16_t sensirion_i2c_select_bus(uint8_t bus_idx)
+{
+    (void)bus_idx;
+    return 0;
+}
+
+void sensirion_i2c_init(void)
+{
+}
+
+void sensirion_i2c_release(void)
+{
+}
+
+void sensirion_i2c_release_address(uint8_t address)
+{
+    (void)address;
+}
+
+int8_t sensirion_i2c_read(uint8_t address, uint8_t *data, uint16_t count)
+{
+    if (nacked(address)) {
+        return -1;
+    }
+    bus(count);
+    return address == SENSIRION_SIM_SCD30_ADDRESS ? scd30_read(data, count) : sht31_read(data, count);
+}
+
+int8_t sensirion_i2c_write(uint8_t address, const uint8_t *data, uint16_t count)
+{
+    if (nacked(address)) {
+        return -1;
+    }
+    bus(count);
+    return address == SENSIRION_SIM_SCD30_ADDRESS ? scd30_write(data, count) : sht31_write(data, count);
+}
+
+void sensirion_sleep_usec(uint32_t useconds)
+{
+    sim.sleeps++;
+    sim.sleptNs += useconds * 1000ull;
+    vclock_advance(useconds * 1000ull);
+}
+
+/* Every GPIO reads as the SCD30's RDY pin, high while a measurement is waiting */
+int GPIO_GetValue(int gpioFd, GPIO_Value_Type *outValue)
+{
+    (void)gpioFd;
+    scd30_update();
+    *outValue = scd30.ready ? GPIO_Value_High : GPIO_Value_Low;
+    return 0;
+}
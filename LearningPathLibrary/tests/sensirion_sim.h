@@ -0,0 +1,43 @@
+/* A simulated SCD30 and SHT31 behind sensirion_i2c.h, on the virtual clock, for host tests of the
+ * Sensirion drivers in the samples. Each transfer takes its 400 kHz bus time and
+ * sensirion_sleep_usec sleeps in virtual time, both stalling whatever called them. The sensors
+ * keep to their datasheets: the SCD30 wants SCD30_WRITE_DELAY_US after a setting is written
+ * before the next command and has a measurement ready every interval once started, the SHT31
+ * NACKs a read during its 15 ms conversion. Breaking one of those is counted, as are sleeps,
+ * transfers and bus time, and either sensor can be made to NACK its next transfers */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SENSIRION_SIM_SCD30_ADDRESS 0x61
+#define SENSIRION_SIM_SHT31_ADDRESS 0x44
+
+/* What the simulated sensors measure */
+#define SENSIRION_SIM_CO2_PPM 415.5f
+#define SENSIRION_SIM_SCD30_TEMPERATURE 21.25f
+#define SENSIRION_SIM_SCD30_HUMIDITY 45.0f
+#define SENSIRION_SIM_SHT31_RAW_TEMPERATURE 0x6666 /* 24.999 degrees */
+#define SENSIRION_SIM_SHT31_RAW_HUMIDITY 0x8000    /* 50.000 percent */
+
+typedef struct {
+    /* Set by the test */
+    unsigned scd30Nacks; /* the SCD30's next transfers are NACKed */
+    unsigned sht31Nacks;
+    /* Recorded */
+    unsigned long transfers;
+    uint64_t busNs;           /* time spent on the bus */
+    unsigned long sleeps;     /* sensirion_sleep_usec calls */
+    uint64_t sleptNs;
+    unsigned writeDelayViolations; /* SCD30 commands sooner than SCD30_WRITE_DELAY_US after a setting */
+    unsigned earlyReads;           /* SHT31 reads during a conversion */
+    unsigned protocolErrors;       /* reads with no command before them, bad CRCs, unknown commands */
+    unsigned long scd30Measurements; /* measurements read */
+    unsigned long sht31Measurements;
+} SENSIRION_SIM;
+
+/// <summary>
+///     The simulated sensors' settings and records. Powers the sensors off and on, which clears
+///     their state, the settings and the records, when reset is set
+/// </summary>
+SENSIRION_SIM *sensirion_sim(bool reset);
@@ -0,0 +1,164 @@
+/* The simulated LSM6DSO and LPS22HH register files, see st_register_sim.h */
+
+#include "st_register_sim.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define LSM6DSO_CTRL3_C_DEFAULT 0x04  /* if_inc */
+#define LSM6DSO_CTRL3_C_RESET 0x81    /* boot and sw_reset, both clear themselves */
+#define LPS22HH_CTRL_REG2_DEFAULT 0x10 /* if_add_inc */
+#define LPS22HH_CTRL_REG2_RESET 0x84   /* boot and swreset */
+#define LPS22HH_CTRL_REG2_SELF_CLEARING 0x85
+
+typedef struct {
+    uint8_t bank;
+    uint8_t first;
+    uint8_t last;
+} SIM_RANGE;
+
+/* Output registers, a new value on every read */
+static const SIM_RANGE lsm6dsoOutput[] = {
+    {0, LSM6DSO_OUT_TEMP_L, LSM6DSO_OUTZ_H_A},
+    {0, LSM6DSO_TIMESTAMP0, LSM6DSO_TIMESTAMP3},
+    {0, LSM6DSO_FIFO_DATA_OUT_TAG, LSM6DSO_FIFO_DATA_OUT_Z_H},
+    {1, LSM6DSO_SENSOR_HUB_1, LSM6DSO_SENSOR_HUB_1 + 17},
+};
+
+static const SIM_RANGE lps22hhOutput[] = {
+    {0, LPS22HH_PRESS_OUT_XL, LPS22HH_TEMP_OUT_H},
+    {0, LPS22HH_FIFO_DATA_OUT_PRESS_XL, LPS22HH_FIFO_DATA_OUT_TEMP_H},
+};
+
+static bool in_ranges(const SIM_RANGE *ranges, size_t count, unsigned bank, unsigned reg)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (ranges[i].bank == bank && reg >= ranges[i].first && reg <= ranges[i].last) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_output(const ST_REGISTER_SIM *sim, unsigned bank, unsigned reg)
+{
+    if (sim->device == ST_SIM_LSM6DSO) {
+        return in_ranges(lsm6dsoOutput, sizeof(lsm6dsoOutput) / sizeof(lsm6dsoOutput[0]), bank, reg);
+    }
+    return in_ranges(lps22hhOutput, sizeof(lps22hhOutput) / sizeof(lps22hhOutput[0]), bank, reg);
+}
+
+static unsigned current_bank(const ST_REGISTER_SIM *sim)
+{
+    unsigned bank = sim->bankSelect >> 6;
+
+    return bank < ST_SIM_BANKS ? bank : 0;
+}
+
+static void load_defaults(ST_REGISTER_SIM *sim)
+{
+    memset(sim->regs, 0, sizeof(sim->regs));
+    sim->bankSelect = 0;
+
+    if (sim->device == ST_SIM_LSM6DSO) {
+        sim->regs[0][LSM6DSO_WHO_AM_I] = LSM6DSO_ID;
+        sim->regs[0][LSM6DSO_CTRL3_C] = LSM6DSO_CTRL3_C_DEFAULT;
+        sim->regs[0][LSM6DSO_STATUS_REG] = 0x07; /* accelerometer, gyroscope and temperature ready */
+        sim->regs[1][LSM6DSO_STATUS_MASTER] = 0x01; /* sens_hub_endop */
+        sim->regs[2][LSM6DSO_PAGE_SEL] = 0x01;
+    } else {
+        sim->regs[0][LPS22HH_WHO_AM_I] = LPS22HH_ID;
+        sim->regs[0][LPS22HH_CTRL_REG2] = LPS22HH_CTRL_REG2_DEFAULT;
+        sim->regs[0][LPS22HH_STATUS] = 0x03; /* pressure and temperature ready */
+    }
+}
+
+void st_sim_power_on(ST_REGISTER_SIM *sim, ST_SIM_DEVICE device)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->device = device;
+    load_defaults(sim);
+}
+
+void st_sim_context(ST_REGISTER_SIM *sim, stmdev_ctx_t *ctx)
+{
+    ctx->read_reg = st_sim_read;
+    ctx->write_reg = st_sim_write;
+    ctx->handle = sim;
+}
+
+uint8_t st_sim_peek(const ST_REGISTER_SIM *sim, unsigned bank, uint8_t reg)
+{
+    if (sim->device == ST_SIM_LSM6DSO && reg == LSM6DSO_FUNC_CFG_ACCESS) {
+        return sim->bankSelect;
+    }
+    return sim->regs[bank][reg];
+}
+
+int32_t st_sim_read(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
+{
+    ST_REGISTER_SIM *sim = handle;
+    unsigned bank = current_bank(sim);
+    uint16_t i;
+
+    sim->reads++;
+    sim->bytes += len;
+    if (sim->failReads > 0) {
+        sim->failReads--;
+        memset(data, ST_SIM_READ_ERROR_FILL, len);
+        return -1;
+    }
+
+    /* Multi byte accesses step through the registers, as if_inc and if_add_inc do */
+    for (i = 0; i < len; i++) {
+        uint8_t address = (uint8_t)(reg + i);
+
+        if (sim->device == ST_SIM_LSM6DSO && address == LSM6DSO_FUNC_CFG_ACCESS) {
+            data[i] = sim->bankSelect;
+        } else if (is_output(sim, bank, address)) {
+            data[i] = sim->sample++;
+        } else {
+            data[i] = sim->regs[bank][address];
+        }
+    }
+    return 0;
+}
+
+int32_t st_sim_write(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
+{
+    ST_REGISTER_SIM *sim = handle;
+    uint16_t i;
+
+    sim->writes++;
+    sim->bytes += len;
+    if (sim->failWrites > 0) {
+        sim->failWrites--;
+        return -1;
+    }
+
+    for (i = 0; i < len; i++) {
+        uint8_t address = (uint8_t)(reg + i);
+        unsigned bank = current_bank(sim);
+
+        if (sim->device == ST_SIM_LSM6DSO) {
+            if (address == LSM6DSO_FUNC_CFG_ACCESS) {
+                sim->bankSelect = data[i];
+            } else if (bank == 0 && address == LSM6DSO_CTRL3_C && (data[i] & LSM6DSO_CTRL3_C_RESET)) {
+                load_defaults(sim);
+            } else {
+                sim->regs[bank][address] = data[i];
+            }
+        } else if (address == LPS22HH_CTRL_REG2) {
+            if (data[i] & LPS22HH_CTRL_REG2_RESET) {
+                load_defaults(sim);
+            } else {
+                sim->regs[0][address] = data[i] & (uint8_t)~LPS22HH_CTRL_REG2_SELF_CLEARING;
+            }
+        } else {
+            sim->regs[0][address] = data[i];
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+/* A simulated register file for the LSM6DSO and the LPS22HH, behind an stmdev_ctx_t, for host
+ * tests of the ST drivers and of st_reg_cache. It models what the cache relies on: the LSM6DSO's
+ * register banks selected through FUNC_CFG_ACCESS, software reset and reboot putting the
+ * registers back to their defaults, self clearing reset bits, output and FIFO registers that
+ * change on every read, and bus errors injected on the next reads or writes. Every transaction
+ * and byte is counted. */
+
+#pragma once
+
+#include "lps22hh_reg.h"
+#include "lsm6dso_reg.h"
+
+#include <stdint.h>
+
+#define ST_SIM_BANKS 3
+#define ST_SIM_READ_ERROR_FILL 0xEE /* what a failed read leaves in the destination */
+
+typedef enum { ST_SIM_LSM6DSO, ST_SIM_LPS22HH } ST_SIM_DEVICE;
+
+typedef struct {
+    ST_SIM_DEVICE device;
+    uint8_t regs[ST_SIM_BANKS][256];
+    uint8_t bankSelect; /* LSM6DSO FUNC_CFG_ACCESS, shared by every bank */
+    uint8_t sample;     /* the next output byte, so output data never repeats */
+    unsigned failReads;  /* the next failReads reads fail */
+    unsigned failWrites; /* the next failWrites writes fail without reaching the registers */
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long bytes;
+} ST_REGISTER_SIM;
+
+/* Power on: every register at its default, the user bank selected, the counters cleared */
+void st_sim_power_on(ST_REGISTER_SIM *sim, ST_SIM_DEVICE device);
+
+/* Point ctx at the simulated device */
+void st_sim_context(ST_REGISTER_SIM *sim, stmdev_ctx_t *ctx);
+
+/* The register as the device holds it, in the given bank, without a bus transaction */
+uint8_t st_sim_peek(const ST_REGISTER_SIM *sim, unsigned bank, uint8_t reg);
+
+int32_t st_sim_read(void *handle, uint8_t reg, uint8_t *data, uint16_t len);
+int32_t st_sim_write(void *handle, uint8_t reg, uint8_t *data, uint16_t len);
@@ -0,0 +1,4 @@
+/* Host stand-in for the Azure Sphere applibs header of the same name, for the host tests only */
+#pragma once
+
+int Application_Connect(const char *componentId);
@@ -0,0 +1,15 @@
+/* Host stand-in for the Azure Sphere applibs header of the same name, for the host tests only */
+#pragma once
+
+#include <stdint.h>
+
+typedef int GPIO_Id;
+typedef uint8_t GPIO_Value_Type;
+typedef enum { GPIO_Value_Low = 0, GPIO_Value_High = 1 } GPIO_Value;
+typedef uint8_t GPIO_OutputMode_Type;
+#define GPIO_OutputMode_PushPull 0
+
+int GPIO_OpenAsOutput(GPIO_Id gpioId, GPIO_OutputMode_Type outputMode, GPIO_Value_Type initialValue);
+int GPIO_OpenAsInput(GPIO_Id gpioId);
+int GPIO_SetValue(int gpioFd, GPIO_Value_Type value);
+int GPIO_GetValue(int gpioFd, GPIO_Value_Type *outValue);
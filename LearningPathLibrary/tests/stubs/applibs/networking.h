@@ -0,0 +1,6 @@
+/* Host stand-in for the Azure Sphere applibs header of the same name, for the host tests only */
+#pragma once
+
+#include <stdbool.h>
+
+int Networking_IsNetworkingReady(bool *outIsNetworkingReady);
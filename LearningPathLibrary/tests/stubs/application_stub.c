@@ -0,0 +1,34 @@
+/* The simulated real-time app, see application_stub.h */
+
+#include "application_stub.h"
+
+#include <applibs/application.h>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int rtAppSocket = -1;
+
+int Application_Connect(const char *componentId)
+{
+    int sockets[2];
+
+    if (componentId == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) == -1) {
+        return -1;
+    }
+    if (rtAppSocket != -1) {
+        close(rtAppSocket);
+    }
+    rtAppSocket = sockets[1];
+    return sockets[0];
+}
+
+int lp_hostRtAppSocket(void)
+{
+    return rtAppSocket;
+}
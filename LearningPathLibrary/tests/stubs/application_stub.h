@@ -0,0 +1,9 @@
+/* A simulated real-time app behind Application_Connect, for the host tests of inter_core.c. Each
+ * connect makes a SOCK_SEQPACKET socketpair, which keeps message boundaries as the intercore
+ * socket does, hands one end to the caller and keeps the other as the real-time app's end */
+#pragma once
+
+/// <summary>
+///     The real-time app's end of the last connection, -1 before the first
+/// </summary>
+int lp_hostRtAppSocket(void);
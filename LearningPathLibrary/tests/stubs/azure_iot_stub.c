@@ -0,0 +1,49 @@
+#include "azure_iot_stub.h"
+
+#include "azure_iot.h"
+
+#include <string.h>
+
+static char reportedState[512];
+static size_t reportedStateCount = 0;
+
+bool lp_azureConnect(void)
+{
+    return true;
+}
+
+IOTHUB_DEVICE_CLIENT_LL_HANDLE lp_azureClientHandleGet(void)
+{
+    return (IOTHUB_DEVICE_CLIENT_LL_HANDLE)reportedState;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubDeviceClient_LL_SendReportedState(
+    IOTHUB_DEVICE_CLIENT_LL_HANDLE iotHubClientHandle, const unsigned char *reportedStateData, size_t size,
+    IOTHUB_CLIENT_REPORTED_STATE_CALLBACK reportedStateCallback, void *userContextCallback)
+{
+    if (iotHubClientHandle == NULL || reportedStateData == NULL || size >= sizeof(reportedState)) {
+        return IOTHUB_CLIENT_ERROR;
+    }
+    memcpy(reportedState, reportedStateData, size);
+    reportedState[size] = '\0';
+    reportedStateCount++;
+    if (reportedStateCallback != NULL) {
+        reportedStateCallback(200, userContextCallback);
+    }
+    return IOTHUB_CLIENT_OK;
+}
+
+void IoTHubDeviceClient_LL_DoWork(IOTHUB_DEVICE_CLIENT_LL_HANDLE iotHubClientHandle)
+{
+    (void)iotHubClientHandle;
+}
+
+const char *lp_hostReportedState(void)
+{
+    return reportedState;
+}
+
+size_t lp_hostReportedStateCount(void)
+{
+    return reportedStateCount;
+}
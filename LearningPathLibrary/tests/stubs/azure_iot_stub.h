@@ -0,0 +1,16 @@
+/* The parts of azure_iot.c and the IoT Hub client that device_twins.c and direct_methods.c call,
+ * for the host tests. The hub is always connected and reported state is kept for inspection */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// <summary>
+///     The last reported state sent, NUL terminated, or an empty string if none has been
+/// </summary>
+const char *lp_hostReportedState(void);
+
+/// <summary>
+///     The number of reported state updates sent since the program started
+/// </summary>
+size_t lp_hostReportedStateCount(void);
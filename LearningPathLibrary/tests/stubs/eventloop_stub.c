@@ -0,0 +1,133 @@
+/* The applibs EventLoop for the host tests, on epoll like the device's. EventLoop_Run with a zero
+ * duration dispatches what is ready and returns EventLoop_Run_FinishedEmpty when nothing was */
+
+#include <applibs/eventloop.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+struct EventLoop {
+    int epollFd;
+    bool stopped;
+};
+
+struct EventRegistration {
+    int fd;
+    EventLoopIoCallback *callback;
+    void *context;
+};
+
+static uint32_t to_epoll(EventLoop_IoEvents events)
+{
+    return ((events & EventLoop_Input) ? EPOLLIN : 0) | ((events & EventLoop_Output) ? EPOLLOUT : 0);
+}
+
+static EventLoop_IoEvents from_epoll(uint32_t events)
+{
+    return ((events & EPOLLIN) ? EventLoop_Input : 0) | ((events & EPOLLOUT) ? EventLoop_Output : 0) |
+           ((events & (EPOLLERR | EPOLLHUP)) ? EventLoop_Error : 0);
+}
+
+EventLoop *EventLoop_Create(void)
+{
+    EventLoop *el = calloc(1, sizeof(*el));
+
+    if (el == NULL) {
+        return NULL;
+    }
+    el->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (el->epollFd == -1) {
+        free(el);
+        return NULL;
+    }
+    return el;
+}
+
+void EventLoop_Close(EventLoop *el)
+{
+    if (el != NULL) {
+        close(el->epollFd);
+        free(el);
+    }
+}
+
+EventLoop_Run_Result EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event)
+{
+    struct epoll_event event;
+    int timeout = duration_in_milliseconds;
+    bool dispatched = false;
+
+    /* One event per epoll_wait, so a callback can unregister any registration, even one that
+     * is also ready */
+    el->stopped = false;
+    while (!el->stopped) {
+        int count = epoll_wait(el->epollFd, &event, 1, timeout);
+        EventRegistration *reg;
+
+        if (count == -1 && errno != EINTR) {
+            return EventLoop_Run_Failed;
+        }
+        if (count <= 0) {
+            break;
+        }
+        reg = event.data.ptr;
+        reg->callback(el, reg->fd, from_epoll(event.events), reg->context);
+        dispatched = true;
+        if (process_one_event) {
+            break;
+        }
+        timeout = duration_in_milliseconds < 0 ? -1 : 0; /* -1 runs until EventLoop_Stop */
+    }
+    return dispatched ? EventLoop_Run_Finished : EventLoop_Run_FinishedEmpty;
+}
+
+int EventLoop_Stop(EventLoop *el)
+{
+    el->stopped = true;
+    return 0;
+}
+
+int EventLoop_GetWaitDescriptor(EventLoop *el)
+{
+    return el->epollFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+                                        EventLoopIoCallback *callback, void *context)
+{
+    EventRegistration *reg = malloc(sizeof(*reg));
+    struct epoll_event event = {.events = to_epoll(eventBitmask)};
+
+    if (reg == NULL) {
+        return NULL;
+    }
+    reg->fd = fd;
+    reg->callback = callback;
+    reg->context = context;
+    event.data.ptr = reg;
+    if (epoll_ctl(el->epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        free(reg);
+        return NULL;
+    }
+    return reg;
+}
+
+int EventLoop_ModifyIoEvents(EventLoop *el, EventRegistration *reg, EventLoop_IoEvents eventBitmask)
+{
+    struct epoll_event event = {.events = to_epoll(eventBitmask), .data.ptr = reg};
+
+    return epoll_ctl(el->epollFd, EPOLL_CTL_MOD, reg->fd, &event);
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+    if (reg == NULL) {
+        return 0;
+    }
+    /* The fd may already be closed, which removed it from the epoll set */
+    epoll_ctl(el->epollFd, EPOLL_CTL_DEL, reg->fd, NULL);
+    free(reg);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "i2c_stub.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+static LP_HOST_ISU isu;
+static pthread_mutex_t isuLock = PTHREAD_MUTEX_INITIALIZER;
+static int running = 0; /* transfers in progress */
+static uint8_t nextByte = 0;
+
+LP_HOST_ISU *lp_hostIsu(bool reset)
+{
+    if (reset) {
+        pthread_mutex_lock(&isuLock);
+        memset(&isu, 0, sizeof(isu));
+        pthread_mutex_unlock(&isuLock);
+    }
+    return &isu;
+}
+
+int I2CMaster_Open(I2C_InterfaceId id)
+{
+    (void)id;
+    pthread_mutex_lock(&isuLock);
+    isu.opens++;
+    pthread_mutex_unlock(&isuLock);
+    return open("/dev/null", O_RDWR | O_CLOEXEC);
+}
+
+int I2CMaster_SetBusSpeed(int fd, uint32_t speedInHz)
+{
+    (void)fd;
+    pthread_mutex_lock(&isuLock);
+    isu.speedSets++;
+    pthread_mutex_unlock(&isuLock);
+    if (isu.refuseSpeed != 0 && speedInHz >= isu.refuseSpeed) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int I2CMaster_SetTimeout(int fd, uint32_t timeoutInMs)
+{
+    (void)fd;
+    (void)timeoutInMs;
+    return 0;
+}
+
+static ssize_t transfer(int fd, I2C_DeviceAddress address, uint8_t *readData, size_t length)
+{
+    ssize_t result = (ssize_t)length;
+    int error = 0;
+
+    pthread_mutex_lock(&isuLock);
+    if (running++ != 0) {
+        isu.overlaps++;
+    }
+    if (fcntl(fd, F_GETFD) == -1) {
+        isu.closedFdTransfers++;
+    }
+    isu.transfers++;
+    if (isu.logCount < LP_HOST_ISU_LOG) {
+        isu.log[isu.logCount++] = address;
+    }
+    if (isu.failTransfers > 0) {
+        isu.failTransfers--;
+        error = isu.failErrno != 0 ? isu.failErrno : EIO;
+        result = -1;
+    } else if (isu.shortTransfers > 0) {
+        isu.shortTransfers--;
+        result--;
+    }
+    /* Reads return a running count, so data read twice is never mistaken for new data */
+    if (readData != NULL) {
+        for (size_t i = 0; i < length; i++) {
+            readData[i] = nextByte++;
+        }
+    }
+    pthread_mutex_unlock(&isuLock);
+
+    if (isu.transfer_ms != 0) {
+        struct timespec hold = {.tv_sec = 0, .tv_nsec = (long)isu.transfer_ms * 1000000};
+        nanosleep(&hold, NULL);
+    }
+
+    pthread_mutex_lock(&isuLock);
+    running--;
+    pthread_mutex_unlock(&isuLock);
+
+    errno = error;
+    return result;
+}
+
+ssize_t I2CMaster_Write(int fd, I2C_DeviceAddress address, const uint8_t *buffer, size_t length)
+{
+    (void)buffer;
+    return transfer(fd, address, NULL, length);
+}
+
+ssize_t I2CMaster_Read(int fd, I2C_DeviceAddress address, uint8_t *buffer, size_t maxLength)
+{
+    return transfer(fd, address, buffer, maxLength);
+}
+
+ssize_t I2CMaster_WriteThenRead(int fd, I2C_DeviceAddress address, const uint8_t *writeData,
+                                size_t lenWriteData, uint8_t *readData, size_t lenReadData)
+{
+    (void)writeData;
+    /* Like the real one, the count covers both halves */
+    ssize_t result = transfer(fd, address, readData, lenReadData);
+    return result < 0 ? result : result + (ssize_t)lenWriteData;
+}
@@ -0,0 +1,32 @@
+/* A simulated ISU behind the applibs I2CMaster functions, for the host tests of i2c_bus.c. Each
+ * open hands out a real file descriptor, so the bus manager's close works and a transfer on a
+ * closed descriptor can be told apart. Speeds can be refused, transfers made to fail, come up
+ * short or hold the bus for a while, and it records what the bus manager did with it */
+#pragma once
+
+#include <applibs/i2c.h>
+#include <stdbool.h>
+
+#define LP_HOST_ISU_LOG 64
+
+typedef struct {
+    /* Set by the test while no transfer is running */
+    uint32_t refuseSpeed;    /* I2CMaster_SetBusSpeed fails at or above this speed, 0 for never */
+    unsigned failTransfers;  /* the next transfers fail with failErrno */
+    int failErrno;
+    unsigned shortTransfers; /* the next transfers move one byte less than asked */
+    unsigned transfer_ms;    /* how long each transfer holds the bus */
+    /* Recorded */
+    unsigned opens;
+    unsigned closedFdTransfers; /* transfers on a descriptor that was closed */
+    unsigned speedSets;
+    unsigned transfers;
+    unsigned overlaps; /* transfers started while another was still running */
+    I2C_DeviceAddress log[LP_HOST_ISU_LOG]; /* the address of each transfer, in order */
+    unsigned logCount;
+} LP_HOST_ISU;
+
+/// <summary>
+///     The simulated ISU's settings and records. Clears the records and settings when reset is set
+/// </summary>
+LP_HOST_ISU *lp_hostIsu(bool reset);
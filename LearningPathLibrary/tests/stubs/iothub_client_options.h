@@ -0,0 +1,3 @@
+/* Host stand-in for the Azure IoT SDK header of the same name, for the host tests only. Nothing
+ * in it is used by the code built on the host */
+#pragma once
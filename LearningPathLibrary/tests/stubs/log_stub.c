@@ -0,0 +1,26 @@
+/* Log_Debug for the host tests. Quiet unless LP_HOST_LOG is set in the environment, so benchmarks
+ * and fuzzers do not spend their time printing */
+
+#include <applibs/log.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int Log_Debug(const char *fmt, ...)
+{
+    static int enabled = -1;
+    va_list args;
+    int written;
+
+    if (enabled < 0) {
+        enabled = getenv("LP_HOST_LOG") != NULL;
+    }
+    if (!enabled) {
+        return 0;
+    }
+    va_start(args, fmt);
+    written = vfprintf(stderr, fmt, args);
+    va_end(args);
+    return written;
+}
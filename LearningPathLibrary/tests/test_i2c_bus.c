@@ -0,0 +1,291 @@
+/* Tests for the I2C bus manager in i2c_bus.c against the simulated ISU in stubs/i2c_stub.c: bus
+ * speed negotiation and fallback, retries with and without backoff, transfers that must not be
+ * retried, service in priority order, four threads never overlapping on the bus, and a device
+ * detached while its transfer waits for the bus.
+ * Usage: test_i2c_bus */
+
+#include "i2c_bus.h"
+#include "i2c_stub.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define ISU 2
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(unsigned ms)
+{
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = (long)ms * 1000000};
+    nanosleep(&ts, NULL);
+}
+
+static LP_I2C_DEVICE *device(LP_I2C_DEVICE *device, I2C_DeviceAddress address, uint32_t maxSpeed,
+                             LP_I2C_PRIORITY priority)
+{
+    memset(device, 0, sizeof(*device));
+    device->address = address;
+    device->maxSpeed = maxSpeed;
+    device->priority = priority;
+    return device;
+}
+
+static void test_speed_negotiation(void)
+{
+    LP_I2C_DEVICE imu, scd30, unknown;
+    LP_HOST_ISU *isu = lp_hostIsu(true);
+
+    /* One open, at the fastest speed every attached device supports */
+    CHECK(lp_i2cAttach(device(&imu, 0x6a, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cBusSpeed(ISU) == I2C_BUS_SPEED_FAST_PLUS);
+    CHECK(lp_i2cAttach(device(&scd30, 0x61, I2C_BUS_SPEED_STANDARD, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cBusSpeed(ISU) == I2C_BUS_SPEED_STANDARD);
+    CHECK(isu->opens == 1);
+
+    /* Back up once the slow device leaves, and closed with the last one */
+    lp_i2cDetach(&scd30);
+    CHECK(lp_i2cBusSpeed(ISU) == I2C_BUS_SPEED_FAST_PLUS);
+    lp_i2cDetach(&imu);
+    CHECK(lp_i2cBusSpeed(ISU) == 0);
+
+    /* An ISU refusing a speed falls back to the next slower one */
+    isu->refuseSpeed = I2C_BUS_SPEED_FAST_PLUS;
+    CHECK(lp_i2cAttach(&imu, ISU));
+    CHECK(lp_i2cBusSpeed(ISU) == I2C_BUS_SPEED_FAST);
+
+    /* A device that does not say runs at the standard speed */
+    CHECK(lp_i2cAttach(device(&unknown, 0x44, 0, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cBusSpeed(ISU) == I2C_BUS_SPEED_STANDARD);
+    lp_i2cDetach(&unknown);
+    lp_i2cDetach(&imu);
+
+    /* Nothing it can run at, the attach fails and the ISU is closed again */
+    isu->refuseSpeed = I2C_BUS_SPEED_STANDARD;
+    CHECK(!lp_i2cAttach(&imu, ISU));
+    CHECK(imu.bus == NULL && lp_i2cBusSpeed(ISU) == 0);
+}
+
+static void test_retries(void)
+{
+    LP_I2C_DEVICE imu;
+    LP_HOST_ISU *isu = lp_hostIsu(true);
+    uint8_t data[3] = {1, 2, 3};
+    double start, quick, slept;
+
+    CHECK(lp_i2cAttach(device(&imu, 0x6a, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+
+    /* Straight back in the queue, no sleeping on the event loop thread */
+    isu->failTransfers = 2;
+    start = now_ms();
+    CHECK(lp_i2cWrite(&imu, data, sizeof(data)) == sizeof(data));
+    quick = now_ms() - start;
+    CHECK(imu.stats.retries == 2 && imu.stats.errors == 0 && imu.stats.transactions == 1);
+
+    /* Backoff of 2 then 4 ms for a device that opted in */
+    imu.retryBackoff = true;
+    isu->failTransfers = 2;
+    start = now_ms();
+    CHECK(lp_i2cWrite(&imu, data, sizeof(data)) == sizeof(data));
+    slept = now_ms() - start;
+    CHECK(slept >= 6);
+    imu.retryBackoff = false;
+
+    /* A short transfer is a failure too */
+    isu->shortTransfers = 1;
+    CHECK(lp_i2cWrite(&imu, data, sizeof(data)) == sizeof(data));
+    CHECK(imu.stats.retries == 5);
+
+    /* Giving up with the device's errno after the last retry */
+    isu->failTransfers = 100;
+    isu->failErrno = ENXIO;
+    CHECK(lp_i2cWrite(&imu, data, sizeof(data)) == -1 && errno == ENXIO);
+    CHECK(imu.stats.errors == 1 && imu.stats.lastError == ENXIO);
+    CHECK(imu.stats.retries == 5 + LP_I2C_MAX_RETRIES);
+    isu->failTransfers = 0;
+
+    lp_i2cDetach(&imu);
+    CHECK(lp_i2cWrite(&imu, data, sizeof(data)) == -1 && errno == ENODEV);
+    printf("retries: %.2f ms without backoff, %.2f ms with\n", quick, slept);
+}
+
+static void test_read_once(void)
+{
+    LP_I2C_DEVICE imu;
+    LP_HOST_ISU *isu = lp_hostIsu(true);
+    uint8_t reg = 0x78, words[14];
+    unsigned transfers;
+
+    CHECK(lp_i2cAttach(device(&imu, 0x6a, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+
+    /* A FIFO burst that fails or comes up short is not read again */
+    transfers = isu->transfers;
+    isu->failTransfers = 1;
+    isu->failErrno = EBUSY;
+    CHECK(lp_i2cWriteThenReadOnce(&imu, &reg, 1, words, sizeof(words)) == -1 && errno == EBUSY);
+    CHECK(isu->transfers == transfers + 1);
+    isu->shortTransfers = 1;
+    CHECK(lp_i2cWriteThenReadOnce(&imu, &reg, 1, words, sizeof(words)) == -1 && errno == EIO);
+    CHECK(isu->transfers == transfers + 2);
+    CHECK(imu.stats.retries == 0 && imu.stats.errors == 2);
+
+    /* When it works it is like any other read */
+    CHECK(lp_i2cWriteThenReadOnce(&imu, &reg, 1, words, sizeof(words)) == 1 + sizeof(words));
+    CHECK(isu->transfers == transfers + 3);
+
+    /* Where an ordinary read tries again */
+    isu->shortTransfers = 1;
+    CHECK(lp_i2cWriteThenRead(&imu, &reg, 1, words, sizeof(words)) == 1 + sizeof(words));
+    CHECK(isu->transfers == transfers + 5);
+    lp_i2cDetach(&imu);
+}
+
+typedef struct {
+    LP_I2C_DEVICE *device;
+    ssize_t result;
+    int error;
+} WRITER;
+
+static void *write_once(void *arg)
+{
+    WRITER *writer = arg;
+    uint8_t data[4] = {0};
+
+    writer->result = lp_i2cWrite(writer->device, data, sizeof(data));
+    writer->error = errno;
+    return NULL;
+}
+
+static void test_priority_order(void)
+{
+    LP_I2C_DEVICE first, low, normal, high;
+    WRITER writers[4] = {{.device = &first}, {.device = &low}, {.device = &normal}, {.device = &high}};
+    pthread_t threads[4];
+    LP_HOST_ISU *isu;
+
+    CHECK(lp_i2cAttach(device(&first, 0x10, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cAttach(device(&low, 0x11, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_LOW), ISU));
+    CHECK(lp_i2cAttach(device(&normal, 0x12, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cAttach(device(&high, 0x13, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_HIGH), ISU));
+    isu = lp_hostIsu(true);
+    isu->transfer_ms = 50;
+
+    /* While the first transfer holds the bus the others queue, lowest priority first */
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, write_once, &writers[i]);
+        sleep_ms(10);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(writers[i].result == 4);
+    }
+
+    CHECK(isu->logCount == 4);
+    CHECK(isu->log[0] == first.address && isu->log[1] == high.address &&
+          isu->log[2] == normal.address && isu->log[3] == low.address);
+
+    lp_i2cDetach(&first);
+    lp_i2cDetach(&low);
+    lp_i2cDetach(&normal);
+    lp_i2cDetach(&high);
+}
+
+#define HAMMER_TRANSFERS 2000
+
+static void *hammer(void *arg)
+{
+    LP_I2C_DEVICE *device = arg;
+    uint8_t reg = 0x28, data[6];
+
+    for (int i = 0; i < HAMMER_TRANSFERS; i++) {
+        if (lp_i2cWriteThenRead(device, &reg, 1, data, sizeof(data)) != 1 + sizeof(data)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void test_no_overlap(void)
+{
+    LP_I2C_DEVICE imu, pressure;
+    pthread_t threads[4];
+    LP_HOST_ISU *isu = lp_hostIsu(true);
+
+    CHECK(lp_i2cAttach(device(&imu, 0x6a, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cAttach(device(&pressure, 0x5c, I2C_BUS_SPEED_FAST, LP_I2C_PRIORITY_HIGH), ISU));
+
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, hammer, i % 2 ? &imu : &pressure);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK(isu->overlaps == 0);
+    CHECK(isu->transfers == 4 * HAMMER_TRANSFERS);
+    CHECK(imu.stats.transactions == 2 * HAMMER_TRANSFERS && pressure.stats.transactions == 2 * HAMMER_TRANSFERS);
+    lp_i2cDetach(&imu);
+    lp_i2cDetach(&pressure);
+}
+
+static void test_detach_during_transfer(void)
+{
+    LP_I2C_DEVICE first, queued;
+    WRITER writers[2] = {{.device = &first}, {.device = &queued}};
+    pthread_t threads[2];
+    LP_HOST_ISU *isu;
+
+    CHECK(lp_i2cAttach(device(&first, 0x10, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+    CHECK(lp_i2cAttach(device(&queued, 0x11, I2C_BUS_SPEED_FAST_PLUS, LP_I2C_PRIORITY_NORMAL), ISU));
+    isu = lp_hostIsu(true);
+    isu->transfer_ms = 50;
+
+    /* The queued device is detached and the bus closed while its transfer waits for the bus */
+    pthread_create(&threads[0], NULL, write_once, &writers[0]);
+    sleep_ms(10);
+    pthread_create(&threads[1], NULL, write_once, &writers[1]);
+    sleep_ms(10);
+    lp_i2cDetach(&queued);
+    lp_i2cDetach(&first);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    CHECK(writers[0].result == 4);
+    CHECK(writers[1].result == -1 && writers[1].error == ENODEV);
+    CHECK(isu->transfers == 1 && isu->closedFdTransfers == 0);
+    CHECK(lp_i2cBusSpeed(ISU) == 0);
+}
+
+int main(void)
+{
+    test_speed_negotiation();
+    test_retries();
+    test_read_once();
+    test_priority_order();
+    test_no_overlap();
+    test_detach_during_transfer();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_i2c_bus passed\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+/* Intercore receive batching, over a SOCK_SEQPACKET socketpair standing in for the real-time
+ * app's socket. The real-time end sends bursts of legacy blocks and the event loop runs until the
+ * socket is drained, first through inter_core.c, which drains a burst per readiness event, then
+ * through a handler with one blocking recv per event, like the one batching replaced. Every
+ * message must arrive once and in order. Reports the event loop dispatches and messages/s of each.
+ * Usage: test_inter_core_batch [messages] [burst] */
+
+#include "inter_core.h"
+#include "application_stub.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+static unsigned long received;
+static unsigned long mismatches;
+
+static void receive(LP_IC_MESSAGE *message)
+{
+    if (message->cmd != LP_IC_ENVIRONMENT_SENSOR || message->temperature != (float)received) {
+        mismatches++;
+    }
+    received++;
+}
+
+/* The handler inter_core.c had before batching: one recv per readiness event */
+static void one_recv_handler(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+{
+    LP_INTER_CORE_BLOCK block;
+    LP_IC_MESSAGE message;
+
+    (void)el;
+    (void)events;
+    (void)context;
+    if (recv(fd, &block, sizeof(block), 0) == -1) {
+        mismatches++;
+        return;
+    }
+    lp_icFromBlock(&block, &message);
+    receive(&message);
+}
+
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (double)(end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Returns the event loop dispatches it took to receive messages sent burst at a time */
+static unsigned long run(const char *name, int rtAppSocket, unsigned long messages, unsigned burst)
+{
+    EventLoop *eventLoop = lp_timerGetEventLoop();
+    LP_INTER_CORE_BLOCK block = {.cmd = LP_IC_ENVIRONMENT_SENSOR};
+    unsigned long sent = 0, dispatches = 0;
+    struct timespec start;
+    double seconds;
+
+    received = mismatches = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (sent < messages) {
+        unsigned i;
+
+        for (i = 0; i < burst && sent < messages; i++) {
+            block.temperature = (float)sent++;
+            if (send(rtAppSocket, &block, sizeof(block), 0) != sizeof(block)) {
+                mismatches++;
+            }
+        }
+        while (EventLoop_Run(eventLoop, 0, true) == EventLoop_Run_Finished) {
+            dispatches++;
+        }
+    }
+    seconds = seconds_since(&start);
+
+    CHECK(received == messages);
+    CHECK(mismatches == 0);
+    printf("%-16s %lu messages in bursts of %u: %lu dispatches, %.2f M msgs/s\n", name, messages,
+           burst, dispatches, messages / seconds / 1e6);
+    return dispatches;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long messages = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000;
+    unsigned burst = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 10;
+    unsigned long bursts = (messages + burst - 1) / burst;
+    LP_INTER_CORE_CHANNEL channel = {
+        .name = "bench", .rtAppComponentId = "rt-app", .interCoreCallback = receive};
+    LP_INTER_CORE_STATS stats;
+    EventRegistration *registration;
+    unsigned long dispatches;
+    int sockets[2];
+
+    CHECK(burst != 0);
+    CHECK(lp_interCoreChannelOpen(&channel));
+    dispatches = run("batched", lp_hostRtAppSocket(), messages, burst);
+    /* A burst that fits the batch is drained by the one event */
+    if (burst <= LP_INTER_CORE_BATCH_SIZE) {
+        CHECK(dispatches == bursts);
+    }
+    lp_interCoreChannelGetStats(&channel, &stats);
+    CHECK(stats.received == messages && stats.dropped == 0 && stats.errors == 0);
+    lp_interCoreChannelClose(&channel);
+
+    CHECK(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) == 0);
+    registration = EventLoop_RegisterIo(lp_timerGetEventLoop(), sockets[0], EventLoop_Input, one_recv_handler, NULL);
+    CHECK(registration != NULL);
+    dispatches = run("one recv a turn", sockets[1], messages, burst);
+    CHECK(dispatches == messages);
+    EventLoop_UnregisterIo(lp_timerGetEventLoop(), registration);
+    close(sockets[0]);
+    close(sockets[1]);
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_inter_core_batch passed\n");
+    return 0;
+}
@@ -0,0 +1,239 @@
+/* Tests for the intercore SPSC ring in IntercoreContract/intercore_ring.h: blocks that wrap the
+ * end of the data area, a full ring, a destination too small, one doorbell per flushed batch, and
+ * a two thread stress run over one shared header and data layout, like the two cores, with every
+ * payload checked and the throughput reported for unbatched and batched doorbells.
+ * Usage: test_intercore_ring [messages per stress run] */
+
+#include "intercore_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define RING_SIZE 4096
+
+/* What each side sees as its outbound buffer, as GetIntercoreBuffers returns them */
+static _Alignas(64) uint8_t bufferA[sizeof(LP_IC_RING_HEADER) + RING_SIZE];
+static _Alignas(64) uint8_t bufferB[sizeof(LP_IC_RING_HEADER) + RING_SIZE];
+
+static unsigned long doorbells[2];
+
+static void doorbell(uint32_t swint)
+{
+    __atomic_fetch_add(&doorbells[swint], 1, __ATOMIC_RELAXED);
+}
+
+static void reset_rings(LP_IC_RING *writer, LP_IC_RING *reader)
+{
+    memset(bufferA, 0, sizeof(bufferA));
+    memset(bufferB, 0, sizeof(bufferB));
+    doorbells[LP_IC_RING_SWINT_WRITE] = doorbells[LP_IC_RING_SWINT_READ] = 0;
+    lp_icRingInit(writer, bufferA, bufferB, RING_SIZE, doorbell);
+    lp_icRingInit(reader, bufferB, bufferA, RING_SIZE, doorbell);
+}
+
+static void test_batched_doorbell(void)
+{
+    LP_IC_RING writer, reader;
+    uint8_t block[64], received[64];
+    uint32_t size, i;
+
+    reset_rings(&writer, &reader);
+    for (i = 0; i < 8; i++) {
+        uint8_t *space = lp_icRingReserve(&writer, sizeof(block));
+        CHECK(space != NULL);
+        memset(space, (int)i, sizeof(block));
+        lp_icRingCommit(&writer, 10 + i);
+    }
+
+    /* Nothing is visible until the flush, which rings once for the batch */
+    size = sizeof(received);
+    CHECK(lp_icRingDequeue(&reader, received, &size) == -1);
+    CHECK(lp_icRingFlushWrites(&writer) == 8);
+    CHECK(lp_icRingFlushWrites(&writer) == 0);
+    CHECK(doorbells[LP_IC_RING_SWINT_WRITE] == 1);
+
+    for (i = 0; i < 8; i++) {
+        size = sizeof(received);
+        CHECK(lp_icRingDequeue(&reader, received, &size) == 0);
+        CHECK(size == 10 + i);
+        CHECK(received[0] == i && received[size - 1] == i);
+    }
+    CHECK(lp_icRingFlushReads(&reader) == 8);
+    CHECK(doorbells[LP_IC_RING_SWINT_READ] == 1);
+    CHECK(__atomic_load_n(&((LP_IC_RING_HEADER *)bufferB)->readPosition, __ATOMIC_ACQUIRE) ==
+          __atomic_load_n(&((LP_IC_RING_HEADER *)bufferA)->writePosition, __ATOMIC_ACQUIRE));
+}
+
+static void fill_block(uint8_t *block, uint32_t size, uint32_t sequence)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        block[i] = (uint8_t)(sequence * 7 + i);
+    }
+}
+
+static void test_wrap_full_and_small_destination(void)
+{
+    LP_IC_RING writer, reader;
+    uint8_t block[300], received[300], expected[300];
+    uint32_t size, round, sent = 0, read = 0, bounced = 0;
+
+    reset_rings(&writer, &reader);
+    memset(block, 0, sizeof(block));
+
+    /* Blocks take 304 bytes, which does not divide the ring, so over the rounds they straddle
+     * the end at different offsets and go through the bounce buffer */
+    for (round = 0; round < 100; round++) {
+        uint8_t *space;
+
+        /* Fill the ring until it refuses a block */
+        while ((space = lp_icRingReserve(&writer, sizeof(block))) != NULL) {
+            bounced += writer.bounced;
+            fill_block(space, sizeof(block), sent++);
+            lp_icRingCommit(&writer, sizeof(block));
+        }
+        CHECK(lp_icRingEnqueue(&writer, block, sizeof(block)) == -1);
+        lp_icRingFlushWrites(&writer);
+
+        /* A destination too small leaves the block in place and says how big it is */
+        size = 16;
+        CHECK(lp_icRingDequeue(&reader, received, &size) == -1);
+        CHECK(size == sizeof(block));
+
+        size = sizeof(received);
+        while (lp_icRingDequeue(&reader, received, &size) == 0) {
+            fill_block(expected, sizeof(expected), read++);
+            CHECK(size == sizeof(block));
+            CHECK(memcmp(received, expected, sizeof(expected)) == 0);
+            size = sizeof(received);
+        }
+        lp_icRingFlushReads(&reader);
+        CHECK(read == sent);
+    }
+    CHECK(bounced > 10);
+}
+
+typedef struct {
+    LP_IC_RING ring;
+    unsigned long messages;
+    unsigned int batch;
+    unsigned long mismatches;
+} STRESS_SIDE;
+
+static uint32_t stress_length(unsigned long sequence)
+{
+    return 8 + (uint32_t)(sequence % 57);
+}
+
+static void *stress_producer(void *arg)
+{
+    STRESS_SIDE *side = arg;
+    unsigned long sequence = 0;
+
+    while (sequence < side->messages) {
+        unsigned int batched = 0;
+
+        while (batched < side->batch && sequence < side->messages) {
+            uint32_t length = stress_length(sequence);
+            uint8_t *block = lp_icRingReserve(&side->ring, length);
+
+            if (block == NULL) {
+                break;
+            }
+            memcpy(block, &sequence, sizeof(sequence));
+            memset(block + sizeof(sequence), (uint8_t)sequence, length - sizeof(sequence));
+            lp_icRingCommit(&side->ring, length);
+            sequence++;
+            batched++;
+        }
+        if (lp_icRingFlushWrites(&side->ring) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *stress_consumer(void *arg)
+{
+    STRESS_SIDE *side = arg;
+    unsigned long sequence = 0;
+    uint8_t block[64];
+
+    while (sequence < side->messages) {
+        uint32_t size = sizeof(block);
+        unsigned long received;
+
+        if (lp_icRingDequeue(&side->ring, block, &size) != 0) {
+            lp_icRingFlushReads(&side->ring);
+            sched_yield();
+            continue;
+        }
+        memcpy(&received, block, sizeof(received));
+        /* The shortest blocks are just the sequence number */
+        if (received != sequence || size != stress_length(sequence) ||
+            (size > sizeof(received) && block[size - 1] != (uint8_t)sequence)) {
+            side->mismatches++;
+        }
+        sequence++;
+        if (sequence % side->batch == 0) {
+            lp_icRingFlushReads(&side->ring);
+        }
+    }
+    lp_icRingFlushReads(&side->ring);
+    return NULL;
+}
+
+static void stress(unsigned long messages, unsigned int batch)
+{
+    STRESS_SIDE producer = {.messages = messages, .batch = batch};
+    STRESS_SIDE consumer = {.messages = messages, .batch = batch};
+    pthread_t producerThread, consumerThread;
+    struct timespec start, end;
+    double seconds;
+
+    reset_rings(&producer.ring, &consumer.ring);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&consumerThread, NULL, stress_consumer, &consumer);
+    pthread_create(&producerThread, NULL, stress_producer, &producer);
+    pthread_join(producerThread, NULL);
+    pthread_join(consumerThread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    CHECK(consumer.mismatches == 0);
+    CHECK(doorbells[LP_IC_RING_SWINT_WRITE] <= messages);
+    printf("batch %2u: %lu messages in %.2f s, %.2f M msgs/s, %lu write and %lu read doorbells\n",
+           batch, messages, seconds, messages / seconds / 1e6, doorbells[LP_IC_RING_SWINT_WRITE],
+           doorbells[LP_IC_RING_SWINT_READ]);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long messages = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+
+    test_batched_doorbell();
+    test_wrap_full_and_small_destination();
+    stress(messages, 1);
+    stress(messages, 16);
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_intercore_ring passed\n");
+    return 0;
+}
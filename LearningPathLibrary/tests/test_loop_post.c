@@ -0,0 +1,121 @@
+/* Tests for lp_eventLoopPost in loop_post.c with four threads posting while the event loop starts
+ * and stops posting over and over. Each stop is followed by a new eventfd, which takes the number
+ * of the one just closed, and a post that raced the stop must never write to it. Posts after a
+ * stop must fail, and posting must work again after a restart.
+ * Usage: test_loop_post */
+
+#include "loop_post.h"
+#include "timer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define PRODUCERS 4
+#define ROUNDS 100
+#define RUNS_PER_ROUND 10
+
+static atomic_bool producing = true;
+static atomic_uint epoch = 1; /* odd while posting is stopped */
+static atomic_ulong posted;
+static atomic_ulong postedWhileStopped;
+static unsigned long handled;
+
+static void count_handler(void *context)
+{
+    (void)context;
+    handled++;
+}
+
+static void *producer(void *arg)
+{
+    (void)arg;
+    while (atomic_load(&producing)) {
+        unsigned before = atomic_load(&epoch);
+
+        if (lp_eventLoopPost(count_handler, NULL)) {
+            atomic_fetch_add(&posted, 1);
+            /* Stopped for the whole post, no start in between */
+            if ((before & 1) != 0 && atomic_load(&epoch) == before) {
+                atomic_fetch_add(&postedWhileStopped, 1);
+            }
+        }
+        sched_yield(); /* lets the event loop in on a single core */
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    EventLoop *eventLoop = lp_timerGetEventLoop();
+    pthread_t producers[PRODUCERS];
+    unsigned long strayWrites = 0, totalHandled;
+    uint64_t count;
+    int i, round, run;
+
+    for (i = 0; i < PRODUCERS; i++) {
+        CHECK(pthread_create(&producers[i], NULL, producer, NULL) == 0);
+    }
+
+    for (round = 0; round < ROUNDS; round++) {
+        atomic_fetch_add(&epoch, 1);
+        CHECK(lp_eventLoopPostStart());
+        for (run = 0; run < RUNS_PER_ROUND; run++) {
+            EventLoop_Run(eventLoop, 1, true);
+        }
+        lp_eventLoopPostStop();
+        atomic_fetch_add(&epoch, 1);
+
+        /* Takes the lowest free descriptor, the eventfd just closed */
+        int fd = eventfd(0, EFD_NONBLOCK);
+        CHECK(fd != -1);
+        usleep(100);
+        if (read(fd, &count, sizeof(count)) != -1 || errno != EAGAIN) {
+            strayWrites++;
+        }
+        close(fd);
+    }
+
+    atomic_store(&producing, false);
+    for (i = 0; i < PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+
+    CHECK(strayWrites == 0);
+    CHECK(atomic_load(&postedWhileStopped) == 0);
+    CHECK(handled > 0 && handled <= atomic_load(&posted));
+    CHECK(!lp_eventLoopPost(count_handler, NULL));
+
+    /* A restart drops nothing posted after it */
+    totalHandled = handled;
+    handled = 0;
+    CHECK(lp_eventLoopPostStart());
+    CHECK(lp_eventLoopPost(count_handler, NULL));
+    CHECK(lp_eventLoopPost(count_handler, NULL));
+    EventLoop_Run(eventLoop, 0, true);
+    CHECK(handled == 2);
+    lp_eventLoopPostStop();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_loop_post passed (%lu posted, %lu handled over %d rounds)\n", atomic_load(&posted),
+           totalHandled, ROUNDS);
+    return 0;
+}
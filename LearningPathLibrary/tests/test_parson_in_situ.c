@@ -0,0 +1,191 @@
+/* Tests for json_parse_string_in_situ, the destructive parse mode that leaves names and strings in
+ * the input buffer. Built with AddressSanitizer where the compiler has it, so use after free and
+ * double free in the mixed owned and in-situ paths show up as failures. */
+
+#include "parson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+static int in_buffer(const char *pointer, const char *buffer, size_t length)
+{
+    return pointer >= buffer && pointer < buffer + length;
+}
+
+static char *copy_of(const char *string)
+{
+    char *copy = malloc(strlen(string) + 1);
+    strcpy(copy, string);
+    return copy;
+}
+
+static void test_escapes_decoded_in_place(void)
+{
+    char *buffer = copy_of("{\"a\\\"b\": \"x\\ny\\u00e9\\t\\/\", \"s\": \"\\ud83d\\ude00\"}");
+    size_t length = strlen(buffer);
+    JSON_Value *root = json_parse_string_in_situ(buffer);
+    JSON_Object *object = json_value_get_object(root);
+    const char *value = NULL;
+
+    CHECK(object != NULL);
+    CHECK(json_object_get_count(object) == 2);
+    CHECK(strcmp(json_object_get_name(object, 0), "a\"b") == 0);
+    value = json_object_get_string(object, "a\"b");
+    CHECK(value != NULL && strcmp(value, "x\ny\xc3\xa9\t/") == 0);
+    CHECK(in_buffer(value, buffer, length));
+    value = json_object_get_string(object, "s");
+    CHECK(value != NULL && strcmp(value, "\xf0\x9f\x98\x80") == 0);
+
+    json_value_free(root);
+    free(buffer);
+}
+
+static void test_names_and_values_point_into_buffer(void)
+{
+    char *buffer = copy_of("{\"desired\": {\"Led\": true, \"Name\": \"hvac\", \"List\": [\"a\", "
+                           "{\"Inner\": \"b\"}]}, \"$version\": 3}");
+    size_t length = strlen(buffer);
+    JSON_Value *root = json_parse_string_in_situ(buffer);
+    JSON_Object *object = json_value_get_object(root);
+    JSON_Object *desired = json_object_get_object(object, "desired");
+    JSON_Array *list = json_object_get_array(desired, "List");
+    size_t i;
+
+    CHECK(desired != NULL && list != NULL);
+    for (i = 0; i < json_object_get_count(object); i++) {
+        CHECK(in_buffer(json_object_get_name(object, i), buffer, length));
+    }
+    for (i = 0; i < json_object_get_count(desired); i++) {
+        CHECK(in_buffer(json_object_get_name(desired, i), buffer, length));
+    }
+    CHECK(in_buffer(json_object_get_string(desired, "Name"), buffer, length));
+    CHECK(in_buffer(json_array_get_string(list, 0), buffer, length));
+    CHECK(in_buffer(json_object_dotget_string(json_array_get_object(list, 1), "Inner"), buffer,
+                    length));
+    CHECK(json_object_get_boolean(desired, "Led") == 1);
+    CHECK(json_object_get_number(object, "$version") == 3);
+
+    json_value_free(root);
+    free(buffer);
+}
+
+static void test_mutation_after_parse(void)
+{
+    char *buffer = copy_of("{\"keep\": \"in situ\", \"drop\": \"gone\", \"swap\": \"old\"}");
+    JSON_Value *root = json_parse_string_in_situ(buffer);
+    JSON_Object *object = json_value_get_object(root);
+    char *serialized = NULL;
+
+    CHECK(object != NULL);
+    /* Adding a name takes ownership of every existing name, so the old names no longer depend
+     * on the buffer; string values still do */
+    CHECK(json_object_set_number(object, "added", 7) == JSONSuccess);
+    CHECK(json_object_remove(object, "drop") == JSONSuccess);
+    /* Replacing an in-situ string value must not free it */
+    CHECK(json_object_set_string(object, "swap", "new") == JSONSuccess);
+    CHECK(json_object_dotset_string(object, "nested.name", "deep") == JSONSuccess);
+
+    CHECK(strcmp(json_object_get_string(object, "keep"), "in situ") == 0);
+    CHECK(strcmp(json_object_get_string(object, "swap"), "new") == 0);
+    CHECK(json_object_get_number(object, "added") == 7);
+    CHECK(json_object_get_value(object, "drop") == NULL);
+    CHECK(strcmp(json_object_dotget_string(object, "nested.name"), "deep") == 0);
+
+    /* json_object_remove moves the last member into the removed one's place */
+    serialized = json_serialize_to_string(root);
+    CHECK(serialized != NULL &&
+          strcmp(serialized, "{\"keep\":\"in situ\",\"added\":7,\"swap\":\"new\","
+                             "\"nested\":{\"name\":\"deep\"}}") == 0);
+    json_free_serialized_string(serialized);
+
+    json_value_free(root);
+    free(buffer);
+}
+
+static void test_free_paths(void)
+{
+    char *buffer = copy_of("{\"a\": [\"x\", {\"b\": \"y\"}], \"c\": \"z\"}");
+    JSON_Value *root = json_parse_string_in_situ(buffer);
+    JSON_Value *copy = json_value_deep_copy(root);
+
+    /* A deep copy owns everything, so it outlives the buffer */
+    json_value_free(root);
+    memset(buffer, 'q', strlen(buffer));
+    free(buffer);
+    CHECK(strcmp(json_object_dotget_string(json_value_get_object(copy), "c"), "z") == 0);
+    json_value_free(copy);
+
+    /* Removing a value from an in-situ tree frees it without freeing its strings */
+    buffer = copy_of("{\"a\": \"x\", \"b\": {\"c\": \"y\"}}");
+    root = json_parse_string_in_situ(buffer);
+    CHECK(json_object_remove(json_value_get_object(root), "b") == JSONSuccess);
+    json_value_free(root);
+    free(buffer);
+
+    /* A parse that fails part way frees what it built */
+    buffer = copy_of("{\"a\": \"x\", \"b\": [\"y\", \"z\" }");
+    CHECK(json_parse_string_in_situ(buffer) == NULL);
+    free(buffer);
+
+    CHECK(json_parse_string_in_situ(NULL) == NULL);
+}
+
+static void test_fewer_allocations(void)
+{
+    const char *twin = "{\"desired\": {\"DesiredTemperature\": 22.5, \"LedBlink\": true, "
+                       "\"Message\": \"hello\", \"$version\": 4}, \"reported\": "
+                       "{\"ReportedTemperature\": 21.0, \"$version\": 9}}";
+    char *buffer = copy_of(twin);
+    size_t owning, in_situ;
+    JSON_Value *root;
+
+    json_set_allocation_functions(counting_malloc, free);
+    allocations = 0;
+    root = json_parse_string(twin);
+    owning = allocations;
+    json_value_free(root);
+
+    allocations = 0;
+    root = json_parse_string_in_situ(buffer);
+    in_situ = allocations;
+    json_value_free(root);
+    json_set_allocation_functions(malloc, free);
+
+    CHECK(in_situ * 2 < owning);
+    free(buffer);
+}
+
+int main(void)
+{
+    test_escapes_decoded_in_place();
+    test_names_and_values_point_into_buffer();
+    test_mutation_after_parse();
+    test_free_paths();
+    test_fewer_allocations();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_parson_in_situ passed\n");
+    return 0;
+}
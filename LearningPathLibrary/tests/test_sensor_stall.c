@@ -0,0 +1,203 @@
+/* Event loop stalls from the Sensirion drivers, simulated on a virtual clock with an SCD30 and an
+ * SHT31 on a 400 kHz bus. The start up and readings of the samples before scd30_async and
+ * sht3x_async, which slept in the calling code, are timed against the async drivers run by the
+ * event loop, with sensors that answer at once and with sensors that fail their first two probes.
+ * The async drivers must never sleep, never stall the loop for a millisecond, deliver every
+ * reading, keep the SCD30's write delay and never read the SHT31 during a conversion.
+ * Usage: test_sensor_stall */
+
+#include "scd30_async.h"
+#include "sensirion_sim.h"
+#include "sht3x_async.h"
+#include "timer.h"
+#include "virtual_clock.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define INTERVAL_SEC 2
+#define READINGS 10
+#define START_UP_NS (6000 * VCLOCK_NS_PER_MS) /* long enough for failed probes and a first measurement */
+#define MAX_ASYNC_STALL_NS VCLOCK_NS_PER_MS
+#define SHT31_TEMPERATURE (((21875 * (int32_t)SENSIRION_SIM_SHT31_RAW_TEMPERATURE) >> 13) - 45000)
+#define SHT31_HUMIDITY ((12500 * (int32_t)SENSIRION_SIM_SHT31_RAW_HUMIDITY) >> 13)
+
+typedef struct {
+    uint64_t startUp;     /* longest the event loop was held up by start up */
+    uint64_t reading;     /* longest the event loop was held up by one reading */
+    unsigned long sleeps;
+    unsigned long scd30Good;
+    unsigned long sht31Good;
+    unsigned long bad;
+} STALL;
+
+static STALL stall;
+static bool useAsync;
+
+/* The CO2 monitor's start up before scd30_async */
+static bool blocking_scd30_start(void)
+{
+    uint16_t interval_in_seconds = INTERVAL_SEC;
+    int retry = 0;
+    uint8_t asc_enabled;
+
+    sensirion_i2c_init();
+    while (scd30_probe() != STATUS_OK && ++retry < 5) {
+        sensirion_sleep_usec(1000000u);
+    }
+    if (retry >= 5) {
+        return false;
+    }
+    if (scd30_get_automatic_self_calibration(&asc_enabled) == 0 && asc_enabled == 0) {
+        scd30_enable_automatic_self_calibration(1);
+    }
+    scd30_set_measurement_interval(interval_in_seconds);
+    sensirion_sleep_usec(20000u);
+    scd30_start_periodic_measurement(0);
+    sensirion_sleep_usec(interval_in_seconds * 1000000u);
+    return true;
+}
+
+/* The SHT31 samples' start up before sht3x_async */
+static bool blocking_sht31_start(void)
+{
+    int retry = 0;
+
+    sensirion_i2c_init();
+    while (sht3x_probe() != STATUS_OK && ++retry < 5) {
+        sensirion_sleep_usec(1000000u);
+    }
+    sensirion_sleep_usec(INTERVAL_SEC * 1000000u); /* sleep for good luck */
+    return retry < 5;
+}
+
+static void scd30_ready(int16_t status, float co2_ppm, float temperature, float humidity)
+{
+    if (status == STATUS_OK && co2_ppm == SENSIRION_SIM_CO2_PPM &&
+        temperature == SENSIRION_SIM_SCD30_TEMPERATURE && humidity == SENSIRION_SIM_SCD30_HUMIDITY) {
+        stall.scd30Good++;
+    } else {
+        stall.bad++;
+    }
+}
+
+static void sht31_ready(int16_t status, int32_t temperature, int32_t humidity)
+{
+    if (status == STATUS_OK && temperature == SHT31_TEMPERATURE && humidity == SHT31_HUMIDITY) {
+        stall.sht31Good++;
+    } else {
+        stall.bad++;
+    }
+}
+
+/* The samples' periodic measure handler, before and after the async drivers */
+static void measure_handler(EventLoopTimer *eventLoopTimer)
+{
+    float co2_ppm, temperature, humidity;
+    int32_t shtTemperature, shtHumidity;
+    int16_t status;
+
+    if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+        stall.bad++;
+        return;
+    }
+    if (useAsync) {
+        scd30_async_measure();
+        sht3x_async_measure();
+        return;
+    }
+    /* Read before the values are passed on, argument evaluation order is unspecified */
+    status = scd30_read_measurement(&co2_ppm, &temperature, &humidity);
+    scd30_ready(status, co2_ppm, temperature, humidity);
+    status = sht3x_measure_blocking_read(&shtTemperature, &shtHumidity);
+    sht31_ready(status, shtTemperature, shtHumidity);
+}
+
+static LP_TIMER measureTimer = {
+    .period = {INTERVAL_SEC, 0}, .name = "measureSensor", .handler = measure_handler};
+
+static void simulate(const char *name, bool async, unsigned failedProbes)
+{
+    scd30_async_config_t scd30Config = {
+        .interval_sec = INTERVAL_SEC, .enable_asc = true, .rdy = NULL, .measurement_ready = scd30_ready};
+    EventLoop *eventLoop = lp_timerGetEventLoop();
+    SENSIRION_SIM *sim = sensirion_sim(true);
+    uint64_t start = vclock_now(), longest;
+
+    stall = (STALL){0};
+    useAsync = async;
+    sim->scd30Nacks = sim->sht31Nacks = failedProbes;
+
+    if (async) {
+        CHECK(scd30_async_start(&scd30Config));
+        CHECK(sht3x_async_start(sht31_ready));
+        /* The first measurement is ready an interval after the SCD30 starts */
+        CHECK(scd30_async_measure());
+        stall.startUp = vclock_now() - start;
+        vclock_longest_dispatch(true);
+        vclock_run(eventLoop, start + START_UP_NS);
+        longest = vclock_longest_dispatch(true);
+        if (longest > stall.startUp) {
+            stall.startUp = longest;
+        }
+        CHECK(stall.scd30Good == 1);
+    } else {
+        CHECK(blocking_scd30_start());
+        CHECK(blocking_sht31_start());
+        stall.startUp = vclock_now() - start;
+    }
+
+    CHECK(lp_timerStart(&measureTimer));
+    vclock_longest_dispatch(true);
+    vclock_run(eventLoop, vclock_now() + READINGS * INTERVAL_SEC * 1000 * VCLOCK_NS_PER_MS);
+    stall.reading = vclock_longest_dispatch(true);
+    lp_timerStop(&measureTimer);
+    if (async) {
+        /* Let the last requests complete */
+        vclock_run(eventLoop, vclock_now() + 2 * INTERVAL_SEC * 1000 * VCLOCK_NS_PER_MS);
+        scd30_async_stop();
+        sht3x_async_stop();
+    }
+    stall.sleeps = sim->sleeps;
+
+    CHECK(stall.bad == 0);
+    CHECK(stall.sht31Good == READINGS + 0ul);
+    CHECK(stall.scd30Good >= READINGS - (async ? 0ul : 1ul));
+    CHECK(sim->writeDelayViolations == 0);
+    CHECK(sim->earlyReads == 0);
+    CHECK(sim->protocolErrors == 0);
+    CHECK(vclock_timerfds() == 0);
+    if (async) {
+        CHECK(stall.sleeps == 0);
+        CHECK(stall.startUp < MAX_ASYNC_STALL_NS);
+        CHECK(stall.reading < MAX_ASYNC_STALL_NS);
+    }
+
+    printf("%-8s %-19s start up stalls the loop %7.2f ms, a reading %5.2f ms, %lu sleeps\n",
+           async ? "async" : "blocking", name, (double)stall.startUp / VCLOCK_NS_PER_MS,
+           (double)stall.reading / VCLOCK_NS_PER_MS, stall.sleeps);
+}
+
+int main(void)
+{
+    simulate("", false, 0);
+    simulate("", true, 0);
+    simulate("two failed probes", false, 2);
+    simulate("two failed probes", true, 2);
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_sensor_stall passed\n");
+    return 0;
+}
@@ -0,0 +1,210 @@
+/* Tests for the real-time core's window statistics in IntercoreContract/sensor_stats.h: Welford
+ * mean and variance, minimum and maximum, the P² percentile estimate against the exact one, and
+ * the LP_IC_SENSOR_SUMMARY message they are sent in. The samples come from a fixed generator so
+ * the estimates are the same on every run. */
+
+#include "sensor_stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance)                                                 \
+    do {                                                                                       \
+        double check_value = (value), check_expected = (expected);                             \
+        if (!(fabs(check_value - check_expected) <= (tolerance))) {                            \
+            fprintf(stderr, "%s:%d: %s is %g, expected %g within %g\n", __FILE__, __LINE__,     \
+                    #value, check_value, check_expected, (double)(tolerance));                 \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define SAMPLES 20000
+
+static float samples[SAMPLES];
+static unsigned long long rng_state = 88172645463325252ULL;
+
+/* xorshift64, uniform in [0, 1) */
+static double uniform(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (double)(rng_state >> 11) / 9007199254740992.0;
+}
+
+static double normal(double mean, double deviation)
+{
+    double u = 1.0 - uniform(), v = uniform();
+    return mean + deviation * sqrt(-2.0 * log(u)) * cos(2.0 * 3.14159265358979323846 * v);
+}
+
+static int compare_floats(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Summarises count samples with stats and checks the summary against exact statistics */
+static void check_window(const float *values, size_t count, uint32_t rank, double percentile_tolerance,
+                         LP_IC_MESSAGE *summary)
+{
+    static float sorted[SAMPLES];
+    LP_SENSOR_STATS stats;
+    double sum = 0, squares = 0, mean;
+    size_t i;
+
+    lp_sensorStatsInit(&stats, LP_IC_SENSOR_TEMPERATURE, rank);
+    for (i = 0; i < count; i++) {
+        lp_sensorStatsUpdate(&stats, values[i]);
+        sum += values[i];
+    }
+    mean = sum / count;
+    for (i = 0; i < count; i++) {
+        squares += (values[i] - mean) * (values[i] - mean);
+    }
+    memcpy(sorted, values, count * sizeof(float));
+    qsort(sorted, count, sizeof(float), compare_floats);
+
+    CHECK(lp_sensorStatsSummary(&stats, summary, 1000));
+    CHECK(summary->cmd == LP_IC_SENSOR_SUMMARY);
+    CHECK(summary->sensor == LP_IC_SENSOR_TEMPERATURE);
+    CHECK(summary->sampleCount == count);
+    CHECK(summary->window_ms == 1000);
+    CHECK(summary->percentileRank == rank);
+    CHECK_NEAR(summary->mean, mean, 1e-4 * (1 + fabs(mean)));
+    CHECK_NEAR(summary->variance, count > 1 ? squares / (count - 1) : 0, 1e-3 * (1 + squares / count));
+    CHECK(summary->minimum == sorted[0]);
+    CHECK(summary->maximum == sorted[count - 1]);
+    CHECK_NEAR(summary->percentile, sorted[(size_t)ceil(rank / 100.0 * count) - 1], percentile_tolerance);
+
+    /* The next window starts empty */
+    CHECK(stats.count == 0);
+    CHECK(!lp_sensorStatsSummary(&stats, summary, 1000));
+}
+
+static void test_uniform_p95(void)
+{
+    LP_IC_MESSAGE summary;
+    size_t i;
+
+    for (i = 0; i < SAMPLES; i++) {
+        samples[i] = (float)(100 * uniform());
+    }
+    check_window(samples, SAMPLES, 95, 0.5, &summary);
+    CHECK_NEAR(summary.percentile, 95, 0.5);
+    CHECK_NEAR(summary.mean, 50, 1);
+}
+
+static void test_normal_median_and_tail(void)
+{
+    LP_IC_MESSAGE summary;
+    size_t i;
+
+    for (i = 0; i < SAMPLES; i++) {
+        samples[i] = (float)normal(25, 2);
+    }
+    check_window(samples, SAMPLES, 50, 0.05, &summary);
+    check_window(samples, SAMPLES, 99, 0.2, &summary);
+    check_window(samples, 500, 95, 0.3, &summary);
+}
+
+static void test_awkward_inputs(void)
+{
+    LP_IC_MESSAGE summary;
+    size_t i;
+
+    /* Sorted input, the worst case for the markers */
+    for (i = 0; i < 1000; i++) {
+        samples[i] = (float)i;
+    }
+    check_window(samples, 1000, 95, 15, &summary);
+
+    /* A constant signal has no spread */
+    for (i = 0; i < 1000; i++) {
+        samples[i] = 21.5f;
+    }
+    check_window(samples, 1000, 95, 0, &summary);
+    CHECK(summary.variance == 0);
+
+    /* Fewer samples than markers are still exact */
+    samples[0] = 3;
+    samples[1] = 1;
+    samples[2] = 2;
+    check_window(samples, 3, 50, 0, &summary);
+    check_window(samples, 1, 95, 0, &summary);
+}
+
+static void test_failed_reads(void)
+{
+    LP_SENSOR_STATS stats;
+    LP_IC_MESSAGE summary = {.cmd = LP_IC_UNKNOWN};
+
+    /* A NaN is a failed read and is skipped, a window without samples sends nothing */
+    lp_sensorStatsInit(&stats, LP_IC_SENSOR_PRESSURE, 95);
+    lp_sensorStatsUpdate(&stats, NAN);
+    CHECK(!lp_sensorStatsSummary(&stats, &summary, 1000));
+    CHECK(summary.cmd == LP_IC_UNKNOWN);
+
+    lp_sensorStatsUpdate(&stats, 1010);
+    lp_sensorStatsUpdate(&stats, NAN);
+    lp_sensorStatsUpdate(&stats, 1012);
+    CHECK(lp_sensorStatsSummary(&stats, &summary, 1000));
+    CHECK(summary.sensor == LP_IC_SENSOR_PRESSURE);
+    CHECK(summary.sampleCount == 2);
+    CHECK(summary.mean == 1011);
+    CHECK(summary.variance == 2);
+}
+
+static void test_summary_message(void)
+{
+    LP_SENSOR_STATS stats;
+    LP_IC_MESSAGE summary, decoded;
+    LP_INTER_CORE_BLOCK legacy;
+    uint8_t buffer[LP_IC_MAX_MESSAGE];
+    uint16_t sequence = 0;
+    size_t length;
+
+    lp_sensorStatsInit(&stats, LP_IC_SENSOR_HUMIDITY, 95);
+    lp_sensorStatsUpdate(&stats, 40);
+    lp_sensorStatsUpdate(&stats, 44);
+    CHECK(lp_sensorStatsSummary(&stats, &summary, 60000));
+
+    length = lp_icEncode(&summary, 7, buffer, sizeof(buffer));
+    CHECK(length == sizeof(LP_IC_HEADER) + LP_IC_SENSOR_SUMMARY_SIZE);
+    CHECK(lp_icDecode(buffer, length, &decoded, &sequence));
+    CHECK(sequence == 7);
+    CHECK(memcmp(&decoded, &summary, sizeof(summary)) == 0);
+
+    /* The summary has no room in a legacy block, so it is always sent as a message */
+    CHECK(!lp_icFitsBlock(LP_IC_SENSOR_SUMMARY));
+    CHECK(lp_icFitsBlock(LP_IC_ENVIRONMENT_SENSOR));
+    CHECK(sizeof(legacy) == 16);
+}
+
+int main(void)
+{
+    test_uniform_p95();
+    test_normal_median_and_tail();
+    test_awkward_inputs();
+    test_failed_reads();
+    test_summary_message();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_sensor_stats passed\n");
+    return 0;
+}
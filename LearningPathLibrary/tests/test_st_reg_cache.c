@@ -0,0 +1,362 @@
+/* Tests for the ST register shadow cache in Drivers/AVNET_SK/Common/st_reg_cache.c, through the
+ * real lsm6dso_reg.c and lps22hh_reg.c drivers, against the simulated register files in
+ * st_register_sim.c: setters down to one write, per bank caching and the bank register, a cache
+ * attached to a device left in another bank, volatile registers always read from the bus, reset
+ * and reboot emptying the cache, failed reads never cached and failed writes forgotten. Last, the
+ * IMU initialization sequence runs with and without the cache, checks both leave the devices in
+ * the same state, and prints the bus transactions each took.
+ * Usage: test_st_reg_cache */
+
+#include "st_reg_cache.h"
+#include "st_register_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+typedef struct {
+    ST_REGISTER_SIM sim;
+    st_reg_cache_t cache;
+    stmdev_ctx_t ctx;
+} CACHED_DEVICE;
+
+static void attach(CACHED_DEVICE *device, ST_SIM_DEVICE kind)
+{
+    st_sim_power_on(&device->sim, kind);
+    st_sim_context(&device->sim, &device->ctx);
+    st_reg_cache_attach(&device->cache,
+                        kind == ST_SIM_LSM6DSO ? &st_reg_cache_lsm6dso : &st_reg_cache_lps22hh,
+                        &device->ctx);
+}
+
+static uint8_t read_byte(CACHED_DEVICE *device, uint8_t reg)
+{
+    uint8_t value = 0;
+
+    CHECK(lsm6dso_read_reg(&device->ctx, reg, &value, 1) == 0);
+    return value;
+}
+
+static void write_byte(CACHED_DEVICE *device, uint8_t reg, uint8_t value)
+{
+    CHECK(lsm6dso_write_reg(&device->ctx, reg, &value, 1) == 0);
+}
+
+static void test_setter_is_one_write(void)
+{
+    CACHED_DEVICE imu;
+    lsm6dso_fs_xl_t fullScale;
+    unsigned long reads, writes;
+
+    attach(&imu, ST_SIM_LSM6DSO);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+    CHECK(imu.cache.bank == 0);
+
+    /* The first setter reads CTRL1_XL from the bus, the next ones from the cache */
+    CHECK(lsm6dso_xl_full_scale_set(&imu.ctx, LSM6DSO_4g) == 0);
+    reads = imu.sim.reads;
+    writes = imu.sim.writes;
+    CHECK(lsm6dso_xl_full_scale_set(&imu.ctx, LSM6DSO_8g) == 0);
+    CHECK(imu.sim.reads == reads);
+    CHECK(imu.sim.writes == writes + 1);
+
+    CHECK(lsm6dso_xl_full_scale_get(&imu.ctx, &fullScale) == 0);
+    CHECK(fullScale == LSM6DSO_8g);
+    CHECK(imu.sim.reads == reads);
+    CHECK(st_sim_peek(&imu.sim, 0, LSM6DSO_CTRL1_XL) == read_byte(&imu, LSM6DSO_CTRL1_XL));
+}
+
+static void test_unknown_bank_passes_through(void)
+{
+    CACHED_DEVICE imu;
+    unsigned long reads;
+
+    /* A previous run left the device in the sensor hub bank */
+    attach(&imu, ST_SIM_LSM6DSO);
+    imu.sim.regs[0][LSM6DSO_CTRL5_C] = 0x60;
+    imu.sim.regs[1][LSM6DSO_MASTER_CONFIG] = 0x04;
+    imu.sim.bankSelect = (uint8_t)(LSM6DSO_SENSOR_HUB_BANK << 6);
+    CHECK(imu.cache.bank == -1);
+
+    reads = imu.sim.reads;
+    CHECK(read_byte(&imu, LSM6DSO_MASTER_CONFIG) == 0x04);
+    CHECK(read_byte(&imu, LSM6DSO_MASTER_CONFIG) == 0x04);
+    CHECK(imu.sim.reads == reads + 2);
+    CHECK(imu.cache.hits == 0);
+
+    /* Reading the bank register tells the cache where it is, and is then served from it */
+    CHECK(read_byte(&imu, LSM6DSO_FUNC_CFG_ACCESS) == LSM6DSO_SENSOR_HUB_BANK << 6);
+    CHECK(imu.cache.bank == LSM6DSO_SENSOR_HUB_BANK);
+    reads = imu.sim.reads;
+    CHECK(read_byte(&imu, LSM6DSO_FUNC_CFG_ACCESS) == LSM6DSO_SENSOR_HUB_BANK << 6);
+    CHECK(read_byte(&imu, LSM6DSO_MASTER_CONFIG) == 0x04);
+    CHECK(read_byte(&imu, LSM6DSO_MASTER_CONFIG) == 0x04);
+    CHECK(imu.sim.reads == reads + 1);
+}
+
+static void test_bank_switch(void)
+{
+    CACHED_DEVICE imu;
+    uint8_t first, second;
+    unsigned long reads, writes;
+
+    attach(&imu, ST_SIM_LSM6DSO);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+
+    /* Register 0x14 is CTRL5_C in the user bank and MASTER_CONFIG in the sensor hub bank */
+    write_byte(&imu, LSM6DSO_CTRL5_C, 0x60);
+    reads = imu.sim.reads;
+    writes = imu.sim.writes;
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_SENSOR_HUB_BANK) == 0);
+    CHECK(imu.sim.reads == reads && imu.sim.writes == writes + 1);
+    CHECK(imu.cache.bank == LSM6DSO_SENSOR_HUB_BANK);
+
+    write_byte(&imu, LSM6DSO_MASTER_CONFIG, 0x04);
+    reads = imu.sim.reads;
+    CHECK(read_byte(&imu, LSM6DSO_MASTER_CONFIG) == 0x04);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+    CHECK(read_byte(&imu, LSM6DSO_CTRL5_C) == 0x60);
+    CHECK(imu.sim.reads == reads);
+    CHECK(st_sim_peek(&imu.sim, 0, LSM6DSO_CTRL5_C) == 0x60);
+    CHECK(st_sim_peek(&imu.sim, 1, LSM6DSO_MASTER_CONFIG) == 0x04);
+
+    /* Register 0x02 is PIN_CTRL in the user bank, and a sensor hub output in the other */
+    reads = imu.sim.reads;
+    read_byte(&imu, LSM6DSO_PIN_CTRL);
+    read_byte(&imu, LSM6DSO_PIN_CTRL);
+    CHECK(imu.sim.reads == reads + 1);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_SENSOR_HUB_BANK) == 0);
+    reads = imu.sim.reads;
+    first = read_byte(&imu, LSM6DSO_SENSOR_HUB_1);
+    second = read_byte(&imu, LSM6DSO_SENSOR_HUB_1);
+    CHECK(imu.sim.reads == reads + 2);
+    CHECK(first != second);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+
+    /* Setting the data rate visits the embedded functions bank and comes back */
+    CHECK(lsm6dso_xl_data_rate_set(&imu.ctx, LSM6DSO_XL_ODR_12Hz5) == 0);
+    CHECK(imu.cache.bank == LSM6DSO_USER_BANK);
+    CHECK(imu.sim.bankSelect == 0);
+    CHECK(read_byte(&imu, LSM6DSO_CTRL5_C) == 0x60);
+}
+
+static void test_volatile_registers(void)
+{
+    CACHED_DEVICE imu, pressure;
+    uint8_t first[6], second[6], pair[2];
+    uint32_t firstPressure, secondPressure;
+    unsigned long reads;
+
+    attach(&imu, ST_SIM_LSM6DSO);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+
+    reads = imu.sim.reads;
+    read_byte(&imu, LSM6DSO_STATUS_REG);
+    read_byte(&imu, LSM6DSO_STATUS_REG);
+    read_byte(&imu, LSM6DSO_WHO_AM_I);
+    read_byte(&imu, LSM6DSO_WHO_AM_I);
+    CHECK(imu.sim.reads == reads + 4);
+
+    reads = imu.sim.reads;
+    CHECK(lsm6dso_acceleration_raw_get(&imu.ctx, first) == 0);
+    CHECK(lsm6dso_acceleration_raw_get(&imu.ctx, second) == 0);
+    CHECK(imu.sim.reads == reads + 2);
+    CHECK(memcmp(first, second, sizeof(first)) != 0);
+
+    reads = imu.sim.reads;
+    CHECK(lsm6dso_fifo_out_raw_get(&imu.ctx, first) == 0);
+    CHECK(lsm6dso_fifo_out_raw_get(&imu.ctx, second) == 0);
+    CHECK(imu.sim.reads == reads + 2);
+    CHECK(memcmp(first, second, sizeof(first)) != 0);
+
+    /* A read that runs from a cached register into a volatile one goes to the bus whole */
+    write_byte(&imu, LSM6DSO_CTRL10_C, 0x20);
+    reads = imu.sim.reads;
+    CHECK(lsm6dso_read_reg(&imu.ctx, LSM6DSO_CTRL10_C, pair, 2) == 0);
+    CHECK(lsm6dso_read_reg(&imu.ctx, LSM6DSO_CTRL10_C, pair, 2) == 0);
+    CHECK(imu.sim.reads == reads + 2);
+    CHECK(pair[0] == 0x20);
+
+    attach(&pressure, ST_SIM_LPS22HH);
+    reads = pressure.sim.reads;
+    CHECK(lps22hh_pressure_raw_get(&pressure.ctx, &firstPressure) == 0);
+    CHECK(lps22hh_pressure_raw_get(&pressure.ctx, &secondPressure) == 0);
+    CHECK(pressure.sim.reads == reads + 2);
+    CHECK(firstPressure != secondPressure);
+}
+
+static void test_reset_empties_the_cache(void)
+{
+    CACHED_DEVICE imu, pressure;
+    lsm6dso_fs_xl_t fullScale;
+    lps22hh_odr_t rate;
+    uint8_t rst = 1;
+    unsigned long reads;
+    uint32_t hits;
+
+    attach(&imu, ST_SIM_LSM6DSO);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+    CHECK(lsm6dso_xl_full_scale_set(&imu.ctx, LSM6DSO_8g) == 0);
+
+    CHECK(lsm6dso_reset_set(&imu.ctx, PROPERTY_ENABLE) == 0);
+    CHECK(lsm6dso_reset_get(&imu.ctx, &rst) == 0);
+    CHECK(rst == 0);
+    CHECK(imu.cache.bank == -1);
+    reads = imu.sim.reads;
+    CHECK(lsm6dso_xl_full_scale_get(&imu.ctx, &fullScale) == 0);
+    CHECK(imu.sim.reads == reads + 1);
+    CHECK(fullScale == LSM6DSO_2g);
+
+    /* Reboot as well, once the bank is known again */
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+    CHECK(lsm6dso_xl_full_scale_set(&imu.ctx, LSM6DSO_16g) == 0);
+    CHECK(lsm6dso_boot_set(&imu.ctx, PROPERTY_ENABLE) == 0);
+    CHECK(imu.cache.bank == -1);
+    CHECK(lsm6dso_xl_full_scale_get(&imu.ctx, &fullScale) == 0);
+    CHECK(fullScale == LSM6DSO_2g);
+
+    attach(&pressure, ST_SIM_LPS22HH);
+    CHECK(lps22hh_data_rate_set(&pressure.ctx, LPS22HH_10_Hz_LOW_NOISE) == 0);
+    hits = pressure.cache.hits;
+    CHECK(lps22hh_reset_set(&pressure.ctx, PROPERTY_ENABLE) == 0);
+    CHECK(lps22hh_reset_get(&pressure.ctx, &rst) == 0);
+    CHECK(rst == 0);
+    CHECK(lps22hh_data_rate_get(&pressure.ctx, &rate) == 0);
+    CHECK(rate == LPS22HH_POWER_DOWN);
+    /* CTRL_REG1 came from the bus too */
+    CHECK(pressure.cache.hits == hits);
+}
+
+static void test_failed_transfers_are_not_cached(void)
+{
+    CACHED_DEVICE imu;
+    uint8_t value;
+    unsigned long reads;
+
+    attach(&imu, ST_SIM_LSM6DSO);
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+    imu.sim.regs[0][LSM6DSO_CTRL2_G] = 0x4C;
+
+    /* The failed read's garbage is not kept, the next read goes to the bus and is kept */
+    imu.sim.failReads = 1;
+    CHECK(lsm6dso_read_reg(&imu.ctx, LSM6DSO_CTRL2_G, &value, 1) != 0);
+    CHECK(value == ST_SIM_READ_ERROR_FILL);
+    reads = imu.sim.reads;
+    CHECK(read_byte(&imu, LSM6DSO_CTRL2_G) == 0x4C);
+    CHECK(read_byte(&imu, LSM6DSO_CTRL2_G) == 0x4C);
+    CHECK(imu.sim.reads == reads + 1);
+
+    /* A failed bank register read leaves the bank unknown */
+    attach(&imu, ST_SIM_LSM6DSO);
+    imu.sim.failReads = 1;
+    CHECK(lsm6dso_read_reg(&imu.ctx, LSM6DSO_FUNC_CFG_ACCESS, &value, 1) != 0);
+    CHECK(imu.cache.bank == -1);
+
+    /* A failed write may or may not have reached the device, so the register is read again */
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_USER_BANK) == 0);
+    write_byte(&imu, LSM6DSO_CTRL2_G, 0x4C);
+    imu.sim.failWrites = 1;
+    value = 0x5C;
+    CHECK(lsm6dso_write_reg(&imu.ctx, LSM6DSO_CTRL2_G, &value, 1) != 0);
+    reads = imu.sim.reads;
+    CHECK(read_byte(&imu, LSM6DSO_CTRL2_G) == 0x4C);
+    CHECK(imu.sim.reads == reads + 1);
+
+    /* And so is a failed bank switch */
+    imu.sim.failWrites = 1;
+    CHECK(lsm6dso_mem_bank_set(&imu.ctx, LSM6DSO_SENSOR_HUB_BANK) != 0);
+    CHECK(imu.cache.bank == -1);
+    CHECK(read_byte(&imu, LSM6DSO_FUNC_CFG_ACCESS) == 0);
+    CHECK(imu.cache.bank == LSM6DSO_USER_BANK);
+}
+
+/* lp_imu_initialize's LSM6DSO sequence and detect_lps22hh's LPS22HH one, talking to the
+ * LPS22HH directly rather than through the sensor hub */
+static void initialize(stmdev_ctx_t *imu, stmdev_ctx_t *pressure)
+{
+    uint8_t whoamI, rst;
+
+    lsm6dso_device_id_get(imu, &whoamI);
+    CHECK(whoamI == LSM6DSO_ID);
+    lsm6dso_reset_set(imu, PROPERTY_ENABLE);
+    do {
+        lsm6dso_reset_get(imu, &rst);
+    } while (rst);
+    lsm6dso_i3c_disable_set(imu, LSM6DSO_I3C_DISABLE);
+    lsm6dso_block_data_update_set(imu, PROPERTY_ENABLE);
+    lsm6dso_xl_data_rate_set(imu, LSM6DSO_XL_ODR_12Hz5);
+    lsm6dso_gy_data_rate_set(imu, LSM6DSO_GY_ODR_12Hz5);
+    lsm6dso_xl_full_scale_set(imu, LSM6DSO_2g);
+    lsm6dso_gy_full_scale_set(imu, LSM6DSO_2000dps);
+    lsm6dso_xl_hp_path_on_out_set(imu, LSM6DSO_LP_ODR_DIV_100);
+    lsm6dso_xl_filter_lp2_set(imu, PROPERTY_ENABLE);
+    lsm6dso_sh_pin_mode_set(imu, LSM6DSO_INTERNAL_PULL_UP);
+
+    lps22hh_device_id_get(pressure, &whoamI);
+    CHECK(whoamI == LPS22HH_ID);
+    lps22hh_reset_set(pressure, PROPERTY_ENABLE);
+    do {
+        lps22hh_reset_get(pressure, &rst);
+    } while (rst);
+    lps22hh_block_data_update_set(pressure, PROPERTY_ENABLE);
+    lps22hh_data_rate_set(pressure, LPS22HH_10_Hz_LOW_NOISE);
+}
+
+static void test_same_state_fewer_transactions(void)
+{
+    ST_REGISTER_SIM imu, pressure;
+    CACHED_DEVICE cachedImu, cachedPressure;
+    stmdev_ctx_t imuCtx, pressureCtx;
+    unsigned long uncached, cached;
+
+    st_sim_power_on(&imu, ST_SIM_LSM6DSO);
+    st_sim_power_on(&pressure, ST_SIM_LPS22HH);
+    st_sim_context(&imu, &imuCtx);
+    st_sim_context(&pressure, &pressureCtx);
+    initialize(&imuCtx, &pressureCtx);
+
+    attach(&cachedImu, ST_SIM_LSM6DSO);
+    attach(&cachedPressure, ST_SIM_LPS22HH);
+    initialize(&cachedImu.ctx, &cachedPressure.ctx);
+
+    CHECK(memcmp(imu.regs, cachedImu.sim.regs, sizeof(imu.regs)) == 0);
+    CHECK(imu.bankSelect == cachedImu.sim.bankSelect);
+    CHECK(memcmp(pressure.regs, cachedPressure.sim.regs, sizeof(pressure.regs)) == 0);
+
+    uncached = imu.reads + imu.writes + pressure.reads + pressure.writes;
+    cached = cachedImu.sim.reads + cachedImu.sim.writes + cachedPressure.sim.reads +
+             cachedPressure.sim.writes;
+    CHECK(cached < uncached);
+    printf("initialization: %lu transactions, %lu bytes uncached, %lu transactions, %lu bytes "
+           "cached, %u cache hits\n",
+           uncached, imu.bytes + pressure.bytes, cached,
+           cachedImu.sim.bytes + cachedPressure.sim.bytes,
+           (unsigned)(cachedImu.cache.hits + cachedPressure.cache.hits));
+}
+
+int main(void)
+{
+    test_setter_is_one_write();
+    test_unknown_bank_passes_through();
+    test_bank_switch();
+    test_volatile_registers();
+    test_reset_empties_the_cache();
+    test_failed_transfers_are_not_cached();
+    test_same_state_fewer_transactions();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_st_reg_cache passed\n");
+    return 0;
+}
@@ -0,0 +1,158 @@
+/* Timer slack and grid alignment, simulated on a virtual clock. Five LP_TIMERs with periods from
+ * 40 to 300 ms, started a few milliseconds apart, run for six virtual seconds with no slack, with
+ * 20 ms of slack and with 20 ms of slack on a 20 ms grid. In every run each timer must fire once
+ * per period, never before its deadline and never later than its slack allows, and the wakeups,
+ * the instants the event loop had to run, are counted. Built once with the timer wheel and once
+ * with the default backend, which has a timerfd per timer and ignores slack but aligns to the grid.
+ * Usage: test_timer_slack_wheel, test_timer_slack_timerfd */
+
+#include "timer.h"
+#include "virtual_clock.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+#define TIMERS 5
+#define RUN_MS 6000
+#define SLACK_MS 20
+#define GRID_MS 20
+#define START_STAGGER_NS 7300000ull /* init work between one timer start and the next */
+#define TICK_NS VCLOCK_NS_PER_MS     /* the wheel rounds deadlines up to its 1 ms tick */
+
+static const unsigned periods_ms[TIMERS] = {40, 70, 110, 190, 300};
+
+typedef struct {
+    LP_TIMER timer;
+    uint64_t start;
+    uint64_t period;
+    unsigned long fires;   /* fires for deadlines inside the run */
+    unsigned long early;
+    unsigned long late;
+    uint64_t lateMax;
+} SIM_TIMER;
+
+static SIM_TIMER sims[TIMERS];
+static uint64_t runEnd;
+static uint64_t lateness; /* how late a fire may be in this run */
+
+static void sim_handler(EventLoopTimer *eventLoopTimer)
+{
+    SIM_TIMER *sim = NULL;
+    uint64_t now = vclock_now(), deadline;
+    int i;
+
+    for (i = 0; i < TIMERS; i++) {
+        if (sims[i].timer.eventLoopTimer == eventLoopTimer) {
+            sim = &sims[i];
+        }
+    }
+    CHECK(sim != NULL);
+    if (sim == NULL || ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+        return;
+    }
+
+    /* Periodic timers keep their cadence from the start, slack must never add up to drift */
+    deadline = sim->start + (sim->fires + 1) * sim->period;
+    if (deadline > runEnd) {
+        return;
+    }
+    sim->fires++;
+    if (now < deadline) {
+        sim->early++;
+    } else if (now - deadline > lateness) {
+        sim->late++;
+    }
+    if (now > deadline && now - deadline > sim->lateMax) {
+        sim->lateMax = now - deadline;
+    }
+}
+
+/* Returns the wakeups over the run */
+static unsigned long simulate(const char *name, unsigned slack_ms, unsigned grid_ms, bool *wheel)
+{
+    struct timespec slack = {.tv_sec = 0, .tv_nsec = (long)(slack_ms * VCLOCK_NS_PER_MS)};
+    struct timespec grid = {.tv_sec = 0, .tv_nsec = (long)(grid_ms * VCLOCK_NS_PER_MS)};
+    EventLoop *eventLoop = lp_timerGetEventLoop();
+    EventLoopTimerStats before, after;
+    unsigned long wakeups;
+    uint64_t lateMax = 0;
+    int i;
+
+    lp_timerSetGrid(grid_ms != 0 ? &grid : NULL);
+    for (i = 0; i < TIMERS; i++) {
+        sims[i] = (SIM_TIMER){
+            .timer = {.handler = sim_handler,
+                      .period = {.tv_sec = 0, .tv_nsec = (long)(periods_ms[i] * VCLOCK_NS_PER_MS)},
+                      .name = "sim",
+                      .slack = slack},
+            .start = vclock_now(),
+            .period = periods_ms[i] * VCLOCK_NS_PER_MS};
+        CHECK(lp_timerStart(&sims[i].timer));
+        vclock_advance(START_STAGGER_NS);
+    }
+    lp_timerSetGrid(NULL);
+
+    GetEventLoopTimerStats(&before);
+    *wheel = before.timerCount == TIMERS && before.fdCount == 1;
+    lateness = (*wheel ? slack_ms * VCLOCK_NS_PER_MS + TICK_NS : 0) + grid_ms * VCLOCK_NS_PER_MS;
+    runEnd = sims[0].start + RUN_MS * VCLOCK_NS_PER_MS;
+
+    wakeups = vclock_run(eventLoop, runEnd);
+    GetEventLoopTimerStats(&after);
+    if (*wheel) {
+        CHECK(after.wakeups - before.wakeups == wakeups);
+    }
+    /* Let the last deadlines of the run fire late, by as much as they may */
+    vclock_run(eventLoop, runEnd + lateness + START_STAGGER_NS * TIMERS);
+
+    for (i = 0; i < TIMERS; i++) {
+        SIM_TIMER *sim = &sims[i];
+
+        CHECK(sim->fires == (runEnd - sim->start) / sim->period);
+        CHECK(sim->early == 0);
+        CHECK(sim->late == 0);
+        if (sim->lateMax > lateMax) {
+            lateMax = sim->lateMax;
+        }
+        lp_timerStop(&sim->timer);
+    }
+    CHECK(vclock_timerfds() == 0);
+
+    printf("%-7s %-26s %4lu wakeups, latest fire %4.1f ms after its deadline\n",
+           *wheel ? "wheel" : "timerfd", name, wakeups, (double)lateMax / VCLOCK_NS_PER_MS);
+    return wakeups;
+}
+
+int main(void)
+{
+    unsigned long none, slack, grid;
+    bool wheel;
+
+    none = simulate("no slack", 0, 0, &wheel);
+    slack = simulate("20 ms slack", SLACK_MS, 0, &wheel);
+    grid = simulate("20 ms slack on a 20 ms grid", SLACK_MS, GRID_MS, &wheel);
+
+    if (wheel) {
+        CHECK(slack < none);
+        CHECK(grid < none);
+    } else {
+        CHECK(slack == none);
+        CHECK(grid < none);
+    }
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_timer_slack passed\n");
+    return 0;
+}
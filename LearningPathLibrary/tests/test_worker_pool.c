@@ -0,0 +1,134 @@
+/* Tests for stopping the worker pool in worker_pool.c: a job blocked in a read that never returns
+ * must not hold up lp_workerPoolStop beyond LP_WORKER_POOL_STOP_TIMEOUT_MS, a completion already
+ * posted to the event loop must not run after the stop, the blocked job must be let go of once
+ * its read returns, and a restarted pool must run it again.
+ * Usage: test_worker_pool */
+
+#include "loop_post.h"
+#include "timer.h"
+#include "worker_pool.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+static int blockingPipe[2];
+
+typedef struct {
+    unsigned long completed;
+    LP_WORK_RESULT result;
+} JOB;
+
+static bool blocking_read(void *context)
+{
+    char byte;
+
+    (void)context;
+    return read(blockingPipe[0], &byte, 1) == 1;
+}
+
+static bool quick(void *context)
+{
+    (void)context;
+    return true;
+}
+
+static void complete(void *context, LP_WORK_RESULT result)
+{
+    JOB *job = context;
+
+    job->completed++;
+    job->result = result;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Runs the event loop until done is set or timeoutMs passes */
+static void run_until(const unsigned long *done, double timeoutMs)
+{
+    double end = now_ms() + timeoutMs;
+
+    while (*done == 0 && now_ms() < end) {
+        EventLoop_Run(lp_timerGetEventLoop(), 10, true);
+    }
+}
+
+int main(void)
+{
+    JOB blockedJob = {0}, quickJob = {0}, lateJob = {0};
+    LP_WORK blocked = {.run = blocking_read, .complete = complete, .context = &blockedJob, .name = "blocked"};
+    LP_WORK quickWork = {.run = quick, .complete = complete, .context = &quickJob, .name = "quick"};
+    LP_WORK late = {.run = quick, .complete = complete, .context = &lateJob, .name = "late"};
+    double start, stopMs;
+    int i;
+
+    CHECK(pipe(blockingPipe) == 0);
+    CHECK(lp_workerPoolStart(2));
+
+    /* One worker blocks for good, the other still runs jobs */
+    CHECK(lp_workerSubmit(&blocked));
+    CHECK(lp_workerSubmit(&quickWork));
+    run_until(&quickJob.completed, 1000);
+    CHECK(quickJob.completed == 1 && quickJob.result == LP_WORK_OK);
+
+    /* Finished and posted, but the event loop does not run before the stop */
+    CHECK(lp_workerSubmit(&late));
+    usleep(20000);
+
+    start = now_ms();
+    lp_workerPoolStop();
+    stopMs = now_ms() - start;
+    CHECK(stopMs < LP_WORKER_POOL_STOP_TIMEOUT_MS + 500);
+    CHECK(stopMs >= LP_WORKER_POOL_STOP_TIMEOUT_MS - 50);
+    CHECK(!lp_workerSubmit(&quickWork));
+
+    /* The late completion is dropped, and the work is free again once the event loop lets go of it */
+    run_until(&lateJob.completed, 100);
+    CHECK(lateJob.completed == 0);
+    CHECK(!lp_workerBusy(&late));
+
+    /* The detached worker returns from its read, lets go of the job and exits without a completion */
+    CHECK(write(blockingPipe[1], "x", 1) == 1);
+    for (i = 0; i < 1000 && lp_workerBusy(&blocked); i++) {
+        usleep(1000);
+    }
+    CHECK(!lp_workerBusy(&blocked));
+    run_until(&blockedJob.completed, 50);
+    CHECK(blockedJob.completed == 0);
+
+    /* A restarted pool runs the job that blocked before */
+    CHECK(lp_workerPoolStart(1));
+    CHECK(lp_workerSubmit(&blocked));
+    CHECK(write(blockingPipe[1], "x", 1) == 1);
+    run_until(&blockedJob.completed, 1000);
+    CHECK(blockedJob.completed == 1 && blockedJob.result == LP_WORK_OK);
+    start = now_ms();
+    lp_workerPoolStop();
+    CHECK(now_ms() - start < 100);
+
+    lp_eventLoopPostStop();
+    close(blockingPipe[0]);
+    close(blockingPipe[1]);
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_worker_pool passed (a stop with a blocked job took %.0f ms)\n", stopMs);
+    return 0;
+}
@@ -0,0 +1,222 @@
+/* The virtual clock and timerfds, see virtual_clock.h */
+
+#include "virtual_clock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VCLOCK_MAX_FDS 256
+#define NS_PER_SEC 1000000000ull
+
+typedef struct {
+    bool timer;
+    uint64_t deadline; /* 0 when disarmed */
+    uint64_t interval;
+} VCLOCK_TIMERFD;
+
+/* Starts part way through a millisecond, so tick rounding is exercised */
+static uint64_t now = 1000 * NS_PER_SEC + 300000;
+static VCLOCK_TIMERFD timerfds[VCLOCK_MAX_FDS];
+static uint64_t longestDispatch;
+
+int __real_clock_gettime(clockid_t clockid, struct timespec *tp);
+int __real_close(int fd);
+
+static uint64_t to_ns(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * NS_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+
+static struct timespec to_timespec(uint64_t ns)
+{
+    return (struct timespec){.tv_sec = (time_t)(ns / NS_PER_SEC), .tv_nsec = (long)(ns % NS_PER_SEC)};
+}
+
+static VCLOCK_TIMERFD *find(int fd)
+{
+    if (fd < 0 || fd >= VCLOCK_MAX_FDS || !timerfds[fd].timer) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &timerfds[fd];
+}
+
+int __wrap_clock_gettime(clockid_t clockid, struct timespec *tp)
+{
+    if (clockid != CLOCK_MONOTONIC) {
+        return __real_clock_gettime(clockid, tp);
+    }
+    *tp = to_timespec(now);
+    return 0;
+}
+
+int __wrap_timerfd_create(int clockid, int flags)
+{
+    int fd;
+
+    if (clockid != CLOCK_MONOTONIC) {
+        errno = EINVAL;
+        return -1;
+    }
+    fd = eventfd(0, ((flags & TFD_NONBLOCK) ? EFD_NONBLOCK : 0) | ((flags & TFD_CLOEXEC) ? EFD_CLOEXEC : 0));
+    if (fd >= VCLOCK_MAX_FDS) {
+        __real_close(fd);
+        errno = EMFILE;
+        return -1;
+    }
+    if (fd != -1) {
+        timerfds[fd] = (VCLOCK_TIMERFD){.timer = true};
+    }
+    return fd;
+}
+
+int __wrap_timerfd_gettime(int fd, struct itimerspec *curr_value)
+{
+    VCLOCK_TIMERFD *timerfd = find(fd);
+
+    if (timerfd == NULL) {
+        return -1;
+    }
+    curr_value->it_value = to_timespec(timerfd->deadline == 0 ? 0 : timerfd->deadline - now);
+    curr_value->it_interval = to_timespec(timerfd->interval);
+    return 0;
+}
+
+int __wrap_timerfd_settime(int fd, int flags, const struct itimerspec *new_value, struct itimerspec *old_value)
+{
+    VCLOCK_TIMERFD *timerfd = find(fd);
+    uint64_t value, pending;
+
+    if (timerfd == NULL) {
+        return -1;
+    }
+    if (old_value != NULL) {
+        __wrap_timerfd_gettime(fd, old_value);
+    }
+
+    /* Setting a timerfd discards the expirations not yet read. A read takes the whole count,
+     * and only a nonblocking one is safe when there is none */
+    if (fcntl(fd, F_GETFL) & O_NONBLOCK) {
+        ssize_t drained = read(fd, &pending, sizeof(pending));
+        (void)drained;
+    }
+
+    value = to_ns(&new_value->it_value);
+    timerfd->interval = to_ns(&new_value->it_interval);
+    if (value == 0) {
+        timerfd->deadline = 0;
+    } else if (flags & TFD_TIMER_ABSTIME) {
+        timerfd->deadline = value <= now ? now : value;
+    } else {
+        timerfd->deadline = now + value;
+    }
+    vclock_advance(0); /* an absolute deadline may already have passed */
+    return 0;
+}
+
+int __wrap_close(int fd)
+{
+    if (fd >= 0 && fd < VCLOCK_MAX_FDS) {
+        timerfds[fd].timer = false;
+    }
+    return __real_close(fd);
+}
+
+uint64_t vclock_now(void)
+{
+    return now;
+}
+
+void vclock_advance(uint64_t ns)
+{
+    int fd;
+
+    now += ns;
+    for (fd = 0; fd < VCLOCK_MAX_FDS; fd++) {
+        VCLOCK_TIMERFD *timerfd = &timerfds[fd];
+        uint64_t expirations;
+
+        if (!timerfd->timer || timerfd->deadline == 0 || timerfd->deadline > now) {
+            continue;
+        }
+        expirations = 1;
+        if (timerfd->interval != 0) {
+            expirations += (now - timerfd->deadline) / timerfd->interval;
+            timerfd->deadline += expirations * timerfd->interval;
+        } else {
+            timerfd->deadline = 0;
+        }
+        if (write(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            timerfd->deadline = 0;
+        }
+    }
+}
+
+static uint64_t next_deadline(void)
+{
+    uint64_t next = UINT64_MAX;
+    int fd;
+
+    for (fd = 0; fd < VCLOCK_MAX_FDS; fd++) {
+        if (timerfds[fd].timer && timerfds[fd].deadline != 0 && timerfds[fd].deadline < next) {
+            next = timerfds[fd].deadline;
+        }
+    }
+    return next;
+}
+
+unsigned long vclock_run(EventLoop *eventLoop, uint64_t until)
+{
+    unsigned long wakeups = 0;
+
+    for (;;) {
+        bool dispatched = false;
+        uint64_t start = now;
+
+        /* Whatever is ready now first, a handler may have left work for the loop. One event
+         * at a time, so the virtual time each handler takes can be measured */
+        while (EventLoop_Run(eventLoop, 0, true) == EventLoop_Run_Finished) {
+            if (now - start > longestDispatch) {
+                longestDispatch = now - start;
+            }
+            dispatched = true;
+            start = now;
+        }
+        wakeups += dispatched;
+        uint64_t next = next_deadline();
+        if (next > until) {
+            break;
+        }
+        vclock_advance(next > now ? next - now : 0);
+    }
+    if (until > now) {
+        vclock_advance(until - now);
+    }
+    return wakeups;
+}
+
+uint64_t vclock_longest_dispatch(bool reset)
+{
+    uint64_t longest = longestDispatch;
+
+    if (reset) {
+        longestDispatch = 0;
+    }
+    return longest;
+}
+
+unsigned vclock_timerfds(void)
+{
+    unsigned count = 0;
+    int fd;
+
+    for (fd = 0; fd < VCLOCK_MAX_FDS; fd++) {
+        count += timerfds[fd].timer;
+    }
+    return count;
+}
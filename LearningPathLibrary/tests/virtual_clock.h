@@ -0,0 +1,33 @@
+/* A virtual CLOCK_MONOTONIC for host tests of code built on timerfds and the event loop. Link
+ * with -Wl,--wrap=clock_gettime,--wrap=timerfd_create,--wrap=timerfd_settime,
+ * --wrap=timerfd_gettime,--wrap=close and CLOCK_MONOTONIC reads the virtual clock, while a timerfd
+ * is an eventfd that the clock writes its expiration count to when virtual time passes its
+ * deadline. Reading it consumes the count as a timerfd read does, and it polls in the event loop
+ * like a timerfd. Time only moves when the test moves it, so seconds of timers run in
+ * milliseconds and every run gives the same result */
+#pragma once
+
+#include <applibs/eventloop.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VCLOCK_NS_PER_MS 1000000ull
+
+/* Virtual nanoseconds on CLOCK_MONOTONIC */
+uint64_t vclock_now(void);
+
+/* Moves the clock forward by ns, for code that stands in for time spent, like a bus transfer or
+ * a sleep. Timerfds that fall due are signalled but nothing is dispatched */
+void vclock_advance(uint64_t ns);
+
+/* Runs the event loop in virtual time up to until: moves the clock to each timerfd deadline in
+ * turn and dispatches what is ready, as a device that sleeps between timer expiries would.
+ * Returns the wakeups, the instants at which the loop dispatched at least one event */
+unsigned long vclock_run(EventLoop *eventLoop, uint64_t until);
+
+/* The most virtual time one event handler has taken in vclock_run, the longest the event loop
+ * has been stalled, since the last reset */
+uint64_t vclock_longest_dispatch(bool reset);
+
+/* Timerfds currently open */
+unsigned vclock_timerfds(void);
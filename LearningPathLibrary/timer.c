@@ -40,7 +40,16 @@ bool lp_timerStart(LP_TIMER* timer) {
 			return false;
 		}
 	}
-	
+
+	if (timer->slack.tv_sec != 0 || timer->slack.tv_nsec != 0) {
+		SetEventLoopTimerSlack(timer->eventLoopTimer, &timer->slack);
+	}
+
+	if (timer->profile == NULL) {
+		timer->profile = lp_profileRegister(timer->name);
+	}
+	SetEventLoopTimerProfile(timer->eventLoopTimer, timer->profile);
+
 	return true;
 }
 
@@ -65,6 +74,11 @@ void lp_timerSetStop(LP_TIMER* timerSet[], size_t timerCount) {
 	}
 }
 
+// Timers started after this have their first expiry aligned to a multiple of grid
+void lp_timerSetGrid(const struct timespec* grid) {
+	SetEventLoopTimerGrid(grid);
+}
+
 void lp_timerEventLoopStop(void) {
 	EventLoop* eventLoop = lp_timerGetEventLoop();
 	if (eventLoop != NULL) {
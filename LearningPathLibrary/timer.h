@@ -1,6 +1,7 @@
 #pragma once
 
 #include "eventloop_timer_utilities.h"
+#include "loop_profile.h"
 #include "stdbool.h"
 #include <applibs/eventloop.h>
 
@@ -9,12 +10,16 @@ typedef struct {
 	struct timespec period;
 	EventLoopTimer* eventLoopTimer;
 	const char* name;
+	struct timespec slack;	// optional, how late the timer may fire to share a wakeup with other timers.
+							// Only the LP_TIMER_WHEEL backend uses it, the default backend ignores slack
+	LP_PROFILE* profile;	// set on start when built with LP_PROFILE_ENABLED
 } LP_TIMER;
 
 EventLoop* lp_timerGetEventLoop(void);
 bool lp_timerChange(LP_TIMER* timer, const struct timespec* period);
 bool lp_timerOneShotSet(LP_TIMER* timer, const struct timespec* delay);
 bool lp_timerStart(LP_TIMER* timer);
+void lp_timerSetGrid(const struct timespec* grid);
 void lp_timerSetStart(LP_TIMER* timerSet[], size_t timerCount);
 void lp_timerSetStop(LP_TIMER* timerSet[], size_t timerCount);
 void lp_timerStop(LP_TIMER* timer);
@@ -0,0 +1,301 @@
+#include "worker_pool.h"
+#include "loop_post.h"
+#include "timer.h"
+#include <applibs/log.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+	WORK_IDLE,
+	WORK_QUEUED,
+	WORK_RUNNING,
+	WORK_FINISHED,	// completion posted to the event loop
+	WORK_ABANDONED	// timed out, waiting for the worker to let go of it
+};
+
+static void WorkTimeoutHandler(EventLoopTimer* eventLoopTimer);
+
+static pthread_t workers[LP_WORKER_POOL_MAX_THREADS];
+static unsigned int workerCount = 0;
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueReady = PTHREAD_COND_INITIALIZER;
+static LP_WORK* queueHead = NULL;
+static LP_WORK* queueTail = NULL;
+static LP_WORK* inFlight = NULL;	// event loop thread only
+// Workers belong to the generation they were started in and leave once it ends. Each stop starts a
+// new one, so a worker that outlived its pool never takes work from the next
+static atomic_uint poolGeneration = 0;
+static pthread_cond_t workersExited = PTHREAD_COND_INITIALIZER;
+static unsigned int retiringGeneration;	// guarded by queueLock, as is retiring
+static unsigned int retiring = 0;		// workers of retiringGeneration yet to exit
+
+static LP_TIMER workTimeoutTimer = {
+	.period = { 0, 0 },
+	.name = "workTimeoutTimer",
+	.handler = WorkTimeoutHandler };
+
+static uint64_t WorkNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static void RemoveInFlight(LP_WORK* work) {
+	for (LP_WORK** link = &inFlight; *link != NULL; link = &(*link)->nextInFlight) {
+		if (*link == work) {
+			*link = work->nextInFlight;
+			break;
+		}
+	}
+}
+
+// Arm the timeout timer for the earliest deadline of the work in flight. Finished work waiting
+// for WorkDone is skipped, it cannot time out any more and WorkDone rearms the timer
+static void ArmWorkTimeout(void) {
+	uint64_t next = UINT64_MAX;
+	uint64_t now = WorkNow();
+
+	for (LP_WORK* work = inFlight; work != NULL; work = work->nextInFlight) {
+		int state = atomic_load(&work->state);
+		if ((state == WORK_QUEUED || state == WORK_RUNNING) && work->deadline != 0 && work->deadline < next) {
+			next = work->deadline;
+		}
+	}
+
+	if (next != UINT64_MAX) {
+		uint64_t delay = next > now ? next - now : 1;
+		struct timespec period = { .tv_sec = (time_t)(delay / 1000000000), .tv_nsec = (long)(delay % 1000000000) };
+		lp_timerOneShotSet(&workTimeoutTimer, &period);
+	}
+}
+
+/// <summary>
+///     Posted by a worker thread when it is done with work, runs on the event loop thread
+/// </summary>
+static void WorkDone(void* context) {
+	LP_WORK* work = (LP_WORK*)context;
+
+	if (atomic_exchange(&work->state, WORK_IDLE) == WORK_ABANDONED) {
+		return;	// the timeout was already reported
+	}
+
+	RemoveInFlight(work);
+	work->complete(work->context, work->result);
+	ArmWorkTimeout();
+}
+
+/// <summary>
+///     Report LP_WORK_TIMEOUT for work past its deadline. A blocked run cannot be cancelled, so
+///     its result is discarded when it eventually returns
+/// </summary>
+static void WorkTimeoutHandler(EventLoopTimer* eventLoopTimer) {
+	uint64_t now = WorkNow();
+	LP_WORK* work = inFlight;
+
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+		return;
+	}
+
+	while (work != NULL) {
+		LP_WORK* next = work->nextInFlight;
+		if (work->deadline != 0 && work->deadline <= now) {
+			// A worker picking the work up moves it from queued to running, which fails the exchange,
+			// so it is retried with the new state until the work is abandoned or has finished
+			int state = atomic_load(&work->state);
+			bool abandoned = false;
+			while (!abandoned && (state == WORK_QUEUED || state == WORK_RUNNING)) {
+				abandoned = atomic_compare_exchange_strong(&work->state, &state, WORK_ABANDONED);
+			}
+			if (abandoned) {
+				RemoveInFlight(work);
+				work->complete(work->context, LP_WORK_TIMEOUT);
+			}
+		}
+		work = next;
+	}
+
+	ArmWorkTimeout();
+}
+
+static void WorkerExit(unsigned int generation) {
+	pthread_mutex_lock(&queueLock);
+	if (generation == retiringGeneration && retiring != 0) {
+		retiring--;
+		pthread_cond_broadcast(&workersExited);
+	}
+	pthread_mutex_unlock(&queueLock);
+}
+
+static void* WorkerThread(void* arg) {
+	unsigned int generation = (unsigned int)(uintptr_t)arg;
+
+	for (;;) {
+		pthread_mutex_lock(&queueLock);
+		while (queueHead == NULL && atomic_load(&poolGeneration) == generation) {
+			pthread_cond_wait(&queueReady, &queueLock);
+		}
+		if (atomic_load(&poolGeneration) != generation) {
+			pthread_mutex_unlock(&queueLock);
+			break;
+		}
+		LP_WORK* work = queueHead;
+		queueHead = work->next;
+		if (queueHead == NULL) {
+			queueTail = NULL;
+		}
+		pthread_mutex_unlock(&queueLock);
+
+		int expected = WORK_QUEUED;
+		if (atomic_compare_exchange_strong(&work->state, &expected, WORK_RUNNING)) {
+			work->result = work->run(work->context) ? LP_WORK_OK : LP_WORK_FAILED;
+			expected = WORK_RUNNING;
+			atomic_compare_exchange_strong(&work->state, &expected, WORK_FINISHED);
+		}
+
+		// Hand the work back to the event loop thread, which owns the completion. Once the pool
+		// has stopped the event loop no longer tracks the work, so it is only let go of
+		bool posted = false;
+		while (atomic_load(&poolGeneration) == generation && !(posted = lp_eventLoopPost(WorkDone, work))) {
+			usleep(1000);
+		}
+		if (!posted) {
+			atomic_store(&work->state, WORK_IDLE);
+			break;
+		}
+	}
+
+	WorkerExit(generation);
+	return NULL;
+}
+
+/// <summary>
+///     Start threads workers for blocking jobs such as sensor reads. Call from the event loop
+///     thread, completions are posted back to it with lp_eventLoopPost
+/// </summary>
+bool lp_workerPoolStart(unsigned int threads) {
+	if (workerCount != 0) {
+		return true;
+	}
+
+	if (!lp_eventLoopPostStart() || !lp_timerStart(&workTimeoutTimer)) {
+		return false;
+	}
+
+	void* generation = (void*)(uintptr_t)atomic_load(&poolGeneration);
+	for (unsigned int i = 0; i < threads && i < LP_WORKER_POOL_MAX_THREADS; i++) {
+		int result = pthread_create(&workers[workerCount], NULL, WorkerThread, generation);
+		if (result != 0) {
+			Log_Debug("ERROR: Unable to create worker thread: %d (%s)\n", result, strerror(result));
+			break;
+		}
+		workerCount++;
+	}
+
+	return workerCount != 0;
+}
+
+/// <summary>
+///     Stop the workers, waiting up to LP_WORKER_POOL_STOP_TIMEOUT_MS for their current jobs to
+///     return. A worker still blocked after that is detached and exits when its job returns. Queued
+///     jobs are dropped, and no complete callback runs after this, even for a completion already
+///     posted to the event loop
+/// </summary>
+void lp_workerPoolStop(void) {
+	struct timespec deadline;
+	bool exited;
+
+	pthread_mutex_lock(&queueLock);
+	retiringGeneration = atomic_fetch_add(&poolGeneration, 1);
+	retiring = workerCount;
+	pthread_cond_broadcast(&queueReady);
+
+	for (LP_WORK* work = queueHead; work != NULL; work = work->next) {
+		atomic_store(&work->state, WORK_IDLE);
+	}
+	queueHead = queueTail = NULL;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += LP_WORKER_POOL_STOP_TIMEOUT_MS / 1000;
+	deadline.tv_nsec += (LP_WORKER_POOL_STOP_TIMEOUT_MS % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	while (retiring != 0 && pthread_cond_timedwait(&workersExited, &queueLock, &deadline) != ETIMEDOUT) {
+	}
+	exited = retiring == 0;
+	pthread_mutex_unlock(&queueLock);
+
+	for (unsigned int i = 0; i < workerCount; i++) {
+		if (exited) {
+			pthread_join(workers[i], NULL);
+		} else {
+			pthread_detach(workers[i]);
+		}
+	}
+	if (!exited) {
+		Log_Debug("ERROR: Worker pool stopped with a job still running\n");
+	}
+	workerCount = 0;
+
+	// Abandoned, so WorkDone drops a completion already posted, a job a worker took just before
+	// the stop is not run, and a detached worker lets go of its job when it returns
+	for (LP_WORK* work = inFlight; work != NULL; work = work->nextInFlight) {
+		int state = atomic_load(&work->state);
+		while ((state == WORK_QUEUED || state == WORK_RUNNING || state == WORK_FINISHED) &&
+			!atomic_compare_exchange_strong(&work->state, &state, WORK_ABANDONED)) {
+		}
+	}
+	inFlight = NULL;
+
+	lp_timerStop(&workTimeoutTimer);
+}
+
+/// <summary>
+///     Queue work for a worker thread. Call from the event loop thread. Returns false if the
+///     pool is not started or the work has not completed since it was last submitted
+/// </summary>
+bool lp_workerSubmit(LP_WORK* work) {
+	int expected = WORK_IDLE;
+
+	if (workerCount == 0 || work->run == NULL || work->complete == NULL) {
+		return false;
+	}
+
+	if (!atomic_compare_exchange_strong(&work->state, &expected, WORK_QUEUED)) {
+		return false;
+	}
+
+	work->deadline = 0;
+	if (work->timeout.tv_sec != 0 || work->timeout.tv_nsec != 0) {
+		work->deadline = WorkNow() + (uint64_t)work->timeout.tv_sec * 1000000000 + (uint64_t)work->timeout.tv_nsec;
+	}
+	work->nextInFlight = inFlight;
+	inFlight = work;
+
+	pthread_mutex_lock(&queueLock);
+	work->next = NULL;
+	if (queueTail != NULL) {
+		queueTail->next = work;
+	} else {
+		queueHead = work;
+	}
+	queueTail = work;
+	pthread_cond_signal(&queueReady);
+	pthread_mutex_unlock(&queueLock);
+
+	if (work->deadline != 0) {
+		ArmWorkTimeout();
+	}
+
+	return true;
+}
+
+/// <summary>
+///     True from lp_workerSubmit until the worker has let go of the work
+/// </summary>
+bool lp_workerBusy(LP_WORK* work) {
+	return atomic_load(&work->state) != WORK_IDLE;
+}
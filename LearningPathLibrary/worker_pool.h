@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define LP_WORKER_POOL_MAX_THREADS 4
+// How long lp_workerPoolStop waits for running jobs before it leaves their workers behind
+#define LP_WORKER_POOL_STOP_TIMEOUT_MS 1000
+
+typedef enum {
+	LP_WORK_OK,
+	LP_WORK_FAILED,
+	LP_WORK_TIMEOUT
+} LP_WORK_RESULT;
+
+typedef struct LP_WORK {
+	bool (*run)(void* context);								// runs on a worker thread and may block
+	void (*complete)(void* context, LP_WORK_RESULT result);	// runs on the event loop thread
+	void* context;
+	struct timespec timeout;	// optional, complete is called with LP_WORK_TIMEOUT if run takes longer
+	const char* name;
+	// Owned by the worker pool
+	atomic_int state;
+	LP_WORK_RESULT result;
+	uint64_t deadline;
+	struct LP_WORK* next;
+	struct LP_WORK* nextInFlight;
+} LP_WORK;
+
+bool lp_workerPoolStart(unsigned int threads);
+void lp_workerPoolStop(void);
+bool lp_workerSubmit(LP_WORK* work);
+bool lp_workerBusy(LP_WORK* work);
@@ -61,6 +61,14 @@ void sensirion_i2c_init(void);
  */
 void sensirion_i2c_release(void);
 
+/**
+ * Release the resources used by the device at the given address only, leaving
+ * any other device on the bus in use.
+ *
+ * @param address 7-bit I2C address of the device
+ */
+void sensirion_i2c_release_address(uint8_t address);
+
 /**
  * Execute one read transaction on the I2C bus, reading a given number of bytes.
  * If the device does not acknowledge the read command, an error shall be
@@ -0,0 +1,76 @@
+/*
+ * Non-blocking SCD30 driver for the event loop.
+ *
+ * The blocking driver sleeps inside the calling handler: every setter waits
+ * SCD30_WRITE_DELAY_US for the sensor, and starting the sensor up takes
+ * seconds of probe retries and settling. Here each of those waits is an
+ * LP_TIMER one shot instead, so the event loop only ever runs the I2C
+ * transactions themselves. The bus manager retries a failed transaction
+ * straight away rather than sleeping, as the sensor's device leaves
+ * retryBackoff unset.
+ *
+ * scd30_async_start() probes and configures the sensor and starts periodic
+ * measurement. scd30_async_measure() then asks for a measurement: data ready
+ * is polled, from the RDY pin if one is wired up or else over I2C, and the
+ * measurement is read and handed to the measurement_ready callback. There is
+ * one SCD30 per application, so the driver state is static.
+ */
+
+#ifndef SCD30_ASYNC_H
+#define SCD30_ASYNC_H
+
+#include "scd30.h"
+#include "peripheral_gpio.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCD30_ASYNC_PROBE_RETRIES 5
+#define SCD30_ASYNC_PROBE_RETRY_US 1000000
+#define SCD30_ASYNC_POLL_US 100000
+
+typedef struct {
+    uint16_t interval_sec; /* measurement interval, 2-1800s */
+    bool enable_asc;       /* turn on automatic self calibration if it is off */
+    LP_GPIO *rdy; /* optional, opened input wired to the RDY pin, else NULL */
+    /* called on the event loop with STATUS_OK and the measurement, or an
+     * error code and NAN values */
+    void (*measurement_ready)(int16_t status, float co2_ppm, float temperature,
+                              float humidity);
+} scd30_async_config_t;
+
+/**
+ * scd30_async_start() - Probe the sensor, configure it and start periodic
+ * measurement, without blocking. Requires the LP_TIMER event loop.
+ *
+ * @param config    settings, copied
+ *
+ * @return          true if start up was scheduled
+ */
+bool scd30_async_start(const scd30_async_config_t *config);
+
+/**
+ * scd30_async_measure() - Request the next measurement. measurement_ready is
+ * called once it has been read, which may be before this returns if data is
+ * already waiting. A request made while the sensor is starting up is served
+ * once it is running, and a request made while one is outstanding joins it.
+ *
+ * @return  false if the sensor failed to start or has been stopped
+ */
+bool scd30_async_measure(void);
+
+/**
+ * scd30_async_stop() - Cancel any outstanding work and detach the SCD30 from
+ * the bus, leaving any other sensor on it in use.
+ * Periodic measurement is left running, see
+ * scd30_stop_periodic_measurement().
+ */
+void scd30_async_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCD30_ASYNC_H */
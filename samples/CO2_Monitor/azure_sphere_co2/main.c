@@ -34,7 +34,7 @@
 #include <stdio.h>
 #include <time.h>
 
-#include "./embedded-scd/scd30/scd30.h"
+#include "./embedded-scd/scd30/scd30_async.h"
 
 
 #define JSON_MESSAGE_BYTES 256 // Number of bytes to allocate for the JSON telemetry message for IoT Central
@@ -51,7 +51,7 @@ LP_USER_CONFIG lp_config;
 
 static char msgBuffer[JSON_MESSAGE_BYTES] = { 0 };
 
-static float co2_ppm, temperature, relative_humidity = NAN;
+static float co2_ppm = NAN, temperature = NAN, relative_humidity = NAN;
 static const struct timespec co2AlertBuzzerPeriod = { 0, 5 * 100 * 1000 };
 
 // GPIO Output PeripheralGpios
@@ -179,7 +179,17 @@ static void PublishTelemetryTimer(EventLoopTimer* eventLoopTimer)
 
 
 /// <summary>
-/// Read sensor and send to Azure IoT
+/// Called on the event loop when the SCD30 measurement has been read
+/// </summary>
+static void MeasurementReady(int16_t status, float co2, float temp, float humidity)
+{
+	co2_ppm = status == STATUS_OK ? co2 : NAN;
+	temperature = temp;
+	relative_humidity = humidity;
+}
+
+/// <summary>
+/// Request an SCD30 measurement, MeasurementReady is called once it has been read
 /// </summary>
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 {
@@ -189,7 +199,7 @@ static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 	}
 	else
 	{
-		if (scd30_read_measurement(&co2_ppm, &temperature, &relative_humidity) != STATUS_OK)
+		if (!scd30_async_measure())
 		{
 			co2_ppm = NAN;
 		}
@@ -205,46 +215,18 @@ static void DeviceTwinGenericHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding)
 	lp_deviceTwinAckDesiredState(deviceTwinBinding, deviceTwinBinding->twinState, LP_DEVICE_TWIN_COMPLETED);
 }
 
+/// <summary>
+/// Probe and configure the SCD30 and start periodic measurement, driven by the event loop
+/// </summary>
 static bool InitializeSdc30(void)
 {
-	uint16_t interval_in_seconds = 2;
-	int retry = 0;
-	uint8_t asc_enabled, enable_asc;
-
-	sensirion_i2c_init();
-
-	while (scd30_probe() != STATUS_OK && ++retry < 5)
-	{
-		printf("SCD30 sensor probing failed\n");
-		sensirion_sleep_usec(1000000u);
-	}
-
-	if (retry >= 5) { return false; }
-
-	/*
-	When scd30 automatic self calibration activated for the first time a period of minimum 7 days is needed so
-	that the algorithm can find its initial parameter set for ASC. The sensor has to be exposed to fresh air for at least 1 hour every day.
-	Refer to the datasheet for further conditions and scd30.h for more info.
-	*/
-
-	if (scd30_get_automatic_self_calibration(&asc_enabled) == 0)
-	{
-		if (asc_enabled == 0)
-		{
-			enable_asc = 1;
-			if (scd30_enable_automatic_self_calibration(enable_asc) == 0)
-			{
-				Log_Debug("scd30 automatic self calibration enabled. Takes 7 days, at least 1 hour/day outside, powered continuously");
-			}
-		}
-	}
-
-	scd30_set_measurement_interval(interval_in_seconds);
-	sensirion_sleep_usec(20000u);
-	scd30_start_periodic_measurement(0);
-	sensirion_sleep_usec(interval_in_seconds * 1000000u);
+	scd30_async_config_t scd30Config = {
+		.interval_sec = 2,
+		.enable_asc = true,
+		.rdy = NULL,	// or an LP_INPUT LP_GPIO in PeripheralGpioSet wired to the SCD30 RDY pin
+		.measurement_ready = MeasurementReady };
 
-	return true;
+	return scd30_async_start(&scd30Config);
 }
 
 /// <summary>
@@ -264,7 +246,8 @@ static void InitPeripheralGpiosAndHandlers(void)
 
 	lp_azureToDeviceStart();
 
-	scd30_read_measurement(&co2_ppm, &temperature, &relative_humidity);
+	// The first measurement is ready an interval after the SCD30 starts
+	scd30_async_measure();
 }
 
 /// <summary>
@@ -282,6 +265,7 @@ static void ClosePeripheralGpiosAndHandlers(void)
 	lp_deviceTwinSetClose();
 
 	scd30_stop_periodic_measurement();
+	scd30_async_stop();
 
 	lp_timerEventLoopStop();
 }
@@ -65,7 +65,7 @@ static LP_DIRECT_METHOD_RESPONSE_CODE LightControlDirectMethodHandler(JSON_Value
 LP_USER_CONFIG lp_config;
 
 static char msgBuffer[JSON_MESSAGE_BYTES] = { 0 };
-static LP_INTER_CORE_BLOCK ic_control_block;
+static LP_IC_MESSAGE ic_control_block;
 static int msgId = 0;
 
 // Telemetry message template and properties
@@ -161,7 +161,7 @@ static LP_DIRECT_METHOD_RESPONSE_CODE LightControlDirectMethodHandler(JSON_Value
 /// <summary>
 /// Callback handler for Inter-Core Messaging - Does Device Twin Update, and Event Message
 /// </summary>
-static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
+static void InterCoreHandler(LP_IC_MESSAGE* ic_message_block)
 {
 	switch (ic_message_block->cmd)
 	{
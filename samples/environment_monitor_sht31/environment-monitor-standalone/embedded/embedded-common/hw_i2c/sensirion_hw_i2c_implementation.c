@@ -34,14 +34,55 @@
 #include "sensirion_i2c.h"
 
 #include "hw/azure_sphere_learning_path.h"
-#include <applibs/i2c.h>
+#include "i2c_bus.h"
 #include <applibs/log.h>
 #include <errno.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
-int i2cHandle = -1;
+// The sensors these drivers talk to, attached to the bus manager on first use. The SCD30
+// only runs at up to 100 kHz, the SHT3x at up to 1 MHz
+static LP_I2C_DEVICE sensirionDevices[] = {
+	{ .address = 0x61, .maxSpeed = I2C_BUS_SPEED_STANDARD, .priority = LP_I2C_PRIORITY_NORMAL, .name = "scd30" },
+	{ .address = 0x44, .maxSpeed = I2C_BUS_SPEED_FAST_PLUS, .priority = LP_I2C_PRIORITY_NORMAL, .name = "sht3x" },
+	{ .address = 0x45, .maxSpeed = I2C_BUS_SPEED_FAST_PLUS, .priority = LP_I2C_PRIORITY_NORMAL, .name = "sht3x" },
+};
+
+#define SENSIRION_DEVICES (sizeof(sensirionDevices) / sizeof(sensirionDevices[0]))
+
+
+/// <summary>
+///     Returns the attached bus manager device for address, NULL if it is not a known sensor or
+///     the bus could not be opened
+/// </summary>
+static LP_I2C_DEVICE* AttachedDevice(uint8_t address)
+{
+	for (size_t i = 0; i < SENSIRION_DEVICES; i++)
+	{
+		if (sensirionDevices[i].address == address)
+		{
+			if (sensirionDevices[i].bus == NULL && !lp_i2cAttach(&sensirionDevices[i], I2cMaster2))
+			{
+				Log_Debug("ERROR: lp_i2cAttach: errno=%d (%s)\n", errno, strerror(errno));
+				return NULL;
+			}
+			return &sensirionDevices[i];
+		}
+	}
+
+	Log_Debug("ERROR: No I2C device known at 0x%02x\n", address);
+	return NULL;
+}
+
+static void ReleaseDevice(LP_I2C_DEVICE* device)
+{
+	if (device->bus != NULL)
+	{
+		lp_i2cLogStats(device);
+		lp_i2cDetach(device);
+	}
+}
 
 
 /*
@@ -72,54 +113,33 @@ int16_t sensirion_i2c_select_bus(uint8_t bus_idx) {
  * communication.
  */
 void sensirion_i2c_init(void) {
-    // IMPLEMENT
-	i2cHandle = I2CMaster_Open(I2cMaster2);
-	if (i2cHandle < 0)
-	{
-		Log_Debug("ERROR: I2CMaster_Open: errno=%d (%s)\n", errno, strerror(errno));
-		return;
-	}
-
-	int result = I2CMaster_SetBusSpeed(i2cHandle, I2C_BUS_SPEED_STANDARD);
-	if (result != 0)
-	{
-		Log_Debug("ERROR: I2CMaster_SetBusSpeed: errno=%d (%s)\n", errno, strerror(errno));
-		return;
-	}
+	// Nothing to do, each sensor is attached to the bus manager when it is first used
+}
 
-	result = I2CMaster_SetTimeout(i2cHandle, 100);
-	if (result != 0)
+/**
+ * Release all resources initialized by sensirion_i2c_init().
+ */
+void sensirion_i2c_release(void) {
+	for (size_t i = 0; i < SENSIRION_DEVICES; i++)
 	{
-		Log_Debug("ERROR: I2CMaster_SetTimeout: errno=%d (%s)\n", errno, strerror(errno));
-		return;
+		ReleaseDevice(&sensirionDevices[i]);
 	}
 }
 
-/// <summary>
-///     Closes a file descriptor and prints an error on failure.
-/// </summary>
-/// <param name="fd">File descriptor to close</param>
-/// <param name="fdName">File descriptor name to use in error message</param>
-void CloseI2cHandle(int fd, const char* fdName)
-{
-	if (fd >= 0)
+/**
+ * Release the resources used by the device at the given address only, leaving
+ * any other device on the bus in use.
+ */
+void sensirion_i2c_release_address(uint8_t address) {
+	for (size_t i = 0; i < SENSIRION_DEVICES; i++)
 	{
-		int result = close(fd);
-		if (result != 0)
+		if (sensirionDevices[i].address == address)
 		{
-			Log_Debug("ERROR: Could not close fd %s: %s (%d).\n", fdName, strerror(errno), errno);
+			ReleaseDevice(&sensirionDevices[i]);
 		}
 	}
 }
 
-/**
- * Release all resources initialized by sensirion_i2c_init().
- */
-void sensirion_i2c_release(void) {
-    // IMPLEMENT or leave empty if no resources need to be freed
-	CloseI2cHandle(i2cHandle, "i2c");
-}
-
 /**
  * Execute one read transaction on the I2C bus, reading a given number of bytes.
  * If the device does not acknowledge the read command, an error shall be
@@ -131,13 +151,14 @@ void sensirion_i2c_release(void) {
  * @returns 0 on success, error code otherwise
  */
 int8_t sensirion_i2c_read(uint8_t address, uint8_t* data, uint16_t count) {
-	// Read the data into the provided buffer
-	int32_t retVal = I2CMaster_Read(i2cHandle, address, data, count);
-	if (retVal != count)
+	LP_I2C_DEVICE* device = AttachedDevice(address);
+
+	// The bus manager retries and logs failures
+	if (device == NULL || lp_i2cRead(device, data, count) < 0)
 	{
-		Log_Debug("ERROR: Expected return value to match count\n");
+		return STATUS_FAIL;
 	}
-	return 0;
+	return STATUS_OK;
 }
 
 /**
@@ -152,14 +173,13 @@ int8_t sensirion_i2c_read(uint8_t address, uint8_t* data, uint16_t count) {
  * @returns 0 on success, error code otherwise
  */
 int8_t sensirion_i2c_write(uint8_t address, const uint8_t* data, uint16_t count) {
-    // IMPLEMENT
-	int32_t retVal = I2CMaster_Write(i2cHandle, address, data, count);
-	if (retVal != count)
+	LP_I2C_DEVICE* device = AttachedDevice(address);
+
+	if (device == NULL || lp_i2cWrite(device, data, count) < 0)
 	{
-		Log_Debug("ERROR: Expected return value to match count\n");
+		return STATUS_FAIL;
 	}
-
-	return 0;
+	return STATUS_OK;
 }
 
 /**
@@ -0,0 +1,204 @@
+#include "scd30_async.h"
+#include "exit_codes.h"
+#include "terminate.h"
+#include "timer.h"
+#include <applibs/gpio.h>
+#include <applibs/log.h>
+#include <math.h>
+
+typedef enum {
+    SCD30_ASYNC_STOPPED,
+    SCD30_ASYNC_PROBE,
+    SCD30_ASYNC_SET_INTERVAL,
+    SCD30_ASYNC_START_MEASUREMENT,
+    SCD30_ASYNC_RUNNING,
+    SCD30_ASYNC_MEASURING,
+    SCD30_ASYNC_FAILED
+} scd30_async_state_t;
+
+static void scd30_async_timer_handler(EventLoopTimer *eventLoopTimer);
+
+static LP_TIMER scd30AsyncTimer = {.period = {0, 0},
+                                   .name = "scd30AsyncTimer",
+                                   .handler = scd30_async_timer_handler};
+
+static scd30_async_config_t config;
+static scd30_async_state_t state = SCD30_ASYNC_STOPPED;
+static bool measure_pending;
+static int retries;
+static uint32_t polls;
+
+static void schedule(scd30_async_state_t next, uint32_t delay_us) {
+    struct timespec delay = {.tv_sec = (time_t)(delay_us / 1000000u),
+                             .tv_nsec = (long)(delay_us % 1000000u) * 1000};
+
+    state = next;
+    lp_timerOneShotSet(&scd30AsyncTimer, &delay);
+}
+
+static void deliver(int16_t status, float co2_ppm, float temperature,
+                    float humidity) {
+    if (config.measurement_ready)
+        config.measurement_ready(status, co2_ppm, temperature, humidity);
+}
+
+static void fail(void) {
+    state = SCD30_ASYNC_FAILED;
+    if (measure_pending) {
+        measure_pending = false;
+        deliver(STATUS_FAIL, NAN, NAN, NAN);
+    }
+}
+
+static bool data_ready(void) {
+    GPIO_Value_Type rdy;
+    uint16_t ready;
+
+    if (config.rdy && config.rdy->opened) {
+        return GPIO_GetValue(config.rdy->fd, &rdy) == 0 &&
+               rdy == GPIO_Value_High;
+    }
+    return scd30_get_data_ready(&ready) == STATUS_OK && ready;
+}
+
+static void poll_measurement(void) {
+    float co2_ppm, temperature, humidity;
+    int16_t ret;
+    /* a measurement is due every interval, allow two before giving up */
+    uint32_t max_polls =
+        2u * config.interval_sec * (1000000u / SCD30_ASYNC_POLL_US);
+
+    if (!data_ready()) {
+        if (++polls < max_polls) {
+            schedule(SCD30_ASYNC_MEASURING, SCD30_ASYNC_POLL_US);
+            return;
+        }
+        state = SCD30_ASYNC_RUNNING;
+        deliver(STATUS_FAIL, NAN, NAN, NAN);
+        return;
+    }
+
+    state = SCD30_ASYNC_RUNNING;
+    ret = scd30_read_measurement(&co2_ppm, &temperature, &humidity);
+    if (ret != STATUS_OK)
+        co2_ppm = temperature = humidity = NAN;
+    deliver(ret, co2_ppm, temperature, humidity);
+}
+
+static void begin_measurement(void) {
+    measure_pending = false;
+    polls = 0;
+    state = SCD30_ASYNC_MEASURING;
+    poll_measurement();
+}
+
+static void step(void) {
+    uint8_t asc_enabled;
+
+    switch (state) {
+        case SCD30_ASYNC_PROBE:
+            if (scd30_probe() != STATUS_OK) {
+                Log_Debug("SCD30 sensor probing failed\n");
+                if (++retries < SCD30_ASYNC_PROBE_RETRIES) {
+                    schedule(SCD30_ASYNC_PROBE, SCD30_ASYNC_PROBE_RETRY_US);
+                } else {
+                    fail();
+                }
+                return;
+            }
+            /*
+             * When ASC is activated for the first time a period of minimum 7
+             * days is needed so that the algorithm can find its initial
+             * parameter set. The sensor has to be exposed to fresh air for at
+             * least 1 hour every day, see scd30.h.
+             */
+            if (config.enable_asc &&
+                scd30_get_automatic_self_calibration(&asc_enabled) ==
+                    STATUS_OK &&
+                asc_enabled == 0 &&
+                scd30_enable_automatic_self_calibration_nowait(1) ==
+                    STATUS_OK) {
+                Log_Debug("scd30 automatic self calibration enabled. Takes 7 "
+                          "days, at least 1 hour/day outside, powered "
+                          "continuously\n");
+                schedule(SCD30_ASYNC_SET_INTERVAL, SCD30_WRITE_DELAY_US);
+                return;
+            }
+            /* fall through */
+        case SCD30_ASYNC_SET_INTERVAL:
+            if (scd30_set_measurement_interval_nowait(config.interval_sec) !=
+                STATUS_OK) {
+                fail();
+                return;
+            }
+            schedule(SCD30_ASYNC_START_MEASUREMENT, SCD30_WRITE_DELAY_US);
+            return;
+        case SCD30_ASYNC_START_MEASUREMENT:
+            if (scd30_start_periodic_measurement(0) != STATUS_OK) {
+                fail();
+                return;
+            }
+            state = SCD30_ASYNC_RUNNING;
+            /* the first measurement arrives an interval from now */
+            if (measure_pending)
+                begin_measurement();
+            return;
+        case SCD30_ASYNC_MEASURING:
+            poll_measurement();
+            return;
+        default:
+            return;
+    }
+}
+
+static void scd30_async_timer_handler(EventLoopTimer *eventLoopTimer) {
+    if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+        lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+        return;
+    }
+    step();
+}
+
+bool scd30_async_start(const scd30_async_config_t *async_config) {
+    if (state != SCD30_ASYNC_STOPPED)
+        return false;
+
+    if (!lp_timerStart(&scd30AsyncTimer))
+        return false;
+
+    config = *async_config;
+    measure_pending = false;
+    retries = 0;
+
+    sensirion_i2c_init();
+
+    state = SCD30_ASYNC_PROBE;
+    step();
+
+    return true;
+}
+
+bool scd30_async_measure(void) {
+    switch (state) {
+        case SCD30_ASYNC_STOPPED:
+        case SCD30_ASYNC_FAILED:
+            return false;
+        case SCD30_ASYNC_RUNNING:
+            begin_measurement();
+            return true;
+        default:
+            /* starting up, or already measuring */
+            if (state != SCD30_ASYNC_MEASURING)
+                measure_pending = true;
+            return true;
+    }
+}
+
+void scd30_async_stop(void) {
+    if (state == SCD30_ASYNC_STOPPED)
+        return;
+
+    lp_timerStop(&scd30AsyncTimer);
+    sensirion_i2c_release_address(scd30_get_configured_address());
+    state = SCD30_ASYNC_STOPPED;
+}
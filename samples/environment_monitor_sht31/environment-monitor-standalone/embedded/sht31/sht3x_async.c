@@ -0,0 +1,145 @@
+#include "sht3x_async.h"
+#include "exit_codes.h"
+#include "terminate.h"
+#include "timer.h"
+#include <applibs/log.h>
+
+typedef enum {
+    SHT3X_ASYNC_STOPPED,
+    SHT3X_ASYNC_PROBE,
+    SHT3X_ASYNC_PROBE_READ,
+    SHT3X_ASYNC_IDLE,
+    SHT3X_ASYNC_MEASURING,
+    SHT3X_ASYNC_FAILED
+} sht3x_async_state_t;
+
+static void sht3x_async_timer_handler(EventLoopTimer* eventLoopTimer);
+
+static LP_TIMER sht3xAsyncTimer = {.period = {0, 0},
+                                   .name = "sht3xAsyncTimer",
+                                   .handler = sht3x_async_timer_handler};
+
+static sht3x_async_callback_t callback;
+static sht3x_async_state_t state = SHT3X_ASYNC_STOPPED;
+static bool measure_pending;
+static int retries;
+
+static void schedule(sht3x_async_state_t next, uint32_t delay_usec) {
+    struct timespec delay = {.tv_sec = (time_t)(delay_usec / 1000000u),
+                             .tv_nsec = (long)(delay_usec % 1000000u) * 1000};
+
+    state = next;
+    lp_timerOneShotSet(&sht3xAsyncTimer, &delay);
+}
+
+static void begin_measurement(void) {
+    int16_t ret;
+
+    measure_pending = false;
+    ret = sht3x_measure();
+    if (ret != STATUS_OK) {
+        state = SHT3X_ASYNC_IDLE;
+        callback(ret, 0, 0);
+        return;
+    }
+    schedule(SHT3X_ASYNC_MEASURING, SHT3X_MEASUREMENT_DURATION_USEC);
+}
+
+static void probe_failed(void) {
+    Log_Debug("SHT sensor probing failed\n");
+    if (++retries < SHT3X_ASYNC_PROBE_RETRIES) {
+        schedule(SHT3X_ASYNC_PROBE, SHT3X_ASYNC_PROBE_RETRY_USEC);
+        return;
+    }
+
+    state = SHT3X_ASYNC_FAILED;
+    if (measure_pending) {
+        measure_pending = false;
+        callback(STATUS_FAIL, 0, 0);
+    }
+}
+
+static void step(void) {
+    int32_t temperature, humidity;
+    int16_t ret;
+
+    switch (state) {
+        case SHT3X_ASYNC_PROBE:
+            if (sht3x_measure() != STATUS_OK) {
+                probe_failed();
+                return;
+            }
+            schedule(SHT3X_ASYNC_PROBE_READ, SHT3X_MEASUREMENT_DURATION_USEC);
+            return;
+        case SHT3X_ASYNC_PROBE_READ:
+            /* the results are CRC checked, so a good read is a good probe */
+            if (sht3x_read(&temperature, &humidity) != STATUS_OK) {
+                probe_failed();
+                return;
+            }
+            Log_Debug("SHT sensor probing successful\n");
+            state = SHT3X_ASYNC_IDLE;
+            if (measure_pending)
+                begin_measurement();
+            return;
+        case SHT3X_ASYNC_MEASURING:
+            state = SHT3X_ASYNC_IDLE;
+            ret = sht3x_read(&temperature, &humidity);
+            callback(ret, temperature, humidity);
+            return;
+        default:
+            return;
+    }
+}
+
+static void sht3x_async_timer_handler(EventLoopTimer* eventLoopTimer) {
+    if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+        lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+        return;
+    }
+    step();
+}
+
+bool sht3x_async_start(sht3x_async_callback_t measurement_ready) {
+    if (state != SHT3X_ASYNC_STOPPED)
+        return false;
+
+    if (!lp_timerStart(&sht3xAsyncTimer))
+        return false;
+
+    callback = measurement_ready;
+    measure_pending = false;
+    retries = 0;
+
+    sensirion_i2c_init();
+
+    state = SHT3X_ASYNC_PROBE;
+    step();
+
+    return true;
+}
+
+bool sht3x_async_measure(void) {
+    switch (state) {
+        case SHT3X_ASYNC_STOPPED:
+        case SHT3X_ASYNC_FAILED:
+            return false;
+        case SHT3X_ASYNC_IDLE:
+            begin_measurement();
+            return true;
+        default:
+            /* being probed, or already measuring */
+            if (state != SHT3X_ASYNC_MEASURING)
+                measure_pending = true;
+            return true;
+    }
+}
+
+void sht3x_async_stop(void) {
+    if (state == SHT3X_ASYNC_STOPPED)
+        return;
+
+    lp_timerStop(&sht3xAsyncTimer);
+    sensirion_i2c_release_address(sht3x_get_configured_address());
+    state = SHT3X_ASYNC_STOPPED;
+}
@@ -0,0 +1,65 @@
+/*
+ * Non-blocking SHT3x driver for the event loop.
+ *
+ * sht3x_measure_blocking_read() sleeps for the whole conversion inside the
+ * calling handler, and sht3x_probe() sleeps between its command and read.
+ * Here the measurement command is sent, an LP_TIMER one shot fires once the
+ * conversion is done, and only then are the results read, so the event loop
+ * only ever runs the I2C transactions themselves. The bus manager retries a
+ * failed transaction straight away rather than sleeping, as the sensor's
+ * device leaves retryBackoff unset.
+ *
+ * There is one SHT3x per application, so the driver state is static.
+ */
+
+#ifndef SHT3X_ASYNC_H
+#define SHT3X_ASYNC_H
+
+#include "sht3x.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHT3X_ASYNC_PROBE_RETRIES 5
+#define SHT3X_ASYNC_PROBE_RETRY_USEC 1000000
+
+/**
+ * Called on the event loop with 0 and the measurement, or an error code.
+ * Temperature is in [degree Celsius] and relative humidity in [percent
+ * relative humidity], each multiplied by 1000.
+ */
+typedef void (*sht3x_async_callback_t)(int16_t status, int32_t temperature,
+                                       int32_t humidity);
+
+/**
+ * Probes the sensor without blocking, retrying every second, by taking a first
+ * measurement which is discarded. Requires the LP_TIMER event loop.
+ *
+ * @param measurement_ready called with each measurement
+ * @return                  true if the probe was scheduled
+ */
+bool sht3x_async_start(sht3x_async_callback_t measurement_ready);
+
+/**
+ * Starts a measurement. measurement_ready is called once the conversion is
+ * done and the results have been read. A request made while the sensor is
+ * being probed is served once it has been found, and a request made while a
+ * measurement is in progress joins it.
+ *
+ * @return  false if the sensor was not found or has been stopped
+ */
+bool sht3x_async_measure(void);
+
+/**
+ * Cancels any measurement in progress and detaches the SHT3x from the bus,
+ * leaving any other sensor on it in use.
+ */
+void sht3x_async_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHT3X_ASYNC_H */
@@ -52,7 +52,6 @@ static const uint8_t SCD30_I2C_ADDRESS = 0x61;
 #define SCD30_CMD_AUTO_SELF_CALIBRATION 0x5306
 #define SCD30_CMD_READ_SERIAL 0xD033
 #define SCD30_SERIAL_NUM_WORDS 16
-#define SCD30_WRITE_DELAY_US 20000
 
 #define SCD30_MAX_BUFFER_WORDS 24
 #define SCD30_CMD_SINGLE_WORD_BUF_LEN                                          \
@@ -100,17 +99,22 @@ int16_t scd30_read_measurement(float *co2_ppm, float *temperature,
 int16_t scd30_set_measurement_interval(uint16_t interval_sec) {
     int16_t ret;
 
+    ret = scd30_set_measurement_interval_nowait(interval_sec);
+    if (ret == STATUS_OK)
+        sensirion_sleep_usec(SCD30_WRITE_DELAY_US);
+
+    return ret;
+}
+
+int16_t scd30_set_measurement_interval_nowait(uint16_t interval_sec) {
     if (interval_sec < 2 || interval_sec > 1800) {
         /* out of allowable range */
         return STATUS_FAIL;
     }
 
-    ret = sensirion_i2c_write_cmd_with_args(
+    return sensirion_i2c_write_cmd_with_args(
         SCD30_I2C_ADDRESS, SCD30_CMD_SET_MEASUREMENT_INTERVAL, &interval_sec,
         SENSIRION_NUM_WORDS(interval_sec));
-    sensirion_sleep_usec(SCD30_WRITE_DELAY_US);
-
-    return ret;
 }
 
 int16_t scd30_get_data_ready(uint16_t *data_ready) {
@@ -157,16 +161,21 @@ int16_t scd30_get_automatic_self_calibration(uint8_t *asc_enabled) {
 
 int16_t scd30_enable_automatic_self_calibration(uint8_t enable_asc) {
     int16_t ret;
-    uint16_t asc = !!enable_asc;
 
-    ret = sensirion_i2c_write_cmd_with_args(SCD30_I2C_ADDRESS,
-                                            SCD30_CMD_AUTO_SELF_CALIBRATION,
-                                            &asc, SENSIRION_NUM_WORDS(asc));
+    ret = scd30_enable_automatic_self_calibration_nowait(enable_asc);
     sensirion_sleep_usec(SCD30_WRITE_DELAY_US);
 
     return ret;
 }
 
+int16_t scd30_enable_automatic_self_calibration_nowait(uint8_t enable_asc) {
+    uint16_t asc = !!enable_asc;
+
+    return sensirion_i2c_write_cmd_with_args(SCD30_I2C_ADDRESS,
+                                             SCD30_CMD_AUTO_SELF_CALIBRATION,
+                                             &asc, SENSIRION_NUM_WORDS(asc));
+}
+
 int16_t scd30_set_forced_recalibration(uint16_t co2_ppm) {
     int16_t ret;
 
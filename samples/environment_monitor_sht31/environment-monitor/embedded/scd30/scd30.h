@@ -44,6 +44,9 @@
 extern "C" {
 #endif
 
+/* time the sensor needs after a write before it takes the next command */
+#define SCD30_WRITE_DELAY_US 20000
+
 /**
  * scd30_probe() - check if the SCD sensor is available and initialize it
  *
@@ -127,6 +130,19 @@ int16_t scd30_read_measurement(float *co2_ppm, float *temperature,
  */
 int16_t scd30_set_measurement_interval(uint16_t interval_sec);
 
+/**
+ * scd30_set_measurement_interval_nowait() - Same as
+ * scd30_set_measurement_interval() but returns without waiting for the sensor
+ * to process the command. The caller must allow SCD30_WRITE_DELAY_US before
+ * sending the next command.
+ *
+ * @param interval_sec  The measurement interval in seconds. The allowable range
+ *                      is 2-1800s
+ *
+ * @return              0 if the command was successful, an error code otherwise
+ */
+int16_t scd30_set_measurement_interval_nowait(uint16_t interval_sec);
+
 /**
  * scd30_get_data_ready() - Get data ready status
  *
@@ -215,6 +231,18 @@ int16_t scd30_get_automatic_self_calibration(uint8_t *asc_enabled);
  */
 int16_t scd30_enable_automatic_self_calibration(uint8_t enable_asc);
 
+/**
+ * scd30_enable_automatic_self_calibration_nowait() - Same as
+ * scd30_enable_automatic_self_calibration() but returns without waiting for
+ * the sensor to process the command. The caller must allow
+ * SCD30_WRITE_DELAY_US before sending the next command.
+ *
+ * @param enable_asc    enable ASC if non-zero, disable otherwise
+ *
+ * @return              0 if the command was successful, an error code otherwise
+ */
+int16_t scd30_enable_automatic_self_calibration_nowait(uint8_t enable_asc);
+
 /**
  * scd30_set_forced_recalibration() - Forcibly recalibrate the sensor to a known
  * value.
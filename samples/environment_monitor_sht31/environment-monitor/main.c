@@ -34,7 +34,7 @@
 #include <stdio.h>
 #include <time.h>
 
-#include "./embedded/sht31/sht3x.h"
+#include "./embedded/sht31/sht3x_async.h"
 
 #define JSON_MESSAGE_BYTES 256 // Number of bytes to allocate for the JSON telemetry message for IoT Central
 
@@ -194,39 +194,46 @@ static void TemperatureAlertHandler(EventLoopTimer* eventLoopTimer)
 
 
 /// <summary>
-/// Read sensor and send to Azure IoT
+/// Called on the event loop when the SHT31 measurement has been read, sends it to Azure IoT
 /// </summary>
-static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
+static void MeasurementReady(int16_t status, int32_t int32_temperature, int32_t int32_humidity)
 {
 	static int msgId = 0;
-	int32_t int32_temperature, int32_humidity;
 
+	if (status != STATUS_OK) { return; }
+
+	temperature = int32_temperature / 1000.0f;
+	humidity = int32_humidity / 1000.0f;
+
+	if (snprintf(msgBuffer, JSON_MESSAGE_BYTES, MsgTemplate, temperature, humidity, ++msgId) > 0)
+	{
+		Log_Debug("%s\n", msgBuffer);
+		lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
+	}
+
+	SetHvacStatusColour((int)temperature);
+
+	// If the previous temperature not equal to the new temperature then update ReportedTemperature device twin
+	if (previous_temperature != (int)temperature) {
+		lp_deviceTwinReportState(&actualTemperature, &temperature);
+	}
+	previous_temperature = (int)temperature;
+}
+
+/// <summary>
+/// Start an SHT31 measurement, MeasurementReady is called once it has been read
+/// </summary>
+static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
+{
 	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0)
 	{
 		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
 	}
 	else {
-		/* Measure temperature and relative humidity and store into variables
-		 * temperature, humidity (each output multiplied by 1000).
+		/* Measure temperature and relative humidity, MeasurementReady gets
+		 * them each multiplied by 1000.
 		 */
-		int16_t ret = sht3x_measure_blocking_read(&int32_temperature, &int32_humidity);
-
-		temperature = int32_temperature / 1000.0f;
-		humidity = int32_humidity / 1000.0f;
-
-		if (ret == STATUS_OK && snprintf(msgBuffer, JSON_MESSAGE_BYTES, MsgTemplate, temperature, humidity, ++msgId) > 0)
-		{
-			Log_Debug("%s\n", msgBuffer);
-			lp_azureMsgSendWithProperties(msgBuffer, telemetryMessageProperties, NELEMS(telemetryMessageProperties));
-		}
-
-		SetHvacStatusColour((int)temperature);
-
-		// If the previous temperature not equal to the new temperature then update ReportedTemperature device twin
-		if (previous_temperature != (int)temperature) {
-			lp_deviceTwinReportState(&actualTemperature, &temperature);
-		}
-		previous_temperature = (int)temperature;
+		sht3x_async_measure();
 	}
 }
 
@@ -241,28 +248,12 @@ static void DeviceTwinGenericHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding)
 	SetHvacStatusColour(previous_temperature);
 }
 
+/// <summary>
+/// Probe the SHT31, driven by the event loop
+/// </summary>
 static bool InitializeSht31(void)
 {
-	uint16_t interval_in_seconds = 2;
-	int retry = 0;
-
-	sensirion_i2c_init();
-
-	while (sht3x_probe() != STATUS_OK && ++retry < 5) {
-		Log_Debug("SHT sensor probing failed\n");
-		sensirion_sleep_usec(1000000u);
-	}
-
-	if (retry < 5) {
-		Log_Debug("SHT sensor probing successful\n");
-	}
-	else {
-		Log_Debug("SHT sensor probing failed\n");
-	}
-
-	sensirion_sleep_usec(interval_in_seconds * 1000000u);	// sleep for good luck
-
-	return true;
+	return sht3x_async_start(MeasurementReady);
 }
 
 /// <summary>
@@ -291,6 +282,7 @@ static void ClosePeripheralGpiosAndHandlers(void)
 	Log_Debug("Closing file descriptors\n");
 
 	lp_timerSetStop(timerSet, NELEMS(timerSet));
+	sht3x_async_stop();
 
 	lp_azureToDeviceStop();
 
@@ -5,6 +5,9 @@
 #include "../applibs_versions.h"
 #include <applibs/uart.h>
 
+// GroveUART_Read fails if no data arrives for this long. Reads still block the calling thread,
+// run them on the worker pool (worker_pool.h) to keep the event loop responsive
+#define GROVE_UART_READ_TIMEOUT_MS 500
 
 int GroveUART_Open(UART_Id id, uint32_t baudRate);
 void GroveUART_Write(int fd, const uint8_t* data, int dataSize);